@@ -0,0 +1,107 @@
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local bool t_countAllocations = false;
+uint64_t g_allocations = 0;
+
+} // namespace
+
+namespace bench {
+
+void countAllocations(bool enabled)
+{
+    t_countAllocations = enabled;
+}
+
+void resetAllocationCount()
+{
+    g_allocations = 0;
+}
+
+uint64_t allocationCount()
+{
+    return g_allocations;
+}
+
+} // namespace bench
+
+// Every replaceable form is routed through the two counting functions
+// below, so each new pairs with the matching delete. They live in their own
+// translation unit so they are never inlined into callers.
+
+void* operator new(size_t size)
+{
+    if (t_countAllocations) {
+        ++g_allocations;
+    }
+    if (void* pointer = std::malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    if (t_countAllocations) {
+        ++g_allocations;
+    }
+    size_t align = static_cast<size_t>(alignment);
+    if (void* pointer = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return ::operator new(size);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    return ::operator new(size, alignment);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    ::operator delete(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t alignment) noexcept
+{
+    ::operator delete(pointer, alignment);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    ::operator delete(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t alignment) noexcept
+{
+    ::operator delete(pointer, alignment);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+    ::operator delete(pointer);
+}
+
+void operator delete[](void* pointer, size_t, std::align_val_t alignment) noexcept
+{
+    ::operator delete(pointer, alignment);
+}
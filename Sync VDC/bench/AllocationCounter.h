@@ -0,0 +1,31 @@
+#ifndef WT13106_BENCH_ALLOCATION_COUNTER_H
+#define WT13106_BENCH_ALLOCATION_COUNTER_H
+
+/**
+ * @file AllocationCounter.h
+ * @brief Count heap allocations made on one thread (replaces global operator new/delete)
+ *
+ * Linking AllocationCounter.cpp into a benchmark replaces every form of
+ * operator new and delete with malloc-based versions that count the
+ * allocations of threads that turned counting on.
+ */
+
+#include <cstdint>
+
+namespace bench {
+
+/**
+ * @brief Turn counting on or off for the calling thread
+ */
+void countAllocations(bool enabled);
+
+void resetAllocationCount();
+
+/**
+ * @brief Allocations counted since the last reset (read it from the counting thread)
+ */
+uint64_t allocationCount();
+
+} // namespace bench
+
+#endif // WT13106_BENCH_ALLOCATION_COUNTER_H
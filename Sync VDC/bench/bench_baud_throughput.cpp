@@ -0,0 +1,210 @@
+/**
+ * @file bench_baud_throughput.cpp
+ * @brief Serial throughput at each baud rate, over a pseudo-terminal or a real port
+ *
+ * For every rate the benchmark connects with "BT:<port>@<rate>" (exercising
+ * the standard Bxxx mapping and the termios2/BOTHER path for non-standard
+ * rates), pushes a fixed payload through the port and reports bytes/s.
+ *
+ * Pseudo-terminals accept any rate but do not pace data, so the pty numbers
+ * show the software ceiling of the receive path. To measure the wire, connect
+ * TX to RX on a USB-serial adapter and pass --loopback /dev/ttyUSB0.
+ *
+ * Usage: bench_baud_throughput [--loopback <port>] [--bytes <n>] [rate...]
+ */
+
+#include "../include/WT13106Connection.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <pty.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Result {
+    bool ok;
+    size_t bytes;
+    double seconds;
+    std::string error;
+};
+
+// Writes the payload through the pty master while the connection reads the slave
+Result runPty(uint32_t rate, size_t totalBytes)
+{
+    int master = -1;
+    int slave = -1;
+    char slaveName[128];
+    if (openpty(&master, &slave, slaveName, nullptr, nullptr) != 0) {
+        return {false, 0, 0, "openpty failed"};
+    }
+
+    WT13106Connection conn(std::string("BT:") + slaveName + "@" + std::to_string(rate));
+    if (!conn.connect()) {
+        close(slave);
+        close(master);
+        return {false, 0, 0, conn.getLastError()};
+    }
+
+    std::vector<uint8_t> payload(4096);
+    for (size_t i = 0; i < payload.size(); ++i) {
+        payload[i] = static_cast<uint8_t>(i);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread writer([&] {
+        size_t sent = 0;
+        while (sent < totalBytes) {
+            size_t chunk = std::min(payload.size(), totalBytes - sent);
+            ssize_t n = write(master, payload.data(), chunk);
+            if (n <= 0) {
+                break;
+            }
+            sent += static_cast<size_t>(n);
+        }
+    });
+
+    std::vector<uint8_t> buffer(64 * 1024);
+    size_t received = 0;
+    while (received < totalBytes) {
+        size_t n = conn.receiveInto(buffer.data(), buffer.size(), 1000);
+        if (n == 0) {
+            break;
+        }
+        received += n;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    writer.join();
+    conn.disconnect();
+    close(slave);
+    close(master);
+
+    return {received == totalBytes, received,
+            std::chrono::duration<double>(end - start).count(),
+            received == totalBytes ? "" : "short read"};
+}
+
+// Sends through a real port whose TX is wired to its own RX
+Result runLoopback(const std::string& port, uint32_t rate, size_t totalBytes)
+{
+    WT13106Connection conn("BT:" + port + "@" + std::to_string(rate));
+    if (!conn.connect()) {
+        return {false, 0, 0, conn.getLastError()};
+    }
+
+    // Allow roughly twice the theoretical wire time (10 bits per byte)
+    uint32_t timeoutMs = static_cast<uint32_t>(totalBytes * 10ull * 2000 / rate) + 1000;
+
+    std::vector<uint8_t> payload(totalBytes);
+    for (size_t i = 0; i < payload.size(); ++i) {
+        payload[i] = static_cast<uint8_t>(i * 31);
+    }
+    std::vector<uint8_t> buffer(totalBytes);
+
+    auto start = std::chrono::steady_clock::now();
+    size_t received = 0;
+    std::thread reader([&] {
+        received = conn.receiveExact(buffer.data(), buffer.size(), timeoutMs);
+    });
+
+    size_t sent = 0;
+    while (sent < totalBytes) {
+        size_t chunk = std::min<size_t>(256, totalBytes - sent);
+        if (!conn.sendCommand(payload.data() + sent, chunk)) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            continue;
+        }
+        sent += chunk;
+    }
+    reader.join();
+    auto end = std::chrono::steady_clock::now();
+    conn.disconnect();
+
+    bool intact = received == totalBytes && buffer == payload;
+    return {intact, received, std::chrono::duration<double>(end - start).count(),
+            intact ? "" : "short or corrupted read"};
+}
+
+/**
+ * @brief Parse a positive decimal number that fits in max
+ */
+bool parsePositive(const char* text, unsigned long long max, unsigned long long& value)
+{
+    if (*text < '0' || *text > '9') {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    value = std::strtoull(text, &end, 10);
+    return *end == '\0' && errno == 0 && value > 0 && value <= max;
+}
+
+int usage(const char* program)
+{
+    std::fprintf(stderr, "Usage: %s [--loopback <port>] [--bytes <n>] [rate...]\n", program);
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::string loopbackPort;
+    size_t totalBytes = 0;
+    std::vector<uint32_t> rates;
+
+    for (int i = 1; i < argc; ++i) {
+        unsigned long long value = 0;
+        if (std::strcmp(argv[i], "--loopback") == 0 && i + 1 < argc) {
+            loopbackPort = argv[++i];
+        } else if (std::strcmp(argv[i], "--bytes") == 0 && i + 1 < argc) {
+            if (!parsePositive(argv[++i], std::numeric_limits<size_t>::max(), value)) {
+                std::fprintf(stderr, "--bytes must be a positive number, not '%s'\n", argv[i]);
+                return 1;
+            }
+            totalBytes = static_cast<size_t>(value);
+        } else if (argv[i][0] == '-') {
+            return usage(argv[0]);
+        } else {
+            if (!parsePositive(argv[i], std::numeric_limits<uint32_t>::max(), value)) {
+                std::fprintf(stderr, "Invalid baud rate '%s'\n", argv[i]);
+                return usage(argv[0]);
+            }
+            rates.push_back(static_cast<uint32_t>(value));
+        }
+    }
+
+    if (rates.empty()) {
+        // Standard rates plus non-standard ones that need termios2/BOTHER
+        rates = {9600, 115200, 230400, 250000, 460800, 921600, 1000000, 1234567, 2000000, 3000000};
+    }
+    if (totalBytes == 0) {
+        totalBytes = loopbackPort.empty() ? 16 * 1024 * 1024 : 64 * 1024;
+    }
+
+    std::printf("%-10s %12s %14s %14s  %s\n", "baud", "bytes", "bytes/s", "wire bytes/s", "mode");
+    for (uint32_t rate : rates) {
+        Result r = loopbackPort.empty() ? runPty(rate, totalBytes)
+                                        : runLoopback(loopbackPort, rate, totalBytes);
+        if (!r.ok) {
+            std::printf("%-10u %12zu %14s %14s  error: %s\n", rate, r.bytes, "-", "-", r.error.c_str());
+            continue;
+        }
+
+        double bytesPerSecond = r.bytes / r.seconds;
+        double wireBytesPerSecond = rate / 10.0;  // 8N1: 10 bits per byte
+        std::printf("%-10u %12zu %14.0f %14.0f  %s\n", rate, r.bytes, bytesPerSecond,
+                    wireBytesPerSecond, loopbackPort.empty() ? "pty (unpaced)" : "loopback");
+    }
+
+    return 0;
+}
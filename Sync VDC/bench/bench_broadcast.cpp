@@ -0,0 +1,286 @@
+/**
+ * @file bench_broadcast.cpp
+ * @brief Fanning one event stream out to several consumers
+ *
+ * fan-out    One producer publishes N events in batches of 64 to K
+ *            consumers. copy: the old way, one SpscRingBuffer per consumer
+ *            and the producer pushes every batch into each of them.
+ *            broadcast: one BroadcastRing, every consumer a BLOCK
+ *            subscriber reading in place. Both sides poll and yield, so on
+ *            a single core the numbers include the scheduling of K + 1
+ *            threads.
+ * slow       Three fast subscribers and one that sleeps 1 ms every 256
+ *            events, once per SlowSubscriberPolicy: what the slow one costs
+ *            the producer and what it loses.
+ *
+ * Usage: bench_broadcast [--events N] [--capacity N]
+ */
+
+#include "../include/BroadcastRing.h"
+#include "../include/SpscRingBuffer.h"
+#include "../include/StylusEvent.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    size_t events = 2000000;
+    size_t capacity = 4096;
+};
+
+const size_t kBatch = 64;
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+StylusEvent makeEvent(size_t i)
+{
+    StylusEvent event = {};
+    event.timestampNs = i;
+    event.x = static_cast<uint16_t>(i);
+    event.pressure = 512;
+    event.flags = STYLUS_TIP_DOWN | STYLUS_IN_RANGE;
+    return event;
+}
+
+/**
+ * @brief Order check a consumer applies to what it receives
+ */
+struct Checker {
+    uint64_t next = 0;
+    uint64_t count = 0;
+    bool inOrder = true;
+
+    void take(const StylusEvent* events, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i) {
+            inOrder = inOrder && events[i].timestampNs == next;
+            next = events[i].timestampNs + 1;
+        }
+        count += n;
+    }
+};
+
+double runCopy(size_t consumers, const Options& options, bool& ok)
+{
+    std::vector<std::unique_ptr<SpscRingBuffer<StylusEvent>>> queues;
+    for (size_t i = 0; i < consumers; ++i) {
+        queues.emplace_back(new SpscRingBuffer<StylusEvent>(options.capacity));
+    }
+    std::vector<Checker> checkers(consumers);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < consumers; ++i) {
+        threads.emplace_back([&, i]() {
+            StylusEvent local[kBatch];
+            while (checkers[i].count < options.events) {
+                size_t n = queues[i]->pop(local, kBatch);
+                if (n == 0) {
+                    std::this_thread::yield();
+                }
+                checkers[i].take(local, n);
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    StylusEvent batch[kBatch];
+    for (size_t sent = 0; sent < options.events; sent += kBatch) {
+        size_t n = std::min(kBatch, options.events - sent);
+        for (size_t j = 0; j < n; ++j) {
+            batch[j] = makeEvent(sent + j);
+        }
+        for (auto& queue : queues) {
+            size_t pushed = 0;
+            while (pushed < n) {
+                size_t m = queue->push(batch + pushed, n - pushed);
+                if (m == 0) {
+                    std::this_thread::yield();
+                }
+                pushed += m;
+            }
+        }
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = secondsSince(start);
+    for (const Checker& checker : checkers) {
+        ok = ok && checker.inOrder;
+    }
+    return double(options.events) / seconds;
+}
+
+double runBroadcast(size_t consumers, const Options& options, bool& ok)
+{
+    BroadcastRing<StylusEvent> ring(options.capacity);
+    std::vector<int> ids;
+    for (size_t i = 0; i < consumers; ++i) {
+        ids.push_back(ring.subscribe(SlowSubscriberPolicy::BLOCK));
+    }
+    std::vector<Checker> checkers(consumers);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < consumers; ++i) {
+        threads.emplace_back([&, i]() {
+            Checker& checker = checkers[i];
+            while (checker.count < options.events) {
+                BroadcastRead read = ring.consume(ids[i], [&checker](const StylusEvent* events, size_t n, uint64_t) {
+                    checker.take(events, n);
+                });
+                if (read.count == 0) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t sent = 0; sent < options.events;) {
+        StylusEvent* slots = nullptr;
+        size_t n = ring.claim(slots, std::min(kBatch, options.events - sent),
+                              BroadcastRing<StylusEvent>::Deadline::max());
+        for (size_t j = 0; j < n; ++j) {
+            slots[j] = makeEvent(sent + j);
+        }
+        ring.commit(n);
+        sent += n;
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = secondsSince(start);
+    for (const Checker& checker : checkers) {
+        ok = ok && checker.inOrder;
+    }
+    return double(options.events) / seconds;
+}
+
+const char* policyName(SlowSubscriberPolicy policy)
+{
+    switch (policy) {
+        case SlowSubscriberPolicy::BLOCK:
+            return "block";
+        case SlowSubscriberPolicy::SKIP:
+            return "skip";
+        case SlowSubscriberPolicy::SNAPSHOT:
+            return "snapshot";
+    }
+    return "?";
+}
+
+void runSlow(SlowSubscriberPolicy policy, const Options& options)
+{
+    // The slow subscriber needs about events / 256 ms; keep BLOCK bounded
+    const size_t events = std::min<size_t>(options.events, 200000);
+    BroadcastRing<StylusEvent> ring(options.capacity);
+    std::vector<int> ids;
+    for (int i = 0; i < 3; ++i) {
+        ids.push_back(ring.subscribe(SlowSubscriberPolicy::BLOCK));
+    }
+    int slowId = ring.subscribe(policy);
+
+    std::vector<std::thread> threads;
+    for (int id : ids) {
+        threads.emplace_back([&ring, id]() {
+            for (;;) {
+                BroadcastRead read = ring.consumeWait(id, [](const StylusEvent*, size_t, uint64_t) {}, 100);
+                if (read.closed) {
+                    break;
+                }
+            }
+        });
+    }
+    uint64_t resyncs = 0;
+    threads.emplace_back([&ring, &resyncs, slowId]() {
+        size_t sinceSleep = 0;
+        for (;;) {
+            BroadcastRead read = ring.consumeWait(slowId, [](const StylusEvent*, size_t, uint64_t) {}, 100, kBatch);
+            resyncs += read.resync ? 1 : 0;
+            if (read.closed) {
+                break;
+            }
+            sinceSleep += read.count;
+            if (sinceSleep >= 256) {
+                sinceSleep = 0;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    StylusEvent batch[kBatch];
+    for (size_t sent = 0; sent < events; sent += kBatch) {
+        size_t n = std::min(kBatch, events - sent);
+        for (size_t j = 0; j < n; ++j) {
+            batch[j] = makeEvent(sent + j);
+        }
+        ring.publish(batch, n);
+    }
+    double seconds = secondsSince(start);
+    ring.close();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    BroadcastSubscriberStats slow = ring.stats(slowId);
+    std::printf("%-9s  producer %10.0f events/s  slow subscriber: received %7llu  lost %7llu  "
+                "overruns %5llu  stalls %5llu  resyncs %llu\n",
+                policyName(policy), double(events) / seconds,
+                static_cast<unsigned long long>(slow.received), static_cast<unsigned long long>(slow.lost),
+                static_cast<unsigned long long>(slow.overruns), static_cast<unsigned long long>(slow.stalls),
+                static_cast<unsigned long long>(resyncs));
+    std::fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--events" && i + 1 < argc) {
+            options.events = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--capacity" && i + 1 < argc) {
+            options.capacity = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            std::fprintf(stderr, "Usage: %s [--events N] [--capacity N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (options.events == 0 || options.capacity < kBatch) {
+        std::fprintf(stderr, "--events must be positive and --capacity at least %zu\n", kBatch);
+        return 1;
+    }
+
+    bool ok = true;
+    std::printf("fan-out: %zu events, batches of %zu, ring of %zu\n", options.events, kBatch, options.capacity);
+    std::printf("consumers       copy events/s  broadcast events/s  bytes written/event (copy / broadcast)\n");
+    for (size_t consumers : {1, 2, 4, 8}) {
+        double copy = runCopy(consumers, options, ok);
+        double broadcast = runBroadcast(consumers, options, ok);
+        std::printf("%9zu  %17.0f  %18.0f  %14zu / %zu\n", consumers, copy, broadcast,
+                    consumers * sizeof(StylusEvent), sizeof(StylusEvent));
+        std::fflush(stdout);
+    }
+
+    std::printf("\nslow subscriber (3 fast BLOCK subscribers + 1 sleeping 1 ms per 256 events)\n");
+    runSlow(SlowSubscriberPolicy::BLOCK, options);
+    runSlow(SlowSubscriberPolicy::SKIP, options);
+    runSlow(SlowSubscriberPolicy::SNAPSHOT, options);
+
+    if (!ok) {
+        std::fprintf(stderr, "events arrived out of order\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file bench_canvas.cpp
+ * @brief Event-to-pixels latency of the incremental Canvas
+ *
+ * Replays synthetic handwriting into a Canvas one receive batch at a time.
+ * After each batch the dirty rectangles are taken and copied out, as a
+ * display would upload them. Reports the latency distribution of that
+ * update and how many pixels it moved, next to the cost of copying the whole
+ * canvas every time.
+ *
+ * Usage: bench_canvas [--width W] [--height H] [--batch N] [--events N]
+ */
+
+#include "../include/Canvas.h"
+#include "../include/ConnectionMetrics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+uint64_t nowNs()
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+std::vector<StylusEvent> makeHandwriting(size_t count)
+{
+    std::vector<StylusEvent> events;
+    events.reserve(count);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    double x = 10000;
+    double y = 7500;
+    while (events.size() < count) {
+        size_t strokeLength = 30 + static_cast<size_t>(unit(rng) * 300);
+        double heading = unit(rng) * 6.283;
+        double turn = (unit(rng) - 0.5) * 0.2;
+        double speed = 10.0 + unit(rng) * 30.0;  // Device units per 5 ms sample
+        for (size_t i = 0; i < strokeLength && events.size() + 1 < count; ++i) {
+            if (unit(rng) < 0.03) {
+                turn = (unit(rng) - 0.5) * 0.4;
+            }
+            heading += turn;
+            x = std::min(std::max(x + speed * std::cos(heading), 200.0), 19800.0);
+            y = std::min(std::max(y + speed * std::sin(heading), 200.0), 14800.0);
+            StylusEvent event = {};
+            event.x = static_cast<uint16_t>(x);
+            event.y = static_cast<uint16_t>(y);
+            event.pressure = static_cast<uint16_t>(200 + 600 * unit(rng));
+            event.flags = STYLUS_IN_RANGE | STYLUS_TIP_DOWN;
+            events.push_back(event);
+        }
+        StylusEvent up = {};
+        up.x = static_cast<uint16_t>(x);
+        up.y = static_cast<uint16_t>(y);
+        up.flags = STYLUS_IN_RANGE;
+        events.push_back(up);
+    }
+    return events;
+}
+
+void printLatency(const char* label, const HistogramSnapshot& snapshot)
+{
+    std::printf("  %-22s p50 %6.1f us  p99 %6.1f us  p99.9 %6.1f us  max %6.1f us\n", label,
+                snapshot.valueAtPercentile(0.5) / 1000.0, snapshot.valueAtPercentile(0.99) / 1000.0,
+                snapshot.valueAtPercentile(0.999) / 1000.0, snapshot.max / 1000.0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    CanvasOptions options;
+    size_t batch = 1;
+    size_t eventCount = 200000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--width" && i + 1 < argc) {
+            options.width = std::atoi(argv[++i]);
+        } else if (arg == "--height" && i + 1 < argc) {
+            options.height = std::atoi(argv[++i]);
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batch = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--events" && i + 1 < argc) {
+            eventCount = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            std::fprintf(stderr, "Usage: %s [--width W] [--height H] [--batch N] [--events N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (options.width <= 0 || options.height <= 0 || batch == 0 || eventCount == 0) {
+        std::fprintf(stderr, "Sizes and counts must be positive\n");
+        return 1;
+    }
+
+    std::vector<StylusEvent> events = makeHandwriting(eventCount);
+    Canvas canvas(options);
+    std::vector<uint8_t> display(static_cast<size_t>(options.width) * options.height);
+    std::vector<CanvasRect> dirty;
+    LatencyHistogram incremental;
+    LatencyHistogram fullFrame;
+    uint64_t updates = 0;
+    uint64_t rectangles = 0;
+    uint64_t pixelsCopied = 0;
+
+    for (size_t offset = 0; offset < events.size(); offset += batch) {
+        size_t count = std::min(batch, events.size() - offset);
+        uint64_t start = nowNs();
+        canvas.addEvents(events.data() + offset, count);
+        dirty.clear();
+        canvas.takeDirtyRects(dirty);
+        for (const CanvasRect& rect : dirty) {
+            canvas.copyRect(rect, display.data() + static_cast<size_t>(rect.y) * options.width + rect.x,
+                            static_cast<size_t>(options.width));
+            pixelsCopied += static_cast<uint64_t>(rect.width) * rect.height;
+        }
+        incremental.record(nowNs() - start);
+        rectangles += dirty.size();
+        ++updates;
+
+        // Baseline: hand the whole canvas to the display on every update
+        if (updates % 16 == 0) {
+            uint64_t fullStart = nowNs();
+            canvas.copyRect(CanvasRect{0, 0, options.width, options.height}, display.data(),
+                            static_cast<size_t>(options.width));
+            fullFrame.record(nowNs() - fullStart);
+        }
+    }
+
+    uint64_t checksum = 0;
+    for (uint8_t value : display) {
+        checksum += value;
+    }
+    double canvasPixels = static_cast<double>(options.width) * options.height;
+    std::printf("%dx%d canvas, %zu events, %zu per update (checksum %llu)\n", options.width, options.height,
+                events.size(), batch, static_cast<unsigned long long>(checksum));
+    printLatency("draw + dirty copy", incremental.snapshot());
+    printLatency("full canvas copy only", fullFrame.snapshot());
+    std::printf("  %.2f rectangles and %.0f pixels (%.3f%% of the canvas) per update\n",
+                static_cast<double>(rectangles) / updates, static_cast<double>(pixelsCopied) / updates,
+                100.0 * pixelsCopied / updates / canvasPixels);
+    return 0;
+}
@@ -0,0 +1,313 @@
+/**
+ * @file bench_connection_manager.cpp
+ * @brief CPU cost per device as the number of connections grows
+ *
+ * Opens N pseudo-terminals, connects a WT13106Connection to each slave and
+ * feeds pen frames into every master from one writer thread at a fixed rate
+ * per device. The receive side is either a ConnectionManager (default) or the
+ * old one-thread-per-board model (--threads), where every connection has its
+ * own thread blocking in receiveEvents().
+ *
+ * --engine picks the manager's I/O engine: epoll (default), io_uring, or
+ * both to run every N with each. For the manager, the system calls its loop
+ * threads make are reported per second.
+ *
+ * Reported CPU is process CPU minus the writer thread's own CPU, i.e. what it
+ * costs to receive and decode.
+ *
+ * Usage: bench_connection_manager [--threads] [--engine epoll|io_uring|both] [--loops N]
+ *                                 [--rate HZ] [--seconds S] [N ...]
+ *   defaults: 1 loop, 500 Hz per device, 2 s, N = 1 8 64 256
+ */
+
+#include "../include/ConnectionManager.h"
+#include "../include/WT13106Connection.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <pty.h>
+#include <string>
+#include <sys/resource.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Options {
+    bool threadPerDevice = false;
+    std::vector<IoEngine> engines;
+    size_t loops = 1;
+    double rateHz = 500.0;
+    double seconds = 2.0;
+};
+
+double cpuSeconds(int who)
+{
+    struct rusage usage;
+    getrusage(who, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+void raiseFileLimit()
+{
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+struct Device {
+    int masterFd = -1;
+    std::unique_ptr<WT13106Connection> connection;
+    std::atomic<uint64_t> received{0};
+    std::thread reader;  // --threads mode only
+};
+
+const char* engineName(IoEngine engine)
+{
+    return engine == IoEngine::IO_URING ? "io_uring" : "epoll";
+}
+
+bool runOnce(size_t deviceCount, IoEngine engine, const Options& options)
+{
+    std::vector<std::unique_ptr<Device>> devices;
+    for (size_t i = 0; i < deviceCount; ++i) {
+        std::unique_ptr<Device> device(new Device());
+        int slaveFd = -1;
+        char name[64];
+        struct termios raw;
+        cfmakeraw(&raw);
+        if (openpty(&device->masterFd, &slaveFd, name, &raw, nullptr) != 0) {
+            std::fprintf(stderr, "openpty failed at device %zu: %s\n", i, std::strerror(errno));
+            return false;
+        }
+
+        device->connection.reset(new WT13106Connection(std::string("BT:") + name));
+        bool connected = device->connection->connect();
+        close(slaveFd);
+        if (!connected) {
+            std::fprintf(stderr, "connect %s: %s\n", name, device->connection->getLastError().c_str());
+            return false;
+        }
+        devices.push_back(std::move(device));
+    }
+
+    std::atomic<bool> stopReaders(false);
+    ConnectionManagerOptions managerOptions;
+    managerOptions.loopCount = options.loops;
+    managerOptions.ioEngine = engine;
+    ConnectionManager manager(managerOptions);
+
+    if (options.threadPerDevice) {
+        for (auto& device : devices) {
+            Device* raw = device.get();
+            device->reader = std::thread([raw, &stopReaders] {
+                StylusEvent events[256];
+                while (!stopReaders) {
+                    raw->received += raw->connection->receiveEvents(events, 256, 50);
+                }
+            });
+        }
+    } else {
+        if (!manager.start()) {
+            std::fprintf(stderr, "ConnectionManager: %s\n", manager.getLastError().c_str());
+            return false;
+        }
+        if (manager.activeIoEngine() != engine) {
+            std::fprintf(stderr, "%s\n", manager.getLastError().c_str());
+        }
+        for (auto& device : devices) {
+            Device* raw = device.get();
+            DeviceHandlers handlers;
+            handlers.onEvents = [raw](int, const StylusEvent*, size_t count) {
+                raw->received.fetch_add(count, std::memory_order_relaxed);
+            };
+            if (manager.addConnection(*device->connection, handlers) < 0) {
+                std::fprintf(stderr, "addConnection: %s\n", manager.getLastError().c_str());
+                return false;
+            }
+        }
+    }
+
+    // Writer: one pen frame per device per tick
+    const auto tick = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / options.rateHz));
+    const uint64_t ticks = static_cast<uint64_t>(options.rateHz * options.seconds);
+    double writerCpu = 0;
+    uint64_t sent = 0;
+
+    double cpuStart = cpuSeconds(RUSAGE_SELF);
+    auto wallStart = std::chrono::steady_clock::now();
+    ConnectionManagerStats statsStart = manager.getStats();
+
+    std::thread writer([&] {
+        double threadStart = cpuSeconds(RUSAGE_THREAD);
+        uint8_t frame[PEN_FRAME_SIZE];
+        StylusEvent event = {};
+        event.flags = STYLUS_IN_RANGE | STYLUS_TIP_DOWN;
+        auto next = std::chrono::steady_clock::now();
+        for (uint64_t t = 0; t < ticks; ++t) {
+            event.x = static_cast<uint16_t>(t);
+            event.sequence = static_cast<uint8_t>(t);
+            encodePenFrame(event, frame);
+            for (auto& device : devices) {
+                if (write(device->masterFd, frame, sizeof(frame)) == static_cast<ssize_t>(sizeof(frame))) {
+                    sent++;
+                }
+            }
+            next += tick;
+            std::this_thread::sleep_until(next);
+        }
+        writerCpu = cpuSeconds(RUSAGE_THREAD) - threadStart;
+    });
+    writer.join();
+
+    // Let the receivers drain what is still in flight
+    auto drainDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    for (;;) {
+        uint64_t received = 0;
+        for (auto& device : devices) {
+            received += device->received.load(std::memory_order_relaxed);
+        }
+        if (received >= sent || std::chrono::steady_clock::now() > drainDeadline) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    double receiveCpu = cpuSeconds(RUSAGE_SELF) - cpuStart - writerCpu;
+    uint64_t systemCalls = manager.getStats().systemCalls - statsStart.systemCalls;
+
+    stopReaders = true;
+    for (auto& device : devices) {
+        if (device->reader.joinable()) {
+            device->reader.join();
+        }
+    }
+    manager.stop();
+
+    uint64_t received = 0;
+    for (auto& device : devices) {
+        received += device->received.load();
+        device->connection->disconnect();
+        close(device->masterFd);
+    }
+
+    char systemCallRate[32] = "-";
+    if (!options.threadPerDevice) {
+        std::snprintf(systemCallRate, sizeof(systemCallRate), "%.0f", systemCalls / wall);
+    }
+    std::printf("%-9s %8zu %10llu %10llu %10.2f %14.2f %14.3f %12s%s\n",
+                options.threadPerDevice ? "threads" : engineName(manager.activeIoEngine()), deviceCount,
+                static_cast<unsigned long long>(sent), static_cast<unsigned long long>(received),
+                100.0 * receiveCpu / wall,
+                received ? 1e9 * receiveCpu / received : 0.0,
+                100.0 * receiveCpu / wall / deviceCount,
+                systemCallRate,
+                received == sent ? "" : "  (events lost)");
+    return received == sent;
+}
+
+/**
+ * @brief Parse a positive decimal count
+ */
+bool parseCount(const char* text, size_t& value)
+{
+    if (*text < '0' || *text > '9') {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long parsed = std::strtoull(text, &end, 10);
+    value = static_cast<size_t>(parsed);
+    return *end == '\0' && errno == 0 && parsed > 0 && parsed <= std::numeric_limits<size_t>::max();
+}
+
+int usage(const char* program)
+{
+    std::fprintf(stderr, "Usage: %s [--threads] [--engine epoll|io_uring|both] [--loops N]"
+                 " [--rate HZ] [--seconds S] [N ...]\n", program);
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    std::vector<size_t> counts;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads") {
+            options.threadPerDevice = true;
+        } else if (arg == "--engine" && i + 1 < argc) {
+            std::string engine = argv[++i];
+            if (engine != "epoll" && engine != "io_uring" && engine != "both") {
+                std::fprintf(stderr, "Unknown engine: %s\n", engine.c_str());
+                return usage(argv[0]);
+            }
+            if (engine == "epoll" || engine == "both") {
+                options.engines.push_back(IoEngine::EPOLL);
+            }
+            if (engine == "io_uring" || engine == "both") {
+                options.engines.push_back(IoEngine::IO_URING);
+            }
+        } else if (arg == "--loops" && i + 1 < argc) {
+            if (!parseCount(argv[++i], options.loops)) {
+                std::fprintf(stderr, "--loops must be a positive number, not '%s'\n", argv[i]);
+                return 1;
+            }
+        } else if (arg == "--rate" && i + 1 < argc) {
+            options.rateHz = std::atof(argv[++i]);
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            options.seconds = std::atof(argv[++i]);
+        } else if (arg[0] == '-') {
+            return usage(argv[0]);
+        } else {
+            size_t count = 0;
+            if (!parseCount(argv[i], count)) {
+                std::fprintf(stderr, "Invalid connection count '%s'\n", argv[i]);
+                return usage(argv[0]);
+            }
+            counts.push_back(count);
+        }
+    }
+    if (counts.empty()) {
+        counts = {1, 8, 64, 256};
+    }
+    if (options.engines.empty() || options.threadPerDevice) {
+        options.engines = {IoEngine::EPOLL};
+    }
+    if (options.rateHz <= 0 || options.seconds <= 0) {
+        std::fprintf(stderr, "Rate and duration must be positive\n");
+        return 1;
+    }
+
+    raiseFileLimit();
+
+    std::printf("Receiver: %s, %.0f Hz per device, %.1f s\n",
+                options.threadPerDevice ? "one thread per device" : "ConnectionManager",
+                options.rateHz, options.seconds);
+    std::printf("%-9s %8s %10s %10s %10s %14s %14s %12s\n",
+                "engine", "devices", "sent", "received", "cpu %", "ns/event", "cpu %/device", "syscalls/s");
+
+    bool ok = true;
+    for (size_t count : counts) {
+        for (IoEngine engine : options.engines) {
+            ok = runOnce(count, engine, options) && ok;
+        }
+    }
+    return ok ? 0 : 1;
+}
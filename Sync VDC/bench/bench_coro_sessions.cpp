@@ -0,0 +1,175 @@
+/**
+ * @file bench_coro_sessions.cpp
+ * @brief Many coroutine device sessions on one EventLoop thread
+ *
+ * Starts N simulated boards and one session coroutine per board. Each session
+ * alternates co_await request() and co_await read() for the run time, and a
+ * second coroutine per board sends a command with co_await send() every few
+ * milliseconds. Reports requests and events per second and the number of
+ * heap allocations made on the loop thread per co_await after warm-up.
+ *
+ * Usage: bench_coro_sessions [--sessions N] [--rate HZ] [--seconds S]
+ */
+
+#include "../include/CoroEventLoop.h"
+#include "../include/WT13106Connection.h"
+#include "../include/WT13106Simulator.h"
+#include "AllocationCounter.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Stats {
+    uint64_t awaits = 0;
+    uint64_t requests = 0;
+    uint64_t failedRequests = 0;
+    uint64_t events = 0;
+    uint64_t sends = 0;
+    uint64_t roundTripNs = 0;
+};
+
+Task<void> readSession(AsyncConnection& connection, Stats& stats, std::chrono::steady_clock::time_point end)
+{
+    StylusEvent events[64];
+    while (std::chrono::steady_clock::now() < end) {
+        Response response = co_await connection.request(0x02, nullptr, 0);
+        ++stats.awaits;
+        if (response.ok()) {
+            ++stats.requests;
+            stats.roundTripNs += response.roundTripNs;
+        } else {
+            ++stats.failedRequests;
+        }
+
+        size_t count = co_await connection.read(events, 64);
+        ++stats.awaits;
+        if (count == 0) {
+            break;
+        }
+        stats.events += count;
+    }
+}
+
+Task<void> sendSession(EventLoop& loop, AsyncConnection& connection, Stats& stats,
+                       std::chrono::steady_clock::time_point end)
+{
+    uint8_t command[FRAME_MAX_SIZE];
+    const uint8_t payload[2] = {0x01, 0x02};
+    size_t length = encodeFrame(0x03, 0xFF, payload, sizeof(payload), command);
+    while (std::chrono::steady_clock::now() < end) {
+        co_await loop.sleepFor(std::chrono::milliseconds(5));
+        ++stats.awaits;
+        if (co_await connection.send(command, length)) {
+            ++stats.sends;
+        }
+        ++stats.awaits;
+    }
+}
+
+Task<void> startCounting(EventLoop& loop, Stats& stats, uint64_t& awaitsAtStart)
+{
+    // Let every session get through its first round (frame pool and queues warm up)
+    co_await loop.sleepFor(std::chrono::milliseconds(200));
+    awaitsAtStart = stats.awaits;
+    bench::resetAllocationCount();
+    bench::countAllocations(true);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t sessions = 100;
+    double rateHz = 200;
+    double seconds = 3;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--sessions" && i + 1 < argc) {
+            sessions = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--rate" && i + 1 < argc) {
+            rateHz = std::atof(argv[++i]);
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            seconds = std::atof(argv[++i]);
+        } else {
+            std::fprintf(stderr, "Usage: %s [--sessions N] [--rate HZ] [--seconds S]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (sessions == 0 || rateHz <= 0 || seconds <= 0) {
+        std::fprintf(stderr, "Sessions, rate and duration must be positive\n");
+        return 1;
+    }
+
+    SimulatorOptions simOptions;
+    simOptions.sampleRateHz = rateHz;
+
+    std::vector<std::unique_ptr<WT13106Simulator>> simulators;
+    std::vector<std::unique_ptr<WT13106Connection>> connections;
+    for (size_t i = 0; i < sessions; ++i) {
+        simulators.emplace_back(new WT13106Simulator());
+        if (!simulators.back()->start(simOptions)) {
+            std::fprintf(stderr, "simulator %zu: %s\n", i, simulators.back()->getLastError().c_str());
+            return 1;
+        }
+        connections.emplace_back(new WT13106Connection(simulators.back()->connectionString()));
+        if (!connections.back()->connect()) {
+            std::fprintf(stderr, "connect %zu: %s\n", i, connections.back()->getLastError().c_str());
+            return 1;
+        }
+    }
+
+    EventLoop loop;
+    std::vector<std::unique_ptr<AsyncConnection>> asyncConnections;
+    for (auto& connection : connections) {
+        asyncConnections.emplace_back(new AsyncConnection(loop, *connection));
+        if (!asyncConnections.back()->isAttached()) {
+            std::fprintf(stderr, "attach: %s\n", asyncConnections.back()->getLastError().c_str());
+            return 1;
+        }
+    }
+
+    Stats stats;
+    uint64_t awaitsAtStart = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(seconds));
+    for (auto& connection : asyncConnections) {
+        loop.spawn(readSession(*connection, stats, end));
+        loop.spawn(sendSession(loop, *connection, stats, end));
+    }
+    loop.spawn(startCounting(loop, stats, awaitsAtStart));
+    loop.run();
+    bench::countAllocations(false);
+    uint64_t allocations = bench::allocationCount();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t dropped = 0;
+    for (auto& connection : asyncConnections) {
+        dropped += connection->droppedEvents();
+    }
+    uint64_t countedAwaits = stats.awaits - awaitsAtStart;
+    std::printf("%zu sessions on one thread, %.1f s\n", sessions, elapsed);
+    std::printf("  requests  %.0f/s (%llu failed), mean round trip %.1f us\n", stats.requests / elapsed,
+                static_cast<unsigned long long>(stats.failedRequests),
+                stats.requests ? stats.roundTripNs / 1000.0 / stats.requests : 0.0);
+    std::printf("  events    %.0f/s (%llu dropped)\n", stats.events / elapsed, static_cast<unsigned long long>(dropped));
+    std::printf("  sends     %.0f/s\n", stats.sends / elapsed);
+    std::printf("  allocations after warm-up: %llu for %llu awaits (%.4f per await)\n",
+                static_cast<unsigned long long>(allocations), static_cast<unsigned long long>(countedAwaits),
+                countedAwaits ? static_cast<double>(allocations) / countedAwaits : 0.0);
+
+    asyncConnections.clear();
+    for (auto& connection : connections) {
+        connection->disconnect();
+    }
+    for (auto& simulator : simulators) {
+        simulator->stop();
+    }
+    return stats.failedRequests == 0 ? 0 : 1;
+}
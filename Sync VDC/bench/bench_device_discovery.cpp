@@ -0,0 +1,238 @@
+/**
+ * @file bench_device_discovery.cpp
+ * @brief Cost of resolving "USB:VID:PID" to a tty with DeviceDiscovery
+ *
+ * Builds a fake sysfs tree in a temporary directory: boards with CDC-ACM
+ * (ttyACM) and usb-serial (ttyUSB) ports, some behind a hub, other USB
+ * devices without a tty, and the virtual consoles and UARTs every machine
+ * has. Reports the time of a full scan (what resolving costs without an
+ * index), of an indexed lookup, and of applying a hotplug uevent, and checks
+ * that every board resolves to its own node before and after being
+ * unplugged and replugged.
+ *
+ * Usage: bench_device_discovery [--boards N] [--lookups N]
+ */
+
+#include "../include/DeviceDiscovery.h"
+#include "../tests/FakeSysfs.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+using test::FakeSysfs;
+using test::uevent;
+
+const uint16_t kBoardVid = 0x2914;
+const uint16_t kBoardPid = 0x0100;
+
+uint64_t nowNs()
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+struct Board {
+    std::string usbName;
+    std::string usbDevpath;
+    std::string ttyName;
+    std::string ttyDevpath;
+    std::string serial;
+};
+
+bool resolvesTo(DeviceDiscovery& discovery, const Board& board)
+{
+    DeviceMatch match;
+    match.vid = kBoardVid;
+    match.pid = kBoardPid;
+    match.serial = board.serial;
+    DiscoveredDevice device;
+    return discovery.findSerialPort(match, device) && device.devicePath == "/dev/" + board.ttyName &&
+           device.usbName == board.usbName;
+}
+
+double median(std::vector<uint64_t> values)
+{
+    std::sort(values.begin(), values.end());
+    return values.empty() ? 0 : static_cast<double>(values[values.size() / 2]);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    int boardCount = 64;
+    long lookups = 200000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--boards" && i + 1 < argc) {
+            boardCount = std::atoi(argv[++i]);
+        } else if (arg == "--lookups" && i + 1 < argc) {
+            lookups = std::atol(argv[++i]);
+        } else {
+            std::fprintf(stderr, "Usage: %s [--boards N] [--lookups N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (boardCount <= 0 || lookups <= 0) {
+        std::fprintf(stderr, "Board and lookup counts must be positive\n");
+        return 1;
+    }
+
+    char directory[] = "/tmp/bench_discovery_XXXXXX";
+    if (!mkdtemp(directory)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    const std::string root = directory;
+    FakeSysfs sysfs(root);
+
+    // Boards alternate between the root hub and an external hub (1-1), and
+    // in pairs between CDC-ACM and a usb-serial converter
+    const std::string controller = "/devices/pci0000:00/0000:00:14.0/usb1";
+    sysfs.addUsbDevice("/devices/pci0000:00/0000:00:14.0/usb1", 0x1d6b, 0x0002, "0000:00:14.0", "xHCI Host");
+    sysfs.addUsbDevice(controller + "/1-1", 0x05e3, 0x0610, "", "USB2.0 Hub");
+    std::vector<Board> boards;
+    for (int i = 0; i < boardCount; ++i) {
+        Board board;
+        std::string parent = i % 2 == 0 ? controller : controller + "/1-1";
+        board.usbName = i % 2 == 0 ? "1-" + std::to_string(i + 2) : "1-1." + std::to_string(i + 1);
+        board.usbDevpath = parent + "/" + board.usbName;
+        char serial[16];
+        std::snprintf(serial, sizeof(serial), "WT%05d", i);
+        board.serial = serial;
+        sysfs.addUsbDevice(board.usbDevpath, kBoardVid, kBoardPid, board.serial, "Boogie Board Sync");
+        std::string interface = board.usbDevpath + "/" + board.usbName + ":1.0";
+        if (i % 4 < 2) {
+            board.ttyName = "ttyACM" + std::to_string(i);
+            board.ttyDevpath = interface + "/tty/" + board.ttyName;
+        } else {
+            board.ttyName = "ttyUSB" + std::to_string(i);
+            board.ttyDevpath = interface + "/" + board.ttyName + "/tty/" + board.ttyName;
+        }
+        sysfs.addTty(board.ttyDevpath);
+        boards.push_back(board);
+    }
+    for (int i = 0; i < 8; ++i) {
+        sysfs.addUsbDevice(controller + "/1-" + std::to_string(boardCount + 10 + i), 0x046d, 0xc52b, "",
+                           "Receiver");
+    }
+    for (int i = 0; i < 64; ++i) {
+        sysfs.addTty("/devices/virtual/tty/tty" + std::to_string(i));
+    }
+    for (int i = 0; i < 4; ++i) {
+        sysfs.addTty("/devices/platform/serial8250/tty/ttyS" + std::to_string(i));
+    }
+    if (!sysfs.ok()) {
+        std::perror("building the fake sysfs tree");
+        return 1;
+    }
+
+    DiscoveryOptions options;
+    options.sysfsRoot = root;
+    options.watchUevents = false;
+
+    // Full scans: what every "USB:VID:PID" connect would cost without the index
+    std::vector<uint64_t> scans;
+    for (int i = 0; i < 20; ++i) {
+        uint64_t start = nowNs();
+        DeviceDiscovery scan(options);
+        scans.push_back(nowNs() - start);
+    }
+
+    DeviceDiscovery discovery(options);
+    int failures = 0;
+    for (const Board& board : boards) {
+        if (!resolvesTo(discovery, board)) {
+            std::fprintf(stderr, "%s did not resolve to %s\n", board.serial.c_str(), board.ttyName.c_str());
+            ++failures;
+        }
+    }
+
+    // Indexed lookups by serial number, cycling through the boards
+    DeviceMatch match;
+    match.vid = kBoardVid;
+    match.pid = kBoardPid;
+    DiscoveredDevice device;
+    uint64_t start = nowNs();
+    for (long i = 0; i < lookups; ++i) {
+        match.serial = boards[static_cast<size_t>(i) % boards.size()].serial;
+        if (!discovery.findSerialPort(match, device)) {
+            ++failures;
+        }
+    }
+    double lookupNs = static_cast<double>(nowNs() - start) / lookups;
+
+    // The same with the uevent socket open: every lookup drains it first
+    DiscoveryOptions watched = options;
+    watched.watchUevents = true;
+    DeviceDiscovery watching(watched);
+    double watchedLookupNs = -1;
+    if (watching.getNativeHandle() >= 0) {
+        start = nowNs();
+        for (long i = 0; i < lookups; ++i) {
+            match.serial = boards[static_cast<size_t>(i) % boards.size()].serial;
+            watching.findSerialPort(match, device);
+        }
+        watchedLookupNs = static_cast<double>(nowNs() - start) / lookups;
+    }
+
+    // Unplug and replug every board through uevents: tty and interface go
+    // first, then the device; on replug the device comes back first
+    const size_t usbDevices = discovery.deviceCount();
+    std::vector<uint64_t> unplugs;
+    std::vector<uint64_t> replugs;
+    for (const Board& board : boards) {
+        std::string ttyRemove = uevent("remove", board.ttyDevpath, "tty", "", board.ttyName);
+        std::string usbRemove = uevent("remove", board.usbDevpath, "usb", "usb_device", "");
+        std::string usbAdd = uevent("add", board.usbDevpath, "usb", "usb_device", "");
+        std::string ttyAdd = uevent("add", board.ttyDevpath, "tty", "", board.ttyName);
+
+        start = nowNs();
+        discovery.applyUevent(ttyRemove.data(), ttyRemove.size());
+        discovery.applyUevent(usbRemove.data(), usbRemove.size());
+        unplugs.push_back(nowNs() - start);
+        // Not findSerialPort(): without a uevent socket a miss rescans, and
+        // the fake tree still has the board
+        if (discovery.serialPortCount() != boards.size() - 1 || discovery.deviceCount() != usbDevices - 1) {
+            std::fprintf(stderr, "%s still indexed after unplug\n", board.serial.c_str());
+            ++failures;
+        }
+
+        start = nowNs();
+        discovery.applyUevent(usbAdd.data(), usbAdd.size());
+        discovery.applyUevent(ttyAdd.data(), ttyAdd.size());
+        replugs.push_back(nowNs() - start);
+        if (!resolvesTo(discovery, board)) {
+            std::fprintf(stderr, "%s does not resolve after replug\n", board.serial.c_str());
+            ++failures;
+        }
+    }
+
+    std::printf("%d boards, %zu USB devices, %zu USB serial ports in the fake tree\n", boardCount,
+                discovery.deviceCount(), discovery.serialPortCount());
+    std::printf("  full sysfs scan          median %9.1f us\n", median(scans) / 1000.0);
+    std::printf("  indexed lookup                  %9.3f us\n", lookupNs / 1000.0);
+    if (watchedLookupNs >= 0) {
+        std::printf("  lookup + uevent drain           %9.3f us\n", watchedLookupNs / 1000.0);
+    } else {
+        std::printf("  lookup + uevent drain           (uevent socket unavailable)\n");
+    }
+    std::printf("  unplug (2 uevents)       median %9.1f us\n", median(unplugs) / 1000.0);
+    std::printf("  replug (2 uevents)       median %9.1f us\n", median(replugs) / 1000.0);
+    std::printf("  %d failures\n", failures);
+
+    std::string command = "rm -rf '" + root + "'";
+    if (std::system(command.c_str()) != 0) {
+        std::fprintf(stderr, "could not remove %s\n", root.c_str());
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+/**
+ * @file bench_frame_decoder.cpp
+ * @brief FrameDecoder throughput on recorded or synthetic byte streams
+ *
+ * Feeds the stream through the decoder in chunks of several sizes (so frames
+ * are regularly split across calls) and reports MB/s and events/s.
+ *
+ * Usage: bench_frame_decoder [raw_stream_file]
+ *
+ * Without a file, a 64 MiB synthetic stream is generated: pen frames mixed with
+ * reply frames and runs of line noise. The decoded pen frame count is checked
+ * against the number generated.
+ */
+
+#include "../include/FrameDecoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<uint8_t> makeSyntheticStream(size_t targetBytes, uint64_t& penFrames)
+{
+    std::vector<uint8_t> stream;
+    stream.reserve(targetBytes + FRAME_MAX_SIZE);
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::uniform_int_distribution<int> byteValue(0, 255);
+
+    uint8_t frame[FRAME_MAX_SIZE];
+    uint8_t sequence = 0;
+    StylusEvent event = {};
+    penFrames = 0;
+
+    while (stream.size() < targetBytes) {
+        int kind = percent(rng);
+        if (kind < 94) {
+            event.x = static_cast<uint16_t>(event.x + 3);
+            event.y = static_cast<uint16_t>(event.y + 5);
+            event.pressure = static_cast<uint16_t>(byteValue(rng) * 4);
+            event.flags = STYLUS_IN_RANGE | STYLUS_TIP_DOWN;
+            event.sequence = sequence++;
+            size_t n = encodePenFrame(event, frame);
+            stream.insert(stream.end(), frame, frame + n);
+            penFrames++;
+        } else if (kind < 97) {
+            uint8_t payload[32];
+            uint8_t length = static_cast<uint8_t>(byteValue(rng) % sizeof(payload));
+            for (uint8_t i = 0; i < length; ++i) {
+                payload[i] = static_cast<uint8_t>(byteValue(rng));
+            }
+            size_t n = encodeFrame(0x81, sequence++, payload, length, frame);
+            stream.insert(stream.end(), frame, frame + n);
+        } else {
+            // Line noise that never contains the sync byte, so every real frame survives
+            int noise = 1 + byteValue(rng) % 16;
+            for (int i = 0; i < noise; ++i) {
+                uint8_t b = static_cast<uint8_t>(byteValue(rng));
+                stream.push_back(b == FRAME_SYNC ? 0 : b);
+            }
+        }
+    }
+    return stream;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::vector<uint8_t> stream;
+    uint64_t expectedPenFrames = 0;
+
+    if (argc > 1) {
+        std::ifstream file(argv[1], std::ios::binary);
+        if (!file) {
+            std::fprintf(stderr, "Cannot open %s\n", argv[1]);
+            return 1;
+        }
+        stream.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        std::printf("Recorded stream: %s (%zu bytes)\n", argv[1], stream.size());
+    } else {
+        stream = makeSyntheticStream(64 * 1024 * 1024, expectedPenFrames);
+        std::printf("Synthetic stream: %zu bytes, %llu pen frames\n", stream.size(),
+                    static_cast<unsigned long long>(expectedPenFrames));
+    }
+
+    const size_t chunkSizes[] = {61, 512, 4096, 65536};
+    const int passes = 5;
+    StylusEvent events[256];
+    bool ok = true;
+
+    std::printf("%-10s %12s %14s %10s %10s\n", "chunk", "MB/s", "events/s", "crc errs", "skipped");
+    for (size_t chunkSize : chunkSizes) {
+        double bestSeconds = 0;
+        FrameDecoderStats stats;
+        uint64_t checksum = 0;
+
+        for (int pass = 0; pass < passes; ++pass) {
+            FrameDecoder decoder;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t offset = 0; offset < stream.size(); offset += chunkSize) {
+                size_t length = std::min(chunkSize, stream.size() - offset);
+                const uint8_t* data = stream.data() + offset;
+                while (length > 0) {
+                    size_t produced = 0;
+                    size_t used = decoder.decode(data, length, offset, events, 256, produced);
+                    for (size_t i = 0; i < produced; ++i) {
+                        checksum += events[i].x;  // Keep the decode from being optimised away
+                    }
+                    data += used;
+                    length -= used;
+                }
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (pass == 0 || seconds < bestSeconds) {
+                bestSeconds = seconds;
+            }
+            stats = decoder.stats();
+        }
+
+        std::printf("%-10zu %12.1f %14.0f %10llu %10llu%s\n", chunkSize,
+                    stream.size() / bestSeconds / 1e6, stats.penFrames / bestSeconds,
+                    static_cast<unsigned long long>(stats.checksumErrors),
+                    static_cast<unsigned long long>(stats.skippedBytes),
+                    checksum == 0 ? " (no events)" : "");
+
+        if (expectedPenFrames != 0 && stats.penFrames != expectedPenFrames) {
+            std::printf("  MISMATCH: decoded %llu pen frames, expected %llu\n",
+                        static_cast<unsigned long long>(stats.penFrames),
+                        static_cast<unsigned long long>(expectedPenFrames));
+            ok = false;
+        }
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,227 @@
+/**
+ * @file bench_reconnect.cpp
+ * @brief How quickly auto-reconnect notices a dropped port and resumes
+ *
+ * The connection opens a symlink in a temporary directory that points at a
+ * WT13106Simulator pty, the way udev publishes /dev/serial/by-id links. Each
+ * cycle streams for a while, then the simulator is stopped (the pty hangs
+ * up) and the link removed; after a pause a new simulator is started and
+ * the link recreated. Reports the time from the hang-up to the link-down
+ * callback and from the link reappearing to the link-up callback, and
+ * checks that every event the simulators sent arrived, including those
+ * still queued in the ring when the link dropped. stop() lets the host read
+ * what is queued in the pty before hanging up (which adds a fraction of a
+ * millisecond to the hang-up time); frames it still had to discard are
+ * reported as lost at hang-up and not expected to arrive.
+ *
+ * Usage: bench_reconnect [--cycles N] [--gap MS] [--direct]
+ *   --gap     how long the port stays away in each cycle
+ *   --direct  receive with direct reads on a consumer thread instead of streaming
+ */
+
+#include "../include/FrameDecoder.h"
+#include "../include/WT13106Connection.h"
+#include "../include/WT13106Simulator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+uint64_t nowNs()
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+void sleepMs(int ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+/**
+ * @brief Atomically point path at target (symlink to a temporary name, then rename)
+ */
+bool publishLink(const std::string& target, const std::string& path)
+{
+    std::string temporary = path + ".new";
+    unlink(temporary.c_str());
+    return symlink(target.c_str(), temporary.c_str()) == 0 && rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+bool waitFor(const std::atomic<uint64_t>& value, int timeoutMs)
+{
+    for (int i = 0; i < timeoutMs && value == 0; ++i) {
+        sleepMs(1);
+    }
+    return value != 0;
+}
+
+double percentileUs(std::vector<uint64_t> values, double p)
+{
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[static_cast<size_t>(p * (values.size() - 1))] / 1000.0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    int cycles = 20;
+    int gapMs = 50;
+    bool direct = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--cycles" && i + 1 < argc) {
+            cycles = std::atoi(argv[++i]);
+        } else if (arg == "--gap" && i + 1 < argc) {
+            gapMs = std::atoi(argv[++i]);
+        } else if (arg == "--direct") {
+            direct = true;
+        } else {
+            std::fprintf(stderr, "Usage: %s [--cycles N] [--gap MS] [--direct]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (cycles <= 0 || gapMs < 0) {
+        std::fprintf(stderr, "Cycles must be positive and the gap non-negative\n");
+        return 1;
+    }
+
+    char directory[] = "/tmp/bench_reconnect_XXXXXX";
+    if (!mkdtemp(directory)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    const std::string link = std::string(directory) + "/board";
+
+    SimulatorOptions simOptions;
+    simOptions.sampleRateHz = 1000;
+    simOptions.pattern = SimulatorPattern::COUNTER;
+    WT13106Simulator* simulator = new WT13106Simulator();
+    if (!simulator->start(simOptions) || !publishLink(simulator->devicePath(), link)) {
+        std::fprintf(stderr, "simulator: %s\n", simulator->getLastError().c_str());
+        return 1;
+    }
+
+    std::atomic<uint64_t> downNs(0);
+    std::atomic<uint64_t> upNs(0);
+    WT13106Connection connection("BT:" + link);
+    ReconnectOptions reconnect;
+    reconnect.enabled = true;
+    connection.setReconnectOptions(reconnect, [&](bool up) {
+        (up ? upNs : downNs) = nowNs();
+    });
+    if (!connection.connect()) {
+        std::fprintf(stderr, "connect: %s\n", connection.getLastError().c_str());
+        return 1;
+    }
+
+    // Streaming: nothing is consumed until the end, so everything sent must
+    // still be in the ring. Direct: a consumer thread keeps receiving.
+    std::atomic<uint64_t> received(0);
+    std::atomic<bool> stop(false);
+    std::thread consumer;
+    if (direct) {
+        consumer = std::thread([&]() {
+            StylusEvent events[256];
+            while (!stop) {
+                received += connection.receiveEvents(events, 256, 20);
+            }
+        });
+    } else {
+        StreamingOptions streamOptions;
+        streamOptions.ringCapacity = 4 * 1024 * 1024;
+        if (!connection.startStreaming(streamOptions)) {
+            std::fprintf(stderr, "startStreaming: %s\n", connection.getLastError().c_str());
+            return 1;
+        }
+    }
+
+    std::vector<uint64_t> detect;
+    std::vector<uint64_t> resume;
+    uint64_t sent = 0;
+    uint64_t lostAtHangUp = 0;
+    int failures = 0;
+    for (int cycle = 0; cycle < cycles; ++cycle) {
+        sleepMs(200);
+
+        downNs = 0;
+        upNs = 0;
+        uint64_t hangUpNs = nowNs();
+        simulator->stop();
+        sent += simulator->framesSent();
+        lostAtHangUp += (simulator->bytesUnread() + PEN_FRAME_SIZE - 1) / PEN_FRAME_SIZE;
+        delete simulator;
+        unlink(link.c_str());
+        if (!waitFor(downNs, 1000)) {
+            std::fprintf(stderr, "cycle %d: drop not noticed\n", cycle);
+            ++failures;
+            break;
+        }
+        detect.push_back(downNs - hangUpNs);
+
+        sleepMs(gapMs);
+        simulator = new WT13106Simulator();
+        if (!simulator->start(simOptions)) {
+            std::fprintf(stderr, "simulator: %s\n", simulator->getLastError().c_str());
+            return 1;
+        }
+        uint64_t publishedNs = nowNs();
+        if (!publishLink(simulator->devicePath(), link)) {
+            std::perror("symlink");
+            return 1;
+        }
+        if (!waitFor(upNs, 2000)) {
+            std::fprintf(stderr, "cycle %d: not reconnected\n", cycle);
+            ++failures;
+            break;
+        }
+        resume.push_back(upNs - publishedNs);
+    }
+
+    sleepMs(200);
+    simulator->stop();
+    sent += simulator->framesSent();
+    lostAtHangUp += (simulator->bytesUnread() + PEN_FRAME_SIZE - 1) / PEN_FRAME_SIZE;
+    delete simulator;
+    unlink(link.c_str());
+    rmdir(directory);
+
+    if (direct) {
+        sleepMs(100);
+        stop = true;
+        consumer.join();
+    } else {
+        StylusEvent events[1024];
+        size_t count;
+        while ((count = connection.receiveEvents(events, 1024, 100)) > 0) {
+            received += count;
+        }
+    }
+    connection.disconnect();
+
+    std::printf("%s, %d cycles, port away %d ms per cycle, %llu reconnects\n",
+                direct ? "direct reads" : "streaming", cycles, gapMs,
+                static_cast<unsigned long long>(connection.reconnectCount()));
+    std::printf("  hang-up -> link down     p50 %8.1f us  max %8.1f us\n", percentileUs(detect, 0.5),
+                percentileUs(detect, 1.0));
+    std::printf("  node back -> link up     p50 %8.1f us  max %8.1f us\n", percentileUs(resume, 0.5),
+                percentileUs(resume, 1.0));
+    std::printf("  events                   %llu sent, %llu received, %llu lost at hang-up\n",
+                static_cast<unsigned long long>(sent), static_cast<unsigned long long>(received.load()),
+                static_cast<unsigned long long>(lostAtHangUp));
+    return failures == 0 && received == sent - lostAtHangUp ? 0 : 1;
+}
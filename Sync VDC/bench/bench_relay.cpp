@@ -0,0 +1,266 @@
+/**
+ * @file bench_relay.cpp
+ * @brief Fan-out of one simulated board to many relay clients
+ *
+ * A WT13106Simulator streams COUNTER samples through a StreamRelay on a
+ * Unix socket (or loopback TCP with --tcp) to K client threads, plus one
+ * client that connects and never reads. Run once per client count.
+ *
+ * The simulator starts paused and only streams once every client has been
+ * accepted, and is paused again until the reader has decoded all it sent
+ * and the clients have gone quiet. Every live client therefore sees the
+ * whole stream: received + lost must equal the events decoded, and any
+ * client for which it does not (duplicates or silent loss) is reported.
+ *
+ * Reported per run: events the reader decoded, what each live client
+ * received and lost, delivery latency from the reader's timestamp to the
+ * client (p50/p99/max), sendmsg() calls per delivered event (how well
+ * messages are gathered), the stalled client's losses, and whether the
+ * reader kept up: samples the simulator had to drop because the port was
+ * not drained, and batches the relay thread did not take in time.
+ *
+ * Usage: bench_relay [--clients K] [--rate HZ] [--seconds S] [--frames-per-write N]
+ *                    [--queue BYTES] [--tcp]
+ *   --clients  one run with K clients instead of runs with 1, 16 and 128
+ */
+
+#include "../include/StreamRelay.h"
+#include "../include/WT13106Connection.h"
+#include "../include/WT13106Simulator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace {
+
+struct Options {
+    std::vector<size_t> clients = {1, 16, 128};
+    double rateHz = 5000.0;
+    double seconds = 3.0;
+    size_t framesPerWrite = 1;
+    size_t queueBytes = 64 * 1024;
+    bool tcp = false;
+};
+
+struct ClientResult {
+    uint64_t received = 0;
+    uint64_t lost = 0;
+    uint64_t outOfOrder = 0;
+    std::vector<uint64_t> latenciesNs;
+};
+
+uint64_t steadyNowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+double percentile(const std::vector<uint64_t>& sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    return sorted[static_cast<size_t>(p * (sorted.size() - 1))] / 1000.0;
+}
+
+/**
+ * @brief Poll until done() returns true or timeoutMs passes
+ */
+template <typename Done>
+bool waitFor(Done done, int timeoutMs)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!done()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+double processCpuSeconds()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+void receiveAll(RelayClient& client, ClientResult& result, const std::atomic<bool>& done)
+{
+    StylusEvent events[256];
+    uint16_t expected = 0;
+    bool first = true;
+    while (client.isConnected()) {
+        size_t n = client.receive(events, 256, result.lost, 100);
+        if (n == 0 && done) {
+            break;
+        }
+        uint64_t now = steadyNowNs();
+        for (size_t i = 0; i < n; ++i) {
+            result.latenciesNs.push_back(now - events[i].timestampNs);
+            result.outOfOrder += !first && events[i].x != expected && result.lost == 0 ? 1 : 0;
+            expected = static_cast<uint16_t>(events[i].x + 1);
+            first = false;
+        }
+        result.received += n;
+    }
+}
+
+bool run(const Options& options, size_t clientCount)
+{
+    WT13106Simulator simulator;
+    SimulatorOptions simOptions;
+    simOptions.sampleRateHz = options.rateHz;
+    simOptions.framesPerWrite = options.framesPerWrite;
+    simOptions.pattern = SimulatorPattern::COUNTER;
+    simOptions.startPaused = true;
+    if (!simulator.start(simOptions)) {
+        std::fprintf(stderr, "simulator: %s\n", simulator.getLastError().c_str());
+        return false;
+    }
+    WT13106Connection connection(simulator.connectionString());
+    if (!connection.connect()) {
+        std::fprintf(stderr, "connect: %s\n", connection.getLastError().c_str());
+        return false;
+    }
+
+    StreamRelayOptions relayOptions;
+    if (options.tcp) {
+        relayOptions.tcpPort = 0;
+    } else {
+        relayOptions.unixPath = "/tmp/bench_relay_" + std::to_string(getpid()) + ".sock";
+    }
+    relayOptions.clientQueueBytes = options.queueBytes;
+    StreamRelay relay(relayOptions);
+    if (!relay.start(connection)) {
+        std::fprintf(stderr, "relay: %s\n", relay.getLastError().c_str());
+        return false;
+    }
+    std::string address = options.tcp ? "tcp:" + std::to_string(relay.tcpPort()) : relayOptions.unixPath;
+
+    std::vector<RelayClient> clients(clientCount);
+    RelayClient stalled;
+    for (RelayClient& client : clients) {
+        if (!client.connect(address)) {
+            std::fprintf(stderr, "client: %s\n", client.getLastError().c_str());
+            return false;
+        }
+    }
+    if (!stalled.connect(address)) {
+        std::fprintf(stderr, "client: %s\n", stalled.getLastError().c_str());
+        return false;
+    }
+
+    // Nothing is streamed before every client (and the stalled one) is accepted
+    if (!waitFor([&] { return relay.getStats().clients == clientCount + 1; }, 5000)) {
+        std::fprintf(stderr, "relay: clients were not accepted\n");
+        return false;
+    }
+
+    std::atomic<bool> done(false);
+    std::vector<ClientResult> results(clientCount);
+    std::vector<std::thread> threads;
+    double cpuBefore = processCpuSeconds();
+    for (size_t i = 0; i < clientCount; ++i) {
+        threads.emplace_back(receiveAll, std::ref(clients[i]), std::ref(results[i]), std::cref(done));
+    }
+    simulator.setPaused(false);
+
+    // Stop sampling, let the reader decode everything written, then let each
+    // client read until it has been idle for a receive timeout
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.seconds));
+    simulator.setPaused(true);
+    if (!waitFor([&] { return relay.getStats().eventsIn >= simulator.framesSent(); }, 2000)) {
+        std::fprintf(stderr, "reader: decoded %llu of %llu events\n",
+                     static_cast<unsigned long long>(relay.getStats().eventsIn),
+                     static_cast<unsigned long long>(simulator.framesSent()));
+    }
+    done = true;
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double cpu = processCpuSeconds() - cpuBefore;
+    StreamRelayStats stats = relay.getStats();
+    uint64_t simDropped = simulator.framesDropped();
+    relay.stop();
+    connection.disconnect();
+    simulator.stop();
+
+    const uint64_t eventsIn = stats.eventsIn;
+    ClientResult total;
+    size_t mismatched = 0;  // Clients whose received + lost is not eventsIn
+    for (ClientResult& result : results) {
+        mismatched += result.received + result.lost != eventsIn ? 1 : 0;
+        total.received += result.received;
+        total.lost += result.lost;
+        total.outOfOrder += result.outOfOrder;
+        total.latenciesNs.insert(total.latenciesNs.end(), result.latenciesNs.begin(), result.latenciesNs.end());
+    }
+    std::sort(total.latenciesNs.begin(), total.latenciesNs.end());
+    double perClient = double(total.received) / double(clientCount);
+    // The stalled client's losses are whatever the live clients did not lose
+    uint64_t stalledLost = stats.eventsLost > total.lost ? stats.eventsLost - total.lost : 0;
+
+    std::printf("%4zu clients  %8llu events in  %8.0f/client  lost %llu  out of order %llu  mismatched %zu"
+                "  latency p50 %7.1f us  p99 %7.1f us  max %8.1f us  %.3f sendmsg/event"
+                "  cpu %5.1f us/event  stalled client lost %llu  reader: sim dropped %llu, batches dropped %llu\n",
+                clientCount, static_cast<unsigned long long>(eventsIn), perClient,
+                static_cast<unsigned long long>(total.lost), static_cast<unsigned long long>(total.outOfOrder),
+                mismatched, percentile(total.latenciesNs, 0.5), percentile(total.latenciesNs, 0.99),
+                percentile(total.latenciesNs, 1.0),
+                double(stats.writeCalls) / std::max(1.0, double(total.received)),
+                cpu * 1e6 / std::max<uint64_t>(eventsIn, 1), static_cast<unsigned long long>(stalledLost),
+                static_cast<unsigned long long>(simDropped), static_cast<unsigned long long>(stats.batchesDropped));
+    std::fflush(stdout);
+    return total.lost == 0 && total.outOfOrder == 0 && mismatched == 0 && stats.batchesDropped == 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--clients" && i + 1 < argc) {
+            options.clients = {std::strtoul(argv[++i], nullptr, 10)};
+        } else if (arg == "--rate" && i + 1 < argc) {
+            options.rateHz = std::atof(argv[++i]);
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            options.seconds = std::atof(argv[++i]);
+        } else if (arg == "--frames-per-write" && i + 1 < argc) {
+            options.framesPerWrite = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--queue" && i + 1 < argc) {
+            options.queueBytes = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--tcp") {
+            options.tcp = true;
+        } else {
+            std::fprintf(stderr, "Usage: %s [--clients K] [--rate HZ] [--seconds S] [--frames-per-write N]"
+                         " [--queue BYTES] [--tcp]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::printf("Relay over %s, %.0f samples/s, %zu frames per write, %zu-byte client queues\n",
+                options.tcp ? "loopback TCP" : "a Unix socket", options.rateHz, options.framesPerWrite,
+                options.queueBytes);
+    bool ok = true;
+    for (size_t count : options.clients) {
+        ok = run(options, std::max<size_t>(count, 1)) && ok;
+    }
+    if (!ok) {
+        std::fprintf(stderr, "a live client missed or duplicated events\n");
+        return 1;
+    }
+    return 0;
+}
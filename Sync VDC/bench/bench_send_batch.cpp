@@ -0,0 +1,168 @@
+/**
+ * @file bench_send_batch.cpp
+ * @brief System calls and time needed to upload a burst of commands
+ *
+ * Sends the same burst of command frames (a configuration upload) to the
+ * simulator with each flush policy and with sendBatch(), then checks that
+ * every command was answered in order, which also proves that partial
+ * writes were resumed at the right byte.
+ *
+ * Usage: bench_send_batch [--commands N] [--payload BYTES] [--batch N]
+ */
+
+#include "../include/WT13106Connection.h"
+#include "../include/WT13106Simulator.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    size_t commands = 2000;
+    size_t payload = 16;
+    size_t batch = 256;  // Commands per sendBatch() call
+};
+
+enum class Mode {
+    IMMEDIATE,
+    SIZE_THRESHOLD,
+    TIME_WINDOW,
+    BATCH
+};
+
+const char* modeName(Mode mode)
+{
+    switch (mode) {
+    case Mode::IMMEDIATE:
+        return "immediate";
+    case Mode::SIZE_THRESHOLD:
+        return "size 4096";
+    case Mode::TIME_WINDOW:
+        return "window 2ms";
+    case Mode::BATCH:
+        return "sendBatch";
+    }
+    return "";
+}
+
+bool run(Mode mode, const Options& options, const std::vector<std::vector<uint8_t>>& frames)
+{
+    SimulatorOptions simOptions;
+    simOptions.sampleRateHz = 50;  // Keep pen traffic out of the way of the replies
+    simOptions.maxBacklogBytes = 1024 * 1024;
+
+    WT13106Simulator simulator;
+    if (!simulator.start(simOptions)) {
+        std::fprintf(stderr, "simulator: %s\n", simulator.getLastError().c_str());
+        return false;
+    }
+
+    WT13106Connection connection(simulator.connectionString());
+    size_t replies = 0;
+    size_t outOfOrder = 0;
+    connection.setFrameHandler([&replies, &outOfOrder](const FrameView& frame) {
+        if (frame.sequence != static_cast<uint8_t>(replies)) {
+            ++outOfOrder;
+        }
+        ++replies;
+    });
+    connection.setMetricsEnabled(true);
+    if (!connection.connect()) {
+        std::fprintf(stderr, "connect: %s\n", connection.getLastError().c_str());
+        return false;
+    }
+
+    SendOptions sendOptions;
+    if (mode == Mode::SIZE_THRESHOLD) {
+        sendOptions.policy = FlushPolicy::SIZE_THRESHOLD;
+        sendOptions.sizeThreshold = 4096;
+    } else if (mode == Mode::TIME_WINDOW) {
+        sendOptions.policy = FlushPolicy::TIME_WINDOW;
+        sendOptions.windowUs = 2000;
+    }
+    connection.setSendOptions(sendOptions);
+
+    auto start = std::chrono::steady_clock::now();
+    bool ok = true;
+    if (mode == Mode::BATCH) {
+        std::vector<CommandBuffer> batch;
+        for (size_t i = 0; i < frames.size() && ok; i += options.batch) {
+            batch.clear();
+            for (size_t j = i; j < frames.size() && j < i + options.batch; ++j) {
+                batch.push_back(CommandBuffer{frames[j].data(), frames[j].size()});
+            }
+            ok = connection.sendBatch(batch.data(), batch.size());
+        }
+    } else {
+        for (size_t i = 0; i < frames.size() && ok; ++i) {
+            ok = connection.sendCommand(frames[i].data(), frames[i].size());
+        }
+    }
+    ok = ok && connection.flush();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!ok) {
+        std::fprintf(stderr, "%s: %s\n", modeName(mode), connection.getLastError().c_str());
+    }
+
+    // Drain the replies
+    StylusEvent events[256];
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (replies < frames.size() && std::chrono::steady_clock::now() < deadline) {
+        connection.receiveEvents(events, 256, 50);
+    }
+    ConnectionMetricsSnapshot metrics = connection.getMetrics();
+    connection.disconnect();
+    simulator.stop();
+
+    std::printf("%-11s %6llu writes  %5llu partial  %8.2f ms  %.0f commands/s  %zu/%zu replies%s\n",
+                modeName(mode), static_cast<unsigned long long>(metrics.writeCalls),
+                static_cast<unsigned long long>(metrics.partialWrites), seconds * 1000.0,
+                frames.size() / seconds, replies, frames.size(), outOfOrder ? " OUT OF ORDER" : "");
+    return ok && replies == frames.size() && outOfOrder == 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--commands" && i + 1 < argc) {
+            options.commands = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--payload" && i + 1 < argc) {
+            options.payload = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--batch" && i + 1 < argc) {
+            options.batch = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            std::fprintf(stderr, "Usage: %s [--commands N] [--payload BYTES] [--batch N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (options.commands == 0 || options.payload > 255 || options.batch == 0) {
+        std::fprintf(stderr, "Need at least one command, a payload of at most 255 bytes and a batch size\n");
+        return 1;
+    }
+
+    std::vector<std::vector<uint8_t>> frames(options.commands);
+    std::vector<uint8_t> payload(options.payload);
+    for (size_t i = 0; i < frames.size(); ++i) {
+        for (size_t j = 0; j < payload.size(); ++j) {
+            payload[j] = static_cast<uint8_t>(i + j);
+        }
+        frames[i].resize(FRAME_MAX_SIZE);
+        frames[i].resize(encodeFrame(0x02, static_cast<uint8_t>(i), payload.data(),
+                                     static_cast<uint8_t>(payload.size()), frames[i].data()));
+    }
+
+    std::printf("%zu commands of %zu bytes\n", frames.size(), frames[0].size());
+    bool ok = true;
+    for (Mode mode : {Mode::IMMEDIATE, Mode::SIZE_THRESHOLD, Mode::TIME_WINDOW, Mode::BATCH}) {
+        ok = run(mode, options, frames) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,350 @@
+/**
+ * @file bench_shared_ring.cpp
+ * @brief Getting decoded events to other processes: pipes vs the shared ring
+ *
+ * One writer process publishes N pen events in batches of 64 to K reader
+ * processes (forked), first through one pipe per reader (a write() per
+ * batch and reader, a read() per wake-up), then through a SharedEventRing
+ * (readers poll the mapping and sleep on its futex when it is empty).
+ *
+ * Reported per transport: events/s until every reader has everything, the
+ * readers' CPU time and system calls per event (read() for pipes, futex
+ * sleeps for the ring) and events lost (the ring never holds the writer
+ * back, so a reader more than a ring behind loses events). --rate paces the
+ * writer like a set of boards would instead of publishing flat out.
+ * --frame-ms makes the readers behave like a renderer: wake up once per
+ * frame and take whatever arrived (pipe: non-blocking read() until EAGAIN;
+ * ring: read() from the mapping) instead of sleeping until data arrives.
+ *
+ * Usage: bench_shared_ring [--events N] [--readers K] [--capacity N] [--rate EVENTS_PER_S]
+ *                          [--frame-ms N]
+ */
+
+#include "../include/SharedEventRing.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Options {
+    size_t events = 2000000;
+    size_t readers = 2;
+    size_t capacity = 65536;
+    double rate = 0;     // Events per second; 0 = as fast as possible
+    uint32_t frameMs = 0;  // > 0: readers poll once per frame instead of waiting
+};
+
+struct ReaderResult {
+    uint64_t received = 0;
+    uint64_t lost = 0;
+    uint64_t systemCalls = 0;
+    uint64_t outOfOrder = 0;
+    uint64_t cpuNs = 0;
+};
+
+const size_t kBatch = 64;
+
+StylusEvent makeEvent(size_t i)
+{
+    StylusEvent event = {};
+    event.timestampNs = i;
+    event.x = static_cast<uint16_t>(i);
+    event.pressure = 512;
+    event.flags = STYLUS_TIP_DOWN | STYLUS_IN_RANGE;
+    return event;
+}
+
+/**
+ * @brief With --rate, sleep until event number sent is due
+ */
+void pace(const Options& options, std::chrono::steady_clock::time_point start, size_t sent)
+{
+    if (options.rate > 0) {
+        std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                  std::chrono::duration<double>(double(sent) / options.rate)));
+    }
+}
+
+bool writeAll(int fd, const void* data, size_t length)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    while (length > 0) {
+        ssize_t n = write(fd, bytes, length);
+        if (n <= 0) {
+            return false;
+        }
+        bytes += n;
+        length -= size_t(n);
+    }
+    return true;
+}
+
+uint64_t cpuNs()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return uint64_t(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ull +
+           uint64_t(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ull;
+}
+
+/**
+ * @brief Fork a reader; it runs body() and reports its result through a pipe
+ */
+template <class Body>
+pid_t forkReader(int& resultFd, Body body)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        ReaderResult result = body();
+        result.cpuNs = cpuNs();
+        writeAll(fds[1], &result, sizeof(result));
+        _exit(0);
+    }
+    close(fds[1]);
+    resultFd = fds[0];
+    return pid;
+}
+
+bool collect(std::vector<pid_t>& pids, std::vector<int>& resultFds, ReaderResult& total)
+{
+    bool ok = true;
+    for (size_t i = 0; i < pids.size(); ++i) {
+        ReaderResult result;
+        ok = read(resultFds[i], &result, sizeof(result)) == ssize_t(sizeof(result)) && ok;
+        close(resultFds[i]);
+        waitpid(pids[i], nullptr, 0);
+        total.received += result.received;
+        total.lost += result.lost;
+        total.systemCalls += result.systemCalls;
+        total.outOfOrder += result.outOfOrder;
+        total.cpuNs += result.cpuNs;
+    }
+    return ok;
+}
+
+void report(const char* name, const Options& options, double seconds, uint64_t writerNs, const ReaderResult& total)
+{
+    double received = double(std::max<uint64_t>(total.received, 1));
+    std::printf("%-6s  %11.0f events/s  writer %6.1f ns/event  reader %6.1f ns/event %7.4f syscalls/event"
+                "  lost %llu  out of order %llu\n",
+                name, double(options.events) / seconds, double(writerNs) / double(options.events),
+                double(total.cpuNs) / received,
+                double(total.systemCalls) / received,
+                static_cast<unsigned long long>(total.lost), static_cast<unsigned long long>(total.outOfOrder));
+    std::fflush(stdout);
+}
+
+bool runPipes(const Options& options)
+{
+    std::vector<pid_t> pids;
+    std::vector<int> resultFds(options.readers);
+    std::vector<int> writeFds;
+    for (size_t r = 0; r < options.readers; ++r) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            std::perror("pipe");
+            return false;
+        }
+        pids.push_back(forkReader(resultFds[r], [&options, fds]() {
+            close(fds[1]);
+            if (options.frameMs > 0) {
+                fcntl(fds[0], F_SETFL, O_NONBLOCK);
+            }
+            ReaderResult result;
+            StylusEvent events[256];
+            size_t partial = 0;
+            uint8_t* bytes = reinterpret_cast<uint8_t*>(events);
+            for (;;) {
+                ssize_t n = read(fds[0], bytes + partial, sizeof(events) - partial);
+                ++result.systemCalls;
+                if (n < 0 && errno == EAGAIN) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(options.frameMs));
+                    continue;
+                }
+                if (n <= 0) {
+                    break;
+                }
+                partial += size_t(n);
+                size_t whole = partial / sizeof(StylusEvent);
+                for (size_t i = 0; i < whole; ++i) {
+                    result.outOfOrder += events[i].timestampNs != result.received ? 1 : 0;
+                    ++result.received;
+                }
+                partial -= whole * sizeof(StylusEvent);
+                std::memmove(bytes, bytes + whole * sizeof(StylusEvent), partial);
+            }
+            return result;
+        }));
+        close(fds[0]);
+        writeFds.push_back(fds[1]);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t writerStartNs = cpuNs();
+    StylusEvent batch[kBatch];
+    for (size_t sent = 0; sent < options.events; sent += kBatch) {
+        pace(options, start, sent);
+        size_t n = std::min(kBatch, options.events - sent);
+        for (size_t j = 0; j < n; ++j) {
+            batch[j] = makeEvent(sent + j);
+        }
+        for (int fd : writeFds) {
+            writeAll(fd, batch, n * sizeof(StylusEvent));
+        }
+    }
+    for (int fd : writeFds) {
+        close(fd);
+    }
+    uint64_t writerNs = cpuNs() - writerStartNs;
+    ReaderResult total;
+    bool ok = collect(pids, resultFds, total);
+    report("pipe", options, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(),
+           writerNs, total);
+    return ok && total.received == options.events * options.readers;
+}
+
+bool runSharedRing(const Options& options)
+{
+    std::string name = "wt13106-bench-" + std::to_string(getpid());
+    SharedEventWriter writer;
+    if (!writer.create(name, options.capacity)) {
+        std::fprintf(stderr, "%s\n", writer.getLastError().c_str());
+        return false;
+    }
+
+    // Readers attach before the first event and say so through a pipe
+    int ready[2];
+    if (pipe(ready) != 0) {
+        std::perror("pipe");
+        return false;
+    }
+    std::vector<pid_t> pids;
+    std::vector<int> resultFds(options.readers);
+    for (size_t r = 0; r < options.readers; ++r) {
+        pids.push_back(forkReader(resultFds[r], [&options, &name, ready]() {
+            ReaderResult result;
+            SharedEventReader reader;
+            bool opened = reader.open(name);
+            writeAll(ready[1], "r", 1);
+            if (!opened) {
+                return result;
+            }
+            StylusEvent events[256];
+            uint64_t expected = 0;
+            while (result.received + result.lost < options.events) {
+                size_t n = reader.read(events, 256, result.lost);
+                if (n == 0 && options.frameMs > 0) {
+                    if (reader.writerGone() && reader.lag() == 0) {
+                        break;
+                    }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(options.frameMs));
+                    continue;
+                }
+                if (n == 0) {
+                    // Nothing pending: sleep on the futex (one system call)
+                    ++result.systemCalls;
+                    n = reader.readWait(events, 256, result.lost, 100);
+                    if (n == 0 && reader.writerGone() && reader.lag() == 0) {
+                        break;
+                    }
+                }
+                for (size_t i = 0; i < n; ++i) {
+                    result.outOfOrder += events[i].timestampNs < expected ? 1 : 0;
+                    expected = events[i].timestampNs + 1;
+                }
+                result.received += n;
+            }
+            return result;
+        }));
+    }
+    close(ready[1]);
+    char byte;
+    for (size_t r = 0; r < options.readers; ++r) {
+        if (read(ready[0], &byte, 1) != 1) {
+            break;
+        }
+    }
+    close(ready[0]);
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t writerStartNs = cpuNs();
+    for (size_t sent = 0; sent < options.events;) {
+        pace(options, start, sent);
+        StylusEvent* slots = nullptr;
+        size_t n = writer.claim(slots, std::min(kBatch, options.events - sent));
+        for (size_t j = 0; j < n; ++j) {
+            slots[j] = makeEvent(sent + j);
+        }
+        writer.commit(n);
+        sent += n;
+    }
+    uint64_t writerNs = cpuNs() - writerStartNs;
+    ReaderResult total;
+    bool ok = collect(pids, resultFds, total);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    writer.close();
+    report("shm", options, seconds, writerNs, total);
+    return ok && total.received + total.lost == options.events * options.readers && total.outOfOrder == 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--events" && i + 1 < argc) {
+            options.events = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--readers" && i + 1 < argc) {
+            options.readers = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--capacity" && i + 1 < argc) {
+            options.capacity = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--rate" && i + 1 < argc) {
+            options.rate = std::atof(argv[++i]);
+        } else if (arg == "--frame-ms" && i + 1 < argc) {
+            options.frameMs = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            std::fprintf(stderr, "Usage: %s [--events N] [--readers K] [--capacity N] [--rate EVENTS_PER_S]"
+                         " [--frame-ms N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (options.events == 0 || options.readers == 0 || options.capacity == 0) {
+        std::fprintf(stderr, "--events, --readers and --capacity must be positive\n");
+        return 1;
+    }
+
+    std::printf("%zu events in batches of %zu to %zu reader processes", options.events, kBatch, options.readers);
+    if (options.rate > 0) {
+        std::printf(" at %.0f events/s", options.rate);
+    }
+    if (options.frameMs > 0) {
+        std::printf(", readers polling every %u ms", options.frameMs);
+    }
+    std::printf("\n");
+    bool pipes = runPipes(options);
+    bool ring = runSharedRing(options);
+    if (!pipes || !ring) {
+        std::fprintf(stderr, "a reader missed events\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,300 @@
+/**
+ * @file bench_stroke_archive.cpp
+ * @brief Size, decode speed and query cost of the stroke archive format
+ *
+ * Assembles strokes, either from a capture file (decoded exactly as a live
+ * connection would) or from synthetic handwriting, writes them to a
+ * temporary archive and reads it back. Checks that every stroke round-trips
+ * (x, y and pressure exactly, times within half the resolution), then
+ * reports bytes per point against the wire format and 16-byte StylusEvents,
+ * the full-decode rate and the cost of random time-window and region queries.
+ *
+ * Usage: bench_stroke_archive [capture.wtcap] [--resolution NS] [--block POINTS] [--events N]
+ */
+
+#include "../include/CaptureFile.h"
+#include "../include/FrameDecoder.h"
+#include "../include/StrokeArchive.h"
+#include "../include/StrokeBuilder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+const int kDecodeRuns = 20;
+const int kQueries = 2000;
+
+uint64_t nowNs()
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+/**
+ * @brief Synthetic handwriting at 200 Hz with receive-time jitter, as host timestamps have
+ */
+std::vector<StylusEvent> makeHandwriting(size_t count)
+{
+    std::vector<StylusEvent> events;
+    events.reserve(count);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    double x = 10000;
+    double y = 7500;
+    double pressure = 500;
+    uint64_t time = 1000000000ULL;
+    uint32_t page = 0;
+    while (events.size() < count) {
+        size_t strokeLength = 20 + static_cast<size_t>(unit(rng) * 200);
+        double heading = unit(rng) * 6.283;
+        double turn = (unit(rng) - 0.5) * 0.2;
+        double speed = 10.0 + unit(rng) * 30.0;
+        for (size_t i = 0; i < strokeLength && events.size() + 1 < count; ++i) {
+            if (unit(rng) < 0.03) {
+                turn = (unit(rng) - 0.5) * 0.4;
+            }
+            heading += turn;
+            x = std::min(std::max(x + speed * std::cos(heading), 200.0), 19800.0);
+            y = std::min(std::max(y + speed * std::sin(heading), 200.0), 14800.0);
+            pressure = std::min(std::max(pressure + (unit(rng) - 0.5) * 40.0, 50.0), 1000.0);
+            time += 5000000 + static_cast<uint64_t>(unit(rng) * 300000);
+            StylusEvent event = {};
+            event.timestampNs = time;
+            event.x = static_cast<uint16_t>(x);
+            event.y = static_cast<uint16_t>(y);
+            event.pressure = static_cast<uint16_t>(pressure);
+            event.flags = STYLUS_IN_RANGE | STYLUS_TIP_DOWN;
+            events.push_back(event);
+        }
+        time += 100000000 + static_cast<uint64_t>(unit(rng) * 400000000);
+        StylusEvent up = {};
+        up.timestampNs = time;
+        up.x = static_cast<uint16_t>(x);
+        up.y = static_cast<uint16_t>(y);
+        up.flags = STYLUS_IN_RANGE;
+        if (unit(rng) < 0.01) {
+            up.flags |= STYLUS_PAGE_CLEAR;
+            ++page;
+        }
+        events.push_back(up);
+    }
+    return events;
+}
+
+/**
+ * @brief Decode every record of a capture into events; wireBytes receives the raw byte count
+ */
+bool readCapture(const std::string& path, std::vector<StylusEvent>& events, uint64_t& wireBytes)
+{
+    CaptureReader reader;
+    if (!reader.open(path)) {
+        std::fprintf(stderr, "%s\n", reader.getLastError().c_str());
+        return false;
+    }
+    FrameDecoder decoder;
+    StylusEvent buffer[256];
+    CaptureRecord record;
+    wireBytes = 0;
+    while (reader.next(record)) {
+        wireBytes += record.length;
+        size_t offset = 0;
+        while (offset < record.length) {
+            size_t produced = 0;
+            offset += decoder.decode(record.data + offset, record.length - offset, record.timestampNs, buffer,
+                                     sizeof(buffer) / sizeof(buffer[0]), produced);
+            events.insert(events.end(), buffer, buffer + produced);
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::string capturePath;
+    StrokeArchiveOptions options;
+    size_t eventCount = 2000000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--resolution" && i + 1 < argc) {
+            options.timeResolutionNs = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--block" && i + 1 < argc) {
+            options.pointsPerBlock = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--events" && i + 1 < argc) {
+            eventCount = std::strtoul(argv[++i], nullptr, 10);
+        } else if (!arg.empty() && arg[0] != '-' && capturePath.empty()) {
+            capturePath = arg;
+        } else {
+            std::fprintf(stderr, "Usage: %s [capture.wtcap] [--resolution NS] [--block POINTS] [--events N]\n",
+                         argv[0]);
+            return 1;
+        }
+    }
+    if (options.timeResolutionNs == 0 || options.pointsPerBlock == 0) {
+        std::fprintf(stderr, "Resolution and block size must be positive\n");
+        return 1;
+    }
+
+    std::vector<StylusEvent> events;
+    uint64_t wireBytes = 0;
+    if (!capturePath.empty()) {
+        if (!readCapture(capturePath, events, wireBytes)) {
+            return 1;
+        }
+    } else {
+        events = makeHandwriting(eventCount);
+    }
+
+    StrokeBuilder builder;
+    builder.addEvents(events.data(), events.size());
+    builder.finishStroke();
+    if (builder.strokeCount() == 0) {
+        std::fprintf(stderr, "No strokes in the input\n");
+        return 1;
+    }
+
+    char path[] = "/tmp/bench_stroke_archive_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        std::perror("mkstemp");
+        return 1;
+    }
+    ::close(fd);
+
+    StrokeArchiveWriter writer;
+    if (!writer.open(path, options)) {
+        std::fprintf(stderr, "%s\n", writer.getLastError().c_str());
+        return 1;
+    }
+    uint64_t writeStart = nowNs();
+    for (size_t i = 0; i < builder.strokeCount(); ++i) {
+        writer.append(builder.stroke(i));
+    }
+    bool written = writer.close();
+    uint64_t writeNs = nowNs() - writeStart;
+    if (!written) {
+        std::fprintf(stderr, "%s\n", writer.getLastError().c_str());
+        unlink(path);
+        return 1;
+    }
+
+    StrokeArchiveReader reader;
+    bool opened = reader.open(path);
+    uint64_t archiveBytes = writer.bytesWritten();
+    unlink(path);
+    if (!opened) {
+        std::fprintf(stderr, "%s\n", reader.getLastError().c_str());
+        return 1;
+    }
+
+    std::vector<ArchiveStrokeRef> refs;
+    reader.findStrokes(ArchiveQuery(), refs);
+    size_t maxPoints = 0;
+    for (const ArchiveStrokeRef& ref : refs) {
+        maxPoints = std::max<size_t>(maxPoints, ref.pointCount);
+    }
+
+    // Round trip
+    std::vector<uint16_t> xs(maxPoints), ys(maxPoints), ps(maxPoints);
+    std::vector<uint64_t> ts(maxPoints);
+    const uint64_t tolerance = options.timeResolutionNs / 2;
+    size_t mismatches = refs.size() == builder.strokeCount() ? 0 : 1;
+    for (size_t s = 0; s < refs.size() && s < builder.strokeCount(); ++s) {
+        const Stroke& stroke = builder.stroke(s);
+        if (refs[s].pointCount != stroke.count ||
+            !reader.decodeStroke(refs[s], xs.data(), ys.data(), ps.data(), ts.data())) {
+            ++mismatches;
+            continue;
+        }
+        for (uint32_t i = 0; i < stroke.count; ++i) {
+            uint64_t error = ts[i] > stroke.timestampNs[i] ? ts[i] - stroke.timestampNs[i]
+                                                           : stroke.timestampNs[i] - ts[i];
+            if (xs[i] != stroke.x[i] || ys[i] != stroke.y[i] || ps[i] != stroke.pressure[i] || error > tolerance) {
+                ++mismatches;
+                break;
+            }
+        }
+    }
+
+    // Full decode throughput (all four columns, as a renderer or exporter would)
+    uint64_t checksum = 0;
+    uint64_t decodeStart = nowNs();
+    for (int run = 0; run < kDecodeRuns; ++run) {
+        for (const ArchiveStrokeRef& ref : refs) {
+            reader.decodeStroke(ref, xs.data(), ys.data(), ps.data(), ts.data());
+            checksum += xs[ref.pointCount - 1] + ts[ref.pointCount - 1];
+        }
+    }
+    double decodeSeconds = (nowNs() - decodeStart) / 1e9;
+    double decodedPoints = static_cast<double>(reader.pointCount()) * kDecodeRuns;
+
+    // Random queries: a 10 s time window, and a 1/16-area region
+    std::mt19937 rng(11);
+    const uint64_t firstNs = refs.front().startNs;
+    const uint64_t spanNs = std::max<uint64_t>(refs.back().endNs - firstNs, 1);
+    std::vector<ArchiveStrokeRef> hits;
+    uint64_t timeHits = 0;
+    uint64_t timeQueryStart = nowNs();
+    for (int q = 0; q < kQueries; ++q) {
+        ArchiveQuery query;
+        query.fromNs = firstNs + rng() % spanNs;
+        query.toNs = query.fromNs + 10000000000ULL;
+        hits.clear();
+        timeHits += reader.findStrokes(query, hits);
+        for (const ArchiveStrokeRef& ref : hits) {
+            reader.decodeStroke(ref, xs.data(), ys.data(), nullptr, nullptr);
+        }
+    }
+    double timeQueryUs = (nowNs() - timeQueryStart) / 1e3 / kQueries;
+
+    uint64_t regionHits = 0;
+    uint64_t regionQueryStart = nowNs();
+    for (int q = 0; q < kQueries; ++q) {
+        ArchiveQuery query;
+        uint16_t x = static_cast<uint16_t>(rng() % 15000);
+        uint16_t y = static_cast<uint16_t>(rng() % 11250);
+        query.region = StrokeBounds{x, y, static_cast<uint16_t>(x + 5000), static_cast<uint16_t>(y + 3750)};
+        hits.clear();
+        regionHits += reader.findStrokes(query, hits);
+        for (const ArchiveStrokeRef& ref : hits) {
+            reader.decodeStroke(ref, xs.data(), ys.data(), nullptr, nullptr);
+        }
+    }
+    double regionQueryUs = (nowNs() - regionQueryStart) / 1e3 / kQueries;
+
+    const double points = static_cast<double>(reader.pointCount());
+    std::printf("%s: %llu strokes, %llu points, %zu blocks, time resolution %u ns (checksum %llu)\n",
+                capturePath.empty() ? "synthetic" : capturePath.c_str(),
+                static_cast<unsigned long long>(reader.strokeCount()), static_cast<unsigned long long>(reader.pointCount()),
+                reader.blockCount(), reader.timeResolutionNs(), static_cast<unsigned long long>(checksum));
+    std::printf("  round trip             %s (%zu mismatched strokes)\n", mismatches ? "FAILED" : "ok", mismatches);
+    std::printf("  archive                %llu bytes, %.2f bytes/point\n", static_cast<unsigned long long>(archiveBytes),
+                archiveBytes / points);
+    std::printf("  vs StylusEvent         %.1fx smaller (%.0f bytes/point in memory)\n",
+                sizeof(StylusEvent) * static_cast<double>(events.size()) / archiveBytes,
+                static_cast<double>(sizeof(StylusEvent)));
+    if (wireBytes > 0) {
+        std::printf("  vs wire bytes          %.1fx smaller (%.2f bytes/point received)\n",
+                    static_cast<double>(wireBytes) / archiveBytes, wireBytes / points);
+    }
+    std::printf("  write                  %.1f M points/s\n", points / (writeNs / 1e9) / 1e6);
+    std::printf("  decode                 %.1f M points/s, %.2f GB/s of columns\n", decodedPoints / decodeSeconds / 1e6,
+                decodedPoints * 14 / decodeSeconds / 1e9);
+    std::printf("  10 s window query      %.1f us, %.1f strokes (x/y decoded)\n", timeQueryUs,
+                static_cast<double>(timeHits) / kQueries);
+    std::printf("  1/16 region query      %.1f us, %.1f strokes (x/y decoded)\n", regionQueryUs,
+                static_cast<double>(regionHits) / kQueries);
+    return mismatches ? 1 : 0;
+}
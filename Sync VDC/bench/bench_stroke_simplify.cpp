@@ -0,0 +1,274 @@
+/**
+ * @file bench_stroke_simplify.cpp
+ * @brief Online stroke simplification for many devices on one core
+ *
+ * Generates synthetic handwriting (curved strokes with sensor jitter) and
+ * feeds it, in receive-sized batches, to one StrokeBuilder per device with
+ * simplification enabled. For each distance kernel it reports samples/s on
+ * this core, how many devices at the given sample rate that sustains, the
+ * point reduction ratio and the largest error. It also times the kernels
+ * alone, and checks that all kernels produce the same strokes and that no
+ * dropped point is farther than the tolerance from the output polyline.
+ *
+ * Usage: bench_stroke_simplify [--devices N] [--tolerance T] [--window W] [--rate HZ]
+ */
+
+#include "../include/StrokeBuilder.h"
+#include "../include/StrokeSimplifier.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const size_t kStreamCount = 8;
+const size_t kStreamEvents = 250000;
+const size_t kBatchEvents = 8;           // Events per receiveEvents() call
+const uint64_t kSamplesPerRun = 20000000;
+
+std::vector<StylusEvent> makeHandwriting(uint32_t seed, size_t count)
+{
+    std::vector<StylusEvent> events;
+    events.reserve(count);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::uniform_int_distribution<int> jitter(-1, 1);
+
+    double x = 10000;
+    double y = 10000;
+    uint64_t timeNs = 0;
+    while (events.size() < count) {
+        size_t strokeLength = 30 + static_cast<size_t>(unit(rng) * 400);
+        double heading = unit(rng) * 6.283;
+        double turn = (unit(rng) - 0.5) * 0.2;
+        double speed = 2.0 + unit(rng) * 6.0;
+        for (size_t i = 0; i < strokeLength && events.size() + 1 < count; ++i) {
+            if (unit(rng) < 0.02) {
+                turn = (unit(rng) - 0.5) * 0.3;  // Start of a new curve or a corner
+            }
+            heading += turn;
+            x = std::min(std::max(x + speed * std::cos(heading), 100.0), 30000.0);
+            y = std::min(std::max(y + speed * std::sin(heading), 100.0), 30000.0);
+            StylusEvent event = {};
+            event.timestampNs = timeNs;
+            event.x = static_cast<uint16_t>(std::lround(x) + jitter(rng));
+            event.y = static_cast<uint16_t>(std::lround(y) + jitter(rng));
+            event.pressure = static_cast<uint16_t>(300 + unit(rng) * 200);
+            event.flags = STYLUS_IN_RANGE | STYLUS_TIP_DOWN;
+            events.push_back(event);
+            timeNs += 5000000;
+        }
+        StylusEvent up = {};
+        up.timestampNs = timeNs;
+        up.x = static_cast<uint16_t>(x);
+        up.y = static_cast<uint16_t>(y);
+        up.flags = STYLUS_IN_RANGE;
+        events.push_back(up);
+        timeNs += 5000000;
+    }
+    return events;
+}
+
+double segmentDistance(double px, double py, double ax, double ay, double bx, double by)
+{
+    double ex = bx - ax;
+    double ey = by - ay;
+    double lengthSquared = ex * ex + ey * ey;
+    if (lengthSquared == 0.0) {
+        return std::hypot(px - ax, py - ay);
+    }
+    return std::fabs(ex * (py - ay) - ey * (px - ax)) / std::sqrt(lengthSquared);
+}
+
+/**
+ * @brief Simplify one stream with every kernel; check identical output and the error bound
+ */
+bool verify(const std::vector<StylusEvent>& stream, double tolerance, size_t window)
+{
+    std::vector<SimplifierKernel> kernels = {SimplifierKernel::SCALAR, SimplifierKernel::SSE2, SimplifierKernel::AVX2};
+    std::vector<std::vector<uint16_t>> outputs;
+    for (SimplifierKernel kernel : kernels) {
+        if (!StrokeSimplifier::isSupported(kernel)) {
+            continue;
+        }
+        StrokeBuilder builder;
+        builder.setSimplification(tolerance, window, kernel);
+        builder.addEvents(stream.data(), stream.size());
+        builder.finishStroke();
+
+        std::vector<uint16_t> output;
+        size_t raw = 0;
+        double worst = 0.0;
+        for (size_t s = 0; s < builder.strokeCount(); ++s) {
+            const Stroke& stroke = builder.stroke(s);
+            // Walk the raw samples of this stroke alongside the kept ones
+            while (!(stream[raw].flags & STYLUS_TIP_DOWN)) {
+                ++raw;
+            }
+            size_t kept = 0;
+            for (uint32_t i = 0; i < stroke.rawCount; ++i, ++raw) {
+                const StylusEvent& sample = stream[raw];
+                if (kept < stroke.count && sample.timestampNs == stroke.timestampNs[kept]) {
+                    ++kept;
+                    continue;
+                }
+                double d = segmentDistance(sample.x, sample.y, stroke.x[kept - 1], stroke.y[kept - 1],
+                                           stroke.x[kept], stroke.y[kept]);
+                worst = std::max(worst, d);
+            }
+            output.insert(output.end(), stroke.x, stroke.x + stroke.count);
+            output.insert(output.end(), stroke.y, stroke.y + stroke.count);
+        }
+        if (worst > tolerance + 1e-9) {
+            std::printf("FAIL: %s kernel left a point %.3f from the output (tolerance %.3f)\n",
+                        StrokeSimplifier::kernelName(kernel), worst, tolerance);
+            return false;
+        }
+        outputs.push_back(std::move(output));
+    }
+    for (size_t i = 1; i < outputs.size(); ++i) {
+        if (outputs[i] != outputs[0]) {
+            std::printf("FAIL: kernels produced different strokes\n");
+            return false;
+        }
+    }
+    std::printf("verified %zu kernels on %zu samples: identical output, error within tolerance\n",
+                outputs.size(), stream.size());
+    return true;
+}
+
+void benchKernels(size_t window)
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> coordinate(0.0, 30000.0);
+    std::vector<double> xs(window);
+    std::vector<double> ys(window);
+    for (size_t i = 0; i < window; ++i) {
+        xs[i] = coordinate(rng);
+        ys[i] = coordinate(rng);
+    }
+
+    const size_t iterations = 2000000;
+    std::printf("farthest-point search over %zu points:\n", window);
+    for (SimplifierKernel kernel : {SimplifierKernel::SCALAR, SimplifierKernel::SSE2, SimplifierKernel::AVX2}) {
+        if (!StrokeSimplifier::isSupported(kernel)) {
+            continue;
+        }
+        size_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            double maxCross = 0.0;
+            size_t first = i & 7;
+            sink += StrokeSimplifier::farthestPoint(kernel, xs.data(), ys.data(), first, window - 1, maxCross);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("  %-6s %6.2f ns/point  (checksum %zu)\n", StrokeSimplifier::kernelName(kernel),
+                    seconds * 1e9 / (iterations * (window - 5.5)), sink);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t devices = 256;
+    double tolerance = 1.5;
+    size_t window = StrokeSimplifier::DEFAULT_WINDOW;
+    double rateHz = 200;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--devices" && i + 1 < argc) {
+            devices = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--tolerance" && i + 1 < argc) {
+            tolerance = std::atof(argv[++i]);
+        } else if (arg == "--window" && i + 1 < argc) {
+            window = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--rate" && i + 1 < argc) {
+            rateHz = std::atof(argv[++i]);
+        } else {
+            std::fprintf(stderr, "Usage: %s [--devices N] [--tolerance T] [--window W] [--rate HZ]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (devices == 0 || tolerance <= 0 || rateHz <= 0) {
+        std::fprintf(stderr, "Devices, tolerance and rate must be positive\n");
+        return 1;
+    }
+
+    std::vector<std::vector<StylusEvent>> streams;
+    for (size_t s = 0; s < kStreamCount; ++s) {
+        streams.push_back(makeHandwriting(static_cast<uint32_t>(1000 + s), kStreamEvents));
+    }
+
+    if (!verify(streams[0], tolerance, window)) {
+        return 1;
+    }
+    benchKernels(window);
+
+    std::printf("%zu devices, tolerance %.2f, window %zu, %zu events per batch:\n", devices, tolerance, window,
+                kBatchEvents);
+    std::vector<SimplifierKernel> kernels = {SimplifierKernel::SCALAR, SimplifierKernel::SSE2, SimplifierKernel::AVX2};
+    for (int pass = -1; pass < static_cast<int>(kernels.size()); ++pass) {
+        bool simplify = pass >= 0;
+        if (simplify && !StrokeSimplifier::isSupported(kernels[pass])) {
+            continue;
+        }
+
+        std::vector<std::unique_ptr<StrokeBuilder>> builders;
+        std::vector<size_t> positions;
+        for (size_t d = 0; d < devices; ++d) {
+            builders.emplace_back(new StrokeBuilder());
+            if (simplify) {
+                builders.back()->setSimplification(tolerance, window, kernels[pass]);
+            }
+            positions.push_back((d * 7919) % (kStreamEvents - kBatchEvents));
+        }
+
+        uint64_t samples = 0;
+        auto start = std::chrono::steady_clock::now();
+        while (samples < kSamplesPerRun) {
+            for (size_t d = 0; d < devices; ++d) {
+                const std::vector<StylusEvent>& stream = streams[d % kStreamCount];
+                size_t& position = positions[d];
+                if (position + kBatchEvents > stream.size()) {
+                    position = 0;
+                }
+                StrokeBuilder& builder = *builders[d];
+                builder.addEvents(stream.data() + position, kBatchEvents);
+                position += kBatchEvents;
+                if (builder.sampleCount() > 1000000) {
+                    builder.clear();  // Long session: recycle the arena
+                }
+            }
+            samples += devices * kBatchEvents;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        SimplifierStats total;
+        for (auto& builder : builders) {
+            SimplifierStats stats = builder->simplifierStats();
+            total.inputPoints += stats.inputPoints;
+            total.outputPoints += stats.outputPoints;
+            total.maxError = std::max(total.maxError, stats.maxError);
+        }
+        double rate = samples / seconds;
+        if (simplify) {
+            std::printf("  %-8s %6.1f M samples/s  %8.0f ns/batch  %7.0f devices at %.0f Hz  "
+                        "reduction %.1fx  max error %.2f\n",
+                        StrokeSimplifier::kernelName(kernels[pass]), rate / 1e6,
+                        seconds * 1e9 / (samples / kBatchEvents), rate / rateHz, rateHz,
+                        total.reductionRatio(), total.maxError);
+        } else {
+            std::printf("  %-8s %6.1f M samples/s  %8.0f ns/batch  (stroke assembly only)\n", "none", rate / 1e6,
+                        seconds * 1e9 / (samples / kBatchEvents));
+        }
+    }
+    return 0;
+}
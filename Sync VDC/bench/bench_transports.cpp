@@ -0,0 +1,310 @@
+/**
+ * @file bench_transports.cpp
+ * @brief The same workloads over each transport backend, side by side
+ *
+ * stream      N pen frames decoded with receiveEvents(). loopback: the frames
+ *             are sent with sendBatch() first; pty and serial: the simulator
+ *             streams them as fast as the reader drains (64 frames per
+ *             write); replay: a capture of the same bursts played at @max.
+ * round trip  A command frame goes out and its answer is decoded. loopback:
+ *             the echo of the command; pty and serial: the simulator's
+ *             acknowledgement. Not applicable to replay.
+ *
+ * pty and serial open the same simulator pty, once as "PTY:" (raw mode
+ * only) and once as "BT:" (full serial setup), so the difference between
+ * them is the backend and not the device.
+ *
+ * Usage: bench_transports [--events N] [--round-trips N]
+ */
+
+#include "../include/WT13106Connection.h"
+#include "../include/WT13106Simulator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+struct Options {
+    size_t events = 200000;
+    size_t roundTrips = 2000;
+};
+
+struct Result {
+    bool ok = false;
+    double eventsPerSecond = 0;
+    double readsPerThousand = 0;
+    double roundTripP50Us = -1;
+    double roundTripP99Us = -1;
+};
+
+const size_t kFramesPerBurst = 64;
+const uint8_t kCommandType = 0x10;
+
+uint64_t nowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+std::vector<uint8_t> encodePenFrames(size_t count)
+{
+    std::vector<uint8_t> bytes(count * PEN_FRAME_SIZE);
+    for (size_t i = 0; i < count; ++i) {
+        StylusEvent event = {};
+        event.x = static_cast<uint16_t>(i);
+        event.y = static_cast<uint16_t>(i >> 16);
+        event.pressure = 512;
+        event.flags = STYLUS_TIP_DOWN | STYLUS_IN_RANGE;
+        encodePenFrame(event, bytes.data() + i * PEN_FRAME_SIZE);
+    }
+    return bytes;
+}
+
+/**
+ * @brief Decode events until count have arrived; returns false on a stall
+ */
+bool receiveAll(WT13106Connection& connection, size_t count)
+{
+    StylusEvent events[256];
+    size_t received = 0;
+    while (received < count) {
+        size_t n = connection.receiveEvents(events, 256, 2000);
+        if (n == 0) {
+            std::fprintf(stderr, "  stalled after %zu of %zu events: %s\n", received, count,
+                         connection.getLastError().c_str());
+            return false;
+        }
+        received += n;
+    }
+    return true;
+}
+
+void measureStream(WT13106Connection& connection, size_t count, uint64_t startNs, Result& result)
+{
+    connection.resetMetrics();
+    if (startNs == 0) {
+        // Streaming sources: start the clock at the first event
+        StylusEvent first;
+        if (connection.receiveEvents(&first, 1, 2000) == 0) {
+            return;
+        }
+        startNs = nowNs();
+    }
+    if (!receiveAll(connection, count)) {
+        return;
+    }
+    double seconds = double(nowNs() - startNs) / 1e9;
+    ConnectionMetricsSnapshot metrics = connection.getMetrics();
+    result.eventsPerSecond = double(count) / seconds;
+    result.readsPerThousand = double(metrics.readCalls) * 1000.0 / double(count);
+    result.ok = true;
+}
+
+/**
+ * @brief Time command -> answer with raw reads and a local decoder
+ *
+ * receiveEvents() would keep waiting for a pen event after the answer, so
+ * the answer is picked out of the raw bytes instead.
+ */
+void measureRoundTrips(WT13106Connection& connection, size_t count, Result& result)
+{
+    size_t answers = 0;
+    FrameDecoder decoder;
+    decoder.setFrameHandler([&answers](const FrameView&) { ++answers; });
+
+    std::vector<uint64_t> samples;
+    samples.reserve(count);
+    StylusEvent events[64];
+    uint8_t buffer[4096];
+    uint8_t payload[4] = {1, 2, 3, 4};
+    uint8_t frame[FRAME_MAX_SIZE];
+    for (size_t i = 0; i < count; ++i) {
+        size_t length = encodeFrame(kCommandType, static_cast<uint8_t>(i), payload, sizeof(payload), frame);
+        size_t before = answers;
+        uint64_t started = nowNs();
+        if (!connection.sendCommand(frame, length)) {
+            std::fprintf(stderr, "  send: %s\n", connection.getLastError().c_str());
+            result.ok = false;
+            return;
+        }
+        while (answers == before) {
+            size_t n = connection.receiveInto(buffer, sizeof(buffer), 1000);
+            if (n == 0) {
+                std::fprintf(stderr, "  no answer to command %zu\n", i);
+                result.ok = false;
+                return;
+            }
+            for (size_t offset = 0; offset < n;) {
+                size_t produced = 0;
+                offset += decoder.decode(buffer + offset, n - offset, 0, events, 64, produced);
+            }
+        }
+        samples.push_back(nowNs() - started);
+    }
+    std::sort(samples.begin(), samples.end());
+    result.roundTripP50Us = samples[samples.size() / 2] / 1000.0;
+    result.roundTripP99Us = samples[samples.size() * 99 / 100] / 1000.0;
+}
+
+Result runLoopback(const Options& options)
+{
+    Result result;
+    WT13106Connection connection("LOOPBACK:");
+    connection.setMetricsEnabled(true);
+    if (!connection.connect()) {
+        std::fprintf(stderr, "loopback: %s\n", connection.getLastError().c_str());
+        return result;
+    }
+
+    std::vector<uint8_t> frames = encodePenFrames(options.events);
+    std::vector<CommandBuffer> bursts;
+    for (size_t offset = 0; offset < frames.size(); offset += kFramesPerBurst * PEN_FRAME_SIZE) {
+        bursts.push_back({frames.data() + offset,
+                          std::min(kFramesPerBurst * PEN_FRAME_SIZE, frames.size() - offset)});
+    }
+    uint64_t started = nowNs();
+    if (!connection.sendBatch(bursts.data(), bursts.size())) {
+        std::fprintf(stderr, "loopback: %s\n", connection.getLastError().c_str());
+        return result;
+    }
+    measureStream(connection, options.events, started, result);
+    if (result.ok) {
+        measureRoundTrips(connection, options.roundTrips, result);
+    }
+    return result;
+}
+
+Result runSimulator(const std::string& prefix, const Options& options)
+{
+    Result result;
+
+    // Stream: as fast as the reader drains
+    {
+        SimulatorOptions simOptions;
+        simOptions.sampleRateHz = 0;
+        simOptions.framesPerWrite = kFramesPerBurst;
+        simOptions.maxBacklogBytes = 1024 * 1024;
+        WT13106Simulator simulator;
+        if (!simulator.start(simOptions)) {
+            std::fprintf(stderr, "simulator: %s\n", simulator.getLastError().c_str());
+            return result;
+        }
+        WT13106Connection connection(prefix + simulator.devicePath());
+        connection.setMetricsEnabled(true);
+        if (!connection.connect()) {
+            std::fprintf(stderr, "%s: %s\n", prefix.c_str(), connection.getLastError().c_str());
+            return result;
+        }
+        measureStream(connection, options.events, 0, result);
+    }
+    if (!result.ok) {
+        return result;
+    }
+
+    // Round trips: slow pen traffic so the acknowledgements are not queued behind it
+    SimulatorOptions simOptions;
+    simOptions.sampleRateHz = 50;
+    WT13106Simulator simulator;
+    if (!simulator.start(simOptions)) {
+        std::fprintf(stderr, "simulator: %s\n", simulator.getLastError().c_str());
+        result.ok = false;
+        return result;
+    }
+    WT13106Connection connection(prefix + simulator.devicePath());
+    if (!connection.connect()) {
+        std::fprintf(stderr, "%s: %s\n", prefix.c_str(), connection.getLastError().c_str());
+        result.ok = false;
+        return result;
+    }
+    measureRoundTrips(connection, options.roundTrips, result);
+    return result;
+}
+
+Result runReplay(const Options& options)
+{
+    Result result;
+    std::string path = "/tmp/bench_transports_" + std::to_string(getpid()) + ".wtcap";
+
+    std::vector<uint8_t> frames = encodePenFrames(options.events);
+    CaptureWriter writer;
+    if (!writer.open(path)) {
+        std::fprintf(stderr, "replay: cannot write %s\n", path.c_str());
+        return result;
+    }
+    uint64_t timestampNs = 1000000;
+    for (size_t offset = 0; offset < frames.size(); offset += kFramesPerBurst * PEN_FRAME_SIZE) {
+        writer.append(timestampNs, frames.data() + offset,
+                      std::min(kFramesPerBurst * PEN_FRAME_SIZE, frames.size() - offset));
+        timestampNs += 1000000;
+    }
+    writer.close();
+
+    {
+        WT13106Connection connection("REPLAY:" + path + "@max");
+        connection.setMetricsEnabled(true);
+        if (connection.connect()) {
+            measureStream(connection, options.events, nowNs(), result);
+        } else {
+            std::fprintf(stderr, "replay: %s\n", connection.getLastError().c_str());
+        }
+    }
+    std::remove(path.c_str());
+    return result;
+}
+
+void print(const char* name, const Result& result)
+{
+    if (!result.ok) {
+        std::printf("%-9s  failed\n", name);
+        return;
+    }
+    std::printf("%-9s  %10.0f events/s  %7.2f reads/1k events", name, result.eventsPerSecond,
+                result.readsPerThousand);
+    if (result.roundTripP50Us >= 0) {
+        std::printf("  round trip p50 %6.1f us  p99 %6.1f us\n", result.roundTripP50Us, result.roundTripP99Us);
+    } else {
+        std::printf("  round trip       -\n");
+    }
+    std::fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--events" && i + 1 < argc) {
+            options.events = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--round-trips" && i + 1 < argc) {
+            options.roundTrips = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            std::fprintf(stderr, "Usage: %s [--events N] [--round-trips N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (options.events == 0 || options.roundTrips == 0) {
+        std::fprintf(stderr, "--events and --round-trips must be positive\n");
+        return 1;
+    }
+
+    std::printf("%zu pen events streamed, %zu command round trips per transport\n", options.events,
+                options.roundTrips);
+    Result loopback = runLoopback(options);
+    print("loopback", loopback);
+    Result pty = runSimulator("PTY:", options);
+    print("pty", pty);
+    Result serial = runSimulator("BT:", options);
+    print("serial", serial);
+    Result replay = runReplay(options);
+    print("replay", replay);
+    return loopback.ok && pty.ok && serial.ok && replay.ok ? 0 : 1;
+}
@@ -0,0 +1,432 @@
+/**
+ * @file bench_wt13106.cpp
+ * @brief End-to-end latency and throughput of WT13106Connection against the simulator
+ *
+ * Four phases, each against a fresh WT13106Simulator on a pty:
+ *   latency     paced pen samples; per-event latency from the simulator's write
+ *               to the StylusEvent timestamp in receiveEvents()
+ *   throughput  unpaced stream; sustained events/s and MB/s
+ *   command     stop-and-wait request/reply round trips while pen samples stream
+ *   pipelined   the same requests through submit() with several outstanding
+ *
+ * Usage: bench_wt13106 [--streaming] [--metrics] [--rate HZ] [--seconds S] [--frames-per-write N]
+ *                      [--depth N] [--async-low-latency] [--rt PRIO] [--cpu N] [--busy-poll US]
+ *                      [--latency-modes]
+ *   --streaming          receive through startStreaming() instead of direct reads
+ *   --metrics            enable connection metrics and print each phase's JSON snapshot
+ *   --depth              requests kept outstanding in the pipelined phase
+ *   --async-low-latency, --rt, --cpu, --busy-poll
+ *                        LowLatencyOptions for every phase (SCHED_FIFO priority,
+ *                        reader CPU, busy-poll window)
+ *   --latency-modes      run only the latency phase, once per receive mode
+ *                        (blocking/busy-poll, direct/streaming, SCHED_FIFO +
+ *                        pinned reader), and print the CPU time each costs
+ */
+
+#include "../include/WT13106Connection.h"
+#include "../include/WT13106Simulator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace {
+
+struct Options {
+    bool streaming = false;
+    bool metrics = false;
+    double rateHz = 1000.0;
+    double seconds = 3.0;
+    size_t framesPerWrite = 64;  // Throughput phase only
+    size_t depth = 16;           // Pipelined phase only
+    LowLatencyOptions lowLatency;
+    bool latencyModes = false;
+};
+
+bool openConnection(WT13106Simulator& simulator, WT13106Connection& connection, const Options& options)
+{
+    connection.setMetricsEnabled(options.metrics);
+    connection.setLowLatencyOptions(options.lowLatency);
+    if (!connection.connect()) {
+        std::fprintf(stderr, "connect %s: %s\n", simulator.connectionString().c_str(),
+                     connection.getLastError().c_str());
+        return false;
+    }
+    if (options.streaming && !connection.startStreaming()) {
+        std::fprintf(stderr, "startStreaming: %s\n", connection.getLastError().c_str());
+        return false;
+    }
+    return true;
+}
+
+void printMetrics(const WT13106Connection& connection, const Options& options)
+{
+    if (options.metrics) {
+        std::printf("            metrics %s\n", connection.getMetrics().toJson().c_str());
+    }
+}
+
+double percentile(const std::vector<uint64_t>& sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    return sorted[static_cast<size_t>(p * (sorted.size() - 1))] / 1000.0;
+}
+
+/**
+ * @brief User + system CPU time of the whole process (reader, consumer and simulator threads)
+ */
+double processCpuSeconds()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+const char* yesNo(bool value)
+{
+    return value ? "yes" : "no";
+}
+
+bool runLatency(const Options& options, const char* label = nullptr)
+{
+    SimulatorOptions simOptions;
+    simOptions.sampleRateHz = options.rateHz;
+    simOptions.framesPerWrite = 1;
+    simOptions.pattern = SimulatorPattern::COUNTER;
+
+    WT13106Simulator simulator;
+    if (!simulator.start(simOptions)) {
+        std::fprintf(stderr, "simulator: %s\n", simulator.getLastError().c_str());
+        return false;
+    }
+    WT13106Connection connection(simulator.connectionString());
+    if (!openConnection(simulator, connection, options)) {
+        return false;
+    }
+
+    std::vector<uint64_t> latencies;
+    latencies.reserve(static_cast<size_t>(options.rateHz * options.seconds) + 1024);
+    StylusEvent events[256];
+    uint64_t expected = 0;
+    uint64_t lost = 0;
+    bool first = true;
+
+    double cpuStart = processCpuSeconds();
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::duration<double>(options.seconds);
+    while (std::chrono::steady_clock::now() < end) {
+        size_t count = connection.receiveEvents(events, 256, 100);
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t index = events[i].x | (static_cast<uint64_t>(events[i].y) << 16);
+            if (!first && index != expected) {
+                lost += index > expected ? index - expected : 0;
+            }
+            first = false;
+            expected = index + 1;
+            latencies.push_back(events[i].timestampNs - simulator.sendTimeNs(events[i].x));
+        }
+    }
+    double cpuPercent = 100.0 * (processCpuSeconds() - cpuStart) /
+                        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LowLatencyStatus status = connection.getLowLatencyStatus();
+    connection.disconnect();
+    simulator.stop();
+
+    std::sort(latencies.begin(), latencies.end());
+    if (label) {
+        std::printf("%-22s p50 %6.1f us  p99 %6.1f us  p99.9 %7.1f us  max %7.1f us  cpu %3.0f%%  lost %llu\n",
+                    label, percentile(latencies, 0.50), percentile(latencies, 0.99), percentile(latencies, 0.999),
+                    percentile(latencies, 1.0), cpuPercent, static_cast<unsigned long long>(lost));
+    } else {
+        std::printf("latency     %.0f Hz, %zu events, %llu lost, cpu %.0f%%\n", options.rateHz, latencies.size(),
+                    static_cast<unsigned long long>(lost), cpuPercent);
+        std::printf("            p50 %.1f us  p90 %.1f us  p99 %.1f us  p99.9 %.1f us  max %.1f us\n",
+                    percentile(latencies, 0.50), percentile(latencies, 0.90), percentile(latencies, 0.99),
+                    percentile(latencies, 0.999), percentile(latencies, 1.0));
+    }
+    const LowLatencyOptions& tuning = options.lowLatency;
+    if (tuning.asyncLowLatency || tuning.realtimePriority > 0 || tuning.cpu >= 0) {
+        std::printf("%-22s ASYNC_LOW_LATENCY %s, SCHED_FIFO %s, pinned %s\n", label ? "" : "           ",
+                    tuning.asyncLowLatency ? yesNo(status.asyncLowLatency) : "-",
+                    tuning.realtimePriority > 0 ? yesNo(status.realtimeScheduling) : "-",
+                    tuning.cpu >= 0 ? yesNo(status.cpuPinned) : "-");
+    }
+    printMetrics(connection, options);
+    return !latencies.empty() && lost == 0;
+}
+
+bool runThroughput(const Options& options)
+{
+    SimulatorOptions simOptions;
+    simOptions.sampleRateHz = 0;
+    simOptions.framesPerWrite = options.framesPerWrite;
+    simOptions.pattern = SimulatorPattern::COUNTER;
+
+    WT13106Simulator simulator;
+    if (!simulator.start(simOptions)) {
+        std::fprintf(stderr, "simulator: %s\n", simulator.getLastError().c_str());
+        return false;
+    }
+    WT13106Connection connection(simulator.connectionString());
+    if (!openConnection(simulator, connection, options)) {
+        return false;
+    }
+
+    StylusEvent events[1024];
+    uint64_t received = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::duration<double>(options.seconds);
+    while (std::chrono::steady_clock::now() < end) {
+        received += connection.receiveEvents(events, 1024, 100);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    connection.disconnect();
+    simulator.stop();
+
+    std::printf("throughput  %zu frames/write: %.0f events/s, %.1f MB/s, %llu dropped by simulator\n",
+                options.framesPerWrite, received / seconds, received * PEN_FRAME_SIZE / seconds / 1e6,
+                static_cast<unsigned long long>(simulator.framesDropped()));
+    printMetrics(connection, options);
+    return received > 0;
+}
+
+bool runCommands(const Options& options)
+{
+    SimulatorOptions simOptions;
+    simOptions.sampleRateHz = 1000;
+    simOptions.pattern = SimulatorPattern::CIRCLE;
+
+    WT13106Simulator simulator;
+    if (!simulator.start(simOptions)) {
+        std::fprintf(stderr, "simulator: %s\n", simulator.getLastError().c_str());
+        return false;
+    }
+    WT13106Connection connection(simulator.connectionString());
+
+    // receiveEvents() only returns once pen events arrive, so time the reply
+    // by its receive timestamp rather than by when the loop notices it
+    int lastReply = -1;
+    uint64_t replyNs = 0;
+    connection.setFrameHandler([&lastReply, &replyNs](const FrameView& frame) {
+        lastReply = frame.sequence;
+        replyNs = frame.timestampNs;
+    });
+    if (!openConnection(simulator, connection, options)) {
+        return false;
+    }
+
+    const int rounds = 1000;
+    std::vector<uint64_t> roundTrips;
+    auto start = std::chrono::steady_clock::now();
+    StylusEvent events[64];
+    uint8_t command[FRAME_MAX_SIZE];
+    const uint8_t payload[4] = {0x10, 0x20, 0x30, 0x40};
+
+    for (int i = 0; i < rounds; ++i) {
+        uint8_t sequence = static_cast<uint8_t>(i);
+        size_t n = encodeFrame(0x02, sequence, payload, sizeof(payload), command);
+        auto sent = std::chrono::steady_clock::now();
+        if (!connection.sendCommand(command, n)) {
+            std::fprintf(stderr, "sendCommand: %s\n", connection.getLastError().c_str());
+            return false;
+        }
+        auto deadline = sent + std::chrono::milliseconds(500);
+        while (lastReply != sequence && std::chrono::steady_clock::now() < deadline) {
+            connection.receiveEvents(events, 64, 50);
+        }
+        if (lastReply != sequence) {
+            std::fprintf(stderr, "No reply to command %d\n", i);
+            return false;
+        }
+        roundTrips.push_back(replyNs - static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            sent.time_since_epoch()).count()));
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    connection.disconnect();
+    simulator.stop();
+
+    std::sort(roundTrips.begin(), roundTrips.end());
+    std::printf("command     %d round trips: %.0f requests/s  p50 %.1f us  p99 %.1f us  max %.1f us\n", rounds,
+                rounds / seconds, percentile(roundTrips, 0.50), percentile(roundTrips, 0.99),
+                percentile(roundTrips, 1.0));
+    printMetrics(connection, options);
+    return true;
+}
+
+bool runPipelined(const Options& options)
+{
+    SimulatorOptions simOptions;
+    simOptions.sampleRateHz = 1000;
+    simOptions.pattern = SimulatorPattern::CIRCLE;
+
+    WT13106Simulator simulator;
+    if (!simulator.start(simOptions)) {
+        std::fprintf(stderr, "simulator: %s\n", simulator.getLastError().c_str());
+        return false;
+    }
+    WT13106Connection connection(simulator.connectionString());
+    if (!openConnection(simulator, connection, options)) {
+        return false;
+    }
+
+    const size_t rounds = 1000;
+    std::vector<uint64_t> roundTrips;
+    size_t submitted = 0;
+    size_t failures = 0;
+    size_t wrongPayload = 0;
+    uint64_t penEvents = 0;
+    uint8_t payload[4];
+    StylusEvent events[64];
+    SubmitOptions submitOptions;
+    submitOptions.timeoutMs = 500;
+
+    // Each completion submits the next request from inside the callback, so
+    // the pipeline is refilled as soon as a reply is decoded
+    std::function<void()> submitNext = [&]() {
+        if (submitted == rounds) {
+            return;
+        }
+        // The simulator echoes the payload, so tag each request with its index
+        uint32_t index = static_cast<uint32_t>(submitted++);
+        std::memcpy(payload, &index, sizeof(payload));
+        connection.submit(0x02, payload, sizeof(payload), [&, index](const Response& response) {
+            if (!response.ok()) {
+                ++failures;
+            } else {
+                uint32_t echoed = 0;
+                if (response.payload.size() == sizeof(echoed)) {
+                    std::memcpy(&echoed, response.payload.data(), sizeof(echoed));
+                }
+                wrongPayload += echoed != index ? 1 : 0;
+                roundTrips.push_back(response.roundTripNs);
+            }
+            submitNext();
+        }, submitOptions);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < options.depth; ++i) {
+        submitNext();
+    }
+    while (roundTrips.size() + failures < rounds) {
+        penEvents += connection.receiveEvents(events, 64, 50);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    connection.disconnect();
+    simulator.stop();
+
+    std::sort(roundTrips.begin(), roundTrips.end());
+    std::printf("pipelined   %zu requests, depth %zu: %.0f requests/s  p50 %.1f us  p99 %.1f us  max %.1f us\n",
+                rounds, options.depth, rounds / seconds, percentile(roundTrips, 0.50),
+                percentile(roundTrips, 0.99), percentile(roundTrips, 1.0));
+    std::printf("            %zu failed, %zu mismatched, %llu pen events received alongside\n", failures,
+                wrongPayload, static_cast<unsigned long long>(penEvents));
+    printMetrics(connection, options);
+    return failures == 0 && wrongPayload == 0;
+}
+
+/**
+ * @brief Latency phase once per receive mode, on top of the command-line tuning
+ */
+bool runLatencyModes(const Options& base)
+{
+    struct Mode {
+        const char* label;
+        bool streaming;
+        bool busyPoll;
+        bool realtime;
+    };
+    const Mode modes[] = {
+        {"direct, blocking", false, false, false},
+        {"direct, busy-poll", false, true, false},
+        {"streaming, blocking", true, false, false},
+        {"streaming, busy-poll", true, true, false},
+        {"streaming, FIFO+pinned", true, false, true},
+    };
+    uint32_t busyPollUs = base.lowLatency.busyPollUs ? base.lowLatency.busyPollUs : 2000;
+
+    std::printf("Latency by receive mode, %.0f Hz for %.1f s each (busy-poll window %u us)\n", base.rateHz,
+                base.seconds, busyPollUs);
+    bool ok = true;
+    for (const Mode& mode : modes) {
+        Options options = base;
+        options.streaming = mode.streaming;
+        options.lowLatency.asyncLowLatency = true;
+        options.lowLatency.busyPollUs = mode.busyPoll ? busyPollUs : 0;
+        if (mode.realtime) {
+            options.lowLatency.realtimePriority = base.lowLatency.realtimePriority ? base.lowLatency.realtimePriority
+                                                                                   : 50;
+            options.lowLatency.cpu = base.lowLatency.cpu >= 0 ? base.lowLatency.cpu : 0;
+        } else {
+            options.lowLatency.realtimePriority = 0;
+            options.lowLatency.cpu = -1;
+        }
+        ok = runLatency(options, mode.label) && ok;
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--streaming") {
+            options.streaming = true;
+        } else if (arg == "--metrics") {
+            options.metrics = true;
+        } else if (arg == "--rate" && i + 1 < argc) {
+            options.rateHz = std::atof(argv[++i]);
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            options.seconds = std::atof(argv[++i]);
+        } else if (arg == "--frames-per-write" && i + 1 < argc) {
+            options.framesPerWrite = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--depth" && i + 1 < argc) {
+            options.depth = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--async-low-latency") {
+            options.lowLatency.asyncLowLatency = true;
+        } else if (arg == "--rt" && i + 1 < argc) {
+            options.lowLatency.realtimePriority = std::atoi(argv[++i]);
+        } else if (arg == "--cpu" && i + 1 < argc) {
+            options.lowLatency.cpu = std::atoi(argv[++i]);
+        } else if (arg == "--busy-poll" && i + 1 < argc) {
+            options.lowLatency.busyPollUs = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--latency-modes") {
+            options.latencyModes = true;
+        } else {
+            std::fprintf(stderr,
+                         "Usage: %s [--streaming] [--metrics] [--rate HZ] [--seconds S] [--frames-per-write N] "
+                         "[--depth N]\n"
+                         "          [--async-low-latency] [--rt PRIO] [--cpu N] [--busy-poll US] [--latency-modes]\n",
+                         argv[0]);
+            return 1;
+        }
+    }
+    if (options.rateHz <= 0 || options.seconds <= 0 || options.framesPerWrite == 0 || options.depth == 0 ||
+        options.depth > 256) {
+        std::fprintf(stderr, "Rate, duration and frames per write must be positive, depth 1..256\n");
+        return 1;
+    }
+
+    if (options.latencyModes) {
+        return runLatencyModes(options) ? 0 : 1;
+    }
+
+    std::printf("Receive path: %s\n", options.streaming ? "streaming (background reader)" : "direct reads");
+    bool ok = runLatency(options);
+    ok = runThroughput(options) && ok;
+    ok = runCommands(options) && ok;
+    ok = runPipelined(options) && ok;
+    return ok ? 0 : 1;
+}
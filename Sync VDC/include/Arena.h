@@ -0,0 +1,78 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Bump allocator over a list of large blocks
+ *
+ * allocate() hands out aligned ranges from the current block and moves to
+ * the next one when it is full; requests larger than the block size get a
+ * block of their own. Nothing is freed individually. reset() makes every
+ * block available again without returning memory to the heap, so a
+ * long-running user that resets periodically reaches a steady state with no
+ * allocations at all. Memory handed out never moves.
+ *
+ * Not thread-safe.
+ */
+class Arena {
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 1 << 20;
+
+    explicit Arena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /**
+     * @brief Allocate size bytes aligned to align (a power of two, at most 16)
+     */
+    void* allocate(size_t size, size_t align);
+
+    /**
+     * @brief Allocate uninitialized storage for count objects of trivial type T
+     */
+    template <typename T>
+    T* allocateArray(size_t count)
+    {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    /**
+     * @brief Forget every allocation, keeping the blocks for reuse
+     */
+    void reset();
+
+    /**
+     * @brief Release all blocks back to the heap
+     */
+    void release();
+
+    /**
+     * @brief Bytes handed out since the last reset()
+     */
+    size_t bytesUsed() const { return m_used; }
+
+    /**
+     * @brief Bytes held in blocks
+     */
+    size_t bytesReserved() const { return m_reserved; }
+
+private:
+    struct Block {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size;
+    };
+
+    size_t m_blockSize;
+    std::vector<Block> m_blocks;
+    size_t m_current;   // Block being carved
+    size_t m_offset;    // Next free byte in the current block
+    size_t m_used;
+    size_t m_reserved;
+};
+
+#endif // ARENA_H
@@ -0,0 +1,478 @@
+#ifndef BROADCAST_RING_H
+#define BROADCAST_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+/**
+ * @brief What the producer does when a subscriber falls a whole ring behind
+ */
+enum class SlowSubscriberPolicy {
+    BLOCK,     // The producer waits for the subscriber; nothing is lost
+    SKIP,      // The subscriber is moved ahead, keeping the newest half ring
+    SNAPSHOT   // The subscriber's backlog is dropped; it resumes at the newest data and should rebuild its state
+};
+
+/**
+ * @brief Outcome of one BroadcastRing::consume()
+ */
+struct BroadcastRead {
+    size_t count = 0;       // Elements handed to the handler
+    uint64_t lost = 0;      // Elements the subscriber was moved past since its last read
+    bool resync = false;    // SNAPSHOT subscriber was moved; earlier state is stale
+    bool closed = false;    // The producer closed the ring and everything was read
+};
+
+/**
+ * @brief Per-subscriber counters (see BroadcastRing::stats())
+ */
+struct BroadcastSubscriberStats {
+    uint64_t received = 0;  // Elements handed to the handler
+    uint64_t lost = 0;      // Elements skipped under SKIP or SNAPSHOT
+    uint64_t overruns = 0;  // Times the producer found the subscriber a full ring behind
+    uint64_t stalls = 0;    // Times the producer had to wait for this subscriber
+    uint64_t lag = 0;       // Published elements not yet read
+};
+
+/**
+ * @brief Single-producer, multi-consumer broadcast ring (disruptor style)
+ *
+ * Every element is written once by the producer and read in place by each
+ * subscriber, which keeps its own sequence cursor; elements are numbered
+ * by a 64-bit sequence that never wraps. Neither side takes a lock while
+ * data flows: the producer waits only for the slowest subscriber (and only
+ * re-reads the cursors when its cached minimum says the ring looks full),
+ * a subscriber only for new data.
+ *
+ * When the ring is full because of a subscriber, that subscriber's
+ * SlowSubscriberPolicy decides: BLOCK holds the producer back, SKIP and
+ * SNAPSHOT move the subscriber's cursor forward and the subscriber finds
+ * out from BroadcastRead::lost on its next consume(). A subscriber that is
+ * inside its handler is never moved; the producer waits for the handler to
+ * return, so handlers should be short and must not throw.
+ *
+ * One thread may call claim()/commit()/publish()/close(); each subscriber
+ * id is consumed by one thread at a time. subscribe(), unsubscribe() and
+ * stats() may be called from any thread. Nothing allocates after
+ * construction.
+ *
+ * @tparam T Trivially copyable element type
+ */
+template <typename T>
+class BroadcastRing {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "BroadcastRing elements must be trivially copyable");
+
+public:
+    using Deadline = std::chrono::steady_clock::time_point;
+
+    /**
+     * @brief Constructor
+     * @param capacity Minimum number of elements the ring can hold
+     * @param maxSubscribers Number of subscriber slots
+     */
+    explicit BroadcastRing(size_t capacity, size_t maxSubscribers = 8)
+        : m_capacity(roundUpPowerOfTwo(capacity < 2 ? 2 : capacity))
+        , m_mask(m_capacity - 1)
+        , m_buffer(new T[m_capacity])
+        , m_maxSubscribers(maxSubscribers)
+        , m_slots(new Slot[maxSubscribers])
+    {
+    }
+
+    BroadcastRing(const BroadcastRing&) = delete;
+    BroadcastRing& operator=(const BroadcastRing&) = delete;
+
+    /**
+     * @brief Add a subscriber; it receives everything published from now on
+     * @return Subscriber id, or -1 if every slot is taken
+     */
+    int subscribe(SlowSubscriberPolicy policy)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < m_maxSubscribers; ++i) {
+            Slot& slot = m_slots[i];
+            if (slot.active.load(std::memory_order_relaxed)) {
+                continue;
+            }
+            slot.policy = policy;
+            slot.received.store(0, std::memory_order_relaxed);
+            slot.lost.store(0, std::memory_order_relaxed);
+            slot.overruns.store(0, std::memory_order_relaxed);
+            slot.stalls.store(0, std::memory_order_relaxed);
+            // Starting at the published sequence keeps the producer's cached
+            // minimum valid: every cursor it has seen is at or below it
+            uint64_t start = m_published.load(std::memory_order_acquire);
+            slot.expected = start;
+            slot.cursor.store(start << 1, std::memory_order_relaxed);
+            slot.active.store(true, std::memory_order_release);
+            return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Release a subscriber slot; a producer waiting for it carries on
+     */
+    void unsubscribe(int id)
+    {
+        if (!valid(id)) {
+            return;
+        }
+        m_slots[id].active.store(false, std::memory_order_release);
+        wakeProducer();
+    }
+
+    /**
+     * @brief Reserve contiguous slots for up to count elements (producer side)
+     *
+     * Fill the slots in place and make them visible with commit(). Fewer
+     * than count slots are returned at the end of the ring's storage.
+     *
+     * @param slots Set to the first reserved slot
+     * @param deadline How long to wait for BLOCK subscribers to make room
+     * @return Number of slots reserved; 0 on timeout or when closed
+     */
+    size_t claim(T*& slots, size_t count, Deadline deadline)
+    {
+        const uint64_t published = m_published.load(std::memory_order_relaxed);
+        const size_t offset = static_cast<size_t>(published & m_mask);
+        size_t n = count < m_capacity - offset ? count : m_capacity - offset;
+        if (n == 0 || m_closed.load(std::memory_order_relaxed)) {
+            return 0;
+        }
+
+        // Writing sequence s overwrites s - capacity
+        const uint64_t needed = published + n - m_capacity;
+        if (published + n > m_capacity && m_cachedGate < needed) {
+            if (!makeRoom(published, n, deadline)) {
+                return 0;
+            }
+        }
+        slots = &m_buffer[offset];
+        return n;
+    }
+
+    /**
+     * @brief Publish count elements filled in after claim() (producer side)
+     */
+    void commit(size_t count)
+    {
+        if (count == 0) {
+            return;
+        }
+        m_published.store(m_published.load(std::memory_order_relaxed) + count, std::memory_order_release);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_consumersWaiting.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_dataAvailable.notify_all();
+        }
+    }
+
+    /**
+     * @brief Copy count elements in and publish them (producer side)
+     * @return Number of elements published (less than count on timeout or close)
+     */
+    size_t publish(const T* data, size_t count, Deadline deadline = Deadline::max())
+    {
+        size_t done = 0;
+        while (done < count) {
+            T* slots = nullptr;
+            size_t n = claim(slots, count - done, deadline);
+            if (n == 0) {
+                break;
+            }
+            std::memcpy(slots, data + done, n * sizeof(T));
+            commit(n);
+            done += n;
+        }
+        return done;
+    }
+
+    /**
+     * @brief End the stream: waiting subscribers return and claim() fails
+     *
+     * Elements already published stay readable.
+     */
+    void close()
+    {
+        m_closed.store(true, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_dataAvailable.notify_all();
+        m_roomAvailable.notify_all();
+    }
+
+    bool isClosed() const { return m_closed.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Read the subscriber's pending elements in place, without waiting
+     *
+     * handler(const T* data, size_t count, uint64_t firstSequence) is called
+     * once, or twice when the pending elements wrap around the end of the
+     * ring. The pointers are only valid inside the handler.
+     *
+     * @param maxCount Most elements to take in this call
+     */
+    template <class Handler>
+    BroadcastRead consume(int id, Handler&& handler, size_t maxCount = std::numeric_limits<size_t>::max())
+    {
+        BroadcastRead read;
+        if (!valid(id) || maxCount == 0) {
+            return read;
+        }
+        Slot& slot = m_slots[id];
+
+        uint64_t word = slot.cursor.load(std::memory_order_acquire);
+        uint64_t published = 0;
+        for (;;) {
+            noteMoves(slot, word >> 1, read);
+            published = m_published.load(std::memory_order_acquire);
+            if (published == (word >> 1)) {
+                read.closed = m_closed.load(std::memory_order_acquire) &&
+                              published == m_published.load(std::memory_order_acquire);
+                return read;
+            }
+            // Mark the cursor as being read so the producer neither moves it
+            // nor overwrites what the handler is looking at
+            if (slot.cursor.compare_exchange_weak(word, word | 1, std::memory_order_acq_rel,
+                                                  std::memory_order_acquire)) {
+                break;
+            }
+        }
+
+        const uint64_t cursor = word >> 1;
+        uint64_t available = published - cursor;
+        size_t n = available < maxCount ? static_cast<size_t>(available) : maxCount;
+        const size_t offset = static_cast<size_t>(cursor & m_mask);
+        const size_t first = n < m_capacity - offset ? n : m_capacity - offset;
+        handler(static_cast<const T*>(&m_buffer[offset]), first, cursor);
+        if (n > first) {
+            handler(static_cast<const T*>(&m_buffer[0]), n - first, cursor + first);
+        }
+
+        slot.expected = cursor + n;
+        slot.cursor.store(slot.expected << 1, std::memory_order_release);
+        slot.received.fetch_add(n, std::memory_order_relaxed);
+        read.count = n;
+        wakeProducer();
+        return read;
+    }
+
+    /**
+     * @brief consume(), waiting up to timeoutMs for the producer if nothing is pending
+     */
+    template <class Handler>
+    BroadcastRead consumeWait(int id, Handler&& handler, uint32_t timeoutMs,
+                              size_t maxCount = std::numeric_limits<size_t>::max())
+    {
+        BroadcastRead read = consume(id, handler, maxCount);
+        if (read.count > 0 || read.lost > 0 || read.closed || !valid(id)) {
+            return read;
+        }
+
+        Deadline deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        Slot& slot = m_slots[id];
+        // Announce that we are about to sleep; the fence pairs with the one
+        // in commit() so either we see the new data or the producer sees us
+        m_consumersWaiting.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_dataAvailable.wait_until(lock, deadline, [this, &slot] {
+                return m_published.load(std::memory_order_acquire) !=
+                           (slot.cursor.load(std::memory_order_acquire) >> 1) ||
+                       m_closed.load(std::memory_order_acquire);
+            });
+        }
+        m_consumersWaiting.fetch_sub(1, std::memory_order_relaxed);
+        return consume(id, handler, maxCount);
+    }
+
+    /**
+     * @brief Counters of one subscriber (safe from any thread)
+     */
+    BroadcastSubscriberStats stats(int id) const
+    {
+        BroadcastSubscriberStats result;
+        if (!valid(id)) {
+            return result;
+        }
+        const Slot& slot = m_slots[id];
+        result.received = slot.received.load(std::memory_order_relaxed);
+        result.lost = slot.lost.load(std::memory_order_relaxed);
+        result.overruns = slot.overruns.load(std::memory_order_relaxed);
+        result.stalls = slot.stalls.load(std::memory_order_relaxed);
+        result.lag = m_published.load(std::memory_order_acquire) -
+                     (slot.cursor.load(std::memory_order_acquire) >> 1);
+        return result;
+    }
+
+    /**
+     * @brief Sequence number the next published element will get
+     */
+    uint64_t published() const { return m_published.load(std::memory_order_acquire); }
+
+    size_t capacity() const { return m_capacity; }
+
+private:
+    static constexpr size_t kCacheLine = 64;
+
+    struct alignas(kCacheLine) Slot {
+        // Next sequence to read, shifted left by one; bit 0 is set while the
+        // subscriber's handler runs. The producer only moves even values.
+        std::atomic<uint64_t> cursor{0};
+        std::atomic<bool> active{false};
+        SlowSubscriberPolicy policy = SlowSubscriberPolicy::BLOCK;
+        uint64_t expected = 0;  // Where the subscriber left its cursor (subscriber thread only)
+        std::atomic<uint64_t> received{0};
+        std::atomic<uint64_t> lost{0};
+        std::atomic<uint64_t> overruns{0};
+        std::atomic<uint64_t> stalls{0};
+    };
+
+    static size_t roundUpPowerOfTwo(size_t value)
+    {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    bool valid(int id) const
+    {
+        return id >= 0 && static_cast<size_t>(id) < m_maxSubscribers &&
+               m_slots[id].active.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Report a cursor the producer moved since the subscriber's last read
+     */
+    static void noteMoves(Slot& slot, uint64_t cursor, BroadcastRead& read)
+    {
+        if (cursor == slot.expected) {
+            return;
+        }
+        uint64_t skipped = cursor - slot.expected;
+        read.lost += skipped;
+        read.resync = read.resync || slot.policy == SlowSubscriberPolicy::SNAPSHOT;
+        slot.lost.fetch_add(skipped, std::memory_order_relaxed);
+        slot.expected = cursor;
+    }
+
+    /**
+     * @brief Bring every subscriber to at least published + count - capacity
+     *
+     * Recomputes m_cachedGate, the lowest cursor among subscribers, so the
+     * next claims skip the scan until the ring looks full again.
+     *
+     * @return false on timeout or close
+     */
+    bool makeRoom(uint64_t published, size_t count, Deadline deadline)
+    {
+        const uint64_t needed = published + count - m_capacity;
+        unsigned spins = 0;
+        bool stalled = false;
+        for (;;) {
+            uint64_t gate = published;
+            bool blocked = false;
+            for (size_t i = 0; i < m_maxSubscribers; ++i) {
+                Slot& slot = m_slots[i];
+                if (!slot.active.load(std::memory_order_acquire)) {
+                    continue;
+                }
+                uint64_t word = slot.cursor.load(std::memory_order_acquire);
+                while ((word >> 1) < needed) {
+                    if (slot.policy == SlowSubscriberPolicy::BLOCK || (word & 1) != 0) {
+                        if (!stalled) {
+                            slot.stalls.fetch_add(1, std::memory_order_relaxed);
+                        }
+                        blocked = true;
+                        break;
+                    }
+                    if (slot.cursor.compare_exchange_weak(word, moveTarget(slot.policy, published, count) << 1,
+                                                          std::memory_order_acq_rel, std::memory_order_acquire)) {
+                        slot.overruns.fetch_add(1, std::memory_order_relaxed);
+                        word = slot.cursor.load(std::memory_order_acquire);
+                    }
+                }
+                if ((word >> 1) < gate) {
+                    gate = word >> 1;
+                }
+            }
+            if (!blocked) {
+                m_cachedGate = gate;
+                return true;
+            }
+
+            stalled = true;
+            if (m_closed.load(std::memory_order_acquire) || std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            if ((++spins & 63) != 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            // Same handshake as consumeWait(), with roles swapped
+            m_producerWaiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_roomAvailable.wait_until(lock, std::min(deadline, std::chrono::steady_clock::now() +
+                                                                        std::chrono::milliseconds(10)));
+            }
+            m_producerWaiting.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Where a slow SKIP or SNAPSHOT subscriber is moved to
+     */
+    uint64_t moveTarget(SlowSubscriberPolicy policy, uint64_t published, size_t count) const
+    {
+        if (policy == SlowSubscriberPolicy::SNAPSHOT || count >= m_capacity / 2) {
+            return published;
+        }
+        // Keep the newest half ring so the subscriber is not overrun again at once
+        return published + count - m_capacity / 2;
+    }
+
+    void wakeProducer()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_producerWaiting.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_roomAvailable.notify_one();
+        }
+    }
+
+    const size_t m_capacity;
+    const size_t m_mask;
+    std::unique_ptr<T[]> m_buffer;
+    const size_t m_maxSubscribers;
+    std::unique_ptr<Slot[]> m_slots;
+
+    alignas(kCacheLine) std::atomic<uint64_t> m_published{0};  // Sequence of the next element
+    uint64_t m_cachedGate = 0;                                 // Lowest cursor at the last scan (producer only)
+    std::atomic<bool> m_closed{false};
+
+    // Slow path only: sleeping subscribers and a producer waiting for room
+    alignas(kCacheLine) std::atomic<int> m_consumersWaiting{0};
+    std::atomic<bool> m_producerWaiting{false};
+    std::mutex m_mutex;
+    std::condition_variable m_dataAvailable;
+    std::condition_variable m_roomAvailable;
+};
+
+#endif // BROADCAST_RING_H
@@ -0,0 +1,135 @@
+#ifndef CANVAS_H
+#define CANVAS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "StylusEvent.h"
+
+/**
+ * @brief Pixel rectangle [x, x + width) x [y, y + height)
+ */
+struct CanvasRect {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+/**
+ * @brief Geometry and pen settings of a Canvas
+ */
+struct CanvasOptions {
+    int width = 1280;              // Canvas size in pixels
+    int height = 960;
+    double deviceWidth = 20000;    // Device coordinate range mapped onto the canvas
+    double deviceHeight = 15000;
+    double minPenWidth = 1.0;      // Line width (pixels) at zero pressure
+    double maxPenWidth = 6.0;      // Line width (pixels) at maxPressure
+    double maxPressure = 1023;
+};
+
+/**
+ * @brief 8-bit coverage raster mirroring a board, redrawn incrementally
+ *
+ * Each pen-down sample draws an anti-aliased segment from the previous one
+ * whose width follows the pressure (a tapered capsule with round ends, so
+ * consecutive segments join smoothly). Ink is combined with max(), so
+ * overlapping segments do not darken. STYLUS_PAGE_CLEAR erases the canvas.
+ *
+ * Only the rows and columns a segment can touch are visited, and coverage is
+ * computed 16 pixels at a time with SSE2 on x86-64 (plain C++ elsewhere).
+ * Every write marks the TILE_SIZE x TILE_SIZE tiles it touches; the consumer
+ * calls takeDirtyRects() once per displayed frame and uploads only those
+ * rectangles of pixels().
+ *
+ *     Canvas canvas;
+ *     canvas.addEvents(events, count);
+ *     std::vector<CanvasRect> dirty;
+ *     canvas.takeDirtyRects(dirty);
+ *     for (const CanvasRect& r : dirty) {
+ *         upload(canvas.pixels() + r.y * canvas.stride() + r.x, canvas.stride(), r);
+ *     }
+ *
+ * Not thread-safe.
+ */
+class Canvas {
+public:
+    static const int TILE_SIZE = 32;
+
+    explicit Canvas(const CanvasOptions& options = CanvasOptions());
+
+    Canvas(const Canvas&) = delete;
+    Canvas& operator=(const Canvas&) = delete;
+
+    void addEvent(const StylusEvent& event);
+
+    void addEvents(const StylusEvent* events, size_t count);
+
+    /**
+     * @brief Draw one segment in canvas pixels (radius = half the line width)
+     */
+    void drawSegment(double x0, double y0, double radius0, double x1, double y1, double radius1);
+
+    /**
+     * @brief Erase everything (marks the whole canvas dirty)
+     */
+    void clear();
+
+    /**
+     * @brief Append the regions changed since the last call, then forget them
+     * @return Number of rectangles appended
+     *
+     * Dirty tiles are merged into horizontal runs, and runs spanning the same
+     * columns on consecutive tile rows into one rectangle. Rectangles are
+     * clipped to the canvas and do not overlap.
+     */
+    size_t takeDirtyRects(std::vector<CanvasRect>& out);
+
+    /**
+     * @brief true if anything changed since the last takeDirtyRects()
+     */
+    bool isDirty() const { return m_dirtyCount != 0; }
+
+    /**
+     * @brief Coverage values, 0 = blank, 255 = full ink; row-major with stride() bytes per row
+     */
+    const uint8_t* pixels() const { return m_pixels.data(); }
+
+    size_t stride() const { return m_stride; }
+
+    int width() const { return m_options.width; }
+
+    int height() const { return m_options.height; }
+
+    /**
+     * @brief Copy a rectangle of pixels to dst (rows of dstStride bytes)
+     */
+    void copyRect(const CanvasRect& rect, uint8_t* dst, size_t dstStride) const;
+
+private:
+    CanvasOptions m_options;
+    size_t m_stride;               // Row length rounded up to 16 bytes
+    std::vector<uint8_t> m_pixels;
+    int m_tilesX;
+    int m_tilesY;
+    std::vector<uint8_t> m_dirty;  // One flag per tile
+    size_t m_dirtyCount;
+    std::vector<CanvasRect> m_openRects;  // takeDirtyRects(): rectangles (in tiles) still growing downwards
+    std::vector<CanvasRect> m_rowRuns;    // takeDirtyRects(): dirty runs of the current tile row
+    double m_scaleX;
+    double m_scaleY;
+
+    // Previous pen-down sample in canvas pixels
+    bool m_penDown;
+    double m_lastX;
+    double m_lastY;
+    double m_lastRadius;
+
+    void markDirty(int x0, int y0, int x1, int y1);
+
+    double radiusFor(uint16_t pressure) const;
+};
+
+#endif // CANVAS_H
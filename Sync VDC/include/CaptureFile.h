@@ -0,0 +1,249 @@
+#ifndef CAPTURE_FILE_H
+#define CAPTURE_FILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * WT13106 capture file (".wtcap"), all integers little endian
+ *
+ *   header   64 bytes   magic "WT13CAP1", version u32, header size u32,
+ *                       first timestamp u64, wall clock at start (ns since
+ *                       epoch) u64, reserved
+ *   records             repeated:
+ *     record            kind u32 (CAPTURE_RECORD_DATA) | length u32 |
+ *                       timestamp u64 (steady clock ns) | length bytes
+ *     index block       kind u32 (CAPTURE_RECORD_INDEX) | entry count u32 |
+ *                       previous index block offset u64 (0 = none) |
+ *                       count x { timestamp u64, record offset u64 }
+ *   trailer  32 bytes   magic "WT13END1", last index block offset u64,
+ *                       record count u64, last timestamp u64
+ *
+ * Index blocks (every 16 MiB by default) chain backwards from the
+ * trailer, so a reader finds every index entry by following one offset per
+ * block instead of scanning the data. A file without a trailer (the writer
+ * crashed) is still readable; the reader rebuilds the index with one pass
+ * over the record headers.
+ */
+const char CAPTURE_MAGIC[8] = {'W', 'T', '1', '3', 'C', 'A', 'P', '1'};
+const char CAPTURE_TRAILER_MAGIC[8] = {'W', 'T', '1', '3', 'E', 'N', 'D', '1'};
+const uint32_t CAPTURE_VERSION = 1;
+const size_t CAPTURE_HEADER_SIZE = 64;
+const size_t CAPTURE_RECORD_HEADER_SIZE = 16;
+const size_t CAPTURE_TRAILER_SIZE = 32;
+const uint32_t CAPTURE_RECORD_DATA = 1;
+const uint32_t CAPTURE_RECORD_INDEX = 2;
+
+/**
+ * @brief Options for CaptureWriter
+ */
+struct CaptureWriterOptions {
+    size_t indexStrideBytes = 64 * 1024;  // Data between consecutive index entries
+    size_t entriesPerIndexBlock = 256;     // Index entries per index block
+    size_t bufferSize = 1024 * 1024;       // stdio buffer for the file
+};
+
+/**
+ * @brief Appends timestamped raw reads to a capture file
+ *
+ * Not thread-safe; attach one writer to one connection.
+ */
+class CaptureWriter {
+public:
+    CaptureWriter();
+    ~CaptureWriter();
+
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    /**
+     * @brief Create (truncate) a capture file and write its header
+     */
+    bool open(const std::string& path, const CaptureWriterOptions& options = CaptureWriterOptions());
+
+    /**
+     * @brief Append one raw read
+     * @param timestampNs steady_clock time of the read in nanoseconds
+     */
+    bool append(uint64_t timestampNs, const uint8_t* data, size_t length);
+
+    /**
+     * @brief Push buffered data to the OS
+     */
+    bool flush();
+
+    /**
+     * @brief Write the final index block and trailer, then close the file
+     */
+    bool close();
+
+    bool isOpen() const { return m_file != nullptr; }
+    uint64_t recordCount() const { return m_recordCount; }
+    uint64_t bytesWritten() const { return m_offset; }
+    std::string getLastError() const { return m_lastError; }
+
+private:
+    struct IndexEntry {
+        uint64_t timestampNs;
+        uint64_t offset;
+    };
+
+    std::FILE* m_file;
+    std::vector<char> m_buffer;
+    CaptureWriterOptions m_options;
+    uint64_t m_offset;
+    uint64_t m_recordCount;
+    uint64_t m_firstTimestampNs;
+    uint64_t m_lastTimestampNs;
+    uint64_t m_lastIndexOffset;
+    uint64_t m_nextIndexAt;      // Data offset at which the next index entry is taken
+    std::vector<IndexEntry> m_pendingIndex;
+    std::string m_lastError;
+
+    bool writeBytes(const void* data, size_t length);
+
+    bool writeIndexBlock();
+};
+
+/**
+ * @brief One record as seen by CaptureReader (data points into the mapping)
+ */
+struct CaptureRecord {
+    uint64_t timestampNs;
+    const uint8_t* data;
+    uint32_t length;
+};
+
+/**
+ * @brief Memory-mapped, random-access reader for capture files
+ *
+ * open() maps the file and loads the index chain, so multi-gigabyte captures
+ * open in milliseconds; seek() binary-searches the index and then scans at
+ * most one index stride of records.
+ */
+class CaptureReader {
+public:
+    CaptureReader();
+    ~CaptureReader();
+
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+
+    bool open(const std::string& path);
+
+    void close();
+
+    bool isOpen() const { return m_data != nullptr; }
+
+    /**
+     * @brief Read the record at the cursor and advance
+     * @return false at the end of the capture
+     */
+    bool next(CaptureRecord& record);
+
+    /**
+     * @brief Move the cursor to the first record with timestamp >= timestampNs
+     */
+    void seek(uint64_t timestampNs);
+
+    /**
+     * @brief Move the cursor back to the first record
+     */
+    void rewind();
+
+    uint64_t firstTimestampNs() const { return m_firstTimestampNs; }
+    uint64_t lastTimestampNs() const { return m_lastTimestampNs; }
+    uint64_t wallClockStartNs() const { return m_wallClockStartNs; }
+
+    /**
+     * @brief Number of records (counted while indexing if the trailer is missing)
+     */
+    uint64_t recordCount() const { return m_recordCount; }
+
+    /**
+     * @brief false if the file had no trailer and the index was rebuilt by scanning
+     */
+    bool wasClosedCleanly() const { return m_hasTrailer; }
+
+    std::string getLastError() const { return m_lastError; }
+
+private:
+    struct IndexEntry {
+        uint64_t timestampNs;
+        uint64_t offset;
+    };
+
+    const uint8_t* m_data;
+    uint64_t m_size;
+    uint64_t m_dataEnd;   // Offset of the trailer, or file size if none
+    uint64_t m_cursor;
+    uint64_t m_firstTimestampNs;
+    uint64_t m_lastTimestampNs;
+    uint64_t m_wallClockStartNs;
+    uint64_t m_recordCount;
+    bool m_hasTrailer;
+    std::vector<IndexEntry> m_index;
+    std::string m_lastError;
+#ifdef _WIN32
+    void* m_fileHandle;
+    void* m_mappingHandle;
+#endif
+
+    bool loadIndexChain(uint64_t lastIndexOffset);
+
+    void rebuildIndex();
+};
+
+/**
+ * @brief Replays a capture with its original timing (or scaled, or unpaced)
+ *
+ * Used by WT13106Connection as the "REPLAY:" transport. Record boundaries are
+ * not preserved across read() calls: a reader with a small buffer receives a
+ * record in several pieces, exactly like a serial port.
+ */
+class CaptureReplay {
+public:
+    CaptureReplay();
+
+    /**
+     * @brief Open a capture for replay
+     * @param speed 1.0 = real time, 2.0 = twice as fast, 0 = as fast as possible
+     */
+    bool open(const std::string& path, double speed);
+
+    void close();
+
+    /**
+     * @brief Steady-clock time (ns) at which the next bytes are due; 0 if due
+     *        now, UINT64_MAX at the end of the capture
+     */
+    uint64_t nextDueNs(uint64_t nowNs);
+
+    /**
+     * @brief Copy bytes that are due at nowNs into buffer
+     * @return Number of bytes copied
+     */
+    size_t readDue(uint8_t* buffer, size_t capacity, uint64_t nowNs);
+
+    bool atEnd() const { return m_finished; }
+
+    CaptureReader& reader() { return m_reader; }
+
+private:
+    CaptureReader m_reader;
+    double m_speed;
+    bool m_started;
+    bool m_finished;
+    uint64_t m_startNs;        // Steady time at which the first record was due
+    CaptureRecord m_current;
+    uint32_t m_currentOffset;  // Bytes of m_current already handed out
+    bool m_haveCurrent;
+
+    bool loadNext();
+
+    uint64_t dueTime(const CaptureRecord& record) const;
+};
+
+#endif // CAPTURE_FILE_H
@@ -0,0 +1,218 @@
+#ifndef CONNECTION_MANAGER_H
+#define CONNECTION_MANAGER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "FrameDecoder.h"
+#include "StylusEvent.h"
+
+class WT13106Connection;
+
+/**
+ * @brief How ConnectionManager's loops wait for and move data
+ */
+enum class IoEngine {
+    EPOLL,     // epoll_wait(), then one read() per ready device
+    IO_URING   // Reads and writes run inside io_uring; one io_uring_enter() per wake-up
+};
+
+/**
+ * @brief Options for ConnectionManager
+ */
+struct ConnectionManagerOptions {
+    size_t loopCount = 1;          // Event loop threads (0 = one per CPU core)
+    size_t eventBatchSize = 256;   // Maximum events handed to a handler per call
+    size_t maxEventsPerWait = 64;  // epoll_wait batch size
+    IoEngine ioEngine = IoEngine::EPOLL;  // IO_URING falls back to EPOLL where the kernel lacks it
+    size_t ioUringBuffers = 256;   // 4 KiB receive buffers per io_uring loop (power of two)
+};
+
+/**
+ * @brief Counters summed over all loops (see ConnectionManager::getStats())
+ */
+struct ConnectionManagerStats {
+    uint64_t systemCalls = 0;    // Made by the loop threads: waits, reads and writes
+    uint64_t wakeups = 0;        // Returns from epoll_wait() or io_uring_enter()
+    uint64_t bytesReceived = 0;
+    uint64_t bytesSent = 0;      // send() data written (loopback: handed to sendCommand())
+};
+
+/**
+ * @brief Per-device callbacks, invoked on the device's event loop thread
+ */
+struct DeviceHandlers {
+    std::function<void(int deviceId, const StylusEvent* events, size_t count)> onEvents;
+    FrameDecoder::FrameHandler onFrame;             // Reply/status frames (optional)
+    std::function<void(int deviceId)> onDisconnect;  // Port hung up (optional)
+};
+
+/**
+ * @brief Multiplexes many WT13106Connections on a small number of epoll loops
+ *
+ * Instead of one blocking reader thread per board, every registered
+ * connection's descriptor is added to one of loopCount epoll instances. When
+ * a descriptor becomes readable the owning loop drains it with non-blocking
+ * receiveInto() calls, feeds the bytes through that device's FrameDecoder
+ * and hands batches of decoded events to the device's handlers.
+ *
+ * With IoEngine::IO_URING each loop drives an io_uring instead. A tty
+ * (serial or pty connection) gets a multishot read into the loop's ring of
+ * provided buffers, armed behind a POLL_ADD, so data arrives as completions
+ * without any read() at all; on kernels before 6.7 the linked poll and read
+ * are re-armed after every chunk. Queued send() data for all devices goes
+ * out in the same io_uring_enter() that waits for the next completions.
+ * Other descriptors (loopback) are polled through the ring and read with
+ * receiveInto(). If the kernel cannot set up the ring (before 5.19, or
+ * io_uring disabled) the manager runs epoll loops; see activeIoEngine().
+ *
+ * Connections must be connected, use a transport with a descriptor (serial,
+ * pty or loopback; see WT13106Connection::getNativeHandle()) and not be in
+ * streaming mode. They must outlive their registration. addConnection(),
+ * removeConnection() and send() are thread-safe, may be called from any
+ * device's handlers (also for devices on other loops), but must not race
+ * with start()/stop(). A descriptor can be registered once, on one loop.
+ * Linux only.
+ */
+class ConnectionManager {
+public:
+    explicit ConnectionManager(const ConnectionManagerOptions& options = ConnectionManagerOptions());
+    ~ConnectionManager();
+
+    ConnectionManager(const ConnectionManager&) = delete;
+    ConnectionManager& operator=(const ConnectionManager&) = delete;
+
+    /**
+     * @brief Create the epoll instances and start the loop threads
+     * @return true if all loops are running
+     */
+    bool start();
+
+    /**
+     * @brief Stop and join all loop threads; registrations are dropped
+     */
+    void stop();
+
+    /**
+     * @brief Register a connection with the least loaded loop
+     * @param connection Connected connection whose transport has a descriptor
+     * @param handlers Callbacks for this device
+     * @return Device ID (>= 0), or -1 on error (see getLastError())
+     */
+    int addConnection(WT13106Connection& connection, DeviceHandlers handlers);
+
+    /**
+     * @brief Unregister a device; safe to call from its own handlers
+     * @return true if the device was registered
+     */
+    bool removeConnection(int deviceId);
+
+    /**
+     * @brief Queue bytes for a device; its loop writes them
+     *
+     * Returns without waiting for the write. Everything queued for the
+     * devices of one loop is submitted together on its next wake-up (one
+     * io_uring_enter() with IO_URING, one non-blocking write per device with
+     * EPOLL); a port that cannot take it all keeps the rest queued. Do not
+     * mix with the connection's own sendCommand() while registered.
+     *
+     * @return false if the device is not registered
+     */
+    bool send(int deviceId, const uint8_t* data, size_t length);
+
+    /**
+     * @brief Number of registered devices
+     */
+    size_t connectionCount() const;
+
+    /**
+     * @brief Number of running event loops
+     */
+    size_t loopCount() const;
+
+    /**
+     * @brief Engine the loops run after start() (EPOLL if IO_URING fell back)
+     */
+    IoEngine activeIoEngine() const;
+
+    ConnectionManagerStats getStats() const;
+
+    std::string getLastError() const;
+
+private:
+    struct Device;
+    struct Loop;
+
+    struct Registration {
+        Loop* loop = nullptr;
+        Device* device = nullptr;  // Null while addConnection() is still setting it up
+    };
+
+    ConnectionManagerOptions m_options;
+    std::vector<std::unique_ptr<Loop>> m_loops;  // Fixed between start() and stop()
+    std::atomic<int> m_nextId;
+    std::atomic<size_t> m_deviceCount;
+    mutable std::mutex m_errorMutex;  // Leaf lock; never held while taking a loop mutex
+    std::string m_lastError;
+
+    // Lock order: a loop's mutex, then m_registrationMutex, then a loop's
+    // sendMutex. Only the loop thread running a device's handlers ever holds
+    // a loop mutex while locking anything else, and then never another loop's.
+    std::mutex m_registrationMutex;
+    std::unordered_map<int, int> m_registeredFds;            // Descriptor -> device ID
+    std::unordered_map<int, Registration> m_registrations;   // Device ID -> where it lives
+
+    void runLoop(Loop& loop);
+
+    /**
+     * @brief runLoop() for IoEngine::IO_URING
+     */
+    void runUringLoop(Loop& loop);
+
+    void setError(const std::string& message);
+
+    /**
+     * @brief Drain a readable device and dispatch decoded events
+     * @return false if the port hung up or failed
+     */
+    bool serviceDevice(Loop& loop, Device& device);
+
+    /**
+     * @brief Decode received bytes and hand the events to the device's handlers
+     */
+    void dispatchBytes(Loop& loop, Device& device, const uint8_t* data, size_t length);
+
+    /**
+     * @brief Write the send() queues of devices waiting in loop.sending (EPOLL)
+     */
+    void flushSends(Loop& loop);
+
+    /**
+     * @brief Move send() data into the loop's own queues; lists the devices in loop.flushing
+     */
+    void takeSends(Loop& loop);
+
+    /**
+     * @brief Forget a descriptor and its device ID; takes m_registrationMutex
+     */
+    void unregister(Loop& loop, int fd, int deviceId);
+
+    /**
+     * @brief Unregister a device whose port hung up and tell its handler
+     */
+    void dropDevice(Device& device);
+
+    /**
+     * @brief Wake a loop to pick up new registrations, removals or send() data
+     */
+    void wakeLoop(Loop& loop);
+};
+
+#endif // CONNECTION_MANAGER_H
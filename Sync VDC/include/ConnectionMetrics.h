@@ -0,0 +1,178 @@
+#ifndef CONNECTION_METRICS_H
+#define CONNECTION_METRICS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/**
+ * @brief Point-in-time copy of a LatencyHistogram
+ */
+struct HistogramSnapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;   // Nanoseconds
+    uint64_t max = 0;   // Nanoseconds
+    std::vector<uint64_t> buckets;
+
+    /**
+     * @brief Value (ns) at or below which the given fraction of samples lie
+     * @param fraction 0.0 .. 1.0, e.g. 0.99 for p99
+     * @return Representative value of the bucket, within ~3% of the true value
+     */
+    uint64_t valueAtPercentile(double fraction) const;
+
+    double mean() const { return count ? static_cast<double>(sum) / count : 0.0; }
+};
+
+/**
+ * @brief Lock-free log-linear histogram of nanosecond durations (HDR style)
+ *
+ * Each power-of-two range is split into 32 linear sub-buckets, so any
+ * recorded value is reported within ~3% while the whole range from 1 ns to
+ * ~73 minutes fits in 1216 counters. record() is two relaxed atomic adds and a load
+ * and may be called from any thread.
+ */
+class LatencyHistogram {
+public:
+    static const int SUB_BUCKET_BITS = 5;
+    static const uint64_t SUB_BUCKET_COUNT = 1u << SUB_BUCKET_BITS;
+    static const int MAX_VALUE_BITS = 42;
+    static const size_t BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    LatencyHistogram();
+
+    void record(uint64_t valueNs)
+    {
+        m_buckets[bucketIndex(valueNs)].fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(valueNs, std::memory_order_relaxed);
+        uint64_t max = m_max.load(std::memory_order_relaxed);
+        while (valueNs > max && !m_max.compare_exchange_weak(max, valueNs, std::memory_order_relaxed)) {
+        }
+    }
+
+    HistogramSnapshot snapshot() const;
+
+    void reset();
+
+    static size_t bucketIndex(uint64_t valueNs)
+    {
+        const uint64_t maxValue = (uint64_t(1) << MAX_VALUE_BITS) - 1;
+        if (valueNs > maxValue) {
+            valueNs = maxValue;
+        }
+        if (valueNs < SUB_BUCKET_COUNT) {
+            return static_cast<size_t>(valueNs);
+        }
+        int msb = highestBit(valueNs);
+        int shift = msb - SUB_BUCKET_BITS;
+        return static_cast<size_t>((shift + 1) * SUB_BUCKET_COUNT + ((valueNs >> shift) - SUB_BUCKET_COUNT));
+    }
+
+    /**
+     * @brief Midpoint of the values that map to a bucket
+     */
+    static uint64_t bucketValue(size_t index);
+
+private:
+    static int highestBit(uint64_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return static_cast<int>(index);
+#else
+        return 63 - __builtin_clzll(value);
+#endif
+    }
+
+    std::atomic<uint64_t> m_buckets[BUCKET_COUNT];
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_max;
+};
+
+/**
+ * @brief Point-in-time copy of a connection's metrics
+ */
+struct ConnectionMetricsSnapshot {
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    uint64_t framesIn = 0;        // Frames decoded by receiveEvents() (pen and reply)
+    uint64_t framesOut = 0;       // Commands fully written to the port
+    uint64_t frameErrors = 0;     // Frames rejected by the decoder
+    uint64_t readCalls = 0;       // read()/ReadFile()/USB reads issued
+    uint64_t writeCalls = 0;
+    uint64_t emptyReads = 0;      // Reads that returned no data
+    uint64_t timeouts = 0;        // Receive calls that hit their deadline
+    uint64_t partialWrites = 0;
+    uint64_t ringOverflows = 0;   // Chunks that did not fit into the streaming ring
+    uint64_t ringDroppedBytes = 0;
+    HistogramSnapshot receiveWait;     // Receive/pop call entry to data returned (ns): time the caller waited, not device latency
+    HistogramSnapshot readLatency;     // Data ready at the port to handed to the application (ns)
+    HistogramSnapshot interFrameGap;   // Receive timestamps of consecutive pen events (ns)
+
+    /**
+     * @brief Prometheus text exposition format
+     * @param connectionLabel Value of the "connection" label on every sample
+     */
+    std::string toText(const std::string& connectionLabel = "") const;
+
+    /**
+     * @brief JSON object with the counters and histogram summaries
+     */
+    std::string toJson() const;
+};
+
+/**
+ * @brief Per-connection counters and histograms
+ *
+ * Recording is lock-free (relaxed atomics) and guarded by an enabled flag, so
+ * a disabled instance costs one relaxed load and a branch per hook. Counters
+ * may be bumped from the caller's thread and the streaming reader thread at
+ * the same time; snapshot() can be taken from any thread.
+ */
+class ConnectionMetrics {
+public:
+    ConnectionMetrics();
+
+    void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    std::atomic<uint64_t> bytesIn;
+    std::atomic<uint64_t> bytesOut;
+    std::atomic<uint64_t> framesIn;
+    std::atomic<uint64_t> framesOut;
+    std::atomic<uint64_t> frameErrors;
+    std::atomic<uint64_t> readCalls;
+    std::atomic<uint64_t> writeCalls;
+    std::atomic<uint64_t> emptyReads;
+    std::atomic<uint64_t> timeouts;
+    std::atomic<uint64_t> partialWrites;
+    std::atomic<uint64_t> ringOverflows;
+    std::atomic<uint64_t> ringDroppedBytes;
+    LatencyHistogram receiveWait;
+    LatencyHistogram readLatency;
+    LatencyHistogram interFrameGap;
+
+    /**
+     * @brief Add to a counter (relaxed)
+     */
+    static void add(std::atomic<uint64_t>& counter, uint64_t value = 1)
+    {
+        counter.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    ConnectionMetricsSnapshot snapshot() const;
+
+    void reset();
+
+private:
+    std::atomic<bool> m_enabled;
+};
+
+#endif // CONNECTION_METRICS_H
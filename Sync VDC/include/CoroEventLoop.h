@@ -0,0 +1,279 @@
+#ifndef CORO_EVENT_LOOP_H
+#define CORO_EVENT_LOOP_H
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CoroTask.h"
+#include "RequestTracker.h"
+#include "StylusEvent.h"
+
+class AsyncConnection;
+class WT13106Connection;
+
+/**
+ * @brief Single-threaded epoll loop that drives coroutine sessions
+ *
+ * Sessions are Task<void> coroutines handed to spawn(). They suspend in
+ * co_await on AsyncConnection operations or sleepFor() and are resumed by
+ * run() when the device is readable/writable or the timer expires. Sessions
+ * are stackless: a suspended session costs its coroutine frame (a few
+ * hundred bytes), so thousands share one thread.
+ *
+ * Suspending and resuming does not allocate: awaiters live in the coroutine
+ * frame and are linked into intrusive wait lists, the ready queue and timer
+ * heap reuse their capacity, and coroutine frames are recycled through
+ * CoroFramePool.
+ *
+ * Everything except stop() must be called on the loop's thread. Linux only.
+ */
+class EventLoop {
+public:
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    /**
+     * @brief false if the epoll instance could not be created (see getLastError())
+     */
+    bool isValid() const { return m_epollFd >= 0; }
+
+    /**
+     * @brief Start a session; it runs up to its first suspension inside run()
+     */
+    void spawn(Task<void> task);
+
+    /**
+     * @brief Run until every spawned task has finished or stop() is called
+     */
+    void run();
+
+    /**
+     * @brief Make run() return after the current iteration (safe from any thread)
+     */
+    void stop();
+
+    /**
+     * @brief Number of spawned tasks that have not finished
+     */
+    size_t taskCount() const { return m_liveTasks; }
+
+    /**
+     * @brief Awaitable that resumes the caller after a delay
+     */
+    struct SleepAwaiter {
+        EventLoop& loop;
+        uint64_t dueNs;
+
+        bool await_ready() const noexcept;
+        void await_suspend(std::coroutine_handle<> handle) { loop.addTimer(dueNs, handle, -1); }
+        void await_resume() const noexcept {}
+    };
+
+    SleepAwaiter sleepFor(std::chrono::nanoseconds duration);
+
+    std::string getLastError() const { return m_lastError; }
+
+private:
+    friend class AsyncConnection;
+    friend void coro_detail::detachedTaskFinished(EventLoop* loop, const std::exception_ptr& exception) noexcept;
+
+    struct Timer {
+        uint64_t dueNs;
+        std::coroutine_handle<> handle;  // Resumed when due, or
+        int connectionId;                // connection whose requests are checked for timeouts
+    };
+
+    int m_epollFd;
+    int m_wakeFd;
+    std::atomic<bool> m_stopRequested;
+    size_t m_liveTasks;
+    std::vector<std::coroutine_handle<>> m_ready;
+    std::vector<std::coroutine_handle<>> m_running;  // Swapped with m_ready while resuming
+    std::vector<Timer> m_timers;                     // Min-heap on dueNs
+    std::vector<AsyncConnection*> m_connections;     // Indexed by connection ID
+    std::vector<int> m_freeIds;
+    std::string m_lastError;
+
+    void schedule(std::coroutine_handle<> handle) { m_ready.push_back(handle); }
+
+    void addTimer(uint64_t dueNs, std::coroutine_handle<> handle, int connectionId);
+
+    void runReady();
+
+    void fireTimers(uint64_t nowNs);
+
+    int attach(AsyncConnection* connection, int fd);
+
+    void detach(int id, int fd);
+
+    void unwatch(int fd);
+
+    bool setWriteInterest(int id, int fd, bool enabled);
+};
+
+/**
+ * @brief Awaitable I/O on a WT13106Connection from EventLoop sessions
+ *
+ *     Task<void> session(EventLoop& loop, WT13106Connection& device)
+ *     {
+ *         AsyncConnection conn(loop, device);
+ *         StylusEvent events[64];
+ *         Response info = co_await conn.request(0x10, nullptr, 0);
+ *         while (size_t count = co_await conn.read(events, 64)) {
+ *             // ...
+ *         }
+ *     }
+ *
+ * The connection must be connected over a transport with a descriptor
+ * (serial, pty or loopback; see getNativeHandle()) and not be in
+ * streaming mode. Its descriptor is watched by the loop; whenever it is
+ * readable the loop decodes everything available with receiveEvents(), so
+ * replies to request() are matched even while no read() is pending (pen
+ * events read meanwhile are buffered, up to a limit). Writes never block the
+ * loop: the connection's write timeout is set to 0 and bytes the port cannot
+ * take yet stay in its send queue until the loop sees it writable.
+ *
+ * Operations may be awaited by several sessions at once; reads are served in
+ * order. Must not be destroyed while an operation is pending.
+ */
+class AsyncConnection {
+public:
+    static const size_t MAX_BUFFERED_EVENTS = 4096;
+
+    AsyncConnection(EventLoop& loop, WT13106Connection& connection);
+    ~AsyncConnection();
+
+    AsyncConnection(const AsyncConnection&) = delete;
+    AsyncConnection& operator=(const AsyncConnection&) = delete;
+
+    /**
+     * @brief false if the connection could not be watched (see getLastError())
+     */
+    bool isAttached() const { return m_id >= 0; }
+
+    /**
+     * @brief true once the port has hung up or failed
+     */
+    bool isClosed() const { return m_closed; }
+
+    /**
+     * @brief Pen events dropped because nobody read them in time
+     */
+    uint64_t droppedEvents() const { return m_droppedEvents; }
+
+    std::string getLastError() const { return m_lastError; }
+
+    struct ReadAwaiter {
+        AsyncConnection& connection;
+        StylusEvent* events;
+        size_t capacity;
+        size_t result = 0;
+        std::coroutine_handle<> handle = {};
+        ReadAwaiter* next = nullptr;
+
+        bool await_ready();
+        void await_suspend(std::coroutine_handle<> awaiting);
+        size_t await_resume() const noexcept { return result; }
+    };
+
+    struct SendAwaiter {
+        AsyncConnection& connection;
+        const uint8_t* data;
+        size_t length;
+        bool result = false;
+        std::coroutine_handle<> handle = {};
+        SendAwaiter* next = nullptr;
+
+        bool await_ready();
+        void await_suspend(std::coroutine_handle<> awaiting);
+        bool await_resume() const noexcept { return result; }
+    };
+
+    struct RequestAwaiter {
+        AsyncConnection& connection;
+        uint8_t type;
+        const uint8_t* payload;
+        uint8_t length;
+        SubmitOptions options;
+        Response response = {};
+        std::coroutine_handle<> handle = {};
+        bool submitting = false;       // Inside submit(): a failure completes without suspending
+        bool completedInline = false;
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> awaiting);
+        Response await_resume() { return std::move(response); }
+    };
+
+    /**
+     * @brief Wait for pen events
+     * @return Number of events written to events; 0 once the port has closed
+     */
+    ReadAwaiter read(StylusEvent* events, size_t capacity) { return ReadAwaiter{*this, events, capacity}; }
+
+    /**
+     * @brief Send a command frame, waiting (without blocking the loop) until the port accepts it
+     * @return true if the bytes were written or queued according to the flush policy
+     */
+    SendAwaiter send(const uint8_t* data, size_t length) { return SendAwaiter{*this, data, length}; }
+
+    /**
+     * @brief Submit a request and wait for its reply, timeout or failure
+     */
+    RequestAwaiter request(uint8_t type, const uint8_t* payload, uint8_t length,
+                           const SubmitOptions& options = SubmitOptions())
+    {
+        return RequestAwaiter{*this, type, payload, length, options};
+    }
+
+private:
+    friend class EventLoop;
+
+    EventLoop& m_loop;
+    WT13106Connection& m_connection;
+    int m_fd;
+    int m_id;
+    bool m_closed;
+    bool m_writeInterest;
+    uint64_t m_droppedEvents;
+    std::vector<StylusEvent> m_buffered;  // Events read while no read() was waiting
+    size_t m_bufferedHead;
+    StylusEvent m_scratch[256];
+    ReadAwaiter* m_readersHead;
+    ReadAwaiter* m_readersTail;
+    SendAwaiter* m_sendersHead;
+    SendAwaiter* m_sendersTail;
+    std::string m_lastError;
+
+    /**
+     * @brief Decode everything the port has, completing reads and requests
+     */
+    void onReadable();
+
+    /**
+     * @brief Push queued command bytes; complete sends once the queue is empty
+     */
+    void onWritable();
+
+    /**
+     * @brief Watch for writability while the connection has queued bytes
+     */
+    void updateWriteInterest();
+
+    /**
+     * @brief Move buffered events into waiting reads
+     */
+    void serveReaders();
+
+    void close();
+};
+
+#endif // CORO_EVENT_LOOP_H
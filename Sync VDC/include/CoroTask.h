@@ -0,0 +1,240 @@
+#ifndef CORO_TASK_H
+#define CORO_TASK_H
+
+#if !defined(__cpp_impl_coroutine)
+#error "CoroTask.h requires C++20 coroutines; configure with -DWT13106_ENABLE_COROUTINES=ON"
+#endif
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <utility>
+
+class EventLoop;
+
+/**
+ * @brief Thread-local free lists that recycle coroutine frames
+ *
+ * A session coroutine that calls helper coroutines in a loop would otherwise
+ * allocate a frame per call. Frames up to 4 KiB are rounded up to a 64-byte
+ * size class and returned to a per-thread free list on destruction, so the
+ * steady state performs no heap allocation. Larger frames use the global heap.
+ */
+class CoroFramePool {
+public:
+    static void* allocate(size_t size)
+    {
+        size_t sizeClass = classOf(size);
+        if (sizeClass >= CLASS_COUNT) {
+            return ::operator new(size);
+        }
+        FreeBlock*& head = freeList(sizeClass);
+        if (head) {
+            FreeBlock* block = head;
+            head = block->next;
+            return block;
+        }
+        return ::operator new((sizeClass + 1) * GRANULE);
+    }
+
+    static void deallocate(void* pointer, size_t size)
+    {
+        size_t sizeClass = classOf(size);
+        if (sizeClass >= CLASS_COUNT) {
+            ::operator delete(pointer);
+            return;
+        }
+        FreeBlock* block = static_cast<FreeBlock*>(pointer);
+        FreeBlock*& head = freeList(sizeClass);
+        block->next = head;
+        head = block;
+    }
+
+private:
+    static const size_t GRANULE = 64;
+    static const size_t CLASS_COUNT = 4096 / GRANULE;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    static size_t classOf(size_t size) { return (size + GRANULE - 1) / GRANULE - 1; }
+
+    static FreeBlock*& freeList(size_t sizeClass)
+    {
+        // Blocks are never returned to the heap; the pool only ever holds as
+        // many frames as were alive at the same time
+        thread_local FreeBlock* lists[CLASS_COUNT] = {};
+        return lists[sizeClass];
+    }
+};
+
+namespace coro_detail {
+
+/**
+ * @brief State shared by Task<T> promises: continuation and detached-task bookkeeping
+ */
+struct PromiseBase {
+    std::coroutine_handle<> continuation;
+    EventLoop* detachedLoop = nullptr;  // Set by EventLoop::spawn()
+    std::exception_ptr exception;
+
+    static void* operator new(size_t size) { return CoroFramePool::allocate(size); }
+    static void operator delete(void* pointer, size_t size) { CoroFramePool::deallocate(pointer, size); }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    void unhandled_exception() noexcept { exception = std::current_exception(); }
+};
+
+/**
+ * @brief Resumes the awaiting coroutine (symmetric transfer) or retires a detached task
+ */
+template <typename Promise>
+struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept;
+
+    void await_resume() noexcept {}
+};
+
+} // namespace coro_detail
+
+/**
+ * @brief Lazily started, awaitable coroutine returning T
+ *
+ * Nothing runs until the task is awaited (co_await task) or handed to
+ * EventLoop::spawn(). Awaiting transfers control directly to the task and
+ * back (symmetric transfer), so deep call chains do not grow the stack.
+ * Exceptions propagate to the awaiting coroutine; an exception escaping a
+ * spawned task terminates the program, as with std::thread.
+ */
+template <typename T = void>
+class Task;
+
+namespace coro_detail {
+
+template <typename T>
+struct TaskPromise : PromiseBase {
+    T value{};
+
+    Task<T> get_return_object() noexcept;
+
+    FinalAwaiter<TaskPromise> final_suspend() noexcept { return {}; }
+
+    template <typename U>
+    void return_value(U&& result) { value = std::forward<U>(result); }
+
+    T take()
+    {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+        return std::move(value);
+    }
+};
+
+template <>
+struct TaskPromise<void> : PromiseBase {
+    Task<void> get_return_object() noexcept;
+
+    FinalAwaiter<TaskPromise> final_suspend() noexcept { return {}; }
+
+    void return_void() noexcept {}
+
+    void take()
+    {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+} // namespace coro_detail
+
+template <typename T>
+class Task {
+public:
+    using promise_type = coro_detail::TaskPromise<T>;
+
+    Task() = default;
+    explicit Task(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+    Task(Task&& other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other) {
+            if (m_handle) {
+                m_handle.destroy();
+            }
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task()
+    {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return !m_handle || m_handle.done(); }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        m_handle.promise().continuation = awaiting;
+        return m_handle;
+    }
+
+    T await_resume() { return m_handle.promise().take(); }
+
+    /**
+     * @brief Give up ownership of the coroutine (used by EventLoop::spawn())
+     */
+    std::coroutine_handle<promise_type> release() noexcept { return std::exchange(m_handle, {}); }
+
+private:
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+namespace coro_detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept
+{
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept
+{
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+/**
+ * @brief Called when a spawned task finishes; defined in CoroEventLoop.cpp
+ */
+void detachedTaskFinished(EventLoop* loop, const std::exception_ptr& exception) noexcept;
+
+template <typename Promise>
+std::coroutine_handle<> FinalAwaiter<Promise>::await_suspend(std::coroutine_handle<Promise> handle) noexcept
+{
+    Promise& promise = handle.promise();
+    if (promise.continuation) {
+        return promise.continuation;
+    }
+    if (promise.detachedLoop) {
+        EventLoop* loop = promise.detachedLoop;
+        std::exception_ptr exception = promise.exception;
+        handle.destroy();
+        detachedTaskFinished(loop, exception);
+    }
+    return std::noop_coroutine();
+}
+
+} // namespace coro_detail
+
+#endif // CORO_TASK_H
@@ -0,0 +1,169 @@
+#ifndef DEVICE_DISCOVERY_H
+#define DEVICE_DISCOVERY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Options for DeviceDiscovery
+ */
+struct DiscoveryOptions {
+    std::string sysfsRoot = "/sys";  // Point at a fake tree to test without hardware
+    std::string devRoot = "/dev";    // Prefix of the reported device nodes
+    bool watchUevents = true;        // Follow hotplug through the kernel's uevent socket
+};
+
+/**
+ * @brief A USB device or one of its serial interfaces
+ */
+struct DiscoveredDevice {
+    uint16_t vid = 0;
+    uint16_t pid = 0;
+    std::string serial;          // iSerialNumber string; empty if the device has none
+    std::string manufacturer;
+    std::string product;
+    std::string usbName;         // sysfs name of the device, e.g. "1-1.4" (bus 1, ports 1.4)
+    int interfaceNumber = -1;    // Interface the tty belongs to; -1 for a device without one
+    std::string ttyName;         // e.g. "ttyACM0"; empty for a device without a tty
+    std::string devicePath;      // e.g. "/dev/ttyACM0"; empty for a device without a tty
+};
+
+/**
+ * @brief Which serial port DeviceDiscovery::findSerialPort() should return
+ */
+struct DeviceMatch {
+    uint16_t vid = 0;
+    uint16_t pid = 0;
+    std::string serial;          // Empty matches any serial number
+    int interfaceNumber = -1;    // -1 picks the device's lowest-numbered tty interface
+};
+
+/**
+ * @brief Index of USB devices and the tty nodes their interfaces created (Linux)
+ *
+ * The constructor scans /sys/bus/usb/devices and /sys/class/tty once and
+ * indexes every USB device by VID:PID, with the serial ports (CDC-ACM,
+ * usb-serial) that belong to each of its interfaces. Afterwards the index
+ * is kept current from kernel uevents: poll() applies the add/remove
+ * messages queued on the uevent socket, one device at a time, without
+ * touching the rest of sysfs. Lookups therefore cost a hash probe plus a
+ * non-blocking recv(), not a directory walk.
+ *
+ * The uevent socket is opened before the scan so that nothing plugged in
+ * during the scan is missed; if it cannot be opened (or watchUevents is
+ * off), a lookup that finds nothing rescans first. For a fake sysfs tree,
+ * turn watchUevents off and feed synthetic messages to applyUevent().
+ *
+ * All methods are thread-safe.
+ */
+class DeviceDiscovery {
+public:
+    explicit DeviceDiscovery(const DiscoveryOptions& options = DiscoveryOptions());
+    ~DeviceDiscovery();
+
+    DeviceDiscovery(const DeviceDiscovery&) = delete;
+    DeviceDiscovery& operator=(const DeviceDiscovery&) = delete;
+
+    /**
+     * @brief Process-wide instance with default options, used by "USB:VID:PID" connections
+     */
+    static DeviceDiscovery& shared();
+
+    /**
+     * @brief Rebuild the index from sysfs
+     * @return false if sysfs could not be read (see getLastError())
+     */
+    bool rescan();
+
+    /**
+     * @brief Apply the uevents queued on the uevent socket without blocking
+     * @return Number of messages that changed the index
+     */
+    size_t poll();
+
+    /**
+     * @brief Apply one uevent message ("ACTION@DEVPATH\0KEY=VALUE\0...")
+     * @return true if it changed the index
+     */
+    bool applyUevent(const char* message, size_t length);
+
+    /**
+     * @brief Serial port of the first device (lowest sysfs name) that matches
+     * @return false if no matching device has a tty (see getLastError())
+     */
+    bool findSerialPort(const DeviceMatch& match, DiscoveredDevice& out);
+
+    /**
+     * @brief Every indexed tty, then every device without one, in sysfs name order
+     */
+    std::vector<DiscoveredDevice> devices();
+
+    size_t deviceCount() const;
+
+    size_t serialPortCount() const;
+
+    /**
+     * @brief Uevent socket to wait on before calling poll() (-1 if not watching)
+     */
+    int getNativeHandle() const { return m_ueventFd; }
+
+    std::string getLastError() const;
+
+private:
+    struct UsbEntry {
+        uint16_t vid;
+        uint16_t pid;
+        std::string serial;
+        std::string manufacturer;
+        std::string product;
+        std::vector<std::string> ttys;  // Names of the ttys below it
+    };
+
+    struct TtyEntry {
+        std::string usbName;
+        int interfaceNumber;
+        std::string devicePath;
+    };
+
+    DiscoveryOptions m_options;
+    std::string m_sysfsRoot;      // Canonical form of options.sysfsRoot
+    int m_ueventFd;
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, UsbEntry> m_usb;               // By sysfs name
+    std::unordered_multimap<uint32_t, std::string> m_byId;         // (VID << 16 | PID) -> sysfs name
+    std::unordered_multimap<std::string, std::string> m_bySerial;  // Serial number -> sysfs name
+    std::unordered_map<std::string, TtyEntry> m_ttys;              // By tty name
+    std::string m_lastError;
+
+    bool rescanLocked();
+
+    size_t pollLocked();
+
+    bool applyUeventLocked(const char* message, size_t length);
+
+    /**
+     * @brief Read a device's attributes from sysfs and (re)index it
+     * @param devpath Path below the sysfs root, e.g. "/devices/.../usb1/1-1"
+     */
+    bool addUsbDevice(const std::string& devpath);
+
+    bool removeUsbDevice(const std::string& name);
+
+    void unindexUsbDevice(const std::string& name, const UsbEntry& entry);
+
+    /**
+     * @brief Index a tty if it sits below a USB interface
+     * @param devpath Path below the sysfs root, e.g. "/devices/.../1-1:1.0/tty/ttyACM0"
+     */
+    bool addTty(const std::string& devpath, const std::string& devName);
+
+    bool removeTty(const std::string& name);
+
+    void fill(const std::string& usbName, const UsbEntry& usb, DiscoveredDevice& out) const;
+};
+
+#endif // DEVICE_DISCOVERY_H
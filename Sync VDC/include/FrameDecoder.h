@@ -0,0 +1,139 @@
+#ifndef FRAME_DECODER_H
+#define FRAME_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "StylusEvent.h"
+
+/**
+ * WT13106 wire framing
+ *
+ *   offset  size  field
+ *   0       1     sync byte (0xA5)
+ *   1       1     frame type (FRAME_TYPE_PEN for samples, anything else is a reply/status)
+ *   2       1     sequence number
+ *   3       1     payload length L (0..255)
+ *   4       L     payload
+ *   4+L     1     checksum: low 8 bits of the sum of bytes 1 .. 3+L
+ *
+ * Pen payload (L = 7, little endian): x u16, y u16, pressure u16, flags u8.
+ */
+const uint8_t FRAME_SYNC = 0xA5;
+const uint8_t FRAME_TYPE_PEN = 0x01;
+const size_t FRAME_HEADER_SIZE = 4;
+const size_t FRAME_OVERHEAD = FRAME_HEADER_SIZE + 1;
+const size_t FRAME_MAX_SIZE = FRAME_OVERHEAD + 255;
+const uint8_t PEN_PAYLOAD_SIZE = 7;
+const size_t PEN_FRAME_SIZE = FRAME_OVERHEAD + PEN_PAYLOAD_SIZE;
+
+/**
+ * @brief A complete non-pen frame (reply or status) handed to the frame handler
+ *
+ * The payload pointer is only valid for the duration of the callback.
+ */
+struct FrameView {
+    uint8_t type;
+    uint8_t sequence;
+    uint8_t length;
+    const uint8_t* payload;
+    uint64_t timestampNs;
+};
+
+/**
+ * @brief Counters describing the health of the decoded stream
+ */
+struct FrameDecoderStats {
+    uint64_t penFrames = 0;       // Pen frames decoded into StylusEvents
+    uint64_t otherFrames = 0;     // Reply/status frames passed to the frame handler
+    uint64_t checksumErrors = 0;  // Frames rejected by checksum or malformed length
+    uint64_t skippedBytes = 0;    // Bytes discarded while searching for a sync byte
+};
+
+/**
+ * @brief Incremental, resumable decoder from raw byte chunks to StylusEvents
+ *
+ * Chunks may split frames anywhere or carry many frames at once. A frame that
+ * is cut off at the end of a chunk is kept in a small internal buffer and
+ * completed by the next call; complete frames are decoded straight from the
+ * caller's memory. Sync bytes are located with memchr(), which the C library
+ * vectorizes (SSE2/AVX2), so resynchronising over garbage is cheap.
+ *
+ * Not thread-safe; use one decoder per byte stream.
+ */
+class FrameDecoder {
+public:
+    using FrameHandler = std::function<void(const FrameView& frame)>;
+
+    FrameDecoder();
+
+    /**
+     * @brief Set the callback that receives non-pen frames (replies, status)
+     */
+    void setFrameHandler(FrameHandler handler);
+
+    /**
+     * @brief Decode as much of a chunk as fits into the event array
+     *
+     * Stops early when events is full; the caller should then hand the
+     * unconsumed tail (data + return value) to the next call.
+     *
+     * @param data Raw bytes received from the device
+     * @param length Number of bytes in data
+     * @param timestampNs Receive time stamped onto every event from this chunk
+     * @param events Output array
+     * @param capacity Size of the output array
+     * @param produced Set to the number of events written
+     * @return Number of input bytes consumed (== length unless events filled up)
+     */
+    size_t decode(const uint8_t* data, size_t length, uint64_t timestampNs,
+                  StylusEvent* events, size_t capacity, size_t& produced);
+
+    /**
+     * @brief Drop any partially received frame
+     */
+    void reset();
+
+    /**
+     * @brief Number of bytes of an incomplete frame held between calls
+     */
+    size_t pendingBytes() const { return m_partialLength; }
+
+    const FrameDecoderStats& stats() const { return m_stats; }
+
+private:
+    FrameHandler m_frameHandler;
+    FrameDecoderStats m_stats;
+    uint8_t m_partial[FRAME_MAX_SIZE];
+    size_t m_partialLength;
+
+    /**
+     * @brief Validate and dispatch one complete frame starting with the sync byte
+     * @return false if the frame is corrupt (caller resynchronises)
+     */
+    bool handleFrame(const uint8_t* frame, uint64_t timestampNs, StylusEvent* events, size_t& produced);
+
+    /**
+     * @brief Drop the partial buffer's first count bytes and restart at the next sync byte after them
+     *
+     * Bytes between the dropped ones and that sync byte count as skipped.
+     */
+    void dropPartial(size_t count);
+};
+
+/**
+ * @brief Encode a frame in WT13106 wire format
+ * @param out Destination, at least FRAME_OVERHEAD + length bytes
+ * @return Number of bytes written
+ */
+size_t encodeFrame(uint8_t type, uint8_t sequence, const uint8_t* payload, uint8_t length, uint8_t* out);
+
+/**
+ * @brief Encode a pen sample frame (timestamp is not transmitted)
+ * @param out Destination, at least PEN_FRAME_SIZE bytes
+ * @return Number of bytes written (PEN_FRAME_SIZE)
+ */
+size_t encodePenFrame(const StylusEvent& event, uint8_t* out);
+
+#endif // FRAME_DECODER_H
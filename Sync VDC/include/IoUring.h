@@ -0,0 +1,157 @@
+#ifndef IO_URING_H
+#define IO_URING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Kernel headers from 6.0 on have everything used here (provided buffer
+// rings, single-issuer rings, the opcode probe); with older headers
+// ConnectionManager only has its epoll engine
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#ifdef IORING_SETUP_SINGLE_ISSUER
+#define WT13106_HAVE_IO_URING 1
+#endif
+#endif
+#endif
+
+#ifdef WT13106_HAVE_IO_URING
+
+/**
+ * @brief Minimal io_uring instance driven through the raw system calls (Linux)
+ *
+ * Just what ConnectionManager needs, without a liburing dependency: one
+ * submission/completion ring pair and one ring of provided receive buffers.
+ * Not thread-safe; a ring is owned by one event loop thread.
+ *
+ * Typical cycle: getSqe() for every operation to start, submitAndWait()
+ * once, then forEachCompletion() and recycleBuffer() for the buffers the
+ * completions carried.
+ */
+class IoUring {
+public:
+    // IORING_OP_READ_MULTISHOT (6.7); defined here for older headers
+    static constexpr uint8_t kOpReadMultishot = 49;
+
+    IoUring();
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    /**
+     * @brief Create the ring
+     *
+     * Asks for a single-issuer ring with deferred task work, which runs
+     * completions only inside submitAndWait(); such a ring is created
+     * disabled and belongs to the thread that calls enable(). Kernels
+     * before 6.1 get a plain ring.
+     *
+     * @param entries Submission queue size (rounded up to a power of two)
+     * @return false if io_uring is unavailable (see getLastError())
+     */
+    bool open(unsigned entries);
+
+    void close();
+
+    bool isOpen() const { return m_fd >= 0; }
+
+    /**
+     * @brief Make the calling thread the ring's submitter; call before the first submit
+     */
+    bool enable();
+
+    /**
+     * @brief Whether the kernel implements an IORING_OP_* opcode
+     */
+    bool supports(uint8_t opcode) const;
+
+    /**
+     * @brief Register count buffers of size bytes each as buffer group groupId
+     *
+     * Reads submitted with IOSQE_BUFFER_SELECT and this group pick a free
+     * buffer when data arrives, so idle devices hold no memory.
+     *
+     * @param count Power of two, at most 32768
+     */
+    bool setupBuffers(uint16_t groupId, unsigned count, unsigned size);
+
+    uint8_t* buffer(uint16_t bufferId) { return m_buffers.data() + size_t(bufferId) * m_bufferSize; }
+
+    /**
+     * @brief Give a buffer taken by a completion back to the kernel
+     */
+    void recycleBuffer(uint16_t bufferId);
+
+    /**
+     * @brief Next free submission entry, zeroed; nullptr if the queue is full
+     */
+    struct io_uring_sqe* getSqe();
+
+    /**
+     * @brief Submit the prepared entries and wait for at least waitCount completions
+     * @return Entries submitted, or -errno (EINTR is not an error)
+     */
+    int submitAndWait(unsigned waitCount);
+
+    /**
+     * @brief Hand every available completion to handler(const io_uring_cqe&)
+     * @return Number of completions consumed
+     */
+    template <class Handler>
+    unsigned forEachCompletion(Handler&& handler)
+    {
+        unsigned head = *m_cqHead;
+        unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+        unsigned count = 0;
+        for (; head != tail; ++head, ++count) {
+            handler(m_cqes[head & m_cqMask]);
+        }
+        __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+        return count;
+    }
+
+    int fd() const { return m_fd; }
+
+    std::string getLastError() const { return m_lastError; }
+
+private:
+    int m_fd;
+    bool m_disabled;             // Created with IORING_SETUP_R_DISABLED; enable() pending
+    std::vector<uint8_t> m_supported;  // Per opcode, from IORING_REGISTER_PROBE
+
+    void* m_sqRing;
+    size_t m_sqRingSize;
+    void* m_cqRing;              // Same mapping as m_sqRing with IORING_FEAT_SINGLE_MMAP
+    size_t m_cqRingSize;
+    struct io_uring_sqe* m_sqes;
+    size_t m_sqesSize;
+
+    unsigned* m_sqHead;
+    unsigned* m_sqTail;
+    unsigned* m_sqArray;
+    unsigned m_sqMask;
+    unsigned m_sqEntries;
+    unsigned m_sqLocalTail;      // Prepared but not yet published
+    unsigned* m_cqHead;
+    unsigned* m_cqTail;
+    unsigned m_cqMask;
+    struct io_uring_cqe* m_cqes;
+
+    struct io_uring_buf_ring* m_bufRing;
+    size_t m_bufRingSize;
+    unsigned m_bufMask;
+    std::vector<uint8_t> m_buffers;
+    unsigned m_bufferSize;
+
+    std::string m_lastError;
+
+    bool mapRings(const struct io_uring_params& params);
+};
+
+#endif // WT13106_HAVE_IO_URING
+
+#endif // IO_URING_H
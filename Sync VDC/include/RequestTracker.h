@@ -0,0 +1,152 @@
+#ifndef REQUEST_TRACKER_H
+#define REQUEST_TRACKER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "FrameDecoder.h"
+
+/**
+ * Bit the board sets in the frame type of a reply (reply type = request type | 0x80)
+ */
+const uint8_t FRAME_REPLY_FLAG = 0x80;
+
+/**
+ * @brief Outcome of a submitted request
+ */
+enum class ResponseStatus {
+    OK,            // Reply received
+    TIMEOUT,       // No reply within the request's timeout
+    SEND_FAILED,   // The command could not be written (or no sequence number was free)
+    DISCONNECTED   // The connection was closed while the request was outstanding
+};
+
+/**
+ * @brief Reply to a submitted request
+ */
+struct Response {
+    ResponseStatus status = ResponseStatus::TIMEOUT;
+    uint8_t type = 0;
+    uint8_t sequence = 0;           // Sequence number the request was sent with
+    std::vector<uint8_t> payload;
+    uint64_t timestampNs = 0;       // Receive time of the reply (steady_clock)
+    uint64_t roundTripNs = 0;       // Submit to reply
+
+    bool ok() const { return status == ResponseStatus::OK; }
+};
+
+using ResponseCallback = std::function<void(const Response& response)>;
+
+/**
+ * @brief How a reply is matched to its request
+ */
+enum class RequestMatch {
+    SEQUENCE,  // Reply carries the request's sequence number and the expected type
+    OPCODE     // Reply has the expected type; oldest outstanding request first
+};
+
+/**
+ * @brief Per-request options for WT13106Connection::submit()
+ */
+struct SubmitOptions {
+    uint32_t timeoutMs = 1000;
+    RequestMatch match = RequestMatch::SEQUENCE;
+    int replyType = -1;  // Expected reply frame type; -1 = request type | FRAME_REPLY_FLAG
+};
+
+/**
+ * @brief Correlates reply frames with outstanding requests
+ *
+ * Requests occupy one of 256 slots indexed by their sequence number, so at
+ * most 256 can be outstanding. onFrame() is called for every decoded non-pen
+ * frame and claims the ones that answer a request; everything else (status
+ * frames, stray replies) is left to the application's frame handler. Pen
+ * frames never reach the tracker.
+ *
+ * Thread-safe. Callbacks run on the thread that completes the request (the
+ * one decoding the stream, or the one calling expire()/failAll()) after the
+ * internal lock has been released.
+ */
+class RequestTracker {
+public:
+    RequestTracker();
+
+    /**
+     * @brief Register a request and reserve a sequence number for it
+     * @return Sequence number to send the request with, or -1 if 256 are
+     *         outstanding (callback is then left untouched)
+     */
+    int begin(uint8_t type, const SubmitOptions& options, ResponseCallback&& callback, uint64_t nowNs);
+
+    /**
+     * @brief Complete a request without a reply (e.g. SEND_FAILED)
+     */
+    void cancel(uint8_t sequence, ResponseStatus status);
+
+    /**
+     * @brief Offer a decoded non-pen frame
+     * @return true if it answered an outstanding request
+     */
+    bool onFrame(const FrameView& frame);
+
+    /**
+     * @brief Time out every request whose deadline is at or before nowNs
+     */
+    void expire(uint64_t nowNs);
+
+    /**
+     * @brief Complete every outstanding request with the given status
+     */
+    void failAll(ResponseStatus status);
+
+    /**
+     * @brief Earliest deadline of an outstanding request (UINT64_MAX if none)
+     *
+     * Lock-free; may be earlier than the true value after a request completed,
+     * in which case expire() simply finds nothing to do.
+     */
+    uint64_t nextDeadlineNs() const { return m_nextDeadlineNs.load(std::memory_order_acquire); }
+
+    size_t outstanding() const;
+
+private:
+    struct Slot {
+        bool active = false;
+        RequestMatch match = RequestMatch::SEQUENCE;
+        uint8_t replyType = 0;
+        uint64_t ticket = 0;       // Submission order, for OPCODE matching
+        uint64_t submittedNs = 0;
+        uint64_t deadlineNs = 0;
+        ResponseCallback callback;
+    };
+
+    struct Completion {
+        ResponseCallback callback;
+        Response response;
+    };
+
+    mutable std::mutex m_mutex;
+    Slot m_slots[256];
+    size_t m_active;
+    uint8_t m_nextSequence;
+    uint64_t m_nextTicket;
+    std::atomic<uint64_t> m_nextDeadlineNs;
+
+    /**
+     * @brief Free a slot and move its callback into a completion; caller holds m_mutex
+     */
+    Completion release(uint8_t sequence, ResponseStatus status);
+
+    /**
+     * @brief Recompute m_nextDeadlineNs from the active slots; caller holds m_mutex
+     */
+    void updateNextDeadline();
+
+    static void complete(std::vector<Completion>& completions);
+};
+
+#endif // REQUEST_TRACKER_H
@@ -0,0 +1,207 @@
+#ifndef SHARED_EVENT_RING_H
+#define SHARED_EVENT_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "StylusEvent.h"
+
+/*
+ * Decoded pen events shared with other processes (Linux)
+ *
+ * The process that owns the port publishes events into a POSIX shared
+ * memory object (/dev/shm/<name>) with SharedEventWriter; any number of
+ * local processes map it read-only with SharedEventReader. Reading costs
+ * no system call: a reader polls the published sequence and copies events
+ * straight out of the mapping. Only waiting for events when there are none
+ * enters the kernel (a futex on the header).
+ *
+ * The writer never waits for readers, which cannot write to the mapping.
+ * Events are stamped with sequence numbers, and a reader that falls a
+ * whole ring behind skips ahead and is told how many events it lost.
+ *
+ * Layout, all in native byte order (the object is never shared between
+ * machines):
+ *
+ *   [0, 4096)     SharedEventRingHeader
+ *   [4096, ...)   capacity StylusEvent slots; sequence s is in slot s % capacity
+ *
+ * Writer protocol (a seqlock over the whole ring): raise writeLimit to
+ * the end of the slots about to be written, fence, write the slots, store
+ * published with release semantics, bump the futex word and wake waiters.
+ * Readers copy events below published, fence, and then re-read writeLimit;
+ * copied events more than a ring below it may have been overwritten while
+ * they were copied and are discarded.
+ */
+
+constexpr uint32_t kSharedEventRingMagic = 0x56455457;  // "WTEV"
+constexpr uint32_t kSharedEventRingVersion = 1;
+constexpr size_t kSharedEventRingHeaderSize = 4096;
+
+struct SharedEventRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t eventSize;                   // sizeof(StylusEvent)
+    uint32_t capacity;                    // Slots; a power of two
+    int32_t writerPid;
+    std::atomic<uint32_t> closed;         // Set by the writer when it stops publishing
+
+    alignas(64) std::atomic<uint64_t> writeLimit;  // Slots below this sequence may be being written
+    alignas(64) std::atomic<uint64_t> published;   // Sequence of the next event to be published
+    alignas(64) std::atomic<uint32_t> futexWord;   // Changes on every publish; readers sleep on it
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "The shared ring needs lock-free atomics to work across processes");
+static_assert(sizeof(SharedEventRingHeader) <= kSharedEventRingHeaderSize, "Header must fit in its page");
+
+#ifdef __linux__
+
+/**
+ * @brief Producer side: creates the shared ring and publishes events into it
+ *
+ * Used by one thread (e.g. the connection's reader, see
+ * WT13106Connection::startSharedExport()).
+ */
+class SharedEventWriter {
+public:
+    SharedEventWriter();
+    ~SharedEventWriter();
+
+    SharedEventWriter(const SharedEventWriter&) = delete;
+    SharedEventWriter& operator=(const SharedEventWriter&) = delete;
+
+    /**
+     * @brief Create /dev/shm/<name> and map it
+     *
+     * A ring of the same name left behind by a writer that no longer runs is
+     * replaced; one whose writer is still alive is not.
+     *
+     * @param name Object name, e.g. "wt13106-board1" (a leading '/' is optional)
+     * @param capacity Minimum number of events the ring holds (rounded up to a power of two)
+     * @return false on failure (see getLastError())
+     */
+    bool create(const std::string& name, size_t capacity = 65536);
+
+    /**
+     * @brief Mark the ring closed, wake readers, unmap and unlink it
+     *
+     * Readers keep their mapping and can still read what was published.
+     */
+    void close();
+
+    bool isOpen() const { return m_header != nullptr; }
+
+    /**
+     * @brief Reserve contiguous slots for up to count events; never waits
+     * @return Number of slots (fewer at the end of the ring, 0 if not open)
+     */
+    size_t claim(StylusEvent*& slots, size_t count);
+
+    /**
+     * @brief Publish count events written into the slots from claim()
+     */
+    void commit(size_t count);
+
+    /**
+     * @brief Copy events in and publish them
+     */
+    void publish(const StylusEvent* events, size_t count);
+
+    /**
+     * @brief Sequence number the next published event will get
+     */
+    uint64_t published() const;
+
+    /**
+     * @brief Wake sleeping readers on every commit() (default true)
+     *
+     * One futex wake per commit. Turn it off when every reader polls.
+     */
+    void setWakeReaders(bool wake) { m_wakeReaders = wake; }
+
+    const std::string& name() const { return m_name; }
+
+    std::string getLastError() const { return m_lastError; }
+
+private:
+    std::string m_name;
+    SharedEventRingHeader* m_header;
+    StylusEvent* m_slots;
+    size_t m_mappedSize;
+    uint64_t m_mask;
+    bool m_wakeReaders;
+    std::string m_lastError;
+};
+
+/**
+ * @brief Consumer side: maps a writer's ring read-only
+ *
+ * Each reader keeps its own cursor, so independent readers in any number of
+ * processes see every event. A reader starts with the next event published
+ * after open(). Not thread-safe; use one reader per consuming thread.
+ */
+class SharedEventReader {
+public:
+    SharedEventReader();
+    ~SharedEventReader();
+
+    SharedEventReader(const SharedEventReader&) = delete;
+    SharedEventReader& operator=(const SharedEventReader&) = delete;
+
+    /**
+     * @brief Map /dev/shm/<name> read-only and check its layout
+     */
+    bool open(const std::string& name);
+
+    void close();
+
+    bool isOpen() const { return m_header != nullptr; }
+
+    /**
+     * @brief Copy out events published since the last read, without waiting or system calls
+     * @param events Destination
+     * @param capacity Size of events
+     * @param lost Incremented by the number of events the writer overwrote before they were read
+     * @return Number of events copied
+     */
+    size_t read(StylusEvent* events, size_t capacity, uint64_t& lost);
+
+    /**
+     * @brief read(), sleeping on the ring's futex for up to timeoutMs if nothing is pending
+     * @return Number of events copied (0 on timeout or when the writer has closed)
+     */
+    size_t readWait(StylusEvent* events, size_t capacity, uint64_t& lost, uint32_t timeoutMs);
+
+    /**
+     * @brief True once the writer closed the ring or its process is gone
+     */
+    bool writerGone() const;
+
+    /**
+     * @brief Sequence of the next event this reader will return
+     */
+    uint64_t cursor() const { return m_cursor; }
+
+    /**
+     * @brief Published events this reader has not read yet
+     */
+    uint64_t lag() const;
+
+    std::string getLastError() const { return m_lastError; }
+
+private:
+    const SharedEventRingHeader* m_header;
+    const StylusEvent* m_slots;
+    size_t m_mappedSize;
+    uint64_t m_capacity;
+    uint64_t m_mask;
+    uint64_t m_cursor;
+    std::string m_lastError;
+};
+
+#endif // __linux__
+
+#endif // SHARED_EVENT_RING_H
@@ -0,0 +1,175 @@
+#ifndef SPSC_RING_BUFFER_H
+#define SPSC_RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+/**
+ * @brief Fixed-size single-producer/single-consumer lock-free ring buffer
+ *
+ * Exactly one thread may call push() and exactly one (other) thread may call
+ * pop()/peek(). The capacity is rounded up to a power of two and fixed at
+ * construction, so the buffer never allocates after it is created.
+ *
+ * Head and tail live on separate cache lines, and each side keeps a cached
+ * copy of the other side's index so that the shared index is only re-read
+ * when the cached value says the buffer looks full (producer) or empty
+ * (consumer).
+ *
+ * @tparam T Trivially copyable element type
+ */
+template <typename T>
+class SpscRingBuffer {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "SpscRingBuffer elements must be trivially copyable");
+
+public:
+    /**
+     * @brief Constructor
+     * @param capacity Minimum number of elements the buffer can hold
+     */
+    explicit SpscRingBuffer(size_t capacity)
+        : m_capacity(roundUpPowerOfTwo(capacity < 2 ? 2 : capacity))
+        , m_mask(m_capacity - 1)
+        , m_buffer(new T[m_capacity])
+    {
+    }
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    /**
+     * @brief Append up to count elements (producer side)
+     * @param data Elements to append
+     * @param count Number of elements available in data
+     * @return Number of elements actually appended (less than count when full)
+     */
+    size_t push(const T* data, size_t count)
+    {
+        const size_t tail = m_producer.index.load(std::memory_order_relaxed);
+        size_t free = m_capacity - (tail - m_producer.cachedOther);
+        if (free < count) {
+            m_producer.cachedOther = m_consumer.index.load(std::memory_order_acquire);
+            free = m_capacity - (tail - m_producer.cachedOther);
+        }
+
+        const size_t n = count < free ? count : free;
+        if (n == 0) {
+            return 0;
+        }
+
+        copyIn(tail, data, n);
+        m_producer.index.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    /**
+     * @brief Remove up to capacity elements (consumer side)
+     * @param out Destination buffer
+     * @param capacity Size of the destination buffer in elements
+     * @return Number of elements copied into out (0 when empty)
+     */
+    size_t pop(T* out, size_t capacity)
+    {
+        const size_t n = peek(out, capacity);
+        if (n > 0) {
+            consume(n);
+        }
+        return n;
+    }
+
+    /**
+     * @brief Copy up to capacity elements without removing them (consumer side)
+     * @param out Destination buffer
+     * @param capacity Size of the destination buffer in elements
+     * @return Number of elements copied into out
+     */
+    size_t peek(T* out, size_t capacity)
+    {
+        const size_t head = m_consumer.index.load(std::memory_order_relaxed);
+        size_t available = m_consumer.cachedOther - head;
+        if (available < capacity) {
+            m_consumer.cachedOther = m_producer.index.load(std::memory_order_acquire);
+            available = m_consumer.cachedOther - head;
+        }
+
+        const size_t n = capacity < available ? capacity : available;
+        if (n > 0) {
+            copyOut(head, out, n);
+        }
+        return n;
+    }
+
+    /**
+     * @brief Discard elements previously returned by peek() (consumer side)
+     * @param count Number of elements to discard
+     */
+    void consume(size_t count)
+    {
+        const size_t head = m_consumer.index.load(std::memory_order_relaxed);
+        m_consumer.index.store(head + count, std::memory_order_release);
+    }
+
+    /**
+     * @brief Number of elements currently stored (approximate when racing)
+     */
+    size_t size() const
+    {
+        const size_t tail = m_producer.index.load(std::memory_order_acquire);
+        const size_t head = m_consumer.index.load(std::memory_order_acquire);
+        return tail - head;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    size_t capacity() const { return m_capacity; }
+
+private:
+    static constexpr size_t kCacheLine = 64;
+
+    struct alignas(kCacheLine) Side {
+        std::atomic<size_t> index{0};
+        size_t cachedOther = 0;  // Last observed value of the opposite index
+    };
+
+    static size_t roundUpPowerOfTwo(size_t value)
+    {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    void copyIn(size_t position, const T* data, size_t count)
+    {
+        const size_t offset = position & m_mask;
+        const size_t first = count < m_capacity - offset ? count : m_capacity - offset;
+        std::memcpy(&m_buffer[offset], data, first * sizeof(T));
+        if (count > first) {
+            std::memcpy(&m_buffer[0], data + first, (count - first) * sizeof(T));
+        }
+    }
+
+    void copyOut(size_t position, T* out, size_t count) const
+    {
+        const size_t offset = position & m_mask;
+        const size_t first = count < m_capacity - offset ? count : m_capacity - offset;
+        std::memcpy(out, &m_buffer[offset], first * sizeof(T));
+        if (count > first) {
+            std::memcpy(out + first, &m_buffer[0], (count - first) * sizeof(T));
+        }
+    }
+
+    const size_t m_capacity;
+    const size_t m_mask;
+    std::unique_ptr<T[]> m_buffer;
+
+    Side m_producer;  // Written by the producer thread (tail)
+    Side m_consumer;  // Written by the consumer thread (head)
+};
+
+#endif // SPSC_RING_BUFFER_H
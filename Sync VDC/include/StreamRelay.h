@@ -0,0 +1,251 @@
+#ifndef STREAM_RELAY_H
+#define STREAM_RELAY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrameDecoder.h"
+#include "SpscRingBuffer.h"
+#include "StylusEvent.h"
+
+class WT13106Connection;
+
+/*
+ * Relay wire format
+ *
+ * A relay client receives a stream of messages, each a RelayMessageHeader
+ * followed by header.length payload bytes, all in native byte order (the
+ * relay only listens locally):
+ *
+ *   RELAY_HELLO    Sent once on connect: RelayHello
+ *   RELAY_EVENTS   A batch of StylusEvent structs exactly as the library
+ *                  returns them (16 bytes each)
+ *   RELAY_LOST     uint64_t: events dropped for this client because its
+ *                  send queue was full; sent before the next RELAY_EVENTS
+ *
+ * Clients send nothing; closing the socket unsubscribes.
+ */
+
+enum RelayMessageType : uint32_t {
+    RELAY_HELLO = 1,
+    RELAY_EVENTS = 2,
+    RELAY_LOST = 3
+};
+
+struct RelayMessageHeader {
+    uint32_t length;  // Payload bytes after this header
+    uint32_t type;    // RelayMessageType
+};
+
+constexpr uint32_t kRelayProtocolVersion = 1;
+
+struct RelayHello {
+    uint32_t version;    // kRelayProtocolVersion
+    uint32_t eventSize;  // sizeof(StylusEvent)
+};
+
+static_assert(sizeof(RelayMessageHeader) == 8 && sizeof(RelayHello) == 8, "Relay headers are fixed-size");
+
+#ifdef __linux__
+
+/**
+ * @brief Options for StreamRelay
+ */
+struct StreamRelayOptions {
+    std::string unixPath;             // Unix domain socket to listen on (empty = none)
+    int tcpPort = -1;                 // >= 0: also listen on 127.0.0.1:tcpPort (0 = any free port)
+    size_t maxClients = 1024;
+    size_t clientQueueBytes = 1024 * 1024;  // Per-client limit of queued, unsent bytes
+    size_t pendingBatches = 1024;     // Batches buffered between the reader thread and the relay thread
+};
+
+/**
+ * @brief Counters (see StreamRelay::getStats())
+ */
+struct StreamRelayStats {
+    uint64_t clients = 0;          // Connected now
+    uint64_t clientsServed = 0;    // Accepted since start()
+    uint64_t eventsIn = 0;         // Decoded from the device
+    uint64_t batchesIn = 0;        // Messages built by the reader thread (one per chunk with events)
+    uint64_t batchesDropped = 0;   // Built but not taken by the relay thread in time (lost for every client)
+    uint64_t eventsLost = 0;       // Summed over clients whose queue was full
+    uint64_t bytesSent = 0;
+    uint64_t writeCalls = 0;       // writev() calls to clients
+};
+
+/**
+ * @brief Serves one device's decoded events to many local clients (Linux)
+ *
+ * The relay takes the connection into streaming mode. Its reader thread
+ * decodes every chunk once into a length-prefixed RELAY_EVENTS message and
+ * hands it to the relay thread through a lock-free queue; it never waits
+ * for the relay or for clients, so subscribers cannot slow the device down.
+ *
+ * The relay thread accepts clients on a Unix domain socket and/or
+ * loopback TCP and queues a reference to each message for every client:
+ * a message is built once and shared, not copied per client. Whatever a
+ * client's socket will take is written with one writev() covering many
+ * queued messages; a client that cannot keep up hits its queue limit,
+ * loses the batches that do not fit and is told so with RELAY_LOST.
+ *
+ * The relay decodes the stream itself, so while it runs non-pen frames
+ * (replies) are neither relayed nor matched to submit() requests.
+ */
+class StreamRelay {
+public:
+    explicit StreamRelay(const StreamRelayOptions& options);
+    ~StreamRelay();
+
+    StreamRelay(const StreamRelay&) = delete;
+    StreamRelay& operator=(const StreamRelay&) = delete;
+
+    /**
+     * @brief Listen, start the relay thread and start streaming from connection
+     * @param connection Connected, not streaming; must outlive the relay
+     * @return false on failure (see getLastError())
+     */
+    bool start(WT13106Connection& connection);
+
+    /**
+     * @brief Stop streaming, disconnect every client and close the sockets
+     */
+    void stop();
+
+    bool isRunning() const { return m_running; }
+
+    /**
+     * @brief TCP port actually bound (useful with tcpPort = 0), or -1
+     */
+    int tcpPort() const { return m_boundTcpPort; }
+
+    StreamRelayStats getStats() const;
+
+    std::string getLastError() const { return m_lastError; }
+
+private:
+    struct Batch;
+    struct Client;
+
+    StreamRelayOptions m_options;
+    WT13106Connection* m_connection;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_stopRequested;
+    std::thread m_thread;
+    std::string m_lastError;
+
+    int m_epollFd;
+    int m_wakeFd;
+    int m_unixFd;
+    int m_tcpFd;
+    int m_boundTcpPort;
+
+    // Reader thread -> relay thread; the relay thread frees what it takes
+    std::unique_ptr<SpscRingBuffer<Batch*>> m_pending;
+    std::atomic<bool> m_wakePending;
+    std::atomic<uint64_t> m_droppedEvents;  // Events of dropped batches not yet reported to clients
+    FrameDecoder m_decoder;  // Reader thread only
+    std::shared_ptr<Batch> m_hello;
+
+    std::vector<std::unique_ptr<Client>> m_clients;  // Relay thread only
+
+    // Updated by both threads, read by getStats()
+    std::atomic<uint64_t> m_clientsServed;
+    std::atomic<uint64_t> m_eventsIn;
+    std::atomic<uint64_t> m_batchesIn;
+    std::atomic<uint64_t> m_batchesDropped;
+    std::atomic<uint64_t> m_eventsLost;
+    std::atomic<uint64_t> m_bytesSent;
+    std::atomic<uint64_t> m_writeCalls;
+    std::atomic<uint64_t> m_clientCount;
+
+    bool listenUnix(const std::string& path);
+    bool listenTcp(int port);
+    void closeSockets();
+
+    /**
+     * @brief Streaming callback: decode a chunk into a batch and queue it for the relay thread
+     */
+    void onChunk(const uint8_t* data, size_t length);
+
+    void run();
+    void accept(int listenFd);
+    void distribute();
+    void enqueue(Client& client, const std::shared_ptr<Batch>& batch);
+
+    /**
+     * @brief writev() as much of the client's queue as the socket takes
+     * @return false if the client is gone
+     */
+    bool flush(Client& client);
+
+    /**
+     * @brief Close a client's socket; it is removed by sweepClients() once no event refers to it
+     */
+    void closeClient(Client& client);
+    void sweepClients();
+};
+
+/**
+ * @brief Minimal client for a StreamRelay
+ *
+ * Connects to a Unix socket path or "tcp:PORT" on 127.0.0.1, checks the
+ * hello and returns the events of the RELAY_EVENTS messages that follow.
+ */
+class RelayClient {
+public:
+    RelayClient();
+    ~RelayClient();
+
+    RelayClient(const RelayClient&) = delete;
+    RelayClient& operator=(const RelayClient&) = delete;
+
+    /**
+     * @brief Connect and wait up to timeoutMs for the relay's hello
+     * @param address Unix socket path, or "tcp:PORT" for 127.0.0.1:PORT
+     */
+    bool connect(const std::string& address, uint32_t timeoutMs = 1000);
+
+    void close();
+
+    bool isConnected() const { return m_fd >= 0; }
+
+    /**
+     * @brief Decoded events received since the last call
+     * @param lost Incremented by the relay's RELAY_LOST counts
+     * @return Number of events copied; 0 on timeout or when the relay closed (see isConnected())
+     */
+    size_t receive(StylusEvent* events, size_t capacity, uint64_t& lost, uint32_t timeoutMs = 1000);
+
+    int getNativeHandle() const { return m_fd; }
+
+    std::string getLastError() const { return m_lastError; }
+
+private:
+    int m_fd;
+    std::vector<uint8_t> m_buffer;  // Received bytes in [m_offset, m_end)
+    size_t m_offset;
+    size_t m_end;
+    size_t m_eventBytesLeft;        // Event bytes of the current RELAY_EVENTS message not returned yet
+    std::string m_lastError;
+
+    /**
+     * @brief Take events and control messages out of the buffer
+     * @return Number of events copied; false in ok on a protocol error
+     */
+    size_t parse(StylusEvent* events, size_t capacity, uint64_t& lost, bool& ok);
+
+    /**
+     * @brief Wait up to timeoutMs for data and append it to the buffer
+     * @return false on timeout, or when the relay closed (the socket is then closed too)
+     */
+    bool fill(uint32_t timeoutMs);
+};
+
+#endif // __linux__
+
+#endif // STREAM_RELAY_H
@@ -0,0 +1,235 @@
+#ifndef STROKE_ARCHIVE_H
+#define STROKE_ARCHIVE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "StrokeBuilder.h"
+
+/**
+ * Stroke archive file (".wtstk"), all integers little endian
+ *
+ *   header     32 bytes   magic "WT13STK1", version u32, header size u32,
+ *                         time resolution (ns) u32, reserved
+ *   blocks                repeated, each independently decodable:
+ *     block header  48    magic "STKB", block size u32 (all of the block),
+ *                         stroke count u32, point count u32, start ns u64,
+ *                         end ns u64, min x/y, max x/y u16 x4,
+ *                         first page u32, last page u32
+ *     stroke index        stroke count x 40 bytes: start ns u64, end ns u64,
+ *                         min x/y, max x/y u16 x4, point count u32, page u32,
+ *                         payload offset u32 (from block start), payload size u32
+ *     payloads            per stroke: first x, y, pressure u16 x3, base time
+ *                         step u32, then the remaining points in groups of
+ *                         up to 64: four bit widths u8 (x, y, pressure, time),
+ *                         then each column bit-packed (LSB first, padded to a byte)
+ *     padding       8     zero bytes, so decoders may load 8 bytes at a time
+ *   directory             block count x { block offset u64, copy of its 48-byte header }
+ *   trailer    32 bytes   magic "WT13SEND", directory offset u64,
+ *                         block count u64, stroke count u64
+ *
+ * Column values are zigzag-encoded differences: x, y and pressure against the
+ * previous point, time steps (in units of the time resolution) against the
+ * previous step, the first against the base step. Regularly sampled strokes
+ * therefore cost a few bits per coordinate and nothing for time.
+ *
+ * Queries use the directory to skip whole blocks by time, page or region and
+ * the stroke index to pick strokes inside a block; only the selected strokes'
+ * payloads are decoded. A file without a trailer (the writer crashed) is
+ * still readable: the reader rebuilds the directory from the block headers.
+ */
+const char STROKE_ARCHIVE_MAGIC[8] = {'W', 'T', '1', '3', 'S', 'T', 'K', '1'};
+const char STROKE_ARCHIVE_TRAILER_MAGIC[8] = {'W', 'T', '1', '3', 'S', 'E', 'N', 'D'};
+const uint32_t STROKE_ARCHIVE_VERSION = 1;
+const size_t STROKE_ARCHIVE_HEADER_SIZE = 32;
+const size_t STROKE_ARCHIVE_BLOCK_HEADER_SIZE = 48;
+const size_t STROKE_ARCHIVE_INDEX_ENTRY_SIZE = 40;
+const size_t STROKE_ARCHIVE_BLOCK_PADDING = 8;
+const size_t STROKE_ARCHIVE_TRAILER_SIZE = 32;
+const size_t STROKE_ARCHIVE_GROUP_SIZE = 64;
+
+/**
+ * @brief Options for StrokeArchiveWriter
+ */
+struct StrokeArchiveOptions {
+    size_t pointsPerBlock = 16384;    // A block is closed once it holds this many points
+    uint32_t timeResolutionNs = 1000; // Sample times are stored to this precision (1 = lossless)
+};
+
+/**
+ * @brief Summary of one block, from the directory or its header
+ */
+struct ArchiveBlockInfo {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t strokeCount;
+    uint32_t pointCount;
+    uint64_t startNs;
+    uint64_t endNs;
+    StrokeBounds bounds;
+    uint32_t firstPage;
+    uint32_t lastPage;
+};
+
+/**
+ * @brief Stroke found by a query; metadata comes from the block index, samples from decodeStroke()
+ */
+struct ArchiveStrokeRef {
+    uint32_t block;
+    uint32_t index;       // Position within the block
+    uint64_t startNs;
+    uint64_t endNs;
+    StrokeBounds bounds;
+    uint32_t pointCount;
+    uint32_t page;
+};
+
+/**
+ * @brief Selection for StrokeArchiveReader::findStrokes(); the default matches everything
+ */
+struct ArchiveQuery {
+    uint64_t fromNs = 0;                                        // Strokes overlapping [fromNs, toNs]
+    uint64_t toNs = std::numeric_limits<uint64_t>::max();
+    StrokeBounds region = {0, 0, 0xFFFF, 0xFFFF};               // Strokes whose bounds intersect it
+    uint32_t firstPage = 0;                                     // Strokes on pages [firstPage, lastPage]
+    uint32_t lastPage = std::numeric_limits<uint32_t>::max();
+};
+
+/**
+ * @brief Appends completed strokes to an archive file
+ *
+ * Strokes are encoded as they are appended and buffered until the block is
+ * full, so memory use is bounded by one block. Typically fed from
+ * StrokeBuilder::setStrokeHandler(). Not thread-safe.
+ */
+class StrokeArchiveWriter {
+public:
+    StrokeArchiveWriter();
+    ~StrokeArchiveWriter();
+
+    StrokeArchiveWriter(const StrokeArchiveWriter&) = delete;
+    StrokeArchiveWriter& operator=(const StrokeArchiveWriter&) = delete;
+
+    /**
+     * @brief Create (truncate) an archive and write its header
+     */
+    bool open(const std::string& path, const StrokeArchiveOptions& options = StrokeArchiveOptions());
+
+    /**
+     * @brief Encode one stroke (strokes must be appended in time order)
+     */
+    bool append(const Stroke& stroke);
+
+    /**
+     * @brief Write the block in progress, even if it is not full
+     */
+    bool flush();
+
+    /**
+     * @brief Write the last block, the directory and the trailer, then close the file
+     */
+    bool close();
+
+    bool isOpen() const { return m_file != nullptr; }
+    uint64_t strokeCount() const { return m_strokeCount; }
+    uint64_t pointCount() const { return m_pointCount; }
+    uint64_t bytesWritten() const { return m_offset; }
+    std::string getLastError() const { return m_lastError; }
+
+private:
+    std::FILE* m_file;
+    StrokeArchiveOptions m_options;
+    uint64_t m_offset;
+    uint64_t m_strokeCount;
+    uint64_t m_pointCount;
+    std::vector<uint8_t> m_index;    // Stroke index of the block in progress
+    std::vector<uint8_t> m_payload;  // Encoded strokes of the block in progress
+    ArchiveBlockInfo m_block;        // Summary of the block in progress
+    std::vector<ArchiveBlockInfo> m_directory;
+    std::vector<uint64_t> m_columns; // Scratch: zigzag values of one group
+    std::string m_lastError;
+
+    void encodeStroke(const Stroke& stroke);
+
+    bool writeBlock();
+
+    bool writeBytes(const void* data, size_t length);
+};
+
+/**
+ * @brief Memory-mapped, random-access reader for stroke archives
+ *
+ * open() maps the file and loads the directory. findStrokes() reads only
+ * the headers and stroke indexes of blocks that can match, and
+ * decodeStroke() decodes one stroke's payload into caller-provided columns.
+ */
+class StrokeArchiveReader {
+public:
+    StrokeArchiveReader();
+    ~StrokeArchiveReader();
+
+    StrokeArchiveReader(const StrokeArchiveReader&) = delete;
+    StrokeArchiveReader& operator=(const StrokeArchiveReader&) = delete;
+
+    bool open(const std::string& path);
+
+    void close();
+
+    bool isOpen() const { return m_data != nullptr; }
+
+    size_t blockCount() const { return m_blocks.size(); }
+
+    const ArchiveBlockInfo& block(size_t index) const { return m_blocks[index]; }
+
+    uint64_t strokeCount() const { return m_strokeCount; }
+
+    uint64_t pointCount() const { return m_pointCount; }
+
+    uint32_t timeResolutionNs() const { return m_timeResolutionNs; }
+
+    /**
+     * @brief Append the strokes matching a query, in file order
+     * @return Number of strokes appended
+     */
+    size_t findStrokes(const ArchiveQuery& query, std::vector<ArchiveStrokeRef>& out) const;
+
+    /**
+     * @brief Decode one stroke into ref.pointCount-sized columns
+     *
+     * Times are exact for the first point and within half the time resolution
+     * for the others. Any column pointer may be null to skip storing it.
+     * @return false if the stroke's data is corrupt
+     */
+    bool decodeStroke(const ArchiveStrokeRef& ref, uint16_t* x, uint16_t* y, uint16_t* pressure,
+                      uint64_t* timestampNs) const;
+
+    /**
+     * @brief false if the file had no trailer and the directory was rebuilt by scanning
+     */
+    bool wasClosedCleanly() const { return m_hasTrailer; }
+
+    std::string getLastError() const { return m_lastError; }
+
+private:
+    const uint8_t* m_data;
+    uint64_t m_size;
+    uint32_t m_timeResolutionNs;
+    uint64_t m_strokeCount;
+    uint64_t m_pointCount;
+    bool m_hasTrailer;
+    std::vector<ArchiveBlockInfo> m_blocks;
+    std::string m_lastError;
+#ifdef _WIN32
+    void* m_fileHandle;
+    void* m_mappingHandle;
+#endif
+
+    bool loadDirectory(uint64_t directoryOffset, uint64_t blockCount);
+
+    void rebuildDirectory();
+};
+
+#endif // STROKE_ARCHIVE_H
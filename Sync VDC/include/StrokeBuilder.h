@@ -0,0 +1,186 @@
+#ifndef STROKE_BUILDER_H
+#define STROKE_BUILDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Arena.h"
+#include "StrokeSimplifier.h"
+#include "StylusEvent.h"
+
+/**
+ * @brief Axis-aligned bounding box in device coordinates (inclusive)
+ */
+struct StrokeBounds {
+    uint16_t minX;
+    uint16_t minY;
+    uint16_t maxX;
+    uint16_t maxY;
+};
+
+/**
+ * @brief View of one pen stroke stored as a structure of arrays
+ *
+ * The four columns hold count samples each. For completed strokes they point
+ * into the StrokeBuilder's arena and stay valid until clear(); the view itself
+ * can be copied freely.
+ */
+struct Stroke {
+    const uint16_t* x;
+    const uint16_t* y;
+    const uint16_t* pressure;
+    const uint64_t* timestampNs;
+    uint32_t count;
+    uint32_t rawCount;    // Samples received for the stroke (count + points dropped by simplification)
+    uint32_t page;        // Incremented by every STYLUS_PAGE_CLEAR
+    StrokeBounds bounds;  // Of all received samples
+    double length;        // Length of the received polyline in device units
+
+    uint64_t startNs() const { return count ? timestampNs[0] : 0; }
+    uint64_t endNs() const { return count ? timestampNs[count - 1] : 0; }
+};
+
+/**
+ * @brief Groups decoded pen samples into strokes as they arrive
+ *
+ * A stroke starts with the first sample that has STYLUS_TIP_DOWN set and ends
+ * with the first one that does not (that hover sample is not part of the
+ * stroke). STYLUS_PAGE_CLEAR also ends the current stroke and starts a new
+ * page. Bounds and length of the stroke in progress are updated per sample.
+ * With setSimplification() samples pass through a StrokeSimplifier on the
+ * way in and only the points it keeps are stored.
+ *
+ *     StrokeBuilder strokes;
+ *     while (size_t count = device.receiveEvents(events, 64, 100)) {
+ *         strokes.addEvents(events, count);
+ *     }
+ *     for (size_t i = 0; i < strokes.strokeCount(); ++i) {
+ *         const Stroke& s = strokes.stroke(i);  // s.x[0 .. s.count), ...
+ *     }
+ *
+ * The stroke in progress is collected in reusable scratch columns; when it
+ * ends its samples are copied once into a single arena allocation, so a
+ * session of millions of samples makes a handful of block allocations and
+ * clear() reuses them. Not thread-safe: feed and query from one thread (e.g.
+ * the receive thread or a ConnectionManager handler).
+ */
+class StrokeBuilder {
+public:
+    using StrokeHandler = std::function<void(const Stroke&)>;
+
+    /**
+     * @param arenaBlockSize Size of each arena block holding completed strokes
+     */
+    explicit StrokeBuilder(size_t arenaBlockSize = Arena::DEFAULT_BLOCK_SIZE);
+
+    StrokeBuilder(const StrokeBuilder&) = delete;
+    StrokeBuilder& operator=(const StrokeBuilder&) = delete;
+
+    void addEvent(const StylusEvent& event);
+
+    void addEvents(const StylusEvent* events, size_t count);
+
+    /**
+     * @brief End the stroke in progress as if the pen had been lifted
+     * @return true if a stroke was completed
+     *
+     * Call this when the connection drops mid-stroke.
+     */
+    bool finishStroke();
+
+    /**
+     * @brief Store strokes simplified to within tolerance device units (0 = keep every sample)
+     * @param window Lookahead of the simplifier (see StrokeSimplifier)
+     *
+     * Ends the stroke in progress. Bounds and length still describe the raw samples.
+     */
+    void setSimplification(double tolerance, size_t window = StrokeSimplifier::DEFAULT_WINDOW,
+                           SimplifierKernel kernel = SimplifierKernel::AUTO);
+
+    /**
+     * @brief Point reduction and error of the simplifier (all zero when disabled)
+     */
+    SimplifierStats simplifierStats() const { return m_simplifier ? m_simplifier->stats() : SimplifierStats(); }
+
+    /**
+     * @brief Called with every completed stroke, right after it is stored
+     */
+    void setStrokeHandler(StrokeHandler handler) { m_strokeHandler = std::move(handler); }
+
+    /**
+     * @brief Number of completed strokes
+     */
+    size_t strokeCount() const { return m_strokes.size(); }
+
+    /**
+     * @brief Completed stroke by index (oldest first)
+     *
+     * The reference is invalidated when the next stroke completes; copy the
+     * Stroke (a small view) to keep it, its sample data does not move.
+     */
+    const Stroke& stroke(size_t index) const { return m_strokes[index]; }
+
+    /**
+     * @brief All completed strokes as a contiguous array of strokeCount() views
+     */
+    const Stroke* strokes() const { return m_strokes.data(); }
+
+    /**
+     * @brief true while the pen is down
+     */
+    bool isDrawing() const { return m_drawing; }
+
+    /**
+     * @brief View of the stroke in progress (count 0 when the pen is up)
+     *
+     * Valid until the next addEvent()/addEvents()/finishStroke().
+     */
+    Stroke currentStroke() const;
+
+    /**
+     * @brief Current page number
+     */
+    uint32_t page() const { return m_page; }
+
+    /**
+     * @brief Samples stored in completed strokes
+     */
+    uint64_t sampleCount() const { return m_sampleCount; }
+
+    /**
+     * @brief Bytes reserved for completed strokes
+     */
+    size_t memoryUsage() const { return m_arena.bytesReserved(); }
+
+    /**
+     * @brief Drop all strokes (and the stroke in progress), keeping memory for reuse
+     */
+    void clear();
+
+private:
+    Arena m_arena;
+    std::vector<Stroke> m_strokes;
+    StrokeHandler m_strokeHandler;
+    uint32_t m_page;
+    uint64_t m_sampleCount;
+    std::unique_ptr<StrokeSimplifier> m_simplifier;
+    std::vector<StylusEvent> m_simplified;  // Output buffer of the simplifier
+
+    // Stroke in progress
+    bool m_drawing;
+    std::vector<uint16_t> m_x;
+    std::vector<uint16_t> m_y;
+    std::vector<uint16_t> m_pressure;
+    std::vector<uint64_t> m_timestampNs;
+    StylusEvent m_last;  // Previous received sample
+    StrokeBounds m_bounds;
+    uint32_t m_rawCount;
+    double m_length;
+
+    void appendSample(const StylusEvent& event);
+};
+
+#endif // STROKE_BUILDER_H
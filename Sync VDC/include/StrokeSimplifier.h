@@ -0,0 +1,136 @@
+#ifndef STROKE_SIMPLIFIER_H
+#define STROKE_SIMPLIFIER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "StylusEvent.h"
+
+/**
+ * @brief Implementation of the perpendicular-distance search
+ */
+enum class SimplifierKernel {
+    AUTO,    // Best one the CPU supports
+    SCALAR,
+    SSE2,    // x86 only
+    AVX2     // x86 only, selected at run time
+};
+
+/**
+ * @brief Running totals of a StrokeSimplifier
+ */
+struct SimplifierStats {
+    uint64_t inputPoints = 0;
+    uint64_t outputPoints = 0;
+    double tolerance = 0.0;  // Guaranteed error bound (device units)
+    double maxError = 0.0;   // Largest distance of a dropped point from its output segment
+
+    /**
+     * @brief Input points per output point (e.g. 8.0 = eight times fewer points)
+     */
+    double reductionRatio() const { return outputPoints ? static_cast<double>(inputPoints) / outputPoints : 0.0; }
+};
+
+/**
+ * @brief Online Ramer-Douglas-Peucker simplification with a bounded window
+ *
+ * Points are buffered from the last emitted point (the anchor) until the
+ * window is full; RDP then runs over the window and every kept point up to
+ * the last one before the window end is emitted. The rest of the window
+ * carries over, and if more than half of it would, the window end is
+ * emitted as well, so each run consumes at least window/2 points and the
+ * cost per point is bounded. endStroke() simplifies what is left and emits
+ * the last point.
+ *
+ * Every dropped point lies within the tolerance of the segment between the
+ * two output points around it; output is a subset of the input, in order,
+ * and always includes the first and last point of a stroke.
+ *
+ * The farthest-point search (the RDP inner loop) runs on SSE2 or AVX2 when
+ * available, for segments of at least 32 points; shorter ones are faster
+ * with the scalar loop. Coordinates are processed in double precision, so
+ * the result does not depend on the kernel. Never allocates after
+ * construction.
+ */
+class StrokeSimplifier {
+public:
+    static const size_t DEFAULT_WINDOW = 64;
+
+    /**
+     * @param tolerance Maximum distance (device units) of a dropped point from the output polyline
+     * @param window Points considered per RDP run (at least 3)
+     * @param kernel Distance kernel; falls back to the best supported one
+     */
+    explicit StrokeSimplifier(double tolerance, size_t window = DEFAULT_WINDOW,
+                              SimplifierKernel kernel = SimplifierKernel::AUTO);
+
+    /**
+     * @brief Feed the next point of the current stroke
+     * @param out Receives the points that became final (room for window() points)
+     * @return Number of points written to out
+     */
+    size_t addPoint(const StylusEvent& point, StylusEvent* out);
+
+    /**
+     * @brief End the current stroke
+     * @param out Receives the remaining output points (room for window() points)
+     * @return Number of points written to out
+     */
+    size_t endStroke(StylusEvent* out);
+
+    size_t window() const { return m_window; }
+
+    SimplifierKernel kernel() const { return m_kernel; }
+
+    const SimplifierStats& stats() const { return m_stats; }
+
+    void resetStats();
+
+    /**
+     * @brief Index of the point in (first, last) farthest from the line first..last
+     * @param[out] maxCross |cross product| of that point, i.e. distance * segment length
+     * @return Index, or first if there are no points in between
+     *
+     * Exposed for benchmarks. The segment must not be degenerate.
+     */
+    static size_t farthestPoint(SimplifierKernel kernel, const double* xs, const double* ys,
+                                size_t first, size_t last, double& maxCross);
+
+    /**
+     * @brief Name of a kernel ("scalar", "sse2", "avx2")
+     */
+    static const char* kernelName(SimplifierKernel kernel);
+
+    /**
+     * @brief Whether the CPU can run a kernel
+     */
+    static bool isSupported(SimplifierKernel kernel);
+
+private:
+    double m_tolerance;
+    size_t m_window;
+    SimplifierKernel m_kernel;
+    SimplifierStats m_stats;
+
+    // Current window; index 0 is the anchor (already emitted)
+    size_t m_count;
+    std::vector<double> m_xs;
+    std::vector<double> m_ys;
+    std::vector<StylusEvent> m_points;
+    std::vector<uint8_t> m_keep;
+    std::vector<double> m_segmentError;  // Error of the accepted segment starting at an index
+    std::vector<uint32_t> m_stack;       // Pending (first, last) pairs
+
+    /**
+     * @brief Mark the points RDP keeps in m_keep[0 .. m_count)
+     */
+    void simplifyWindow();
+
+    /**
+     * @brief Emit kept points in (0, end], then make end the new anchor
+     */
+    size_t emitUpTo(size_t end, StylusEvent* out);
+};
+
+#endif // STROKE_SIMPLIFIER_H
@@ -0,0 +1,35 @@
+#ifndef STYLUS_EVENT_H
+#define STYLUS_EVENT_H
+
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * @brief Pen state flags carried in StylusEvent::flags
+ */
+enum StylusFlags : uint8_t {
+    STYLUS_TIP_DOWN = 0x01,   // Stylus tip is touching the surface
+    STYLUS_IN_RANGE = 0x02,   // Stylus is hovering within sensing range
+    STYLUS_BUTTON = 0x04,     // Barrel button pressed
+    STYLUS_PAGE_CLEAR = 0x08  // Board was erased; starts a new page
+};
+
+/**
+ * @brief One decoded pen sample
+ *
+ * Compact POD (16 bytes, no padding) so that batches can be copied, written
+ * to disk or shared between processes as-is.
+ */
+struct StylusEvent {
+    uint64_t timestampNs;  // Host steady_clock time at which the bytes were received
+    uint16_t x;            // Device X coordinate
+    uint16_t y;            // Device Y coordinate
+    uint16_t pressure;     // Tip pressure (0 when hovering)
+    uint8_t flags;         // StylusFlags bit set
+    uint8_t sequence;      // Frame sequence number assigned by the device
+};
+
+static_assert(sizeof(StylusEvent) == 16, "StylusEvent must stay 16 bytes");
+static_assert(std::is_trivially_copyable<StylusEvent>::value, "StylusEvent must be POD");
+
+#endif // STYLUS_EVENT_H
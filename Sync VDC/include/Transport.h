@@ -0,0 +1,366 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "CaptureFile.h"
+#include "UsbBulkEngine.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/**
+ * @brief Connection type enumeration
+ */
+enum class ConnectionType {
+    BLUETOOTH,  // Bluetooth via serial port (COM port)
+    USB,        // USB connection
+    REPLAY,     // Recorded capture file played back in place of a device
+    PTY,        // Pseudo-terminal, e.g. the simulator's (POSIX)
+    LOOPBACK    // In-memory loopback: whatever is sent is received again
+};
+
+/**
+ * @brief One caller-owned command for sendBatch()
+ */
+struct CommandBuffer {
+    const uint8_t* data;
+    size_t length;
+};
+
+/**
+ * @brief Where a connection string points (see parseEndpoint())
+ */
+struct TransportEndpoint {
+    ConnectionType type = ConnectionType::BLUETOOTH;
+    std::string path;           // Serial port, pty or capture file
+    uint32_t baudRate = 9600;   // Serial ports; default baud rate, adjust based on device specs
+    uint16_t vid = 0;           // USB vendor ID
+    uint16_t pid = 0;           // USB product ID
+    std::string usbSerial;      // USB serial number to match; empty for any
+    double replaySpeed = 1.0;   // REPLAY: 0 = as fast as possible
+};
+
+/**
+ * @brief Split a connection string into its transport and parameters
+ *
+ * The prefix picks the transport: "BT:", "USB:", "REPLAY:", "PTY:" or
+ * "LOOPBACK:"; a bare "COM5" or "/dev/..." is taken as a serial port.
+ *
+ * @param connectionString e.g. "BT:/dev/ttyUSB0@921600"
+ * @param endpoint Filled in on success
+ * @param error Receives the reason on failure
+ * @return true if the string is well-formed
+ */
+bool parseEndpoint(const std::string& connectionString, TransportEndpoint& endpoint, std::string& error);
+
+/**
+ * @brief Outcome of a transport read() or write()
+ */
+enum class TransportStatus {
+    OK,       // Bytes were transferred (possibly fewer than offered)
+    TIMEOUT,  // Nothing could be transferred before the deadline
+    CLOSED,   // The other end went away: hang-up, read error, end of a capture
+    FAILED    // Any other error
+};
+
+struct TransportResult {
+    size_t bytes;
+    TransportStatus status;
+};
+
+using TransportDeadline = std::chrono::steady_clock::time_point;
+
+// Most segments handed to one write() call (well below IOV_MAX everywhere)
+constexpr size_t kMaxWriteSegments = 64;
+
+/*
+ * Byte transports behind WT13106Connection
+ *
+ * Each backend is a plain class with the same members; there is no common
+ * base class and nothing is virtual:
+ *
+ *   static constexpr bool kReconnectable   open() may be called again after a drop
+ *   bool open(const TransportEndpoint&, std::string& error)
+ *   void close()
+ *   bool isOpen() const
+ *   TransportResult read(uint8_t* buffer, size_t capacity, TransportDeadline deadline)
+ *       Returns as soon as at least one byte is available, or with TIMEOUT
+ *       once the deadline passes; a deadline in the past only takes what is
+ *       already there.
+ *   TransportResult write(const CommandBuffer* segments, size_t count, TransportDeadline deadline)
+ *       Writes from up to kMaxWriteSegments non-empty segments in order and
+ *       reports how many bytes were taken; TIMEOUT if none could be before
+ *       the deadline.
+ *   int nativeHandle() const               Descriptor that polls readable when read() has data, or -1
+ *   std::string getLastError() const       Reason for the last CLOSED or FAILED
+ *
+ * WT13106Connection holds the active backend in a Transport variant and
+ * dispatches with std::visit once per receive, send or reader thread, so
+ * the loops inside are instantiated for each backend and call it directly.
+ * A new backend needs a class here, an alternative in Transport, a prefix
+ * in parseEndpoint() and a case in WT13106Connection::openTransport().
+ */
+
+/**
+ * @brief The transport of a connection that is not open
+ */
+class NullTransport {
+public:
+    static constexpr bool kReconnectable = false;
+
+    bool open(const TransportEndpoint&, std::string& error)
+    {
+        error = getLastError();
+        return false;
+    }
+
+    void close() {}
+
+    bool isOpen() const { return false; }
+
+    TransportResult read(uint8_t*, size_t, TransportDeadline) { return {0, TransportStatus::FAILED}; }
+
+    TransportResult write(const CommandBuffer*, size_t, TransportDeadline) { return {0, TransportStatus::FAILED}; }
+
+    int nativeHandle() const { return -1; }
+
+    std::string getLastError() const { return "Not connected to device"; }
+};
+
+#ifndef _WIN32
+/**
+ * @brief Non-blocking descriptor shared by the serial and pty backends (POSIX)
+ *
+ * read() and write() try the descriptor first and only wait in ppoll()
+ * when it cannot proceed, so a receive that finds data ready costs one
+ * system call.
+ */
+class FdTransport {
+public:
+    FdTransport() : m_fd(-1) {}
+    ~FdTransport() { close(); }
+
+    FdTransport(const FdTransport&) = delete;
+    FdTransport& operator=(const FdTransport&) = delete;
+
+    void close();
+
+    bool isOpen() const { return m_fd >= 0; }
+
+    TransportResult read(uint8_t* buffer, size_t capacity, TransportDeadline deadline);
+
+    TransportResult write(const CommandBuffer* segments, size_t count, TransportDeadline deadline);
+
+    int nativeHandle() const { return m_fd; }
+
+    std::string getLastError() const { return m_lastError; }
+
+protected:
+    int m_fd;
+    std::string m_lastError;
+
+    /**
+     * @brief Wait with ppoll() until the descriptor is ready or the deadline passes
+     * @param events POLLIN to wait for data, POLLOUT to wait for room to write
+     * @return 1 if ready, 0 on timeout, -1 on poll error, -2 on hang-up
+     */
+    int wait(short events, TransportDeadline deadline);
+};
+
+/**
+ * @brief Serial port ("BT:/dev/ttyUSB0@921600", or a tty found for "USB:VID:PID")
+ *
+ * Configured 8N1, raw, VMIN = VTIME = 0; rates without a Bxxx constant go
+ * through termios2/BOTHER (Linux) or IOSSIOSPEED (macOS).
+ */
+class SerialTransport : public FdTransport {
+public:
+    static constexpr bool kReconnectable = true;
+
+    bool open(const TransportEndpoint& endpoint, std::string& error);
+};
+
+/**
+ * @brief Pseudo-terminal ("PTY:/dev/pts/3")
+ *
+ * Put into raw mode only: a pty has no line speed, modem lines or driver
+ * ioctls, so none of the serial setup is attempted.
+ */
+class PtyTransport : public FdTransport {
+public:
+    static constexpr bool kReconnectable = true;
+
+    bool open(const TransportEndpoint& endpoint, std::string& error);
+};
+#else
+/**
+ * @brief COM port ("BT:COM5"); timeouts are programmed with SetCommTimeouts
+ */
+class SerialTransport {
+public:
+    static constexpr bool kReconnectable = false;
+
+    SerialTransport();
+    ~SerialTransport();
+
+    SerialTransport(const SerialTransport&) = delete;
+    SerialTransport& operator=(const SerialTransport&) = delete;
+
+    bool open(const TransportEndpoint& endpoint, std::string& error);
+
+    void close();
+
+    bool isOpen() const { return m_handle != INVALID_HANDLE_VALUE; }
+
+    TransportResult read(uint8_t* buffer, size_t capacity, TransportDeadline deadline);
+
+    TransportResult write(const CommandBuffer* segments, size_t count, TransportDeadline deadline);
+
+    int nativeHandle() const { return -1; }
+
+    std::string getLastError() const { return m_lastError; }
+
+private:
+    HANDLE m_handle;
+    DWORD m_appliedTimeoutMs;   // ReadTotalTimeoutConstant programmed via SetCommTimeouts (0 or the read slice)
+    std::string m_lastError;
+};
+#endif
+
+/**
+ * @brief Vendor-specific USB interface through UsbBulkEngine ("USB:1234:5678")
+ *
+ * Without libusb (WT13106_HAVE_LIBUSB) open() fails with installation hints.
+ */
+class UsbTransport {
+public:
+    static constexpr bool kReconnectable = false;
+
+    UsbTransport() = default;
+    ~UsbTransport() { close(); }
+
+    UsbTransport(const UsbTransport&) = delete;
+    UsbTransport& operator=(const UsbTransport&) = delete;
+
+    bool open(const TransportEndpoint& endpoint, std::string& error);
+
+    void close();
+
+    bool isOpen() const;
+
+    TransportResult read(uint8_t* buffer, size_t capacity, TransportDeadline deadline);
+
+    TransportResult write(const CommandBuffer* segments, size_t count, TransportDeadline deadline);
+
+    int nativeHandle() const { return -1; }
+
+    std::string getLastError() const { return m_lastError; }
+
+private:
+#ifdef WT13106_HAVE_LIBUSB
+    std::unique_ptr<UsbBulkEngine> m_usb;
+#endif
+    std::string m_lastError;
+};
+
+/**
+ * @brief Capture file played back on its original timing ("REPLAY:session.wtcap@2")
+ *
+ * A recording has nobody to answer, so writes are accepted and dropped. The
+ * end of the capture reads as CLOSED, like a hang-up.
+ */
+class ReplayTransport {
+public:
+    static constexpr bool kReconnectable = false;
+
+    ReplayTransport() = default;
+    ~ReplayTransport() { close(); }
+
+    ReplayTransport(const ReplayTransport&) = delete;
+    ReplayTransport& operator=(const ReplayTransport&) = delete;
+
+    bool open(const TransportEndpoint& endpoint, std::string& error);
+
+    void close();
+
+    bool isOpen() const { return m_replay != nullptr; }
+
+    TransportResult read(uint8_t* buffer, size_t capacity, TransportDeadline deadline);
+
+    TransportResult write(const CommandBuffer* segments, size_t count, TransportDeadline deadline);
+
+    int nativeHandle() const { return -1; }
+
+    std::string getLastError() const { return m_lastError; }
+
+private:
+    std::unique_ptr<CaptureReplay> m_replay;
+    std::string m_lastError;
+};
+
+/**
+ * @brief In-memory loopback ("LOOPBACK:" or "LOOPBACK:name")
+ *
+ * Every byte written is queued and read back, so encoded frames sent with
+ * sendBatch() come out of receiveEvents() without a device, a pty or the
+ * kernel in between. Bytes already read are dropped from the queue once they
+ * make up more than half of it, so it only grows with the unread backlog. On Linux nativeHandle() is an
+ * eventfd that is readable while the queue holds data, so loopback
+ * connections also work with epoll-based event loops.
+ */
+class LoopbackTransport {
+public:
+    static constexpr bool kReconnectable = false;
+
+    LoopbackTransport();
+    ~LoopbackTransport();
+
+    LoopbackTransport(const LoopbackTransport&) = delete;
+    LoopbackTransport& operator=(const LoopbackTransport&) = delete;
+
+    bool open(const TransportEndpoint& endpoint, std::string& error);
+
+    void close();
+
+    bool isOpen() const;
+
+    TransportResult read(uint8_t* buffer, size_t capacity, TransportDeadline deadline);
+
+    TransportResult write(const CommandBuffer* segments, size_t count, TransportDeadline deadline);
+
+    int nativeHandle() const { return m_eventFd; }
+
+    std::string getLastError() const { return "Loopback closed"; }
+
+private:
+    mutable std::mutex m_mutex;
+    std::condition_variable m_readable;
+    std::vector<uint8_t> m_queue;   // Written bytes; those before m_readOffset were read
+    size_t m_readOffset;
+    bool m_open;
+    int m_eventFd;
+};
+
+/**
+ * @brief The backend of a connection, chosen by its connection string
+ */
+using Transport = std::variant<NullTransport,
+                               SerialTransport,
+#ifndef _WIN32
+                               PtyTransport,
+#endif
+                               UsbTransport,
+                               ReplayTransport,
+                               LoopbackTransport>;
+
+#endif // TRANSPORT_H
@@ -0,0 +1,103 @@
+#ifndef USB_BACKEND_H
+#define USB_BACKEND_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief How an asynchronous IN transfer finished
+ */
+enum class UsbTransferStatus {
+    COMPLETED,
+    TIMED_OUT,
+    CANCELLED,
+    NO_DEVICE,
+    FAILED      // Stall, overflow or any other error
+};
+
+struct UsbTransfer;
+
+/**
+ * @brief Called on the event thread when a submitted transfer finishes
+ * @param transfer The transfer (its buffer holds actualLength bytes)
+ * @param status How it finished
+ * @param actualLength Bytes received
+ */
+typedef void (*UsbTransferCallback)(UsbTransfer* transfer, UsbTransferStatus status, size_t actualLength);
+
+/**
+ * @brief A bulk IN transfer owned by UsbBulkEngine and carried out by a UsbBackend
+ */
+struct UsbTransfer {
+    uint8_t endpoint = 0;
+    uint8_t* buffer = nullptr;
+    size_t length = 0;
+    UsbTransferCallback callback = nullptr;
+    void* userData = nullptr;
+    void* backendData = nullptr;    // Set by UsbBackend::prepareTransfer (the libusb_transfer)
+};
+
+/**
+ * @brief The libusb calls UsbBulkEngine makes, as a table of function pointers
+ *
+ * libusbBackend() forwards each entry to libusb-1.0; tests substitute a
+ * table that drives completions by hand. Contexts and device handles are
+ * opaque to the engine. Entries returning int return 0 on success and a
+ * negative backend error code (see errorName) on failure.
+ */
+struct UsbBackend {
+    int (*init)(void** context);
+    void (*exit)(void* context);
+
+    /**
+     * @brief Open the first device matching VID/PID, nullptr if there is none
+     */
+    void* (*openDevice)(void* context, uint16_t vid, uint16_t pid);
+    void (*closeDevice)(void* device);
+
+    /**
+     * @brief Claim an interface, detaching a kernel driver bound to it where supported
+     */
+    int (*claimInterface)(void* device, int interfaceNumber);
+    void (*releaseInterface)(void* device, int interfaceNumber);
+
+    /**
+     * @brief Find the first bulk IN and bulk OUT endpoint of an interface (0 if missing)
+     */
+    int (*findBulkEndpoints)(void* device, int interfaceNumber, uint8_t* inEndpoint, uint8_t* outEndpoint);
+
+    /**
+     * @brief Allocate backend state for a filled-in transfer before its first submit
+     */
+    int (*prepareTransfer)(void* device, UsbTransfer* transfer);
+    void (*releaseTransfer)(UsbTransfer* transfer);
+    int (*submitTransfer)(UsbTransfer* transfer);
+
+    /**
+     * @brief Request cancellation; the callback still runs with CANCELLED
+     */
+    int (*cancelTransfer)(UsbTransfer* transfer);
+
+    /**
+     * @brief Run completion callbacks for up to timeoutMs; an interruption is not an error
+     */
+    int (*handleEvents)(void* context, int timeoutMs);
+
+    /**
+     * @brief Make a handleEvents call in progress return early (may be a no-op)
+     */
+    void (*interruptEvents)(void* context);
+
+    int (*bulkWrite)(void* device, uint8_t endpoint, const uint8_t* data, size_t length,
+                     size_t* transferred, unsigned int timeoutMs);
+    const char* (*errorName)(int error);
+};
+
+#ifdef WT13106_HAVE_LIBUSB
+/**
+ * @brief The backend that forwards to libusb-1.0
+ */
+const UsbBackend& libusbBackend();
+#endif
+
+#endif // USB_BACKEND_H
@@ -0,0 +1,166 @@
+#ifndef USB_BULK_ENGINE_H
+#define USB_BULK_ENGINE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SpscRingBuffer.h"
+#include "UsbBackend.h"
+
+/**
+ * @brief Tuning options for the USB bulk transfer engine
+ */
+struct UsbBulkOptions {
+    int interfaceNumber = 0;            // USB interface to claim
+    size_t transferSize = 4096;         // Bytes per IN transfer (multiple of max packet size)
+    size_t transfersInFlight = 8;       // IN transfers kept submitted at all times
+    size_t ringCapacity = 256 * 1024;   // Bytes buffered between event thread and reader
+};
+
+/**
+ * @brief Continuous libusb bulk-IN streaming engine
+ *
+ * Keeps the libusb_device_handle open for the lifetime of the connection and
+ * keeps several asynchronous IN transfers queued on the bulk endpoint, so the
+ * host controller always has a buffer ready and data streams without gaps
+ * between transfers. A dedicated thread runs libusb_handle_events; completed
+ * transfers are copied into a lock-free ring buffer and resubmitted
+ * immediately. OUT data is sent with synchronous bulk transfers.
+ *
+ * Every libusb call goes through a UsbBackend function table, so the engine
+ * can be exercised against a fake backend (see tests/test_usb_bulk_engine.cpp)
+ * as well as a usbip/dummy_hcd gadget.
+ */
+class UsbBulkEngine {
+public:
+#ifdef WT13106_HAVE_LIBUSB
+    UsbBulkEngine();
+#endif
+
+    /**
+     * @brief Use another backend than libusb (the table must outlive the engine)
+     */
+    explicit UsbBulkEngine(const UsbBackend& backend);
+    ~UsbBulkEngine();
+
+    UsbBulkEngine(const UsbBulkEngine&) = delete;
+    UsbBulkEngine& operator=(const UsbBulkEngine&) = delete;
+
+    /**
+     * @brief Open the first device matching VID/PID and start streaming
+     * @param vid USB vendor ID
+     * @param pid USB product ID
+     * @param options Interface and transfer tuning
+     * @return true if the device was opened and IN transfers are running
+     */
+    bool open(uint16_t vid, uint16_t pid, const UsbBulkOptions& options = UsbBulkOptions());
+
+    /**
+     * @brief Cancel all transfers, stop the event thread and close the device
+     */
+    void close();
+
+    /**
+     * @brief Check if the device handle is open
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Send data on the bulk OUT endpoint
+     *
+     * Short transfers are continued until every byte is sent or timeoutMs,
+     * which covers the whole call, runs out. A transfer that reports success
+     * without sending anything is an error.
+     *
+     * @param data Bytes to send
+     * @param length Number of bytes
+     * @param timeoutMs Time allowed for all of data, in milliseconds
+     * @param written If not null, set to the bytes sent, also on failure
+     * @return true if every byte was transferred
+     */
+    bool write(const uint8_t* data, size_t length, unsigned int timeoutMs, size_t* written = nullptr);
+
+    /**
+     * @brief Read streamed data until minBytes are available or the deadline passes
+     * @param buffer Destination buffer
+     * @param capacity Size of buffer in bytes
+     * @param minBytes Return as soon as this many bytes have been copied
+     * @param deadline steady_clock point after which the call returns
+     * @return Number of bytes copied into buffer
+     */
+    size_t read(uint8_t* buffer, size_t capacity, size_t minBytes,
+                std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief Number of bytes dropped because the ring buffer was full
+     */
+    uint64_t droppedBytes() const;
+
+    /**
+     * @brief Check if the device disappeared or the IN stream failed
+     */
+    bool hasFailed() const;
+
+    /**
+     * @brief Get last error message
+     */
+    std::string getLastError() const;
+
+private:
+    const UsbBackend& m_backend;
+    void* m_context;
+    void* m_handle;
+    UsbBulkOptions m_options;
+    uint8_t m_inEndpoint;
+    uint8_t m_outEndpoint;
+    bool m_interfaceClaimed;
+
+    std::vector<std::unique_ptr<UsbTransfer>> m_transfers;
+    std::vector<std::unique_ptr<uint8_t[]>> m_transferBuffers;
+    std::unique_ptr<SpscRingBuffer<uint8_t>> m_ring;
+
+    std::thread m_eventThread;
+    std::atomic<bool> m_stopRequested;
+    std::atomic<bool> m_failed;
+    std::atomic<int> m_activeTransfers;
+    std::atomic<bool> m_readerWaiting;
+    std::atomic<uint64_t> m_droppedBytes;
+    std::mutex m_waitMutex;
+    std::condition_variable m_dataAvailable;
+
+    mutable std::mutex m_errorMutex;  // Error text is also written from the event thread
+    std::string m_lastError;
+
+    /**
+     * @brief Locate the bulk IN and OUT endpoints of the claimed interface
+     */
+    bool findBulkEndpoints();
+
+    /**
+     * @brief Allocate and submit the IN transfer pool
+     */
+    bool submitTransfers();
+
+    /**
+     * @brief Event thread body: runs the backend's event handling until all transfers retire
+     */
+    void eventLoop();
+
+    /**
+     * @brief Completion handler for IN transfers (runs on the event thread)
+     */
+    static void onTransferComplete(UsbTransfer* transfer, UsbTransferStatus status, size_t actualLength);
+
+    std::string backendError(const char* what, int result) const;
+
+    void setError(const std::string& message);
+};
+
+#endif // USB_BULK_ENGINE_H
@@ -4,6 +4,24 @@
 #include <vector>
 #include <cstdint>
 #include <string>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "BroadcastRing.h"
+#include "CaptureFile.h"
+#include "ConnectionMetrics.h"
+#include "FrameDecoder.h"
+#include "RequestTracker.h"
+#include "SharedEventRing.h"
+#include "SpscRingBuffer.h"
+#include "StylusEvent.h"
+#include "Transport.h"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -14,13 +32,70 @@
 #endif
 
 /**
- * @brief Connection type enumeration
+ * @brief Options for the background streaming reader
+ */
+struct StreamingOptions {
+    size_t ringCapacity = 64 * 1024;  // Bytes buffered between reader thread and consumer
+    size_t readChunkSize = 4096;      // Maximum bytes taken from the port per read() call
+};
+
+/**
+ * @brief Latency tuning for serial connections (see setLowLatencyOptions())
+ */
+struct LowLatencyOptions {
+    bool asyncLowLatency = false;  // Ask the tty driver for ASYNC_LOW_LATENCY (Linux, TIOCSSERIAL)
+    int realtimePriority = 0;      // 1..99: run the streaming reader thread with SCHED_FIFO
+    int cpu = -1;                  // >= 0: pin the streaming reader thread to this CPU
+    uint32_t busyPollUs = 0;       // > 0: spin on non-blocking reads this long before blocking
+};
+
+/**
+ * @brief Which LowLatencyOptions actually took effect
+ */
+struct LowLatencyStatus {
+    bool asyncLowLatency = false;     // The driver accepted and kept ASYNC_LOW_LATENCY
+    bool realtimeScheduling = false;  // The reader thread runs with SCHED_FIFO
+    bool cpuPinned = false;           // The reader thread is pinned to LowLatencyOptions::cpu
+};
+
+/**
+ * @brief Automatic reconnection of serial links (see setReconnectOptions())
+ */
+struct ReconnectOptions {
+    bool enabled = false;
+    std::string watchDirectory;  // Where the port's node reappears; empty = the directory of the port path
+    uint32_t timeoutMs = 0;      // Give up after this long without the port (0 = keep waiting)
+};
+
+/**
+ * @brief Called when a serial link goes down (false) or comes back (true)
+ */
+using LinkStateCallback = std::function<void(bool up)>;
+
+/**
+ * @brief When commands passed to sendCommand() are written to the device
+ */
+enum class FlushPolicy {
+    IMMEDIATE,       // Write every command at once (default)
+    SIZE_THRESHOLD,  // Queue commands until sizeThreshold bytes are pending
+    TIME_WINDOW      // Queue commands until the oldest has waited windowUs (see setSendOptions())
+};
+
+/**
+ * @brief Options for the command send queue
  */
-enum class ConnectionType {
-    BLUETOOTH,  // Bluetooth via serial port (COM port)
-    USB         // USB connection
+struct SendOptions {
+    FlushPolicy policy = FlushPolicy::IMMEDIATE;
+    size_t sizeThreshold = 4096;    // SIZE_THRESHOLD: pending bytes that trigger a write
+    uint32_t windowUs = 2000;       // TIME_WINDOW: maximum age of a queued command
+    uint32_t writeTimeoutMs = 1000; // How long a write may wait for the port to drain
 };
 
+/**
+ * @brief Callback invoked on the reader thread for every chunk read in streaming mode
+ */
+using StreamDataCallback = std::function<void(const uint8_t* data, size_t length)>;
+
 /**
  * @brief Class for managing connection and communication with Boogy Board device
  * 
@@ -29,7 +104,19 @@ enum class ConnectionType {
  * 
  * Connection string formats:
  * - Bluetooth: "BT:COM5" or "BT:/dev/ttyUSB0" (Windows/Linux)
- * - USB: "USB:1234:5678" (VID:PID format)
+ * - Bluetooth with baud rate: "BT:/dev/ttyUSB0@921600" (default 9600; any
+ *   rate the driver accepts, non-standard rates use termios2/BOTHER on Linux)
+ * - USB: "USB:1234:5678" (VID:PID format) or "USB:1234:5678:SERIAL" to pick one
+ *   of several boards. On Linux a board that enumerates as a serial port
+ *   (ttyACM/ttyUSB) is found through DeviceDiscovery and opened as one;
+ *   otherwise libusb is used
+ * - Replay: "REPLAY:session.wtcap" (real time), "REPLAY:session.wtcap@4" (4x)
+ *   or "REPLAY:session.wtcap@max" (as fast as possible); see CaptureFile.h
+ * - Pseudo-terminal: "PTY:/dev/pts/3" (raw mode, no serial line setup; POSIX)
+ * - Loopback: "LOOPBACK:" (everything sent is received again; no device)
+ * 
+ * The prefix selects one of the backends in Transport.h; the connection
+ * adds queueing, decoding, streaming, metrics and reconnects on top.
  */
 class WT13106Connection {
 public:
@@ -58,10 +145,73 @@ public:
     
     /**
      * @brief Check if device is currently connected
+     * 
+     * false from the moment a serial link drops (hang-up or read error)
+     * until it is reopened, even before disconnect() is called.
+     * 
      * @return true if connected, false otherwise
      */
     bool isConnected() const;
     
+    /**
+     * @brief Reopen the serial port by itself when the link drops
+     * 
+     * Applies to serial ports and ptys ("BT:", "PTY:", and "USB:" boards
+     * opened as a serial port). A hang-up or read error on the port marks
+     * the link down: the port is
+     * closed, isConnected() turns false and the callback runs with false.
+     * Without auto-reconnect that is all; disconnect() or connect() start
+     * over. With it, the connection watches the port's directory with
+     * inotify (Linux; elsewhere it retries every 100 ms) and reopens and
+     * reconfigures the port as soon as the node reappears or its permissions
+     * change, then runs the callback with true.
+     * 
+     * In streaming mode the reader thread reconnects in the background and
+     * the ring keeps whatever was received before the drop; pop() just
+     * waits. The reader uses the options in effect at startStreaming(). In
+     * direct mode the receive call that notices the drop waits for the port
+     * until its own deadline, and later calls pick up from there. Commands
+     * sent while the link is down fail. A frame cut off by the drop is
+     * discarded when the decoder resynchronizes.
+     * 
+     * The callback runs on the thread that noticed the change (the reader
+     * thread in streaming mode). getNativeHandle() changes across a
+     * reconnect, so external event loops should re-register from there.
+     */
+    void setReconnectOptions(const ReconnectOptions& options, LinkStateCallback callback = nullptr);
+    
+    ReconnectOptions getReconnectOptions() const;
+    
+    /**
+     * @brief Number of times the serial port was reopened after a drop
+     */
+    uint64_t reconnectCount() const;
+    
+    /**
+     * @brief Descriptor that becomes readable when data arrives
+     * 
+     * Lets an external event loop (e.g. ConnectionManager) multiplex many
+     * connections; read from it with receiveInto() using a zero timeout.
+     * 
+     * @return File descriptor, or -1 if not connected or the transport has
+     *         none (USB, replay, Windows)
+     */
+    int getNativeHandle() const;
+    
+    /**
+     * @brief Account for bytes read from getNativeHandle() by someone else
+     * 
+     * For event loops that read the descriptor themselves (ConnectionManager
+     * with io_uring); updates the metrics and the capture file as a receive
+     * call would.
+     */
+    void recordExternalRead(const uint8_t* data, size_t length);
+    
+    /**
+     * @brief Account for bytes written to getNativeHandle() by someone else
+     */
+    void recordExternalWrite(size_t length);
+    
     /**
      * @brief Send a command to the device
      * @param command Command data to send
@@ -69,13 +219,181 @@ public:
      */
     bool sendCommand(const std::vector<uint8_t>& command);
     
+    /**
+     * @brief Send a command to the device from a caller-owned buffer
+     * @param data Command bytes to send
+     * @param length Number of bytes in data
+     * @return true if command sent successfully, false otherwise
+     */
+    bool sendCommand(const uint8_t* data, size_t length);
+    
+    /**
+     * @brief Write several commands with as few system calls as possible
+     * 
+     * Queued commands and the given buffers are gathered into writev() calls
+     * (on POSIX serial ports) without copying. Short writes resume from the
+     * exact byte where the port stopped, and a full port is waited on with
+     * poll(POLLOUT) rather than treated as an error. If the port does not
+     * drain within SendOptions::writeTimeoutMs, the unsent bytes stay queued
+     * and go out first on the next send or flush(). Ignores the flush policy.
+     * 
+     * @param commands Array of commands, written in order
+     * @param count Number of entries in commands
+     * @return true if every byte was written
+     */
+    bool sendBatch(const CommandBuffer* commands, size_t count);
+    
+    /**
+     * @brief Choose when sendCommand() writes (see FlushPolicy)
+     * 
+     * With SIZE_THRESHOLD or TIME_WINDOW, commands are copied into a queue
+     * that is written when the policy says so, on flush(), or when a receive
+     * call starts waiting (a caller waiting for data usually waits for the
+     * reply to what it queued).
+     * 
+     * While streaming, the reader thread writes a TIME_WINDOW queue once
+     * its window has passed (on Linux it wakes up for that; elsewhere within
+     * its 10 ms read slice). Without a streaming reader TIME_WINDOW is only
+     * checked on sendCommand(), so the last command of a burst stays queued
+     * until the caller sends again, receives, or calls flush(). If such a
+     * write by the reader fails, the next sendCommand(), sendBatch() or
+     * flush() leaves its message in getLastError().
+     * 
+     * The frames_out metric counts commands once all their bytes are written.
+     */
+    void setSendOptions(const SendOptions& options);
+    
+    SendOptions getSendOptions() const;
+    
+    /**
+     * @brief Trade CPU time for lower and steadier receive latency
+     * 
+     * asyncLowLatency asks the tty driver to push received bytes to the line
+     * discipline immediately instead of batching them (ftdi_sio, for example,
+     * drops its latency timer from 16 ms to 1 ms). It is applied on connect()
+     * and when called while connected, and the previous setting is restored
+     * on disconnect. Drivers without TIOCSSERIAL support (ptys, many
+     * Bluetooth RFCOMM ttys) are left alone.
+     * 
+     * realtimePriority and cpu apply to the reader thread started by the
+     * next startStreaming(); the thread sets them on itself before its first
+     * read. SCHED_FIFO needs CAP_SYS_NICE or an RLIMIT_RTPRIO allowance
+     * (Windows uses THREAD_PRIORITY_TIME_CRITICAL instead).
+     * 
+     * busyPollUs makes direct receives, the Linux streaming reader of
+     * descriptor-backed transports and pop() spin for up to that long before sleeping in
+     * poll/epoll or on the condition variable, restarting the window
+     * whenever data arrives. Spinning reads count as emptyReads in the
+     * metrics. Only worthwhile with a core to spare: pin the reader with cpu.
+     * 
+     * Settings that cannot be applied are not errors; see
+     * getLowLatencyStatus(), whose reader thread fields are filled in once
+     * the thread is running.
+     */
+    void setLowLatencyOptions(const LowLatencyOptions& options);
+    
+    LowLatencyOptions getLowLatencyOptions() const;
+    
+    LowLatencyStatus getLowLatencyStatus() const;
+    
+    /**
+     * @brief Write all queued commands now
+     * @return true if the queue is empty afterwards
+     */
+    bool flush();
+    
+    /**
+     * @brief Number of command bytes queued but not yet written
+     */
+    size_t pendingSendBytes() const;
+    
     /**
      * @brief Receive response from the device
-     * @param timeoutMs Timeout in milliseconds (0 = no timeout)
+     * 
+     * Convenience wrapper around receiveInto() that allocates a new vector
+     * per call. Prefer receiveInto() on hot paths.
+     * 
+     * @param timeoutMs Timeout in milliseconds (0 = return only already-buffered data)
      * @return Response data from device, empty vector on error/timeout
      */
     std::vector<uint8_t> receiveResponse(uint32_t timeoutMs = 1000);
     
+    /**
+     * @brief Receive data from the device into a caller-owned buffer
+     * 
+     * Returns as soon as at least one byte is available. Performs no heap
+     * allocation. On error the return value is 0 and getLastError() is
+     * non-empty; on timeout it is 0 and getLastError() is empty.
+     * 
+     * @param buffer Destination buffer
+     * @param capacity Size of buffer in bytes
+     * @param timeoutMs Timeout in milliseconds (0 = return only already-buffered data)
+     * @return Number of bytes written to buffer
+     */
+    size_t receiveInto(uint8_t* buffer, size_t capacity, uint32_t timeoutMs = 1000);
+    
+    /**
+     * @brief Read exactly length bytes, retrying partial reads until the deadline
+     * @param buffer Destination buffer (at least length bytes)
+     * @param length Number of bytes wanted
+     * @param timeoutMs Overall timeout for the whole call in milliseconds
+     * @return Number of bytes read; less than length on timeout or error
+     */
+    size_t receiveExact(uint8_t* buffer, size_t length, uint32_t timeoutMs = 1000);
+    
+    /**
+     * @brief Read exactly length bytes or until an absolute monotonic deadline
+     * 
+     * Use this overload for sub-millisecond deadlines.
+     * 
+     * @param buffer Destination buffer (at least length bytes)
+     * @param length Number of bytes wanted
+     * @param deadline Point in time (steady_clock) after which the call returns
+     * @return Number of bytes read; less than length on timeout or error
+     */
+    size_t receiveExact(uint8_t* buffer, size_t length,
+                        std::chrono::steady_clock::time_point deadline);
+    
+    /**
+     * @brief Receive data onto the end of a reusable vector
+     * 
+     * Reads up to capacity() - size() bytes (1024 if the vector is full)
+     * directly into the vector, after its current contents, and shrinks it
+     * back to the bytes actually read. clear() the vector between calls and
+     * reusing it does not allocate.
+     * 
+     * @param buffer Vector to append to
+     * @param timeoutMs Timeout in milliseconds (0 = return only already-buffered data)
+     * @return Number of bytes read and appended
+     */
+    size_t receiveInto(std::vector<uint8_t>& buffer, uint32_t timeoutMs = 1000);
+    
+    /**
+     * @brief Receive decoded pen samples
+     * 
+     * Reads from the port (or from the ring buffer in streaming mode) and runs
+     * the bytes through the connection's FrameDecoder, so frames split across
+     * reads or packed into one read are handled correctly. Bytes that did not
+     * fit into events are kept for the next call. Non-pen frames go to the
+     * handler set with setFrameHandler().
+     * 
+     * @param events Output array
+     * @param capacity Size of the output array
+     * @param timeoutMs Maximum time to wait for at least one event
+     * @return Number of events written (0 on timeout or error)
+     */
+    size_t receiveEvents(StylusEvent* events, size_t capacity, uint32_t timeoutMs = 1000);
+    
+    /**
+     * @brief Set the callback for reply/status frames seen by receiveEvents()
+     */
+    void setFrameHandler(FrameDecoder::FrameHandler handler);
+    
+    /**
+     * @brief Decoder counters (frames, checksum errors, skipped bytes)
+     */
+    const FrameDecoderStats& getFrameStats() const;
+    
     /**
      * @brief Send command and wait for response
      * @param command Command data to send
@@ -85,56 +403,432 @@ public:
     std::vector<uint8_t> sendCommandAndReceive(const std::vector<uint8_t>& command, 
                                                 uint32_t timeoutMs = 1000);
     
+    /**
+     * @brief Send a request frame without waiting for its reply
+     * 
+     * The connection picks a free sequence number, encodes the frame and
+     * sends it through sendCommand() (so the flush policy applies). Any
+     * number of requests (up to 256) may be outstanding; replies are matched
+     * to them as the stream is decoded by receiveEvents(), so the application
+     * keeps receiving pen events while requests are in flight and only
+     * unmatched reply/status frames reach the setFrameHandler() callback.
+     * Requests whose timeout passes are completed with TIMEOUT during
+     * receiveEvents(), which wakes up for the earliest request deadline.
+     * 
+     * Requires someone to call receiveEvents(), or streaming through
+     * startBroadcast()/startSharedExport(), whose reader thread matches
+     * replies and wakes up to time requests out. Not available while any
+     * other streaming callback is installed.
+     * 
+     * @param type Frame type of the request
+     * @param payload Request payload (may be nullptr if length is 0)
+     * @param length Payload length
+     * @param options Timeout and reply matching
+     * @return Future that becomes ready with the reply or a failure status
+     */
+    std::future<Response> submit(uint8_t type, const uint8_t* payload, uint8_t length,
+                                 const SubmitOptions& options = SubmitOptions());
+    
+    /**
+     * @brief Callback variant of submit()
+     * 
+     * The callback runs exactly once, on the thread that completes the
+     * request (the one in receiveEvents(), or the streaming reader thread
+     * with startBroadcast()/startSharedExport()). It must not call
+     * receiveEvents() itself.
+     * 
+     * @return false if the request failed immediately (the callback has
+     *         already been called with SEND_FAILED)
+     */
+    bool submit(uint8_t type, const uint8_t* payload, uint8_t length, ResponseCallback callback,
+                const SubmitOptions& options = SubmitOptions());
+    
+    /**
+     * @brief Number of submitted requests still waiting for a reply
+     */
+    size_t outstandingRequests() const;
+    
     /**
      * @brief Get last error message
      * @return Error message string
      */
     std::string getLastError() const;
+    
+    /**
+     * @brief Record every raw read into a capture file
+     * 
+     * Each chunk read from the device (by the receive calls or the streaming
+     * reader) is appended with its steady_clock timestamp. The writer is not
+     * owned and must stay open until it is detached with nullptr.
+     * 
+     * @param writer Open CaptureWriter, or nullptr to stop recording
+     */
+    void setCaptureWriter(CaptureWriter* writer);
+    
+    /**
+     * @brief Turn per-connection counters and histograms on or off
+     * 
+     * Disabled by default; while disabled each hook costs one relaxed load.
+     */
+    void setMetricsEnabled(bool enabled);
+    
+    bool metricsEnabled() const;
+    
+    /**
+     * @brief Copy of the current counters and histograms (safe from any thread)
+     * 
+     * Use ConnectionMetricsSnapshot::toText() or toJson() to export them.
+     */
+    ConnectionMetricsSnapshot getMetrics() const;
+    
+    /**
+     * @brief Zero all counters and histograms
+     */
+    void resetMetrics();
+    
+    /**
+     * @brief Start the background reader thread (opt-in streaming mode)
+     * 
+     * The connection owns a reader thread that blocks in epoll on the port
+     * (Linux, transports with a descriptor) or in the transport's own read
+     * (everything else, e.g. ReadFile on Windows, USB, replay) and forwards
+     * data as soon as it arrives. Without a callback, data is pushed into a fixed-size lock-free
+     * ring buffer drained with tryPop()/pop(). With a callback, every chunk is
+     * handed to the callback on the reader thread and the ring is bypassed.
+     * 
+     * While streaming, receiveResponse() is unavailable.
+     * 
+     * @param options Ring capacity and read chunk size
+     * @param callback Optional per-chunk callback (called on the reader thread)
+     * @return true if the reader thread was started
+     */
+    bool startStreaming(const StreamingOptions& options = StreamingOptions(),
+                        StreamDataCallback callback = nullptr);
+    
+    /**
+     * @brief Start streaming with decoded pen events published to a broadcast ring
+     * 
+     * The reader thread decodes every chunk straight into slots claimed
+     * from ring, so each event is written once and read in place by all of
+     * the ring's subscribers (canvas, recorder, relay, ...) instead of being
+     * copied into a queue per consumer. submit() keeps working: the reader
+     * thread matches replies to requests, wakes up to time them out and
+     * hands unmatched non-pen frames to the frame handler, so request
+     * callbacks and the frame handler run on the reader thread.
+     * 
+     * While a BLOCK subscriber keeps the ring full the reader stops reading
+     * and the port's own buffer fills up. The ring must outlive streaming
+     * and is not closed by stopStreaming(); close it to release waiting
+     * subscribers.
+     * 
+     * @param ring Ring to publish to (this connection is its only producer)
+     * @param options Read chunk size (ringCapacity is not used)
+     * @return true if the reader thread was started
+     */
+    bool startBroadcast(BroadcastRing<StylusEvent>& ring,
+                        const StreamingOptions& options = StreamingOptions());
+    
+#ifdef __linux__
+    /**
+     * @brief Start streaming with decoded pen events exported to other processes
+     * 
+     * Like startBroadcast(), but the reader thread decodes into a shared
+     * memory ring created with SharedEventWriter::create(), which local
+     * processes read with SharedEventReader without system calls. The
+     * writer never waits: readers that fall a ring behind lose events. The
+     * writer must outlive streaming; close it to tell readers the stream
+     * has ended.
+     * 
+     * @param writer Open writer (this connection is its only producer)
+     * @param options Read chunk size (ringCapacity is not used)
+     * @return true if the reader thread was started
+     */
+    bool startSharedExport(SharedEventWriter& writer,
+                           const StreamingOptions& options = StreamingOptions());
+#endif
+    
+    /**
+     * @brief Stop the background reader thread
+     * 
+     * Data still buffered in the ring remains available to tryPop().
+     * 
+     * @return true if streaming was active and has been stopped
+     */
+    bool stopStreaming();
+    
+    /**
+     * @brief Check if the background reader thread is running
+     */
+    bool isStreaming() const;
+    
+    /**
+     * @brief Take buffered stream data without blocking
+     * @param buffer Destination buffer
+     * @param capacity Size of buffer in bytes
+     * @return Number of bytes copied (0 if nothing is buffered)
+     */
+    size_t tryPop(uint8_t* buffer, size_t capacity);
+    
+    /**
+     * @brief Take buffered stream data, waiting until some arrives
+     * @param buffer Destination buffer
+     * @param capacity Size of buffer in bytes
+     * @param timeoutMs Maximum time to wait in milliseconds
+     * @return Number of bytes copied (0 on timeout or when streaming stops)
+     */
+    size_t pop(uint8_t* buffer, size_t capacity, uint32_t timeoutMs = 1000);
+    
+    /**
+     * @brief Number of bytes dropped because the ring buffer was full
+     */
+    uint64_t droppedBytes() const;
 
 private:
     std::string m_connectionString;
-    ConnectionType m_connectionType;
-    bool m_isConnected;
-    std::string m_lastError;
+    TransportEndpoint m_endpoint;     // Parsed from m_connectionString by connect()
+    Transport m_transport;            // NullTransport while not connected
+    std::atomic<bool> m_isConnected;  // Between connect() and disconnect()
+    std::atomic<bool> m_linkUp;       // false while a dropped serial link is down
+    std::string m_lastError;          // Application thread only; the reader reports through m_flushFailed
     
-#ifdef _WIN32
-    HANDLE m_serialHandle;      // For Bluetooth/Serial connections (Windows)
-    HANDLE m_usbHandle;         // For USB connections (Windows) - placeholder
-#else
-    int m_serialFd;            // For Bluetooth/Serial connections (Linux/macOS)
-    int m_usbFd;               // For USB connections (Linux/macOS) - placeholder
+    // Command send queue; m_sendMutex guards the queue and writes to the port
+    SendOptions m_sendOptions;
+    std::vector<uint8_t> m_sendQueue;
+    std::vector<size_t> m_sendQueueFrames;  // Unwritten length of each queued command, in order
+    uint64_t m_sendQueuedSinceNs;     // When the oldest queued byte was queued
+    std::atomic<bool> m_sendPending;  // Queue is non-empty; lets receives skip the lock
+    std::atomic<uint64_t> m_sendFlushDueNs;  // TIME_WINDOW: when the reader flushes the queue (max if never)
+    mutable std::mutex m_sendMutex;
+    std::string m_flushError;         // Why the reader's last queue write failed; guarded by m_sendMutex
+    std::atomic<bool> m_flushFailed;  // m_flushError is set and not yet reported
+    
+    // Latency tuning; the reader thread gets its own copy of the options
+    LowLatencyOptions m_lowLatency;
+    std::atomic<bool> m_asyncLowLatency;  // ASYNC_LOW_LATENCY is set on the port (reapplied on reconnect)
+    bool m_restoreAsyncLowLatency;    // ... and was off before we set it
+    std::atomic<uint32_t> m_busyPollUs;
+    std::atomic<bool> m_readerRealtime;
+    std::atomic<bool> m_readerPinned;
+    
+    // Auto-reconnect; the streaming reader works on its own copy
+    ReconnectOptions m_reconnect;
+    LinkStateCallback m_linkCallback;
+    std::atomic<uint64_t> m_reconnects;
+    uint64_t m_linkLostNs;            // When the link last dropped
+#ifndef _WIN32
+    int m_hotplugFd;                  // inotify watch on the port's directory, kept across drops
 #endif
     
-    // USB-specific members
-    uint16_t m_vid;
-    uint16_t m_pid;
+    // Recording of raw reads (not owned)
+    std::atomic<CaptureWriter*> m_captureWriter;
     
-    // Serial/Bluetooth-specific members
-    std::string m_portName;
-    uint32_t m_baudRate;
+    // Frame decoding state for receiveEvents()
+    FrameDecoder m_decoder;
+    FrameDecoder::FrameHandler m_frameHandler;  // Application handler for unmatched frames
+    RequestTracker m_requests;
+    uint8_t m_rxBuffer[4096];
+    size_t m_rxOffset;
+    size_t m_rxLength;
+    uint64_t m_rxTimestampNs;
+    uint64_t m_lastEventNs;    // Timestamp of the previous pen event, for the gap histogram
+    
+    ConnectionMetrics m_metrics;
+    
+    // Streaming mode members
+    struct ChunkStamp {
+        uint64_t endBytes;  // Ring bytes pushed up to and including this chunk
+        uint64_t readyNs;
+    };
+    std::unique_ptr<SpscRingBuffer<uint8_t>> m_ring;
+    std::unique_ptr<SpscRingBuffer<ChunkStamp>> m_chunkStamps;  // For readLatency; skipped when full
+    uint64_t m_bytesPushed;    // Reader thread: bytes pushed into m_ring
+    uint64_t m_bytesPopped;    // Consumer: bytes popped from m_ring
+    StreamDataCallback m_streamCallback;
+    StreamingOptions m_streamOptions;
+    std::thread m_readerThread;
+    std::atomic<bool> m_streaming;
+    std::atomic<bool> m_stopRequested;
+    std::atomic<bool> m_readerDecodes;  // startBroadcast()/startSharedExport(): the reader serves requests
+    std::atomic<bool> m_consumerWaiting;
+    std::atomic<uint64_t> m_droppedBytes;
+    std::mutex m_waitMutex;
+    std::condition_variable m_dataAvailable;
+#ifndef _WIN32
+    int m_wakeFd;              // eventfd used to interrupt the reader's epoll_wait
+#endif
     
     /**
-     * @brief Parse connection string and determine connection type
-     * @return true if parsing successful
+     * @brief Construct and open the backend for m_endpoint in m_transport
+     * @return true if it opened; m_transport is a NullTransport otherwise
      */
-    bool parseConnectionString();
+    bool openTransport();
     
     /**
-     * @brief Initialize Bluetooth/Serial connection
-     * @return true if initialization successful
+     * @brief Append a raw read to the capture writer, if one is attached
+     */
+    void captureChunk(const uint8_t* data, size_t length);
+    
+    /**
+     * @brief Set or clear ASYNC_LOW_LATENCY on the open serial port as configured
      */
-    bool initializeBluetooth();
+    void applyAsyncLowLatency();
+    
+    /**
+     * @brief Apply SCHED_FIFO and CPU affinity to the calling (reader) thread
+     */
+    void applyReaderThreadTuning(const LowLatencyOptions& options);
+    
+    /**
+     * @brief Close the port after a hang-up and report the link down
+     */
+    void onLinkLost(const LinkStateCallback& callback);
+    
+#ifndef _WIN32
     
     /**
-     * @brief Initialize USB connection
+     * @brief Discard pending notifications on m_hotplugFd
+     */
+    void drainHotplugEvents();
+    
+    /**
+     * @brief Wait for the port's node to reappear and reopen it (reconnectable transports)
+     * @param deadline Give up at this point
+     * @param wakeFd Descriptor that aborts the wait when readable (-1 for none)
+     * @return true once the port is open again
+     */
+    bool reopenTransport(const ReconnectOptions& options, const LinkStateCallback& callback,
+                         std::chrono::steady_clock::time_point deadline, int wakeFd);
+#endif
+    
+    /**
+     * @brief Open a "USB:" endpoint as a serial port if it has one, else through libusb
      * @return true if initialization successful
      */
     bool initializeUSB();
     
+#ifdef __linux__
+    /**
+     * @brief Point m_endpoint.path at the tty of the board matching its VID/PID/serial
+     * @param error Set on failure (the reader thread passes its own string)
+     * @return false if no such board has a serial port
+     */
+    bool resolveUsbSerialPort(std::string& error);
+#endif
+    
     /**
      * @brief Clean up connection resources
      */
     void cleanupConnection();
+    
+    /**
+     * @brief Read into buffer until minBytes have arrived or the deadline passes
+     * @return Number of bytes read (at most capacity)
+     */
+    size_t receiveUntil(uint8_t* buffer, size_t capacity, size_t minBytes,
+                        std::chrono::steady_clock::time_point deadline);
+    
+    /**
+     * @brief receiveUntil() body, instantiated for each backend
+     */
+    template <class T>
+    size_t receiveFrom(T& transport, uint8_t* buffer, size_t capacity, size_t minBytes,
+                       std::chrono::steady_clock::time_point deadline, ConnectionMetrics* metrics,
+                       uint64_t& readyNs);
+    
+    /**
+     * @brief Write the send queue followed by buffers; caller holds m_sendMutex
+     * 
+     * On timeout the unwritten tail is left in the queue.
+     * @param error Set on failure; m_lastError unless called by the reader thread
+     */
+    bool writeGathered(const CommandBuffer* buffers, size_t count, std::string& error);
+    
+    /**
+     * @brief writeGathered() body, instantiated for each backend
+     */
+    template <class T>
+    bool writeTo(T& transport, const CommandBuffer* buffers, size_t count, std::string& error);
+    
+    /**
+     * @brief Move a failed reader flush into m_lastError; caller holds m_sendMutex
+     * @return true if there was one
+     */
+    bool takeFlushError();
+    
+    /**
+     * @brief Take ring buffer data, waiting until some arrives or the deadline passes
+     */
+    size_t popUntil(uint8_t* buffer, size_t capacity, std::chrono::steady_clock::time_point deadline);
+    
+    /**
+     * @brief Reader thread body for streaming mode
+     */
+    void readerLoop(const ReconnectOptions& reconnect, const LinkStateCallback& linkCallback);
+    
+    /**
+     * @brief Reader loop that waits in the backend's read() in short slices
+     */
+    template <class T>
+    void streamFrom(T& transport, uint8_t* chunk, size_t chunkSize,
+                    const ReconnectOptions& reconnect, const LinkStateCallback& linkCallback);
+    
+#ifdef __linux__
+    /**
+     * @brief Reader loop that waits in epoll on the backend's descriptor and the wake eventfd
+     */
+    template <class T>
+    void streamFromDescriptor(T& transport, uint8_t* chunk, size_t chunkSize,
+                              const ReconnectOptions& reconnect, const LinkStateCallback& linkCallback);
+#endif
+    
+    /**
+     * @brief Hand a chunk read by the reader thread to the callback or ring
+     * @param readyNs When the data was ready: the epoll wake-up, else when the read returned
+     */
+    void deliverChunk(const uint8_t* data, size_t length, uint64_t readyNs);
+    
+    /**
+     * @brief Record read latency for ring chunks that tryPop() has now handed out completely
+     */
+    void recordChunksHandedOut(size_t popped);
+    
+    /**
+     * @brief Decode a chunk read by the reader thread into a BroadcastRing or SharedEventWriter
+     */
+    template <class Sink>
+    void publishEvents(Sink& sink, const uint8_t* data, size_t length);
+    
+    /**
+     * @brief Update frame counters and the inter-frame gap histogram after a decode
+     */
+    void recordDecodeMetrics(const FrameDecoderStats& before, const StylusEvent* events, size_t produced);
+    
+    /**
+     * @brief Complete requests whose deadline has passed (reader thread, when it decodes)
+     */
+    void expireRequests();
+    
+    /**
+     * @brief Write a TIME_WINDOW send queue whose window has passed (reader thread)
+     */
+    void flushDueCommands();
+    
+    /**
+     * @brief Set when the reader flushes the queue; caller holds m_sendMutex
+     */
+    void updateFlushDue();
+    
+    /**
+     * @brief Make the reader thread recompute its wait (no-op without a wake-up descriptor)
+     */
+    void wakeReader();
+    
+#ifdef __linux__
+    /**
+     * @brief epoll_wait() timeout for the reader: until the next request deadline or send flush, or -1
+     */
+    int readerWaitMs() const;
+#endif
 };
 
 #endif // WT13106_CONNECTION_H
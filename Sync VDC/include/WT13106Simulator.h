@@ -0,0 +1,142 @@
+#ifndef WT13106_SIMULATOR_H
+#define WT13106_SIMULATOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+/**
+ * @brief Shape of the synthetic pen trace
+ */
+enum class SimulatorPattern {
+    CIRCLE,    // Pen down, tracing a circle; pressure varies slowly
+    SCRIBBLE,  // Random walk with occasional pen lifts
+    COUNTER    // x/y carry the sample index (x = low 16 bits) for latency measurement
+};
+
+/**
+ * @brief Options for WT13106Simulator
+ */
+struct SimulatorOptions {
+    double sampleRateHz = 200.0;   // Pen samples per second (0 = as fast as the reader drains)
+    size_t framesPerWrite = 1;     // Pen frames coalesced into one write (radio/USB packet size)
+    SimulatorPattern pattern = SimulatorPattern::CIRCLE;
+    size_t maxBacklogBytes = 64 * 1024;  // Samples are dropped while this much output is unread
+    bool startPaused = false;      // No pen output until setPaused(false)
+};
+
+/**
+ * @brief Pseudo-terminal that behaves like a WT13106 board
+ *
+ * start() creates a pty with openpty() and a thread that writes pen frames to
+ * the master side at the configured rate. Connect to it like a real board
+ * with WT13106Connection(sim.connectionString()).
+ *
+ * Commands are answered: every non-pen frame received from the host is
+ * acknowledged with a frame of type (type | 0x80), the same sequence number
+ * and the same payload.
+ *
+ * For latency measurements use SimulatorPattern::COUNTER and look up
+ * sendTimeNs(event.x) for each received event; it is on the same
+ * steady_clock that stamps StylusEvent::timestampNs.
+ *
+ * POSIX only (Linux and macOS).
+ */
+class WT13106Simulator {
+public:
+    WT13106Simulator();
+    ~WT13106Simulator();
+
+    WT13106Simulator(const WT13106Simulator&) = delete;
+    WT13106Simulator& operator=(const WT13106Simulator&) = delete;
+
+    /**
+     * @brief Create the pty and start streaming
+     * @return true on success
+     */
+    bool start(const SimulatorOptions& options = SimulatorOptions());
+
+    /**
+     * @brief Stop streaming and close the pty
+     *
+     * Closing the master hangs up the slave and discards whatever the host
+     * has not read yet, so stop() first writes out frames still queued and
+     * waits for the host to read them. It gives up once the host makes no
+     * progress for kDrainIdleMs (e.g. nobody has the port open); see
+     * bytesUnread().
+     */
+    void stop();
+
+    bool isRunning() const { return m_running; }
+
+    /**
+     * @brief Stop or resume pen output; commands are still answered while paused
+     *
+     * Nothing is sampled (or dropped) while paused, and output resumes from
+     * the same trace position without catching up on the missed ticks.
+     */
+    void setPaused(bool paused);
+
+    /**
+     * @brief Path of the pty slave, e.g. "/dev/pts/3"
+     */
+    std::string devicePath() const { return m_devicePath; }
+
+    /**
+     * @brief Connection string for WT13106Connection, e.g. "BT:/dev/pts/3"
+     */
+    std::string connectionString() const { return "BT:" + m_devicePath; }
+
+    /**
+     * @brief Steady-clock time (ns) at which the sample with this counter was written
+     *
+     * Only meaningful with SimulatorPattern::COUNTER; indexes wrap every 65536
+     * samples.
+     */
+    uint64_t sendTimeNs(uint16_t counter) const;
+
+    uint64_t framesSent() const { return m_framesSent; }
+    uint64_t framesDropped() const { return m_framesDropped; }
+
+    /**
+     * @brief Bytes counted in framesSent() that the host had not read when stop() closed the pty
+     */
+    uint64_t bytesUnread() const { return m_bytesUnread; }
+
+    static const int kDrainIdleMs = 50;
+    uint64_t commandsAnswered() const { return m_commandsAnswered; }
+
+    std::string getLastError() const { return m_lastError; }
+
+private:
+    SimulatorOptions m_options;
+    int m_masterFd;
+    int m_slaveFd;      // Kept open so the master never reports a hang-up between clients
+    int m_wakeFd;       // Read end of the stop() wake-up pipe
+    int m_wakeWriteFd;
+    std::string m_devicePath;
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_stopRequested;
+    std::atomic<bool> m_paused;
+    std::atomic<uint64_t> m_framesSent;
+    std::atomic<uint64_t> m_framesDropped;
+    std::atomic<uint64_t> m_bytesUnread;
+    std::atomic<uint64_t> m_commandsAnswered;
+    std::unique_ptr<std::atomic<uint64_t>[]> m_sendTimes;
+    std::string m_lastError;
+
+    void run();
+
+    /**
+     * @brief After the stop request: write out the backlog, then wait for the host to read it
+     * @return Bytes left unread when the host stopped making progress
+     */
+    size_t drain(const uint8_t* backlog, size_t pending);
+
+    void closeDescriptors();
+};
+
+#endif // WT13106_SIMULATOR_H
@@ -0,0 +1,52 @@
+#include "../include/Arena.h"
+
+Arena::Arena(size_t blockSize)
+    : m_blockSize(blockSize ? blockSize : DEFAULT_BLOCK_SIZE)
+    , m_current(0)
+    , m_offset(0)
+    , m_used(0)
+    , m_reserved(0)
+{
+}
+
+void* Arena::allocate(size_t size, size_t align)
+{
+    for (;;) {
+        if (m_current < m_blocks.size()) {
+            Block& block = m_blocks[m_current];
+            size_t offset = (m_offset + align - 1) & ~(align - 1);
+            if (offset <= block.size && size <= block.size - offset) {
+                m_offset = offset + size;
+                m_used += size;
+                return block.data.get() + offset;
+            }
+            if (m_current + 1 < m_blocks.size()) {
+                // Move on; the tail of this block stays unused until reset()
+                ++m_current;
+                m_offset = 0;
+                continue;
+            }
+        }
+
+        // No block left that fits: add one (oversized requests get their own)
+        size_t blockSize = size + align > m_blockSize ? size + align : m_blockSize;
+        m_blocks.push_back(Block{std::unique_ptr<uint8_t[]>(new uint8_t[blockSize]), blockSize});
+        m_reserved += blockSize;
+        m_current = m_blocks.size() - 1;
+        m_offset = 0;
+    }
+}
+
+void Arena::reset()
+{
+    m_current = 0;
+    m_offset = 0;
+    m_used = 0;
+}
+
+void Arena::release()
+{
+    m_blocks.clear();
+    m_reserved = 0;
+    reset();
+}
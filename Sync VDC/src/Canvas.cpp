@@ -0,0 +1,296 @@
+#include "../include/Canvas.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define WT13106_CANVAS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Segment being rasterized, in pixel units relative to its start point
+ */
+struct SegmentShape {
+    float x0;
+    float y0;
+    float dx;
+    float dy;
+    float invLengthSquared;  // 0 for a dot
+    float radius0;
+    float deltaRadius;
+};
+
+inline float coverageAt(const SegmentShape& s, float px, float py)
+{
+    float vx = px - s.x0;
+    float vy = py - s.y0;
+    float t = (vx * s.dx + vy * s.dy) * s.invLengthSquared;
+    t = std::min(std::max(t, 0.0f), 1.0f);
+    float ex = vx - t * s.dx;
+    float ey = vy - t * s.dy;
+    float distance = std::sqrt(ex * ex + ey * ey);
+    float coverage = s.radius0 + t * s.deltaRadius + 0.5f - distance;
+    return std::min(std::max(coverage, 0.0f), 1.0f);
+}
+
+void fillSpanScalar(const SegmentShape& s, uint8_t* row, int x, int end, float py)
+{
+    for (; x <= end; ++x) {
+        uint8_t value = static_cast<uint8_t>(coverageAt(s, x + 0.5f, py) * 255.0f + 0.5f);
+        if (value > row[x]) {
+            row[x] = value;
+        }
+    }
+}
+
+#ifdef WT13106_CANVAS_SSE2
+
+/**
+ * @brief Coverage of four pixels whose centers are px (same arithmetic as coverageAt())
+ */
+inline __m128 coverage4(const SegmentShape& s, __m128 px, __m128 vy, __m128 vyTerm)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 vx = _mm_sub_ps(px, _mm_set1_ps(s.x0));
+    __m128 t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_set1_ps(s.dx)), vyTerm), _mm_set1_ps(s.invLengthSquared));
+    t = _mm_min_ps(_mm_max_ps(t, zero), one);
+    __m128 ex = _mm_sub_ps(vx, _mm_mul_ps(t, _mm_set1_ps(s.dx)));
+    __m128 ey = _mm_sub_ps(vy, _mm_mul_ps(t, _mm_set1_ps(s.dy)));
+    __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)));
+    __m128 radius = _mm_add_ps(_mm_set1_ps(s.radius0), _mm_mul_ps(t, _mm_set1_ps(s.deltaRadius)));
+    __m128 coverage = _mm_sub_ps(_mm_add_ps(radius, _mm_set1_ps(0.5f)), distance);
+    return _mm_min_ps(_mm_max_ps(coverage, zero), one);
+}
+
+/**
+ * @brief Fill row[x .. end] 16 pixels per iteration, the remainder with fillSpanScalar()
+ */
+void fillSpan(const SegmentShape& s, uint8_t* row, int x, int end, float py)
+{
+    const __m128 vy = _mm_set1_ps(py - s.y0);
+    const __m128 vyTerm = _mm_mul_ps(vy, _mm_set1_ps(s.dy));
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 step = _mm_set1_ps(4.0f);
+    for (; x + 15 <= end; x += 16) {
+        __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f));
+        __m128i a = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(coverage4(s, px, vy, vyTerm), scale), half));
+        px = _mm_add_ps(px, step);
+        __m128i b = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(coverage4(s, px, vy, vyTerm), scale), half));
+        px = _mm_add_ps(px, step);
+        __m128i c = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(coverage4(s, px, vy, vyTerm), scale), half));
+        px = _mm_add_ps(px, step);
+        __m128i d = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(coverage4(s, px, vy, vyTerm), scale), half));
+        __m128i values = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        __m128i* target = reinterpret_cast<__m128i*>(row + x);
+        _mm_storeu_si128(target, _mm_max_epu8(_mm_loadu_si128(target), values));
+    }
+    fillSpanScalar(s, row, x, end, py);
+}
+
+#else
+
+void fillSpan(const SegmentShape& s, uint8_t* row, int x, int end, float py)
+{
+    fillSpanScalar(s, row, x, end, py);
+}
+
+#endif
+
+} // namespace
+
+Canvas::Canvas(const CanvasOptions& options)
+    : m_options(options)
+    , m_stride((static_cast<size_t>(std::max(options.width, 1)) + 15) & ~static_cast<size_t>(15))
+    , m_pixels(m_stride * static_cast<size_t>(std::max(options.height, 1)), 0)
+    , m_tilesX((std::max(options.width, 1) + TILE_SIZE - 1) / TILE_SIZE)
+    , m_tilesY((std::max(options.height, 1) + TILE_SIZE - 1) / TILE_SIZE)
+    , m_dirty(static_cast<size_t>(m_tilesX) * m_tilesY, 0)
+    , m_dirtyCount(0)
+    , m_scaleX(options.deviceWidth > 0 ? options.width / options.deviceWidth : 1.0)
+    , m_scaleY(options.deviceHeight > 0 ? options.height / options.deviceHeight : 1.0)
+    , m_penDown(false)
+    , m_lastX(0.0)
+    , m_lastY(0.0)
+    , m_lastRadius(0.0)
+{
+    m_options.width = std::max(options.width, 1);
+    m_options.height = std::max(options.height, 1);
+}
+
+void Canvas::addEvent(const StylusEvent& event)
+{
+    if (event.flags & STYLUS_PAGE_CLEAR) {
+        clear();
+        m_penDown = false;
+    }
+    if (!(event.flags & STYLUS_TIP_DOWN)) {
+        m_penDown = false;
+        return;
+    }
+
+    double x = event.x * m_scaleX;
+    double y = event.y * m_scaleY;
+    double radius = radiusFor(event.pressure);
+    if (m_penDown) {
+        drawSegment(m_lastX, m_lastY, m_lastRadius, x, y, radius);
+    } else {
+        drawSegment(x, y, radius, x, y, radius);
+        m_penDown = true;
+    }
+    m_lastX = x;
+    m_lastY = y;
+    m_lastRadius = radius;
+}
+
+void Canvas::addEvents(const StylusEvent* events, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        addEvent(events[i]);
+    }
+}
+
+void Canvas::drawSegment(double x0, double y0, double radius0, double x1, double y1, double radius1)
+{
+    // Everything a pixel center can get coverage from lies within reach of the segment
+    const double reach = std::max(radius0, radius1) + 1.0;
+    int minX = std::max(0, static_cast<int>(std::floor(std::min(x0, x1) - reach)));
+    int maxX = std::min(m_options.width - 1, static_cast<int>(std::ceil(std::max(x0, x1) + reach)));
+    int minY = std::max(0, static_cast<int>(std::floor(std::min(y0, y1) - reach)));
+    int maxY = std::min(m_options.height - 1, static_cast<int>(std::ceil(std::max(y0, y1) + reach)));
+    if (minX > maxX || minY > maxY) {
+        return;
+    }
+
+    SegmentShape shape;
+    shape.x0 = static_cast<float>(x0);
+    shape.y0 = static_cast<float>(y0);
+    shape.dx = static_cast<float>(x1 - x0);
+    shape.dy = static_cast<float>(y1 - y0);
+    double lengthSquared = (x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0);
+    shape.invLengthSquared = lengthSquared > 1e-12 ? static_cast<float>(1.0 / lengthSquared) : 0.0f;
+    shape.radius0 = static_cast<float>(radius0);
+    shape.deltaRadius = static_cast<float>(radius1 - radius0);
+
+    // For slanted segments, restrict each row to the band of width 2 * reach
+    // around the line instead of the whole bounding box
+    const double length = std::sqrt(lengthSquared);
+    const double normalX = length > 0.0 ? -(y1 - y0) / length : 0.0;
+    const double normalY = length > 0.0 ? (x1 - x0) / length : 0.0;
+    const bool useBand = std::fabs(normalX) > 1e-3;
+
+    for (int y = minY; y <= maxY; ++y) {
+        double centerY = y + 0.5;
+        int spanStart = minX;
+        int spanEnd = maxX;
+        if (useBand) {
+            double offset = normalY * (centerY - y0);
+            double a = x0 + (-reach - offset) / normalX;
+            double b = x0 + (reach - offset) / normalX;
+            spanStart = std::max(spanStart, static_cast<int>(std::floor(std::min(a, b) - 0.5)));
+            spanEnd = std::min(spanEnd, static_cast<int>(std::ceil(std::max(a, b) - 0.5)));
+            if (spanStart > spanEnd) {
+                continue;
+            }
+        }
+        fillSpan(shape, m_pixels.data() + static_cast<size_t>(y) * m_stride, spanStart, spanEnd,
+                 static_cast<float>(centerY));
+        markDirty(spanStart, y, spanEnd, y);
+    }
+}
+
+void Canvas::clear()
+{
+    std::fill(m_pixels.begin(), m_pixels.end(), 0);
+    markDirty(0, 0, m_options.width - 1, m_options.height - 1);
+}
+
+size_t Canvas::takeDirtyRects(std::vector<CanvasRect>& out)
+{
+    const size_t before = out.size();
+    if (m_dirtyCount == 0) {
+        return 0;
+    }
+
+    std::vector<CanvasRect>& open = m_openRects;
+    std::vector<CanvasRect>& next = m_rowRuns;
+    open.clear();
+    auto emit = [&](const CanvasRect& tiles) {
+        CanvasRect rect;
+        rect.x = tiles.x * TILE_SIZE;
+        rect.y = tiles.y * TILE_SIZE;
+        rect.width = std::min(tiles.width * TILE_SIZE, m_options.width - rect.x);
+        rect.height = std::min(tiles.height * TILE_SIZE, m_options.height - rect.y);
+        out.push_back(rect);
+    };
+
+    for (int tileY = 0; tileY <= m_tilesY; ++tileY) {
+        next.clear();
+        if (tileY < m_tilesY) {
+            const uint8_t* flags = m_dirty.data() + static_cast<size_t>(tileY) * m_tilesX;
+            for (int tileX = 0; tileX < m_tilesX;) {
+                if (!flags[tileX]) {
+                    ++tileX;
+                    continue;
+                }
+                int runStart = tileX;
+                while (tileX < m_tilesX && flags[tileX]) {
+                    ++tileX;
+                }
+                CanvasRect run = {runStart, tileY, tileX - runStart, 1};
+                for (CanvasRect& rect : open) {
+                    if (rect.width > 0 && rect.x == run.x && rect.width == run.width) {
+                        run.y = rect.y;
+                        run.height = rect.height + 1;
+                        rect.width = 0;  // Continued below
+                        break;
+                    }
+                }
+                next.push_back(run);
+            }
+        }
+        for (const CanvasRect& rect : open) {
+            if (rect.width > 0) {
+                emit(rect);
+            }
+        }
+        open.swap(next);
+    }
+
+    std::fill(m_dirty.begin(), m_dirty.end(), 0);
+    m_dirtyCount = 0;
+    return out.size() - before;
+}
+
+void Canvas::copyRect(const CanvasRect& rect, uint8_t* dst, size_t dstStride) const
+{
+    for (int row = 0; row < rect.height; ++row) {
+        std::memcpy(dst + static_cast<size_t>(row) * dstStride,
+                    m_pixels.data() + static_cast<size_t>(rect.y + row) * m_stride + rect.x,
+                    static_cast<size_t>(rect.width));
+    }
+}
+
+void Canvas::markDirty(int x0, int y0, int x1, int y1)
+{
+    for (int tileY = y0 / TILE_SIZE; tileY <= y1 / TILE_SIZE; ++tileY) {
+        uint8_t* flags = m_dirty.data() + static_cast<size_t>(tileY) * m_tilesX;
+        for (int tileX = x0 / TILE_SIZE; tileX <= x1 / TILE_SIZE; ++tileX) {
+            if (!flags[tileX]) {
+                flags[tileX] = 1;
+                ++m_dirtyCount;
+            }
+        }
+    }
+}
+
+double Canvas::radiusFor(uint16_t pressure) const
+{
+    double fraction = m_options.maxPressure > 0 ? std::min(pressure / m_options.maxPressure, 1.0) : 1.0;
+    return 0.5 * (m_options.minPenWidth + (m_options.maxPenWidth - m_options.minPenWidth) * fraction);
+}
@@ -0,0 +1,562 @@
+#include "../include/CaptureFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+void putLE32(uint8_t* p, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+        p[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+void putLE64(uint8_t* p, uint64_t value)
+{
+    for (int i = 0; i < 8; ++i) {
+        p[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint32_t getLE32(const uint8_t* p)
+{
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; --i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+uint64_t getLE64(const uint8_t* p)
+{
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+const size_t kIndexEntrySize = 16;
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// CaptureWriter
+
+CaptureWriter::CaptureWriter()
+    : m_file(nullptr)
+    , m_offset(0)
+    , m_recordCount(0)
+    , m_firstTimestampNs(0)
+    , m_lastTimestampNs(0)
+    , m_lastIndexOffset(0)
+    , m_nextIndexAt(0)
+{
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    close();
+}
+
+bool CaptureWriter::open(const std::string& path, const CaptureWriterOptions& options)
+{
+    if (m_file) {
+        m_lastError = "Capture file already open";
+        return false;
+    }
+
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) {
+        m_lastError = "Failed to create capture file: " + path;
+        return false;
+    }
+
+    m_options = options;
+    if (m_options.indexStrideBytes == 0) {
+        m_options.indexStrideBytes = 1;
+    }
+    if (m_options.entriesPerIndexBlock == 0) {
+        m_options.entriesPerIndexBlock = 1;
+    }
+    if (m_options.bufferSize > 0) {
+        m_buffer.resize(m_options.bufferSize);
+        std::setvbuf(m_file, m_buffer.data(), _IOFBF, m_buffer.size());
+    }
+
+    m_offset = 0;
+    m_recordCount = 0;
+    m_firstTimestampNs = 0;
+    m_lastTimestampNs = 0;
+    m_lastIndexOffset = 0;
+    m_nextIndexAt = CAPTURE_HEADER_SIZE;
+    m_pendingIndex.clear();
+
+    // The first timestamp is patched in by close()
+    uint8_t header[CAPTURE_HEADER_SIZE] = {};
+    std::memcpy(header, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    putLE32(header + 8, CAPTURE_VERSION);
+    putLE32(header + 12, static_cast<uint32_t>(CAPTURE_HEADER_SIZE));
+    putLE64(header + 24, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count()));
+    if (!writeBytes(header, sizeof(header))) {
+        std::fclose(m_file);
+        m_file = nullptr;
+        return false;
+    }
+
+    m_lastError = "";
+    return true;
+}
+
+bool CaptureWriter::append(uint64_t timestampNs, const uint8_t* data, size_t length)
+{
+    if (!m_file) {
+        m_lastError = "Capture file not open";
+        return false;
+    }
+    if (length > std::numeric_limits<uint32_t>::max()) {
+        m_lastError = "Capture record too large";
+        return false;
+    }
+
+    if (m_offset >= m_nextIndexAt) {
+        m_pendingIndex.push_back(IndexEntry{timestampNs, m_offset});
+        m_nextIndexAt = m_offset + m_options.indexStrideBytes;
+    }
+
+    uint8_t header[CAPTURE_RECORD_HEADER_SIZE];
+    putLE32(header, CAPTURE_RECORD_DATA);
+    putLE32(header + 4, static_cast<uint32_t>(length));
+    putLE64(header + 8, timestampNs);
+    if (!writeBytes(header, sizeof(header)) || (length > 0 && !writeBytes(data, length))) {
+        return false;
+    }
+
+    if (m_recordCount == 0) {
+        m_firstTimestampNs = timestampNs;
+    }
+    m_recordCount++;
+    m_lastTimestampNs = timestampNs;
+
+    if (m_pendingIndex.size() >= m_options.entriesPerIndexBlock) {
+        return writeIndexBlock();
+    }
+    return true;
+}
+
+bool CaptureWriter::flush()
+{
+    if (!m_file) {
+        return false;
+    }
+    return std::fflush(m_file) == 0;
+}
+
+bool CaptureWriter::close()
+{
+    if (!m_file) {
+        return false;
+    }
+
+    bool ok = true;
+    if (!m_pendingIndex.empty()) {
+        ok = writeIndexBlock();
+    }
+
+    uint8_t trailer[CAPTURE_TRAILER_SIZE];
+    std::memcpy(trailer, CAPTURE_TRAILER_MAGIC, sizeof(CAPTURE_TRAILER_MAGIC));
+    putLE64(trailer + 8, m_lastIndexOffset);
+    putLE64(trailer + 16, m_recordCount);
+    putLE64(trailer + 24, m_lastTimestampNs);
+    ok = ok && writeBytes(trailer, sizeof(trailer));
+
+    // Patch the first timestamp into the header
+    if (ok && m_recordCount > 0 && std::fseek(m_file, 16, SEEK_SET) == 0) {
+        uint8_t first[8];
+        putLE64(first, m_firstTimestampNs);
+        ok = std::fwrite(first, 1, sizeof(first), m_file) == sizeof(first);
+    }
+
+    if (std::fclose(m_file) != 0) {
+        ok = false;
+    }
+    m_file = nullptr;
+    if (!ok) {
+        m_lastError = "Failed to finish capture file";
+    }
+    return ok;
+}
+
+bool CaptureWriter::writeBytes(const void* data, size_t length)
+{
+    if (std::fwrite(data, 1, length, m_file) != length) {
+        m_lastError = "Failed to write capture file";
+        return false;
+    }
+    m_offset += length;
+    return true;
+}
+
+bool CaptureWriter::writeIndexBlock()
+{
+    uint64_t blockOffset = m_offset;
+    uint8_t header[CAPTURE_RECORD_HEADER_SIZE];
+    putLE32(header, CAPTURE_RECORD_INDEX);
+    putLE32(header + 4, static_cast<uint32_t>(m_pendingIndex.size()));
+    putLE64(header + 8, m_lastIndexOffset);
+    if (!writeBytes(header, sizeof(header))) {
+        return false;
+    }
+
+    for (const IndexEntry& entry : m_pendingIndex) {
+        uint8_t raw[kIndexEntrySize];
+        putLE64(raw, entry.timestampNs);
+        putLE64(raw + 8, entry.offset);
+        if (!writeBytes(raw, sizeof(raw))) {
+            return false;
+        }
+    }
+
+    m_lastIndexOffset = blockOffset;
+    m_pendingIndex.clear();
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// CaptureReader
+
+CaptureReader::CaptureReader()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_dataEnd(0)
+    , m_cursor(0)
+    , m_firstTimestampNs(0)
+    , m_lastTimestampNs(0)
+    , m_wallClockStartNs(0)
+    , m_recordCount(0)
+    , m_hasTrailer(false)
+#ifdef _WIN32
+    , m_fileHandle(nullptr)
+    , m_mappingHandle(nullptr)
+#endif
+{
+}
+
+CaptureReader::~CaptureReader()
+{
+    close();
+}
+
+bool CaptureReader::open(const std::string& path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        m_lastError = "Failed to open capture file: " + path;
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < static_cast<LONGLONG>(CAPTURE_HEADER_SIZE)) {
+        CloseHandle(file);
+        m_lastError = "Not a capture file (too short): " + path;
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        m_lastError = "Failed to map capture file: " + path;
+        return false;
+    }
+    m_fileHandle = file;
+    m_mappingHandle = mapping;
+    m_data = static_cast<const uint8_t*>(view);
+    m_size = static_cast<uint64_t>(size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        m_lastError = "Failed to open capture file: " + path;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(CAPTURE_HEADER_SIZE)) {
+        ::close(fd);
+        m_lastError = "Not a capture file (too short): " + path;
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // The mapping keeps the file alive
+    if (view == MAP_FAILED) {
+        m_lastError = "Failed to map capture file: " + path;
+        return false;
+    }
+    m_data = static_cast<const uint8_t*>(view);
+    m_size = static_cast<uint64_t>(info.st_size);
+#endif
+
+    if (std::memcmp(m_data, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0 ||
+        getLE32(m_data + 8) != CAPTURE_VERSION) {
+        close();
+        m_lastError = "Not a capture file or unsupported version: " + path;
+        return false;
+    }
+    m_wallClockStartNs = getLE64(m_data + 24);
+
+    m_hasTrailer = false;
+    m_dataEnd = m_size;
+    if (m_size >= CAPTURE_HEADER_SIZE + CAPTURE_TRAILER_SIZE) {
+        const uint8_t* trailer = m_data + m_size - CAPTURE_TRAILER_SIZE;
+        if (std::memcmp(trailer, CAPTURE_TRAILER_MAGIC, sizeof(CAPTURE_TRAILER_MAGIC)) == 0) {
+            m_dataEnd = m_size - CAPTURE_TRAILER_SIZE;
+            m_recordCount = getLE64(trailer + 16);
+            m_lastTimestampNs = getLE64(trailer + 24);
+            m_hasTrailer = loadIndexChain(getLE64(trailer + 8));
+        }
+    }
+    if (!m_hasTrailer) {
+        m_dataEnd = m_size;
+        rebuildIndex();
+    }
+
+    m_firstTimestampNs = m_index.empty() ? 0 : m_index.front().timestampNs;
+    m_cursor = CAPTURE_HEADER_SIZE;
+    m_lastError = "";
+    return true;
+}
+
+void CaptureReader::close()
+{
+    if (!m_data) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(static_cast<HANDLE>(m_mappingHandle));
+    CloseHandle(static_cast<HANDLE>(m_fileHandle));
+    m_mappingHandle = nullptr;
+    m_fileHandle = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(m_data), static_cast<size_t>(m_size));
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_dataEnd = 0;
+    m_index.clear();
+    m_recordCount = 0;
+}
+
+bool CaptureReader::next(CaptureRecord& record)
+{
+    while (m_cursor + CAPTURE_RECORD_HEADER_SIZE <= m_dataEnd) {
+        const uint8_t* p = m_data + m_cursor;
+        uint32_t kind = getLE32(p);
+        uint32_t length = getLE32(p + 4);
+
+        if (kind == CAPTURE_RECORD_INDEX) {
+            m_cursor += CAPTURE_RECORD_HEADER_SIZE + static_cast<uint64_t>(length) * kIndexEntrySize;
+            continue;
+        }
+        if (kind != CAPTURE_RECORD_DATA ||
+            m_cursor + CAPTURE_RECORD_HEADER_SIZE + length > m_dataEnd) {
+            m_cursor = m_dataEnd;  // Corrupt or truncated tail
+            return false;
+        }
+
+        record.timestampNs = getLE64(p + 8);
+        record.data = p + CAPTURE_RECORD_HEADER_SIZE;
+        record.length = length;
+        m_cursor += CAPTURE_RECORD_HEADER_SIZE + length;
+        return true;
+    }
+    return false;
+}
+
+void CaptureReader::seek(uint64_t timestampNs)
+{
+    // Last index entry at or before the target, then scan forward
+    auto it = std::upper_bound(m_index.begin(), m_index.end(), timestampNs,
+                               [](uint64_t ts, const IndexEntry& entry) { return ts < entry.timestampNs; });
+    m_cursor = it == m_index.begin() ? CAPTURE_HEADER_SIZE : (it - 1)->offset;
+
+    CaptureRecord record;
+    for (;;) {
+        uint64_t position = m_cursor;
+        if (!next(record)) {
+            return;
+        }
+        if (record.timestampNs >= timestampNs) {
+            m_cursor = position;
+            return;
+        }
+    }
+}
+
+void CaptureReader::rewind()
+{
+    m_cursor = CAPTURE_HEADER_SIZE;
+}
+
+bool CaptureReader::loadIndexChain(uint64_t lastIndexOffset)
+{
+    m_index.clear();
+    uint64_t offset = lastIndexOffset;
+    while (offset != 0) {
+        if (offset < CAPTURE_HEADER_SIZE || offset + CAPTURE_RECORD_HEADER_SIZE > m_dataEnd) {
+            return false;
+        }
+        const uint8_t* p = m_data + offset;
+        uint32_t count = getLE32(p + 4);
+        uint64_t previous = getLE64(p + 8);
+        if (getLE32(p) != CAPTURE_RECORD_INDEX ||
+            offset + CAPTURE_RECORD_HEADER_SIZE + static_cast<uint64_t>(count) * kIndexEntrySize > m_dataEnd ||
+            previous >= offset) {
+            return false;
+        }
+
+        const uint8_t* entry = p + CAPTURE_RECORD_HEADER_SIZE;
+        for (uint32_t i = 0; i < count; ++i, entry += kIndexEntrySize) {
+            m_index.push_back(IndexEntry{getLE64(entry), getLE64(entry + 8)});
+        }
+        offset = previous;
+    }
+
+    // Blocks were visited newest first
+    std::sort(m_index.begin(), m_index.end(),
+              [](const IndexEntry& a, const IndexEntry& b) { return a.offset < b.offset; });
+    return true;
+}
+
+void CaptureReader::rebuildIndex()
+{
+    const uint64_t stride = CaptureWriterOptions().indexStrideBytes;
+    m_index.clear();
+    m_recordCount = 0;
+    m_lastTimestampNs = 0;
+
+    uint64_t nextIndexAt = CAPTURE_HEADER_SIZE;
+    m_cursor = CAPTURE_HEADER_SIZE;
+    CaptureRecord record;
+    for (;;) {
+        uint64_t position = m_cursor;
+        if (!next(record)) {
+            break;
+        }
+        if (position >= nextIndexAt) {
+            m_index.push_back(IndexEntry{record.timestampNs, position});
+            nextIndexAt = position + stride;
+        }
+        m_recordCount++;
+        m_lastTimestampNs = record.timestampNs;
+    }
+    // Anything after the last complete record is a torn write
+    m_dataEnd = m_cursor;
+}
+
+// ---------------------------------------------------------------------------
+// CaptureReplay
+
+CaptureReplay::CaptureReplay()
+    : m_speed(1.0)
+    , m_started(false)
+    , m_finished(false)
+    , m_startNs(0)
+    , m_current()
+    , m_currentOffset(0)
+    , m_haveCurrent(false)
+{
+}
+
+bool CaptureReplay::open(const std::string& path, double speed)
+{
+    if (!m_reader.open(path)) {
+        return false;
+    }
+    m_speed = speed > 0 ? speed : 0;
+    m_started = false;
+    m_finished = false;
+    m_haveCurrent = false;
+    m_currentOffset = 0;
+    return true;
+}
+
+void CaptureReplay::close()
+{
+    m_reader.close();
+    m_finished = true;
+    m_haveCurrent = false;
+}
+
+bool CaptureReplay::loadNext()
+{
+    if (m_haveCurrent) {
+        return true;
+    }
+    if (m_finished || !m_reader.next(m_current)) {
+        m_finished = true;
+        return false;
+    }
+    m_haveCurrent = true;
+    m_currentOffset = 0;
+    return true;
+}
+
+uint64_t CaptureReplay::dueTime(const CaptureRecord& record) const
+{
+    if (m_speed == 0) {
+        return 0;
+    }
+    uint64_t elapsed = record.timestampNs - m_reader.firstTimestampNs();
+    return m_startNs + static_cast<uint64_t>(static_cast<double>(elapsed) / m_speed);
+}
+
+uint64_t CaptureReplay::nextDueNs(uint64_t nowNs)
+{
+    if (!m_started) {
+        m_started = true;
+        m_startNs = nowNs;
+    }
+    if (!loadNext()) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    uint64_t due = dueTime(m_current);
+    return due <= nowNs ? 0 : due;
+}
+
+size_t CaptureReplay::readDue(uint8_t* buffer, size_t capacity, uint64_t nowNs)
+{
+    if (!m_started) {
+        m_started = true;
+        m_startNs = nowNs;
+    }
+
+    size_t copied = 0;
+    while (copied < capacity && loadNext() && dueTime(m_current) <= nowNs) {
+        size_t take = std::min<size_t>(capacity - copied, m_current.length - m_currentOffset);
+        std::memcpy(buffer + copied, m_current.data + m_currentOffset, take);
+        copied += take;
+        m_currentOffset += static_cast<uint32_t>(take);
+        if (m_currentOffset == m_current.length) {
+            m_haveCurrent = false;
+        }
+    }
+    return copied;
+}
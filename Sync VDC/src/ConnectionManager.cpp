@@ -0,0 +1,918 @@
+#include "../include/ConnectionManager.h"
+#include "../include/IoUring.h"
+#include "../include/WT13106Connection.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace {
+
+// Reads per device per wake-up before moving on to the next ready device;
+// epoll is level-triggered, so anything left is reported again.
+const int kMaxReadsPerWakeup = 16;
+
+#ifdef WT13106_HAVE_IO_URING
+// Size of each provided receive buffer (as the epoll loop's read buffer)
+const unsigned kUringBufferSize = 4096;
+const uint16_t kUringBufferGroup = 0;
+
+// Low bits of a completion's user_data say which operation of the device
+// (pointer in the upper bits) it belongs to; a null device is the wake-up read
+const uint64_t kOpPoll = 0;
+const uint64_t kOpRead = 1;
+const uint64_t kOpWrite = 2;
+const uint64_t kOpCancel = 3;   // Completions of cancel requests are ignored
+const uint64_t kOpMask = 3;
+#endif
+
+uint64_t steadyNowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+} // namespace
+
+struct ConnectionManager::Device {
+    int id = -1;
+    WT13106Connection* connection = nullptr;
+    int fd = -1;
+    DeviceHandlers handlers;
+    FrameDecoder decoder;
+    bool removed = false;
+
+    // A tty: the loop writes send() data to it directly, and with io_uring
+    // also reads it; anything else goes through the connection
+    bool direct = false;
+    std::vector<uint8_t> incoming;   // send() data; guarded by Loop::sendMutex
+    bool sendScheduled = false;      // Listed in Loop::sending; guarded by Loop::sendMutex
+    std::vector<uint8_t> sendQueue;  // send() data taken by the loop, not yet handed to the kernel
+    std::vector<uint8_t> writing;    // Taken from sendQueue, being written
+    size_t written = 0;              // Bytes of writing already written
+    bool waitingWritable = false;    // epoll: registered for EPOLLOUT
+
+    // io_uring only
+    bool hungUp = false;             // A poll reported POLLHUP/POLLERR
+    bool cancelled = false;          // Cancel submitted after removal
+    unsigned inFlight = 0;           // Operations whose last completion is still due
+};
+
+struct ConnectionManager::Loop {
+    int epollFd = -1;
+    int wakeFd = -1;
+    std::thread thread;
+    std::atomic<bool> stopRequested{false};
+    std::atomic<bool> wakePending{false};  // wakeFd signalled and not yet consumed
+    IoEngine engine = IoEngine::EPOLL;
+#ifdef WT13106_HAVE_IO_URING
+    IoUring ring;
+    bool multishot = false;                // IORING_OP_READ_MULTISHOT (6.7)
+    uint64_t wakeValue = 0;
+#endif
+
+    std::atomic<uint64_t> systemCalls{0};
+    std::atomic<uint64_t> wakeups{0};
+    std::atomic<uint64_t> bytesReceived{0};
+    std::atomic<uint64_t> bytesSent{0};
+
+    // Held by the loop while it dispatches a batch of ready devices, so a
+    // device can't be torn down underneath a handler. Recursive because
+    // handlers may call removeConnection().
+    std::recursive_mutex mutex;
+    std::vector<std::unique_ptr<Device>> devices;
+    std::vector<std::unique_ptr<Device>> retired;  // Freed after the current batch (io_uring: once idle)
+    std::vector<Device*> arming;    // io_uring: registered, nothing submitted yet
+    std::vector<Device*> flushing;  // Taken from sending by the loop thread
+    size_t load = 0;                // Registered devices; guarded by m_registrationMutex
+
+    // Leaf lock for send(), which must not wait for a loop busy in handlers
+    std::mutex sendMutex;
+    std::vector<Device*> sending;   // Devices with send() data or room to write; guarded by sendMutex
+
+    std::vector<uint8_t> readBuffer;
+    std::vector<StylusEvent> events;
+};
+
+#ifdef WT13106_HAVE_IO_URING
+namespace {
+
+/**
+ * @brief Free submission entry, submitting what is prepared if the queue is full
+ */
+struct io_uring_sqe* nextSqe(IoUring& ring, std::atomic<uint64_t>& systemCalls)
+{
+    struct io_uring_sqe* sqe = ring.getSqe();
+    while (sqe == nullptr) {
+        ring.submitAndWait(0);
+        ConnectionMetrics::add(systemCalls);
+        sqe = ring.getSqe();
+    }
+    return sqe;
+}
+
+uint64_t userData(void* device, uint64_t op)
+{
+    return reinterpret_cast<uint64_t>(device) | op;
+}
+
+/**
+ * @brief Arm a device: POLL_ADD, linked to a (multishot) buffer-select read for a tty
+ *
+ * The poll gates the read because a tty with VMIN = VTIME = 0 answers a read
+ * with 0 instead of EAGAIN when it is empty, which would end the multishot
+ * read at once; once data has flowed, the multishot read waits on its own.
+ */
+void armDevice(IoUring& ring, bool multishot, std::atomic<uint64_t>& systemCalls, void* device, int fd,
+               bool direct, unsigned& inFlight)
+{
+    struct io_uring_sqe* poll = nextSqe(ring, systemCalls);
+    poll->opcode = IORING_OP_POLL_ADD;
+    poll->fd = fd;
+    poll->poll32_events = POLLIN;
+    poll->user_data = userData(device, kOpPoll);
+    ++inFlight;
+    if (!direct) {
+        return;
+    }
+
+    poll->flags = IOSQE_IO_LINK;
+    struct io_uring_sqe* read = nextSqe(ring, systemCalls);
+    if (multishot) {
+        read->opcode = IoUring::kOpReadMultishot;
+    } else {
+        read->opcode = IORING_OP_READ;
+        read->off = static_cast<uint64_t>(-1);  // Current position (a tty has none)
+    }
+    read->fd = fd;
+    read->flags = IOSQE_BUFFER_SELECT;
+    read->buf_group = kUringBufferGroup;
+    read->user_data = userData(device, kOpRead);
+    ++inFlight;
+}
+
+} // namespace
+#endif
+
+ConnectionManager::ConnectionManager(const ConnectionManagerOptions& options)
+    : m_options(options)
+    , m_nextId(0)
+    , m_deviceCount(0)
+{
+    if (m_options.eventBatchSize == 0) {
+        m_options.eventBatchSize = 1;
+    }
+    if (m_options.maxEventsPerWait == 0) {
+        m_options.maxEventsPerWait = 1;
+    }
+    if (m_options.ioUringBuffers == 0 || (m_options.ioUringBuffers & (m_options.ioUringBuffers - 1)) != 0 ||
+        m_options.ioUringBuffers > 32768) {
+        m_options.ioUringBuffers = 256;
+    }
+}
+
+ConnectionManager::~ConnectionManager()
+{
+    stop();
+}
+
+bool ConnectionManager::start()
+{
+    if (!m_loops.empty()) {
+        setError("Connection manager already started");
+        return false;
+    }
+
+    size_t count = m_options.loopCount;
+    if (count == 0) {
+        count = std::thread::hardware_concurrency();
+        if (count == 0) {
+            count = 1;
+        }
+    }
+
+    IoEngine engine = m_options.ioEngine;
+    std::string fallbackReason;
+#ifndef WT13106_HAVE_IO_URING
+    if (engine == IoEngine::IO_URING) {
+        engine = IoEngine::EPOLL;
+        fallbackReason = "built without io_uring support";
+    }
+#endif
+
+    for (size_t i = 0; i < count; ++i) {
+        std::unique_ptr<Loop> loop(new Loop());
+#ifdef WT13106_HAVE_IO_URING
+        if (engine == IoEngine::IO_URING) {
+            // Two entries arm a device; nextSqe() submits early when they run out
+            unsigned entries = static_cast<unsigned>(std::min<size_t>(m_options.ioUringBuffers * 2, 4096));
+            if (loop->ring.open(entries) &&
+                loop->ring.setupBuffers(kUringBufferGroup, static_cast<unsigned>(m_options.ioUringBuffers),
+                                        kUringBufferSize)) {
+                loop->engine = IoEngine::IO_URING;
+                loop->multishot = loop->ring.supports(IoUring::kOpReadMultishot);
+            } else {
+                // Unsupported kernel: every loop falls back, not just this one
+                fallbackReason = loop->ring.getLastError();
+                loop->ring.close();
+                for (auto& created : m_loops) {
+                    created->ring.close();
+                    created->engine = IoEngine::EPOLL;
+                }
+                engine = IoEngine::EPOLL;
+            }
+        }
+#endif
+        loop->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (loop->epollFd < 0 || loop->wakeFd < 0) {
+            if (loop->epollFd >= 0) {
+                close(loop->epollFd);
+            }
+            if (loop->wakeFd >= 0) {
+                close(loop->wakeFd);
+            }
+            setError("Failed to create epoll instance for event loop");
+            break;
+        }
+
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr;  // nullptr marks the wake-up eventfd
+        epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->wakeFd, &ev);
+
+        loop->readBuffer.resize(4096);
+        loop->events.resize(m_options.eventBatchSize);
+        m_loops.push_back(std::move(loop));
+    }
+
+    if (m_loops.size() != count) {
+        for (auto& loop : m_loops) {
+            close(loop->epollFd);
+            close(loop->wakeFd);
+        }
+        m_loops.clear();
+        return false;
+    }
+
+    for (auto& loop : m_loops) {
+        Loop* raw = loop.get();
+        if (raw->engine == IoEngine::IO_URING) {
+            loop->thread = std::thread([this, raw] { runUringLoop(*raw); });
+        } else {
+            loop->thread = std::thread([this, raw] { runLoop(*raw); });
+        }
+    }
+
+    // A fallback is not an error, but the reason is kept for the caller
+    setError(fallbackReason.empty() ? "" : "io_uring unavailable (" + fallbackReason + "); using epoll");
+    return true;
+}
+
+void ConnectionManager::stop()
+{
+    for (auto& loop : m_loops) {
+        loop->stopRequested = true;
+        uint64_t one = 1;
+        ssize_t ignored = write(loop->wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+
+    for (auto& loop : m_loops) {
+        if (loop->thread.joinable()) {
+            loop->thread.join();
+        }
+        close(loop->epollFd);
+        close(loop->wakeFd);
+    }
+
+    m_loops.clear();
+    m_deviceCount = 0;
+    std::lock_guard<std::mutex> registrationLock(m_registrationMutex);
+    m_registeredFds.clear();
+    m_registrations.clear();
+}
+
+int ConnectionManager::addConnection(WT13106Connection& connection, DeviceHandlers handlers)
+{
+    if (m_loops.empty()) {
+        setError("Connection manager not started");
+        return -1;
+    }
+
+    int fd = connection.getNativeHandle();
+    if (fd < 0) {
+        setError("Connection is not connected or has no pollable descriptor");
+        return -1;
+    }
+
+    if (connection.isStreaming()) {
+        setError("Connection is in streaming mode; it already has its own reader thread");
+        return -1;
+    }
+
+    // Claim the descriptor and pick the least loaded loop before locking
+    // any loop: the loop threads hold their mutex while running handlers
+    const int id = m_nextId.fetch_add(1);
+    Loop* target = nullptr;
+    {
+        std::lock_guard<std::mutex> registrationLock(m_registrationMutex);
+        if (m_registeredFds.emplace(fd, id).second) {
+            for (auto& loop : m_loops) {
+                if (!target || loop->load < target->load) {
+                    target = loop.get();
+                }
+            }
+            target->load++;
+            m_registrations[id].loop = target;
+        }
+    }
+    if (!target) {
+        setError("Connection is already registered");
+        return -1;
+    }
+
+    std::unique_ptr<Device> device(new Device());
+    device->id = id;
+    device->connection = &connection;
+    device->fd = fd;
+    device->handlers = std::move(handlers);
+    if (device->handlers.onFrame) {
+        device->decoder.setFrameHandler(device->handlers.onFrame);
+    }
+
+    // Serial and pty descriptors carry the data; any other descriptor only
+    // signals readiness (loopback's eventfd)
+    device->direct = isatty(fd) != 0;
+
+    std::lock_guard<std::recursive_mutex> loopLock(target->mutex);
+    if (target->engine == IoEngine::IO_URING) {
+        target->arming.push_back(device.get());
+    } else {
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.ptr = device.get();
+        if (epoll_ctl(target->epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            unregister(*target, fd, id);
+            setError("Failed to add connection to epoll");
+            return -1;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> registrationLock(m_registrationMutex);
+        m_registrations[id].device = device.get();
+    }
+    target->devices.push_back(std::move(device));
+    m_deviceCount++;
+    if (target->engine == IoEngine::IO_URING) {
+        wakeLoop(*target);
+    }
+    return id;
+}
+
+bool ConnectionManager::removeConnection(int deviceId)
+{
+    // Only the device's own loop is locked (a handler may be removing a
+    // device of another loop)
+    Loop* loop = nullptr;
+    {
+        std::lock_guard<std::mutex> registrationLock(m_registrationMutex);
+        auto found = m_registrations.find(deviceId);
+        if (found != m_registrations.end()) {
+            loop = found->second.loop;
+        }
+    }
+    if (!loop) {
+        return false;
+    }
+
+    std::lock_guard<std::recursive_mutex> loopLock(loop->mutex);
+    for (size_t i = 0; i < loop->devices.size(); ++i) {
+        if (loop->devices[i]->id != deviceId) {
+            continue;
+        }
+        Device* device = loop->devices[i].get();
+        if (loop->engine == IoEngine::EPOLL) {
+            epoll_ctl(loop->epollFd, EPOLL_CTL_DEL, device->fd, nullptr);
+        }
+        // Forget it before it can be freed, so send() no longer finds it
+        unregister(*loop, device->fd, deviceId);
+        device->removed = true;
+        loop->arming.erase(std::remove(loop->arming.begin(), loop->arming.end(), device), loop->arming.end());
+        {
+            std::lock_guard<std::mutex> sendLock(loop->sendMutex);
+            loop->sending.erase(std::remove(loop->sending.begin(), loop->sending.end(), device),
+                                loop->sending.end());
+        }
+        loop->retired.push_back(std::move(loop->devices[i]));
+        loop->devices[i] = std::move(loop->devices.back());
+        loop->devices.pop_back();
+        m_deviceCount--;
+        if (loop->engine == IoEngine::IO_URING) {
+            wakeLoop(*loop);  // To cancel the device's reads
+        }
+        return true;
+    }
+    return false;  // Removed by someone else in the meantime
+}
+
+void ConnectionManager::unregister(Loop& loop, int fd, int deviceId)
+{
+    std::lock_guard<std::mutex> registrationLock(m_registrationMutex);
+    if (m_registrations.erase(deviceId) == 0) {
+        return;
+    }
+    auto found = m_registeredFds.find(fd);
+    if (found != m_registeredFds.end() && found->second == deviceId) {
+        m_registeredFds.erase(found);
+    }
+    loop.load--;
+}
+
+bool ConnectionManager::send(int deviceId, const uint8_t* data, size_t length)
+{
+    if (data == nullptr || length == 0) {
+        setError("Command is empty");
+        return false;
+    }
+
+    // No loop mutex: the target loop may be busy in a handler that is itself
+    // sending to this caller's loop. The registration lock keeps the device
+    // from being freed while its queue is appended to.
+    Loop* loop = nullptr;
+    {
+        std::lock_guard<std::mutex> registrationLock(m_registrationMutex);
+        auto found = m_registrations.find(deviceId);
+        if (found != m_registrations.end() && found->second.device) {
+            loop = found->second.loop;
+            Device* device = found->second.device;
+            std::lock_guard<std::mutex> sendLock(loop->sendMutex);
+            device->incoming.insert(device->incoming.end(), data, data + length);
+            if (!device->sendScheduled) {
+                device->sendScheduled = true;
+                loop->sending.push_back(device);
+            }
+        }
+    }
+    if (!loop) {
+        setError("Device is not registered");
+        return false;
+    }
+    wakeLoop(*loop);
+    return true;
+}
+
+size_t ConnectionManager::connectionCount() const
+{
+    return m_deviceCount;
+}
+
+size_t ConnectionManager::loopCount() const
+{
+    return m_loops.size();
+}
+
+IoEngine ConnectionManager::activeIoEngine() const
+{
+    return m_loops.empty() ? m_options.ioEngine : m_loops.front()->engine;
+}
+
+ConnectionManagerStats ConnectionManager::getStats() const
+{
+    ConnectionManagerStats stats;
+    for (auto& loop : m_loops) {
+        stats.systemCalls += loop->systemCalls.load(std::memory_order_relaxed);
+        stats.wakeups += loop->wakeups.load(std::memory_order_relaxed);
+        stats.bytesReceived += loop->bytesReceived.load(std::memory_order_relaxed);
+        stats.bytesSent += loop->bytesSent.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+std::string ConnectionManager::getLastError() const
+{
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+    return m_lastError;
+}
+
+void ConnectionManager::setError(const std::string& message)
+{
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+    m_lastError = message;
+}
+
+void ConnectionManager::wakeLoop(Loop& loop)
+{
+    if (std::this_thread::get_id() == loop.thread.get_id()) {
+        return;  // From a handler: the loop looks at its lists before waiting again
+    }
+    if (!loop.wakePending.exchange(true)) {
+        uint64_t one = 1;
+        ssize_t ignored = write(loop.wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+void ConnectionManager::dropDevice(Device& device)
+{
+    int id = device.id;
+    auto onDisconnect = device.handlers.onDisconnect;
+    removeConnection(id);
+    if (onDisconnect) {
+        onDisconnect(id);
+    }
+}
+
+void ConnectionManager::runLoop(Loop& loop)
+{
+    std::vector<struct epoll_event> ready(m_options.maxEventsPerWait);
+
+    while (!loop.stopRequested) {
+        int count = epoll_wait(loop.epollFd, ready.data(), static_cast<int>(ready.size()), -1);
+        ConnectionMetrics::add(loop.systemCalls);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        ConnectionMetrics::add(loop.wakeups);
+
+        std::lock_guard<std::recursive_mutex> lock(loop.mutex);
+        for (int i = 0; i < count; ++i) {
+            Device* device = static_cast<Device*>(ready[i].data.ptr);
+            if (device == nullptr) {
+                uint64_t value;
+                ssize_t ignored = read(loop.wakeFd, &value, sizeof(value));
+                (void)ignored;
+                ConnectionMetrics::add(loop.systemCalls);
+                loop.wakePending = false;
+                continue;
+            }
+            if (device->removed) {
+                continue;  // Unregistered after epoll_wait returned
+            }
+
+            if (ready[i].events & EPOLLOUT) {
+                std::lock_guard<std::mutex> sendLock(loop.sendMutex);
+                if (!device->sendScheduled) {
+                    device->sendScheduled = true;
+                    loop.sending.push_back(device);
+                }
+            }
+            if (!(ready[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                continue;
+            }
+
+            bool alive = serviceDevice(loop, *device);
+            if (device->removed) {
+                continue;  // A handler unregistered it
+            }
+            if (!alive || (ready[i].events & (EPOLLHUP | EPOLLERR))) {
+                dropDevice(*device);
+            }
+        }
+        flushSends(loop);
+        loop.retired.clear();
+    }
+}
+
+void ConnectionManager::runUringLoop(Loop& loop)
+{
+#ifdef WT13106_HAVE_IO_URING
+    IoUring& ring = loop.ring;
+    if (!ring.enable()) {
+        setError(ring.getLastError());
+        return;
+    }
+
+    bool wakeArmed = false;
+
+    auto arm = [&](Device& device) {
+        armDevice(ring, loop.multishot, loop.systemCalls, &device, device.fd, device.direct, device.inFlight);
+    };
+
+    auto submitWrite = [&](Device& device) {
+        struct io_uring_sqe* sqe = nextSqe(ring, loop.systemCalls);
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = device.fd;
+        sqe->addr = reinterpret_cast<uint64_t>(device.writing.data() + device.written);
+        sqe->len = static_cast<uint32_t>(device.writing.size() - device.written);
+        sqe->off = static_cast<uint64_t>(-1);  // Current position (a tty has none)
+        sqe->user_data = userData(&device, kOpWrite);
+        ++device.inFlight;
+    };
+
+    auto startWrite = [&](Device& device) {
+        device.writing.swap(device.sendQueue);
+        device.sendQueue.clear();
+        device.written = 0;
+        submitWrite(device);
+    };
+
+    auto cancel = [&](Device& device) {
+        const uint64_t ops[] = {kOpPoll, kOpRead, kOpWrite};
+        for (uint64_t op : ops) {
+            struct io_uring_sqe* sqe = nextSqe(ring, loop.systemCalls);
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->addr = userData(&device, op);
+            sqe->user_data = kOpCancel;
+        }
+        device.cancelled = true;
+    };
+
+    auto completeRead = [&](Device& device, const struct io_uring_cqe& cqe) {
+        if (cqe.flags & IORING_CQE_F_BUFFER) {
+            uint16_t bufferId = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            if (cqe.res > 0 && !device.removed) {
+                const uint8_t* data = ring.buffer(bufferId);
+                ConnectionMetrics::add(loop.bytesReceived, static_cast<uint64_t>(cqe.res));
+                device.connection->recordExternalRead(data, static_cast<size_t>(cqe.res));
+                dispatchBytes(loop, device, data, static_cast<size_t>(cqe.res));
+            }
+            ring.recycleBuffer(bufferId);
+        }
+        if ((cqe.flags & IORING_CQE_F_MORE) || device.removed) {
+            return;
+        }
+        // The read ended: a single-shot read finished, buffers ran out
+        // (they are back by the next submit), or the tty hung up. An empty
+        // read without a hang-up is a tty with VMIN = 0 that had nothing.
+        if (cqe.res > 0 || cqe.res == -ENOBUFS || cqe.res == -EAGAIN || cqe.res == -EINTR ||
+            (cqe.res == 0 && !device.hungUp)) {
+            arm(device);
+        } else {
+            dropDevice(device);
+        }
+    };
+
+    auto completePoll = [&](Device& device, const struct io_uring_cqe& cqe) {
+        if (cqe.res < 0 || device.removed) {
+            return;  // Cancelled; for a tty the linked read reports why
+        }
+        if (cqe.res & (POLLHUP | POLLERR)) {
+            device.hungUp = true;
+        }
+        if (device.direct) {
+            return;
+        }
+        bool alive = serviceDevice(loop, device);
+        if (device.removed) {
+            return;
+        }
+        if (!alive || device.hungUp) {
+            dropDevice(device);
+        } else {
+            arm(device);
+        }
+    };
+
+    auto completeWrite = [&](Device& device, const struct io_uring_cqe& cqe) {
+        if (cqe.res > 0) {
+            device.written += static_cast<size_t>(cqe.res);
+            ConnectionMetrics::add(loop.bytesSent, static_cast<uint64_t>(cqe.res));
+            device.connection->recordExternalWrite(static_cast<size_t>(cqe.res));
+        } else if (cqe.res != -EAGAIN && cqe.res != -EINTR) {
+            device.written = device.writing.size();  // Failed; the read side notices a dead port
+        }
+        if (device.removed) {
+            return;
+        }
+        if (device.written < device.writing.size()) {
+            submitWrite(device);
+        } else if (!device.sendQueue.empty()) {
+            startWrite(device);
+        } else {
+            device.writing.clear();
+        }
+    };
+
+    while (!loop.stopRequested) {
+        {
+            std::lock_guard<std::recursive_mutex> lock(loop.mutex);
+            if (!wakeArmed) {
+                struct io_uring_sqe* sqe = nextSqe(ring, loop.systemCalls);
+                sqe->opcode = IORING_OP_READ;
+                sqe->fd = loop.wakeFd;
+                sqe->addr = reinterpret_cast<uint64_t>(&loop.wakeValue);
+                sqe->len = sizeof(loop.wakeValue);
+                sqe->user_data = userData(nullptr, kOpRead);
+                wakeArmed = true;
+            }
+            for (Device* device : loop.arming) {
+                arm(*device);
+            }
+            loop.arming.clear();
+
+            takeSends(loop);
+            for (Device* device : loop.flushing) {
+                if (!device->direct) {
+                    // No ring write for an eventfd; the connection's own path
+                    device->connection->sendCommand(device->sendQueue.data(), device->sendQueue.size());
+                    ConnectionMetrics::add(loop.systemCalls);
+                    ConnectionMetrics::add(loop.bytesSent, device->sendQueue.size());
+                    device->sendQueue.clear();
+                } else if (device->writing.empty()) {
+                    startWrite(*device);
+                }  // Else queued behind the write in flight
+            }
+            loop.flushing.clear();
+
+            // Removed devices stay allocated until their last completion
+            for (size_t i = 0; i < loop.retired.size();) {
+                Device* device = loop.retired[i].get();
+                if (device->inFlight == 0) {
+                    loop.retired[i] = std::move(loop.retired.back());
+                    loop.retired.pop_back();
+                    continue;
+                }
+                if (!device->cancelled) {
+                    cancel(*device);
+                }
+                ++i;
+            }
+        }
+
+        int result = ring.submitAndWait(1);
+        ConnectionMetrics::add(loop.systemCalls);
+        if (result < 0 && result != -EINTR && result != -EBUSY && result != -EAGAIN) {
+            setError("io_uring_enter failed: " + std::to_string(-result));
+            break;
+        }
+        ConnectionMetrics::add(loop.wakeups);
+
+        std::lock_guard<std::recursive_mutex> lock(loop.mutex);
+        ring.forEachCompletion([&](const struct io_uring_cqe& cqe) {
+            uint64_t op = cqe.user_data & kOpMask;
+            Device* device = reinterpret_cast<Device*>(cqe.user_data & ~kOpMask);
+            if (op == kOpCancel) {
+                return;
+            }
+            if (device == nullptr) {
+                loop.wakePending = false;  // Anything it announced is picked up before the next submit
+                wakeArmed = false;
+                return;
+            }
+            if (!(cqe.flags & IORING_CQE_F_MORE)) {
+                --device->inFlight;
+            }
+            if (op == kOpRead) {
+                completeRead(*device, cqe);
+            } else if (op == kOpPoll) {
+                completePoll(*device, cqe);
+            } else {
+                completeWrite(*device, cqe);
+            }
+        });
+    }
+
+    // Cancel whatever is still in flight and wait for it, so that no
+    // completion lands in a buffer or device freed by stop()
+    std::lock_guard<std::recursive_mutex> lock(loop.mutex);
+    unsigned pending = wakeArmed ? 1 : 0;
+    if (wakeArmed) {
+        struct io_uring_sqe* sqe = nextSqe(ring, loop.systemCalls);
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = userData(nullptr, kOpRead);
+        sqe->user_data = kOpCancel;
+    }
+    for (auto* list : {&loop.devices, &loop.retired}) {
+        for (auto& device : *list) {
+            if (device->inFlight > 0) {
+                cancel(*device);
+                pending += device->inFlight;
+            }
+        }
+    }
+    while (pending > 0) {
+        int result = ring.submitAndWait(1);
+        if (result < 0 && result != -EINTR && result != -EBUSY && result != -EAGAIN) {
+            break;  // Nothing sensible left to do; closing the ring cancels the rest
+        }
+        ring.forEachCompletion([&](const struct io_uring_cqe& cqe) {
+            Device* device = reinterpret_cast<Device*>(cqe.user_data & ~kOpMask);
+            if ((cqe.user_data & kOpMask) == kOpCancel || (cqe.flags & IORING_CQE_F_MORE)) {
+                return;
+            }
+            if (device != nullptr) {
+                --device->inFlight;
+            }
+            --pending;
+        });
+    }
+#else
+    (void)loop;
+#endif
+}
+
+bool ConnectionManager::serviceDevice(Loop& loop, Device& device)
+{
+    for (int reads = 0; reads < kMaxReadsPerWakeup; ++reads) {
+        size_t bytesRead = device.connection->receiveInto(loop.readBuffer.data(), loop.readBuffer.size(), 0);
+        ConnectionMetrics::add(loop.systemCalls);
+        if (bytesRead == 0) {
+            return device.connection->getLastError().empty();
+        }
+        ConnectionMetrics::add(loop.bytesReceived, bytesRead);
+
+        dispatchBytes(loop, device, loop.readBuffer.data(), bytesRead);
+        if (device.removed) {
+            return true;
+        }
+
+        if (bytesRead < loop.readBuffer.size()) {
+            break;  // Short read: the port is drained
+        }
+    }
+    return true;
+}
+
+void ConnectionManager::dispatchBytes(Loop& loop, Device& device, const uint8_t* data, size_t length)
+{
+    uint64_t timestampNs = steadyNowNs();
+    size_t offset = 0;
+    while (offset < length) {
+        size_t produced = 0;
+        offset += device.decoder.decode(data + offset, length - offset, timestampNs, loop.events.data(),
+                                        loop.events.size(), produced);
+        if (produced > 0 && device.handlers.onEvents) {
+            device.handlers.onEvents(device.id, loop.events.data(), produced);
+            if (device.removed) {
+                return;
+            }
+        }
+    }
+}
+
+void ConnectionManager::takeSends(Loop& loop)
+{
+    std::lock_guard<std::mutex> sendLock(loop.sendMutex);
+    loop.flushing.swap(loop.sending);
+    for (Device* device : loop.flushing) {
+        device->sendScheduled = false;
+        if (device->sendQueue.empty()) {
+            device->sendQueue.swap(device->incoming);
+        } else {
+            device->sendQueue.insert(device->sendQueue.end(), device->incoming.begin(), device->incoming.end());
+            device->incoming.clear();
+        }
+    }
+}
+
+void ConnectionManager::flushSends(Loop& loop)
+{
+    takeSends(loop);
+    for (Device* device : loop.flushing) {
+        if (!device->direct) {
+            device->connection->sendCommand(device->sendQueue.data(), device->sendQueue.size());
+            ConnectionMetrics::add(loop.systemCalls);
+            ConnectionMetrics::add(loop.bytesSent, device->sendQueue.size());
+            device->sendQueue.clear();
+            continue;
+        }
+
+        // Write without blocking the loop; what the tty cannot take now
+        // waits for EPOLLOUT
+        bool blocked = false;
+        while (!blocked) {
+            if (device->written == device->writing.size()) {
+                device->writing.clear();
+                device->written = 0;
+                if (device->sendQueue.empty()) {
+                    break;
+                }
+                device->writing.swap(device->sendQueue);
+            }
+            ssize_t written = write(device->fd, device->writing.data() + device->written,
+                                    device->writing.size() - device->written);
+            ConnectionMetrics::add(loop.systemCalls);
+            if (written > 0) {
+                device->written += static_cast<size_t>(written);
+                ConnectionMetrics::add(loop.bytesSent, static_cast<uint64_t>(written));
+                device->connection->recordExternalWrite(static_cast<size_t>(written));
+            } else if (written < 0 && errno == EAGAIN) {
+                blocked = true;
+            } else if (written < 0 && errno != EINTR) {
+                device->written = device->writing.size();  // Failed; the read side notices a dead port
+            }
+        }
+
+        if (blocked != device->waitingWritable) {
+            struct epoll_event ev = {};
+            ev.events = EPOLLIN;
+            if (blocked) {
+                ev.events |= EPOLLOUT;
+            }
+            ev.data.ptr = device;
+            epoll_ctl(loop.epollFd, EPOLL_CTL_MOD, device->fd, &ev);
+            ConnectionMetrics::add(loop.systemCalls);
+            device->waitingWritable = blocked;
+        }
+    }
+    loop.flushing.clear();
+}
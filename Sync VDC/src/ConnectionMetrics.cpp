@@ -0,0 +1,235 @@
+#include "../include/ConnectionMetrics.h"
+
+#include <cstdarg>
+#include <cstdio>
+
+namespace {
+
+const double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+const char* const kQuantileNames[] = {"0.5", "0.9", "0.99", "0.999"};
+const char* const kQuantileKeys[] = {"p50", "p90", "p99", "p999"};
+
+void appendf(std::string& out, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    va_list copy;
+    va_copy(copy, args);
+    int n = std::vsnprintf(nullptr, 0, format, copy);
+    va_end(copy);
+    if (n > 0) {
+        size_t offset = out.size();
+        out.resize(offset + static_cast<size_t>(n) + 1);
+        std::vsnprintf(&out[offset], static_cast<size_t>(n) + 1, format, args);
+        out.resize(offset + static_cast<size_t>(n));
+    }
+    va_end(args);
+}
+
+struct CounterField {
+    const char* name;
+    const char* help;
+    uint64_t ConnectionMetricsSnapshot::*field;
+};
+
+const CounterField kCounters[] = {
+    {"bytes_in", "Bytes received from the device", &ConnectionMetricsSnapshot::bytesIn},
+    {"bytes_out", "Bytes sent to the device", &ConnectionMetricsSnapshot::bytesOut},
+    {"frames_in", "Frames decoded from the device", &ConnectionMetricsSnapshot::framesIn},
+    {"frames_out", "Commands fully written to the device", &ConnectionMetricsSnapshot::framesOut},
+    {"frame_errors", "Frames rejected by the decoder", &ConnectionMetricsSnapshot::frameErrors},
+    {"read_calls", "Read system calls issued", &ConnectionMetricsSnapshot::readCalls},
+    {"write_calls", "Write system calls issued", &ConnectionMetricsSnapshot::writeCalls},
+    {"empty_reads", "Reads that returned no data", &ConnectionMetricsSnapshot::emptyReads},
+    {"timeouts", "Receive calls that reached their deadline", &ConnectionMetricsSnapshot::timeouts},
+    {"partial_writes", "Writes that sent fewer bytes than requested", &ConnectionMetricsSnapshot::partialWrites},
+    {"ring_overflows", "Chunks that overflowed the streaming ring", &ConnectionMetricsSnapshot::ringOverflows},
+    {"ring_dropped_bytes", "Bytes dropped by the streaming ring", &ConnectionMetricsSnapshot::ringDroppedBytes},
+};
+
+void appendSummaryText(std::string& out, const char* name, const char* help,
+                       const HistogramSnapshot& histogram, const std::string& labels)
+{
+    appendf(out, "# HELP wt13106_%s %s\n", name, help);
+    appendf(out, "# TYPE wt13106_%s summary\n", name);
+    for (size_t i = 0; i < sizeof(kQuantiles) / sizeof(kQuantiles[0]); ++i) {
+        appendf(out, "wt13106_%s{%s%squantile=\"%s\"} %llu\n", name, labels.c_str(),
+                labels.empty() ? "" : ",", kQuantileNames[i],
+                static_cast<unsigned long long>(histogram.valueAtPercentile(kQuantiles[i])));
+    }
+    appendf(out, "wt13106_%s_sum%s%s%s %llu\n", name, labels.empty() ? "" : "{", labels.c_str(),
+            labels.empty() ? "" : "}", static_cast<unsigned long long>(histogram.sum));
+    appendf(out, "wt13106_%s_count%s%s%s %llu\n", name, labels.empty() ? "" : "{", labels.c_str(),
+            labels.empty() ? "" : "}", static_cast<unsigned long long>(histogram.count));
+}
+
+void appendSummaryJson(std::string& out, const char* name, const HistogramSnapshot& histogram)
+{
+    appendf(out, "\"%s\":{\"count\":%llu,\"mean\":%.1f,\"max\":%llu", name,
+            static_cast<unsigned long long>(histogram.count), histogram.mean(),
+            static_cast<unsigned long long>(histogram.max));
+    for (size_t i = 0; i < sizeof(kQuantiles) / sizeof(kQuantiles[0]); ++i) {
+        appendf(out, ",\"%s\":%llu", kQuantileKeys[i],
+                static_cast<unsigned long long>(histogram.valueAtPercentile(kQuantiles[i])));
+    }
+    out += '}';
+}
+
+std::string escapeLabel(const std::string& value)
+{
+    std::string escaped;
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+        }
+        escaped += c == '\n' ? ' ' : c;
+    }
+    return escaped;
+}
+
+} // namespace
+
+uint64_t HistogramSnapshot::valueAtPercentile(double fraction) const
+{
+    if (count == 0) {
+        return 0;
+    }
+    if (fraction >= 1.0) {
+        return max;
+    }
+
+    uint64_t target = static_cast<uint64_t>(fraction * count) + 1;
+    if (target > count) {
+        target = count;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= target) {
+            uint64_t value = LatencyHistogram::bucketValue(i);
+            return value < max ? value : max;
+        }
+    }
+    return max;
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const
+{
+    HistogramSnapshot result;
+    result.buckets.resize(BUCKET_COUNT);
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        result.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+        total += result.buckets[i];
+    }
+    // Use the bucket total so percentiles stay consistent with the buckets
+    // even if record() ran concurrently
+    result.count = total;
+    result.sum = m_sum.load(std::memory_order_relaxed);
+    result.max = m_max.load(std::memory_order_relaxed);
+    return result;
+}
+
+void LatencyHistogram::reset()
+{
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        m_buckets[i].store(0, std::memory_order_relaxed);
+    }
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::bucketValue(size_t index)
+{
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    int shift = static_cast<int>(index / SUB_BUCKET_COUNT) - 1;
+    uint64_t lower = (SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT) << shift;
+    return lower + ((uint64_t(1) << shift) >> 1);
+}
+
+ConnectionMetrics::ConnectionMetrics()
+    : m_enabled(false)
+{
+    reset();
+}
+
+ConnectionMetricsSnapshot ConnectionMetrics::snapshot() const
+{
+    ConnectionMetricsSnapshot result;
+    result.bytesIn = bytesIn.load(std::memory_order_relaxed);
+    result.bytesOut = bytesOut.load(std::memory_order_relaxed);
+    result.framesIn = framesIn.load(std::memory_order_relaxed);
+    result.framesOut = framesOut.load(std::memory_order_relaxed);
+    result.frameErrors = frameErrors.load(std::memory_order_relaxed);
+    result.readCalls = readCalls.load(std::memory_order_relaxed);
+    result.writeCalls = writeCalls.load(std::memory_order_relaxed);
+    result.emptyReads = emptyReads.load(std::memory_order_relaxed);
+    result.timeouts = timeouts.load(std::memory_order_relaxed);
+    result.partialWrites = partialWrites.load(std::memory_order_relaxed);
+    result.ringOverflows = ringOverflows.load(std::memory_order_relaxed);
+    result.ringDroppedBytes = ringDroppedBytes.load(std::memory_order_relaxed);
+    result.receiveWait = receiveWait.snapshot();
+    result.readLatency = readLatency.snapshot();
+    result.interFrameGap = interFrameGap.snapshot();
+    return result;
+}
+
+void ConnectionMetrics::reset()
+{
+    std::atomic<uint64_t>* counters[] = {
+        &bytesIn, &bytesOut, &framesIn, &framesOut, &frameErrors, &readCalls,
+        &writeCalls, &emptyReads, &timeouts, &partialWrites, &ringOverflows, &ringDroppedBytes,
+    };
+    for (auto* counter : counters) {
+        counter->store(0, std::memory_order_relaxed);
+    }
+    receiveWait.reset();
+    readLatency.reset();
+    interFrameGap.reset();
+}
+
+std::string ConnectionMetricsSnapshot::toText(const std::string& connectionLabel) const
+{
+    std::string labels;
+    if (!connectionLabel.empty()) {
+        labels = "connection=\"" + escapeLabel(connectionLabel) + "\"";
+    }
+
+    std::string out;
+    out.reserve(4096);
+    for (const CounterField& counter : kCounters) {
+        appendf(out, "# HELP wt13106_%s_total %s\n", counter.name, counter.help);
+        appendf(out, "# TYPE wt13106_%s_total counter\n", counter.name);
+        appendf(out, "wt13106_%s_total%s%s%s %llu\n", counter.name, labels.empty() ? "" : "{",
+                labels.c_str(), labels.empty() ? "" : "}",
+                static_cast<unsigned long long>(this->*counter.field));
+    }
+    appendSummaryText(out, "receive_wait_ns", "Time receive and pop calls waited for data (not device read latency)", receiveWait, labels);
+    appendSummaryText(out, "read_latency_ns", "Data ready at the port until handed to the application", readLatency, labels);
+    appendSummaryText(out, "inter_frame_gap_ns", "Gap between consecutive pen events", interFrameGap, labels);
+    return out;
+}
+
+std::string ConnectionMetricsSnapshot::toJson() const
+{
+    std::string out;
+    out.reserve(1024);
+    out += '{';
+    for (const CounterField& counter : kCounters) {
+        appendf(out, "\"%s\":%llu,", counter.name, static_cast<unsigned long long>(this->*counter.field));
+    }
+    appendSummaryJson(out, "receive_wait_ns", receiveWait);
+    out += ',';
+    appendSummaryJson(out, "read_latency_ns", readLatency);
+    out += ',';
+    appendSummaryJson(out, "inter_frame_gap_ns", interFrameGap);
+    out += '}';
+    return out;
+}
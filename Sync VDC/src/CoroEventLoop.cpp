@@ -0,0 +1,481 @@
+#include "../include/CoroEventLoop.h"
+#include "../include/WT13106Connection.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <functional>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace {
+
+const uint32_t kWakeId = UINT32_MAX;
+
+uint64_t steadyNowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Heap order for EventLoop timers (earliest due first)
+const auto timerAfter = [](const auto& a, const auto& b) { return a.dueNs > b.dueNs; };
+
+} // namespace
+
+void coro_detail::detachedTaskFinished(EventLoop* loop, const std::exception_ptr& exception) noexcept
+{
+    if (exception) {
+        // Nobody awaits a spawned task, so there is nowhere to rethrow to
+        std::terminate();
+    }
+    --loop->m_liveTasks;
+}
+
+EventLoop::EventLoop()
+    : m_epollFd(-1)
+    , m_wakeFd(-1)
+    , m_stopRequested(false)
+    , m_liveTasks(0)
+{
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_epollFd < 0 || m_wakeFd < 0) {
+        m_lastError = std::string("Failed to create event loop: ") + std::strerror(errno);
+        if (m_epollFd >= 0) {
+            ::close(m_epollFd);
+            m_epollFd = -1;
+        }
+        return;
+    }
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u32 = kWakeId;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &event);
+}
+
+EventLoop::~EventLoop()
+{
+    if (m_epollFd >= 0) {
+        ::close(m_epollFd);
+    }
+    if (m_wakeFd >= 0) {
+        ::close(m_wakeFd);
+    }
+}
+
+void EventLoop::spawn(Task<void> task)
+{
+    auto handle = task.release();
+    if (!handle) {
+        return;
+    }
+    handle.promise().detachedLoop = this;
+    ++m_liveTasks;
+    schedule(handle);
+}
+
+void EventLoop::run()
+{
+    if (!isValid()) {
+        return;
+    }
+
+    m_stopRequested.store(false, std::memory_order_relaxed);
+    epoll_event events[64];
+
+    while (!m_stopRequested.load(std::memory_order_relaxed)) {
+        runReady();
+        if (m_liveTasks == 0) {
+            break;
+        }
+
+        int timeoutMs = -1;
+        if (!m_timers.empty()) {
+            uint64_t now = steadyNowNs();
+            uint64_t due = m_timers.front().dueNs;
+            // Round up so timers never fire early
+            uint64_t waitMs = due > now ? (due - now + 999999) / 1000000 : 0;
+            timeoutMs = static_cast<int>(std::min<uint64_t>(waitMs, INT_MAX));
+        }
+
+        int count = epoll_wait(m_epollFd, events, 64, timeoutMs);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            m_lastError = std::string("epoll_wait failed: ") + std::strerror(errno);
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            uint32_t id = events[i].data.u32;
+            if (id == kWakeId) {
+                uint64_t value;
+                while (::read(m_wakeFd, &value, sizeof(value)) > 0) {
+                }
+                continue;
+            }
+            AsyncConnection* connection = id < m_connections.size() ? m_connections[id] : nullptr;
+            if (!connection) {
+                continue;
+            }
+            if (events[i].events & EPOLLOUT) {
+                connection->onWritable();
+            }
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                connection->onReadable();
+            }
+        }
+
+        fireTimers(steadyNowNs());
+    }
+}
+
+void EventLoop::stop()
+{
+    m_stopRequested.store(true, std::memory_order_relaxed);
+    if (m_wakeFd >= 0) {
+        uint64_t one = 1;
+        ssize_t written = ::write(m_wakeFd, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+bool EventLoop::SleepAwaiter::await_ready() const noexcept
+{
+    return dueNs <= steadyNowNs();
+}
+
+EventLoop::SleepAwaiter EventLoop::sleepFor(std::chrono::nanoseconds duration)
+{
+    return SleepAwaiter{*this, steadyNowNs() + static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0))};
+}
+
+void EventLoop::addTimer(uint64_t dueNs, std::coroutine_handle<> handle, int connectionId)
+{
+    m_timers.push_back(Timer{dueNs, handle, connectionId});
+    std::push_heap(m_timers.begin(), m_timers.end(), timerAfter);
+}
+
+void EventLoop::runReady()
+{
+    // Resuming may schedule more coroutines; keep going until nothing is ready
+    while (!m_ready.empty()) {
+        m_running.swap(m_ready);
+        for (std::coroutine_handle<> handle : m_running) {
+            handle.resume();
+        }
+        m_running.clear();
+    }
+}
+
+void EventLoop::fireTimers(uint64_t nowNs)
+{
+    while (!m_timers.empty() && m_timers.front().dueNs <= nowNs) {
+        std::pop_heap(m_timers.begin(), m_timers.end(), timerAfter);
+        Timer timer = m_timers.back();
+        m_timers.pop_back();
+
+        if (timer.handle) {
+            schedule(timer.handle);
+        } else if (timer.connectionId >= 0 && static_cast<size_t>(timer.connectionId) < m_connections.size() &&
+                   m_connections[timer.connectionId]) {
+            // A request may have timed out; decoding runs the expiry check.
+            // Stale timers (request already answered) find nothing to do.
+            m_connections[timer.connectionId]->onReadable();
+        }
+    }
+}
+
+int EventLoop::attach(AsyncConnection* connection, int fd)
+{
+    int id;
+    if (!m_freeIds.empty()) {
+        id = m_freeIds.back();
+        m_freeIds.pop_back();
+    } else {
+        id = static_cast<int>(m_connections.size());
+        m_connections.push_back(nullptr);
+    }
+
+    epoll_event event = {};
+    event.events = EPOLLIN;  // Level-triggered: onReadable() drains the port anyway
+    event.data.u32 = static_cast<uint32_t>(id);
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        m_lastError = std::string("Failed to watch connection: ") + std::strerror(errno);
+        m_freeIds.push_back(id);
+        return -1;
+    }
+    m_connections[id] = connection;
+    return id;
+}
+
+void EventLoop::unwatch(int fd)
+{
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+void EventLoop::detach(int id, int fd)
+{
+    if (id < 0 || static_cast<size_t>(id) >= m_connections.size() || !m_connections[id]) {
+        return;
+    }
+    if (fd >= 0) {
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+    m_connections[id] = nullptr;
+    m_freeIds.push_back(id);
+}
+
+bool EventLoop::setWriteInterest(int id, int fd, bool enabled)
+{
+    epoll_event event = {};
+    event.events = static_cast<uint32_t>(enabled ? (EPOLLIN | EPOLLOUT) : EPOLLIN);
+    event.data.u32 = static_cast<uint32_t>(id);
+    return epoll_ctl(m_epollFd, EPOLL_CTL_MOD, fd, &event) == 0;
+}
+
+AsyncConnection::AsyncConnection(EventLoop& loop, WT13106Connection& connection)
+    : m_loop(loop)
+    , m_connection(connection)
+    , m_fd(-1)
+    , m_id(-1)
+    , m_closed(false)
+    , m_writeInterest(false)
+    , m_droppedEvents(0)
+    , m_bufferedHead(0)
+    , m_readersHead(nullptr)
+    , m_readersTail(nullptr)
+    , m_sendersHead(nullptr)
+    , m_sendersTail(nullptr)
+{
+    if (!loop.isValid()) {
+        m_lastError = loop.getLastError();
+        return;
+    }
+    if (connection.isStreaming()) {
+        m_lastError = "Connection is in streaming mode";
+        return;
+    }
+    m_fd = connection.getNativeHandle();
+    if (m_fd < 0) {
+        m_lastError = "Connection has no pollable descriptor (not connected, or the transport has none)";
+        return;
+    }
+
+    // The loop must never sit in a blocking write; unsent bytes wait in the send queue
+    SendOptions sendOptions = connection.getSendOptions();
+    sendOptions.writeTimeoutMs = 0;
+    connection.setSendOptions(sendOptions);
+
+    m_buffered.reserve(MAX_BUFFERED_EVENTS);
+    m_id = loop.attach(this, m_fd);
+    if (m_id < 0) {
+        m_lastError = loop.getLastError();
+    }
+}
+
+AsyncConnection::~AsyncConnection()
+{
+    if (m_id >= 0) {
+        m_loop.detach(m_id, m_closed ? -1 : m_fd);
+    }
+}
+
+void AsyncConnection::onReadable()
+{
+    for (;;) {
+        // Decode straight into the first waiting read when nothing is buffered
+        bool direct = m_readersHead && m_bufferedHead == m_buffered.size();
+        StylusEvent* out = direct ? m_readersHead->events : m_scratch;
+        size_t capacity = direct ? m_readersHead->capacity : sizeof(m_scratch) / sizeof(m_scratch[0]);
+
+        size_t count = m_connection.receiveEvents(out, capacity, 0);
+        if (count == 0) {
+            // receiveEvents() reports a timeout with an empty error
+            if (!m_closed && !m_connection.getLastError().empty()) {
+                m_lastError = m_connection.getLastError();
+                close();
+            }
+            break;
+        }
+
+        if (direct) {
+            ReadAwaiter* reader = m_readersHead;
+            m_readersHead = reader->next;
+            if (!m_readersHead) {
+                m_readersTail = nullptr;
+            }
+            reader->result = count;
+            m_loop.schedule(reader->handle);
+            continue;
+        }
+
+        if (m_bufferedHead == m_buffered.size()) {
+            m_buffered.clear();
+            m_bufferedHead = 0;
+        }
+        size_t room = MAX_BUFFERED_EVENTS - (m_buffered.size() - m_bufferedHead);
+        if (count > room) {
+            // Keep the newest events; a session that does not read loses the oldest
+            size_t drop = std::min(count - room, m_buffered.size() - m_bufferedHead);
+            m_bufferedHead += drop;
+            m_droppedEvents += drop;
+            if (m_bufferedHead > 0) {
+                m_buffered.erase(m_buffered.begin(), m_buffered.begin() + m_bufferedHead);
+                m_bufferedHead = 0;
+            }
+        }
+        m_buffered.insert(m_buffered.end(), out, out + count);
+        serveReaders();
+    }
+}
+
+void AsyncConnection::serveReaders()
+{
+    while (m_readersHead && m_bufferedHead < m_buffered.size()) {
+        ReadAwaiter* reader = m_readersHead;
+        m_readersHead = reader->next;
+        if (!m_readersHead) {
+            m_readersTail = nullptr;
+        }
+        size_t count = std::min(reader->capacity, m_buffered.size() - m_bufferedHead);
+        std::copy(m_buffered.begin() + m_bufferedHead, m_buffered.begin() + m_bufferedHead + count, reader->events);
+        m_bufferedHead += count;
+        reader->result = count;
+        m_loop.schedule(reader->handle);
+    }
+}
+
+void AsyncConnection::onWritable()
+{
+    bool ok = m_connection.flush();
+    if (m_connection.pendingSendBytes() > 0) {
+        return;  // Port filled up again; wait for the next EPOLLOUT
+    }
+
+    while (m_sendersHead) {
+        SendAwaiter* sender = m_sendersHead;
+        m_sendersHead = sender->next;
+        sender->result = ok;
+        m_loop.schedule(sender->handle);
+    }
+    m_sendersTail = nullptr;
+    updateWriteInterest();
+}
+
+void AsyncConnection::updateWriteInterest()
+{
+    bool wanted = !m_closed && m_connection.pendingSendBytes() > 0;
+    if (wanted != m_writeInterest && m_loop.setWriteInterest(m_id, m_fd, wanted)) {
+        m_writeInterest = wanted;
+    }
+}
+
+void AsyncConnection::close()
+{
+    // Stop watching the dead descriptor but keep the ID, so request timers
+    // still reach onReadable() and expire outstanding requests
+    m_closed = true;
+    m_loop.unwatch(m_fd);
+
+    while (m_readersHead) {
+        ReadAwaiter* reader = m_readersHead;
+        m_readersHead = reader->next;
+        reader->result = 0;
+        m_loop.schedule(reader->handle);
+    }
+    m_readersTail = nullptr;
+    while (m_sendersHead) {
+        SendAwaiter* sender = m_sendersHead;
+        m_sendersHead = sender->next;
+        sender->result = false;
+        m_loop.schedule(sender->handle);
+    }
+    m_sendersTail = nullptr;
+}
+
+bool AsyncConnection::ReadAwaiter::await_ready()
+{
+    if (connection.m_bufferedHead < connection.m_buffered.size()) {
+        size_t count = std::min(capacity, connection.m_buffered.size() - connection.m_bufferedHead);
+        auto first = connection.m_buffered.begin() + connection.m_bufferedHead;
+        std::copy(first, first + count, events);
+        connection.m_bufferedHead += count;
+        result = count;
+        return true;
+    }
+    return connection.m_closed || capacity == 0;
+}
+
+void AsyncConnection::ReadAwaiter::await_suspend(std::coroutine_handle<> awaiting)
+{
+    handle = awaiting;
+    if (connection.m_readersTail) {
+        connection.m_readersTail->next = this;
+    } else {
+        connection.m_readersHead = this;
+    }
+    connection.m_readersTail = this;
+}
+
+bool AsyncConnection::SendAwaiter::await_ready()
+{
+    if (connection.m_closed) {
+        return true;
+    }
+    result = connection.m_connection.sendCommand(data, length);
+    if (result || connection.m_connection.pendingSendBytes() == 0) {
+        return true;
+    }
+    // The port took only part of it; the rest is queued and goes out when writable
+    return false;
+}
+
+void AsyncConnection::SendAwaiter::await_suspend(std::coroutine_handle<> awaiting)
+{
+    handle = awaiting;
+    if (connection.m_sendersTail) {
+        connection.m_sendersTail->next = this;
+    } else {
+        connection.m_sendersHead = this;
+    }
+    connection.m_sendersTail = this;
+    connection.updateWriteInterest();
+}
+
+bool AsyncConnection::RequestAwaiter::await_suspend(std::coroutine_handle<> awaiting)
+{
+    handle = awaiting;
+    if (connection.m_closed) {
+        response.status = ResponseStatus::DISCONNECTED;
+        return false;
+    }
+
+    // The callback fits std::function's small buffer, so submitting does not allocate
+    submitting = true;
+    bool submitted = connection.m_connection.submit(type, payload, length,
+        [this](const Response& reply) {
+            response = reply;
+            if (submitting) {
+                completedInline = true;
+            } else {
+                connection.m_loop.schedule(handle);
+            }
+        }, options);
+    submitting = false;
+    if (!submitted || completedInline) {
+        return false;
+    }
+
+    connection.updateWriteInterest();
+    // Make sure the loop wakes up to expire the request if no reply arrives
+    connection.m_loop.addTimer(steadyNowNs() + static_cast<uint64_t>(options.timeoutMs) * 1000000 + 1000000,
+                               std::coroutine_handle<>(), connection.m_id);
+    return true;
+}
@@ -0,0 +1,548 @@
+#include "../include/DeviceDiscovery.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// Receive buffer for the uevent socket: a hub with a few devices behind it
+// produces a burst of several dozen messages
+const int kUeventBufferBytes = 1 << 20;
+
+std::string baseName(const std::string& path)
+{
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+/**
+ * @brief Read a sysfs attribute without its trailing newline
+ */
+bool readAttribute(const std::string& path, std::string& value)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    char buffer[256];
+    ssize_t length = read(fd, buffer, sizeof(buffer));
+    close(fd);
+    if (length < 0) {
+        return false;
+    }
+    while (length > 0 && (buffer[length - 1] == '\n' || buffer[length - 1] == ' ')) {
+        --length;
+    }
+    value.assign(buffer, static_cast<size_t>(length));
+    return true;
+}
+
+bool parseHex16(const std::string& text, uint16_t& value)
+{
+    if (text.empty() || text.size() > 4) {
+        return false;
+    }
+    char* end = nullptr;
+    unsigned long parsed = std::strtoul(text.c_str(), &end, 16);
+    if (*end != '\0') {
+        return false;
+    }
+    value = static_cast<uint16_t>(parsed);
+    return true;
+}
+
+uint32_t idKey(uint16_t vid, uint16_t pid)
+{
+    return (static_cast<uint32_t>(vid) << 16) | pid;
+}
+
+/**
+ * @brief Locate the USB interface a device path runs through
+ *
+ * Interfaces are named "<device>:<configuration>.<interface>" and sit
+ * directly below their device, e.g. ".../usb1/1-1/1-1:1.0/tty/ttyACM0".
+ * @param usbDevpath Receives the device's path (".../usb1/1-1")
+ */
+bool findUsbInterface(const std::string& devpath, std::string& usbDevpath, int& interfaceNumber)
+{
+    size_t end = devpath.size();
+    while (end > 0) {
+        size_t start = devpath.rfind('/', end - 1);
+        if (start == std::string::npos || start == 0) {
+            return false;
+        }
+        std::string component = devpath.substr(start + 1, end - start - 1);
+        size_t parentStart = devpath.rfind('/', start - 1);
+        size_t colon = component.find(':');
+        size_t dot = component.rfind('.');
+        if (parentStart != std::string::npos && colon != std::string::npos && dot != std::string::npos &&
+            dot > colon && devpath.compare(parentStart + 1, start - parentStart - 1, component, 0, colon) == 0) {
+            usbDevpath = devpath.substr(0, start);
+            interfaceNumber = std::atoi(component.c_str() + dot + 1);
+            return true;
+        }
+        end = start;
+    }
+    return false;
+}
+
+} // namespace
+
+DeviceDiscovery::DeviceDiscovery(const DiscoveryOptions& options)
+    : m_options(options)
+    , m_ueventFd(-1)
+{
+    char resolved[PATH_MAX];
+    m_sysfsRoot = realpath(m_options.sysfsRoot.c_str(), resolved) ? resolved : m_options.sysfsRoot;
+    if (m_sysfsRoot.size() > 1 && m_sysfsRoot.back() == '/') {
+        m_sysfsRoot.pop_back();
+    }
+
+    // Subscribe before scanning: a device that appears during the scan is
+    // then either seen by the scan or reported by a queued message
+    if (m_options.watchUevents) {
+        m_ueventFd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+        if (m_ueventFd >= 0) {
+            struct sockaddr_nl address;
+            std::memset(&address, 0, sizeof(address));
+            address.nl_family = AF_NETLINK;
+            address.nl_groups = 1;  // Kernel messages (udev rebroadcasts on group 2)
+            setsockopt(m_ueventFd, SOL_SOCKET, SO_RCVBUF, &kUeventBufferBytes, sizeof(kUeventBufferBytes));
+            if (bind(m_ueventFd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0) {
+                close(m_ueventFd);
+                m_ueventFd = -1;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    rescanLocked();
+}
+
+DeviceDiscovery::~DeviceDiscovery()
+{
+    if (m_ueventFd >= 0) {
+        close(m_ueventFd);
+    }
+}
+
+DeviceDiscovery& DeviceDiscovery::shared()
+{
+    static DeviceDiscovery instance;
+    return instance;
+}
+
+bool DeviceDiscovery::rescan()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return rescanLocked();
+}
+
+size_t DeviceDiscovery::poll()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return pollLocked();
+}
+
+bool DeviceDiscovery::applyUevent(const char* message, size_t length)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return applyUeventLocked(message, length);
+}
+
+bool DeviceDiscovery::findSerialPort(const DeviceMatch& match, DiscoveredDevice& out)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    pollLocked();
+
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        const std::string* bestName = nullptr;
+        const UsbEntry* bestUsb = nullptr;
+        const TtyEntry* bestTty = nullptr;
+        const std::string* bestTtyName = nullptr;
+
+        // A serial number narrows the candidates to (usually) one device
+        std::vector<const std::string*> candidates;
+        if (match.serial.empty()) {
+            auto range = m_byId.equal_range(idKey(match.vid, match.pid));
+            for (auto it = range.first; it != range.second; ++it) {
+                candidates.push_back(&it->second);
+            }
+        } else {
+            auto range = m_bySerial.equal_range(match.serial);
+            for (auto it = range.first; it != range.second; ++it) {
+                candidates.push_back(&it->second);
+            }
+        }
+        for (const std::string* name : candidates) {
+            auto usb = m_usb.find(*name);
+            if (usb == m_usb.end() || usb->second.vid != match.vid || usb->second.pid != match.pid) {
+                continue;
+            }
+            if (bestName && usb->first >= *bestName) {
+                continue;
+            }
+            // The device's lowest-numbered tty, or the requested interface's
+            const TtyEntry* tty = nullptr;
+            const std::string* ttyName = nullptr;
+            for (const std::string& name : usb->second.ttys) {
+                const TtyEntry& entry = m_ttys.at(name);
+                if (match.interfaceNumber >= 0 && entry.interfaceNumber != match.interfaceNumber) {
+                    continue;
+                }
+                if (!tty || entry.interfaceNumber < tty->interfaceNumber ||
+                    (entry.interfaceNumber == tty->interfaceNumber && name < *ttyName)) {
+                    tty = &entry;
+                    ttyName = &name;
+                }
+            }
+            if (tty) {
+                bestName = &usb->first;
+                bestUsb = &usb->second;
+                bestTty = tty;
+                bestTtyName = ttyName;
+            }
+        }
+
+        if (bestTty) {
+            fill(*bestName, *bestUsb, out);
+            out.interfaceNumber = bestTty->interfaceNumber;
+            out.ttyName = *bestTtyName;
+            out.devicePath = bestTty->devicePath;
+            return true;
+        }
+
+        // Without uevents the index may be stale; a miss is worth one rescan
+        if (m_ueventFd >= 0 || !rescanLocked()) {
+            break;
+        }
+    }
+
+    char id[16];
+    std::snprintf(id, sizeof(id), "%04x:%04x", match.vid, match.pid);
+    m_lastError = std::string("No serial port found for USB device ") + id;
+    if (!match.serial.empty()) {
+        m_lastError += " with serial number " + match.serial;
+    }
+    return false;
+}
+
+std::vector<DiscoveredDevice> DeviceDiscovery::devices()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    pollLocked();
+
+    std::vector<DiscoveredDevice> list;
+    list.reserve(m_ttys.size() + m_usb.size());
+    for (const auto& tty : m_ttys) {
+        DiscoveredDevice device;
+        fill(tty.second.usbName, m_usb.at(tty.second.usbName), device);
+        device.interfaceNumber = tty.second.interfaceNumber;
+        device.ttyName = tty.first;
+        device.devicePath = tty.second.devicePath;
+        list.push_back(device);
+    }
+    size_t withTty = list.size();
+    for (const auto& usb : m_usb) {
+        if (usb.second.ttys.empty()) {
+            DiscoveredDevice device;
+            fill(usb.first, usb.second, device);
+            list.push_back(device);
+        }
+    }
+
+    auto order = [](const DiscoveredDevice& a, const DiscoveredDevice& b) {
+        if (a.usbName != b.usbName) {
+            return a.usbName < b.usbName;
+        }
+        if (a.interfaceNumber != b.interfaceNumber) {
+            return a.interfaceNumber < b.interfaceNumber;
+        }
+        return a.ttyName < b.ttyName;
+    };
+    std::sort(list.begin(), list.begin() + static_cast<std::ptrdiff_t>(withTty), order);
+    std::sort(list.begin() + static_cast<std::ptrdiff_t>(withTty), list.end(), order);
+    return list;
+}
+
+size_t DeviceDiscovery::deviceCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_usb.size();
+}
+
+size_t DeviceDiscovery::serialPortCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_ttys.size();
+}
+
+std::string DeviceDiscovery::getLastError() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastError;
+}
+
+bool DeviceDiscovery::rescanLocked()
+{
+    m_usb.clear();
+    m_byId.clear();
+    m_bySerial.clear();
+    m_ttys.clear();
+
+    // Entries are symlinks into /sys/devices; their targets are the devpaths
+    // that uevents refer to
+    auto scanLinks = [this](const std::string& directory, bool usb) {
+        DIR* dir = opendir(directory.c_str());
+        if (!dir) {
+            return false;
+        }
+        char resolved[PATH_MAX];
+        while (struct dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name[0] == '.' || (usb && name.find(':') != std::string::npos)) {
+                continue;  // Interfaces are read along with their ttys
+            }
+            std::string link = directory + "/" + name;
+            if (!realpath(link.c_str(), resolved) ||
+                std::strncmp(resolved, m_sysfsRoot.c_str(), m_sysfsRoot.size()) != 0) {
+                continue;
+            }
+            std::string devpath = resolved + m_sysfsRoot.size();
+            if (usb) {
+                addUsbDevice(devpath);
+            } else {
+                addTty(devpath, name);
+            }
+        }
+        closedir(dir);
+        return true;
+    };
+
+    // A machine without USB has no /sys/bus/usb at all; that is not an error
+    scanLinks(m_sysfsRoot + "/bus/usb/devices", true);
+    if (!scanLinks(m_sysfsRoot + "/class/tty", false)) {
+        m_lastError = "Cannot read " + m_sysfsRoot + "/class/tty: " + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+size_t DeviceDiscovery::pollLocked()
+{
+    if (m_ueventFd < 0) {
+        return 0;
+    }
+
+    size_t changes = 0;
+    char buffer[8192];
+    for (;;) {
+        struct sockaddr_nl sender;
+        socklen_t senderLength = sizeof(sender);
+        ssize_t length = recvfrom(m_ueventFd, buffer, sizeof(buffer) - 1, 0,
+                                  reinterpret_cast<struct sockaddr*>(&sender), &senderLength);
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == ENOBUFS) {
+                // Messages were dropped; only a full scan is trustworthy now
+                rescanLocked();
+                ++changes;
+                continue;
+            }
+            break;  // EAGAIN: all caught up
+        }
+        if (sender.nl_pid != 0) {
+            continue;  // Only the kernel speaks on group 1
+        }
+        buffer[length] = '\0';
+        if (applyUeventLocked(buffer, static_cast<size_t>(length))) {
+            ++changes;
+        }
+    }
+    return changes;
+}
+
+bool DeviceDiscovery::applyUeventLocked(const char* message, size_t length)
+{
+    // "ACTION@DEVPATH", then NUL-separated KEY=VALUE pairs
+    std::string action;
+    std::string devpath;
+    std::string subsystem;
+    std::string devtype;
+    std::string devName;
+    size_t offset = std::strlen(message) + 1;
+    while (offset < length) {
+        const char* pair = message + offset;
+        size_t pairLength = strnlen(pair, length - offset);
+        const char* equals = static_cast<const char*>(std::memchr(pair, '=', pairLength));
+        if (equals) {
+            std::string key(pair, static_cast<size_t>(equals - pair));
+            std::string value(equals + 1, pair + pairLength);
+            if (key == "ACTION") {
+                action = value;
+            } else if (key == "DEVPATH") {
+                devpath = value;
+            } else if (key == "SUBSYSTEM") {
+                subsystem = value;
+            } else if (key == "DEVTYPE") {
+                devtype = value;
+            } else if (key == "DEVNAME") {
+                devName = value;
+            }
+        }
+        offset += pairLength + 1;
+    }
+    if (action.empty() || devpath.empty()) {
+        return false;
+    }
+
+    if (action == "move") {
+        return rescanLocked();  // Rare (renamed parents); not worth patching paths
+    }
+    if (subsystem == "usb" && devtype == "usb_device") {
+        if (action == "add" || action == "change" || action == "bind") {
+            return addUsbDevice(devpath);
+        }
+        if (action == "remove") {
+            return removeUsbDevice(baseName(devpath));
+        }
+    } else if (subsystem == "tty") {
+        if (action == "add") {
+            return addTty(devpath, devName);
+        }
+        if (action == "remove") {
+            return removeTty(baseName(devpath));
+        }
+    }
+    return false;
+}
+
+bool DeviceDiscovery::addUsbDevice(const std::string& devpath)
+{
+    std::string directory = m_sysfsRoot + devpath;
+    std::string vidText;
+    std::string pidText;
+    uint16_t vid = 0;
+    uint16_t pid = 0;
+    if (!readAttribute(directory + "/idVendor", vidText) || !readAttribute(directory + "/idProduct", pidText) ||
+        !parseHex16(vidText, vid) || !parseHex16(pidText, pid)) {
+        return false;
+    }
+
+    std::string name = baseName(devpath);
+    auto existing = m_usb.find(name);
+    if (existing != m_usb.end()) {
+        unindexUsbDevice(name, existing->second);
+    }
+
+    UsbEntry& entry = m_usb[name];  // A re-read keeps the ttys already found
+    entry.vid = vid;
+    entry.pid = pid;
+    if (!readAttribute(directory + "/serial", entry.serial)) {
+        entry.serial.clear();
+    }
+    if (!readAttribute(directory + "/manufacturer", entry.manufacturer)) {
+        entry.manufacturer.clear();
+    }
+    if (!readAttribute(directory + "/product", entry.product)) {
+        entry.product.clear();
+    }
+    m_byId.emplace(idKey(vid, pid), name);
+    if (!entry.serial.empty()) {
+        m_bySerial.emplace(entry.serial, name);
+    }
+    return true;
+}
+
+bool DeviceDiscovery::removeUsbDevice(const std::string& name)
+{
+    auto usb = m_usb.find(name);
+    if (usb == m_usb.end()) {
+        return false;
+    }
+    for (const std::string& tty : usb->second.ttys) {
+        m_ttys.erase(tty);
+    }
+    unindexUsbDevice(name, usb->second);
+    m_usb.erase(usb);
+    return true;
+}
+
+void DeviceDiscovery::unindexUsbDevice(const std::string& name, const UsbEntry& entry)
+{
+    auto ids = m_byId.equal_range(idKey(entry.vid, entry.pid));
+    for (auto it = ids.first; it != ids.second; ++it) {
+        if (it->second == name) {
+            m_byId.erase(it);
+            break;
+        }
+    }
+    auto serials = m_bySerial.equal_range(entry.serial);
+    for (auto it = serials.first; it != serials.second; ++it) {
+        if (it->second == name) {
+            m_bySerial.erase(it);
+            break;
+        }
+    }
+}
+
+bool DeviceDiscovery::addTty(const std::string& devpath, const std::string& devName)
+{
+    std::string usbDevpath;
+    int interfaceNumber;
+    if (!findUsbInterface(devpath, usbDevpath, interfaceNumber)) {
+        return false;  // Not a USB serial port (console, ttyS*, rfcomm*, ...)
+    }
+    std::string usbName = baseName(usbDevpath);
+    if (m_usb.find(usbName) == m_usb.end() && !addUsbDevice(usbDevpath)) {
+        return false;
+    }
+
+    std::string name = baseName(devpath);
+    removeTty(name);
+    TtyEntry& tty = m_ttys[name];
+    tty.usbName = usbName;
+    tty.interfaceNumber = interfaceNumber;
+    tty.devicePath = m_options.devRoot + "/" + (devName.empty() ? name : devName);
+    m_usb[usbName].ttys.push_back(name);
+    return true;
+}
+
+bool DeviceDiscovery::removeTty(const std::string& name)
+{
+    auto tty = m_ttys.find(name);
+    if (tty == m_ttys.end()) {
+        return false;
+    }
+    auto usb = m_usb.find(tty->second.usbName);
+    if (usb != m_usb.end()) {
+        std::vector<std::string>& ttys = usb->second.ttys;
+        ttys.erase(std::remove(ttys.begin(), ttys.end(), name), ttys.end());
+    }
+    m_ttys.erase(tty);
+    return true;
+}
+
+void DeviceDiscovery::fill(const std::string& usbName, const UsbEntry& usb, DiscoveredDevice& out) const
+{
+    out.vid = usb.vid;
+    out.pid = usb.pid;
+    out.serial = usb.serial;
+    out.manufacturer = usb.manufacturer;
+    out.product = usb.product;
+    out.usbName = usbName;
+    out.interfaceNumber = -1;
+    out.ttyName.clear();
+    out.devicePath.clear();
+}
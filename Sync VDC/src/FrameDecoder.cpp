@@ -0,0 +1,196 @@
+#include "../include/FrameDecoder.h"
+
+#include <cstring>
+
+namespace {
+
+inline uint8_t frameChecksum(const uint8_t* frame, size_t payloadLength)
+{
+    // Sum of type, sequence, length and payload bytes
+    uint32_t sum = 0;
+    const size_t end = FRAME_HEADER_SIZE + payloadLength;
+    for (size_t i = 1; i < end; ++i) {
+        sum += frame[i];
+    }
+    return static_cast<uint8_t>(sum);
+}
+
+inline uint16_t readLE16(const uint8_t* p)
+{
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline void writeLE16(uint8_t* p, uint16_t value)
+{
+    p[0] = static_cast<uint8_t>(value);
+    p[1] = static_cast<uint8_t>(value >> 8);
+}
+
+} // namespace
+
+FrameDecoder::FrameDecoder()
+    : m_partialLength(0)
+{
+}
+
+void FrameDecoder::setFrameHandler(FrameHandler handler)
+{
+    m_frameHandler = std::move(handler);
+}
+
+void FrameDecoder::reset()
+{
+    m_partialLength = 0;
+}
+
+size_t FrameDecoder::decode(const uint8_t* data, size_t length, uint64_t timestampNs,
+                            StylusEvent* events, size_t capacity, size_t& produced)
+{
+    produced = 0;
+    size_t pos = 0;
+
+    // Finish a frame left over from the previous chunk
+    while (m_partialLength > 0) {
+        size_t needed = m_partialLength < FRAME_HEADER_SIZE
+                            ? FRAME_HEADER_SIZE
+                            : FRAME_OVERHEAD + m_partial[3];
+        if (m_partialLength < needed) {
+            size_t take = needed - m_partialLength;
+            if (take > length - pos) {
+                take = length - pos;
+            }
+            if (take == 0) {
+                return pos;
+            }
+            std::memcpy(m_partial + m_partialLength, data + pos, take);
+            m_partialLength += take;
+            pos += take;
+            continue;  // The header may now be complete; recompute what is needed
+        }
+
+        if (m_partial[1] == FRAME_TYPE_PEN && produced == capacity) {
+            return pos;
+        }
+        // After a resync the buffer can hold a shorter frame followed by
+        // the start of the next ones, which were already taken from data
+        if (handleFrame(m_partial, timestampNs, events, produced)) {
+            dropPartial(FRAME_OVERHEAD + m_partial[3]);
+        } else {
+            m_stats.checksumErrors++;
+            dropPartial(1);
+        }
+    }
+
+    // Decode complete frames in place
+    while (pos < length) {
+        const uint8_t* p = data + pos;
+        if (*p != FRAME_SYNC) {
+            const void* sync = std::memchr(p, FRAME_SYNC, length - pos);
+            if (!sync) {
+                m_stats.skippedBytes += length - pos;
+                pos = length;
+                break;
+            }
+            size_t skip = static_cast<size_t>(static_cast<const uint8_t*>(sync) - p);
+            m_stats.skippedBytes += skip;
+            pos += skip;
+            p = data + pos;
+        }
+
+        size_t available = length - pos;
+        if (available < FRAME_HEADER_SIZE || available < FRAME_OVERHEAD + p[3]) {
+            std::memcpy(m_partial, p, available);
+            m_partialLength = available;
+            pos = length;
+            break;
+        }
+
+        if (p[1] == FRAME_TYPE_PEN && produced == capacity) {
+            break;
+        }
+        if (handleFrame(p, timestampNs, events, produced)) {
+            pos += FRAME_OVERHEAD + p[3];
+        } else {
+            // False sync byte or corrupted frame: rescan from the next byte
+            m_stats.checksumErrors++;
+            pos += 1;
+        }
+    }
+
+    return pos;
+}
+
+bool FrameDecoder::handleFrame(const uint8_t* frame, uint64_t timestampNs,
+                               StylusEvent* events, size_t& produced)
+{
+    const uint8_t payloadLength = frame[3];
+    if (frameChecksum(frame, payloadLength) != frame[FRAME_HEADER_SIZE + payloadLength]) {
+        return false;
+    }
+
+    const uint8_t* payload = frame + FRAME_HEADER_SIZE;
+    if (frame[1] == FRAME_TYPE_PEN) {
+        if (payloadLength != PEN_PAYLOAD_SIZE) {
+            return false;
+        }
+        StylusEvent& event = events[produced++];
+        event.timestampNs = timestampNs;
+        event.x = readLE16(payload);
+        event.y = readLE16(payload + 2);
+        event.pressure = readLE16(payload + 4);
+        event.flags = payload[6];
+        event.sequence = frame[2];
+        m_stats.penFrames++;
+        return true;
+    }
+
+    m_stats.otherFrames++;
+    if (m_frameHandler) {
+        FrameView view;
+        view.type = frame[1];
+        view.sequence = frame[2];
+        view.length = payloadLength;
+        view.payload = payload;
+        view.timestampNs = timestampNs;
+        m_frameHandler(view);
+    }
+    return true;
+}
+
+void FrameDecoder::dropPartial(size_t count)
+{
+    const void* sync = std::memchr(m_partial + count, FRAME_SYNC, m_partialLength - count);
+    if (!sync) {
+        m_stats.skippedBytes += m_partialLength - count;
+        m_partialLength = 0;
+        return;
+    }
+
+    size_t skip = static_cast<size_t>(static_cast<const uint8_t*>(sync) - m_partial);
+    m_stats.skippedBytes += skip - count;
+    m_partialLength -= skip;
+    std::memmove(m_partial, m_partial + skip, m_partialLength);
+}
+
+size_t encodeFrame(uint8_t type, uint8_t sequence, const uint8_t* payload, uint8_t length, uint8_t* out)
+{
+    out[0] = FRAME_SYNC;
+    out[1] = type;
+    out[2] = sequence;
+    out[3] = length;
+    if (length > 0) {
+        std::memcpy(out + FRAME_HEADER_SIZE, payload, length);
+    }
+    out[FRAME_HEADER_SIZE + length] = frameChecksum(out, length);
+    return FRAME_OVERHEAD + length;
+}
+
+size_t encodePenFrame(const StylusEvent& event, uint8_t* out)
+{
+    uint8_t payload[PEN_PAYLOAD_SIZE];
+    writeLE16(payload, event.x);
+    writeLE16(payload + 2, event.y);
+    writeLE16(payload + 4, event.pressure);
+    payload[6] = event.flags;
+    return encodeFrame(FRAME_TYPE_PEN, event.sequence, payload, PEN_PAYLOAD_SIZE, out);
+}
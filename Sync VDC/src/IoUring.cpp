@@ -0,0 +1,281 @@
+#include "../include/IoUring.h"
+
+#ifdef WT13106_HAVE_IO_URING
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+int ioUringSetup(unsigned entries, struct io_uring_params* params)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int ioUringRegister(int fd, unsigned opcode, void* arg, unsigned count)
+{
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+std::string errorText(const char* what, int error)
+{
+    return std::string(what) + ": " + std::strerror(error);
+}
+
+} // namespace
+
+IoUring::IoUring()
+    : m_fd(-1)
+    , m_disabled(false)
+    , m_sqRing(MAP_FAILED)
+    , m_sqRingSize(0)
+    , m_cqRing(MAP_FAILED)
+    , m_cqRingSize(0)
+    , m_sqes(nullptr)
+    , m_sqesSize(0)
+    , m_sqHead(nullptr)
+    , m_sqTail(nullptr)
+    , m_sqArray(nullptr)
+    , m_sqMask(0)
+    , m_sqEntries(0)
+    , m_sqLocalTail(0)
+    , m_cqHead(nullptr)
+    , m_cqTail(nullptr)
+    , m_cqMask(0)
+    , m_cqes(nullptr)
+    , m_bufRing(nullptr)
+    , m_bufRingSize(0)
+    , m_bufMask(0)
+    , m_bufferSize(0)
+{
+}
+
+IoUring::~IoUring()
+{
+    close();
+}
+
+bool IoUring::open(unsigned entries)
+{
+    close();
+
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+#ifdef IORING_SETUP_DEFER_TASKRUN
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_R_DISABLED;
+    m_fd = ioUringSetup(entries, &params);
+    m_disabled = m_fd >= 0;
+    if (m_fd < 0 && errno == EINVAL) {
+        // Before 6.1: no deferred task work
+        std::memset(&params, 0, sizeof(params));
+        m_fd = ioUringSetup(entries, &params);
+    }
+#else
+    m_fd = ioUringSetup(entries, &params);
+#endif
+    if (m_fd < 0) {
+        m_lastError = errorText("io_uring_setup", errno);
+        return false;
+    }
+
+    if (!mapRings(params)) {
+        close();
+        return false;
+    }
+
+    // Opcode probe (5.6); without it nothing beyond the basics is assumed
+    std::vector<uint8_t> probeMemory(sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op));
+    struct io_uring_probe* probe = reinterpret_cast<struct io_uring_probe*>(probeMemory.data());
+    m_supported.assign(256, 0);
+    if (ioUringRegister(m_fd, IORING_REGISTER_PROBE, probe, 256) == 0) {
+        for (unsigned op = 0; op < probe->ops_len && op < 256; ++op) {
+            m_supported[op] = (probe->ops[op].flags & IO_URING_OP_SUPPORTED) ? 1 : 0;
+        }
+    }
+
+    m_lastError.clear();
+    return true;
+}
+
+bool IoUring::mapRings(const struct io_uring_params& params)
+{
+    m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMap) {
+        m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+    }
+
+    m_sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+                    IORING_OFF_SQ_RING);
+    if (m_sqRing == MAP_FAILED) {
+        m_lastError = errorText("Failed to map the submission ring", errno);
+        return false;
+    }
+    if (singleMap) {
+        m_cqRing = m_sqRing;
+    } else {
+        m_cqRing = mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+                        IORING_OFF_CQ_RING);
+        if (m_cqRing == MAP_FAILED) {
+            m_lastError = errorText("Failed to map the completion ring", errno);
+            return false;
+        }
+    }
+
+    m_sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+                      IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        m_lastError = errorText("Failed to map the submission entries", errno);
+        return false;
+    }
+    m_sqes = static_cast<struct io_uring_sqe*>(sqes);
+
+    uint8_t* sq = static_cast<uint8_t*>(m_sqRing);
+    m_sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    m_sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    m_sqEntries = params.sq_entries;
+    m_sqLocalTail = *m_sqTail;
+
+    uint8_t* cq = static_cast<uint8_t*>(m_cqRing);
+    m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    m_cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+}
+
+void IoUring::close()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);  // Cancels everything still in flight
+        m_fd = -1;
+    }
+    if (m_sqes != nullptr) {
+        munmap(m_sqes, m_sqesSize);
+        m_sqes = nullptr;
+    }
+    if (m_cqRing != MAP_FAILED && m_cqRing != m_sqRing) {
+        munmap(m_cqRing, m_cqRingSize);
+    }
+    m_cqRing = MAP_FAILED;
+    if (m_sqRing != MAP_FAILED) {
+        munmap(m_sqRing, m_sqRingSize);
+        m_sqRing = MAP_FAILED;
+    }
+    if (m_bufRing != nullptr) {
+        munmap(m_bufRing, m_bufRingSize);
+        m_bufRing = nullptr;
+    }
+    m_buffers.clear();
+    m_supported.clear();
+    m_disabled = false;
+}
+
+bool IoUring::enable()
+{
+    if (!m_disabled) {
+        return true;
+    }
+    if (ioUringRegister(m_fd, IORING_REGISTER_ENABLE_RINGS, nullptr, 0) != 0) {
+        m_lastError = errorText("Failed to enable io_uring", errno);
+        return false;
+    }
+    m_disabled = false;
+    return true;
+}
+
+bool IoUring::supports(uint8_t opcode) const
+{
+    return opcode < m_supported.size() && m_supported[opcode] != 0;
+}
+
+bool IoUring::setupBuffers(uint16_t groupId, unsigned count, unsigned size)
+{
+    if (count == 0 || count > 32768 || (count & (count - 1)) != 0 || size == 0) {
+        m_lastError = "Buffer count must be a power of two up to 32768";
+        return false;
+    }
+
+    // The ring must be page-aligned
+    m_bufRingSize = count * sizeof(struct io_uring_buf);
+    void* ring = mmap(nullptr, m_bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) {
+        m_lastError = errorText("Failed to allocate the buffer ring", errno);
+        return false;
+    }
+    std::memset(ring, 0, m_bufRingSize);
+
+    struct io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+    reg.ring_entries = count;
+    reg.bgid = groupId;
+    if (ioUringRegister(m_fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        // Before 5.19
+        m_lastError = errorText("Failed to register receive buffers", errno);
+        munmap(ring, m_bufRingSize);
+        return false;
+    }
+
+    m_bufRing = static_cast<struct io_uring_buf_ring*>(ring);
+    m_bufMask = count - 1;
+    m_bufferSize = size;
+    m_buffers.assign(size_t(count) * size, 0);
+    for (unsigned i = 0; i < count; ++i) {
+        recycleBuffer(static_cast<uint16_t>(i));
+    }
+    return true;
+}
+
+void IoUring::recycleBuffer(uint16_t bufferId)
+{
+    uint16_t tail = m_bufRing->tail;
+    // Not m_bufRing->bufs: in C++ the kernel's flexible-array wrapper puts an
+    // empty struct (one byte, padded to eight) in front of the array
+    struct io_uring_buf* entry = reinterpret_cast<struct io_uring_buf*>(m_bufRing) + (tail & m_bufMask);
+    // Field by field: the first entry's resv field is the ring's tail
+    entry->addr = reinterpret_cast<uint64_t>(buffer(bufferId));
+    entry->len = m_bufferSize;
+    entry->bid = bufferId;
+    __atomic_store_n(&m_bufRing->tail, static_cast<uint16_t>(tail + 1), __ATOMIC_RELEASE);
+}
+
+struct io_uring_sqe* IoUring::getSqe()
+{
+    unsigned head = __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+    if (m_sqLocalTail - head >= m_sqEntries) {
+        return nullptr;
+    }
+    unsigned index = m_sqLocalTail & m_sqMask;
+    struct io_uring_sqe* sqe = &m_sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    m_sqArray[index] = index;
+    ++m_sqLocalTail;
+    return sqe;
+}
+
+int IoUring::submitAndWait(unsigned waitCount)
+{
+    __atomic_store_n(m_sqTail, m_sqLocalTail, __ATOMIC_RELEASE);
+    unsigned pending = m_sqLocalTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+    if (pending == 0 && waitCount == 0) {
+        return 0;
+    }
+    int result = ioUringEnter(m_fd, pending, waitCount, waitCount > 0 ? IORING_ENTER_GETEVENTS : 0);
+    return result < 0 ? -errno : result;
+}
+
+#endif // WT13106_HAVE_IO_URING
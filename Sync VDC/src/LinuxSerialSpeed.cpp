@@ -0,0 +1,57 @@
+#include "LinuxSerialSpeed.h"
+
+#include <asm/termbits.h>
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+
+bool setLinuxCustomBaudRate(int fd, uint32_t baudRate)
+{
+    struct termios2 tio;
+    if (ioctl(fd, TCGETS2, &tio) != 0) {
+        return false;
+    }
+    
+    tio.c_cflag &= ~CBAUD;
+    tio.c_cflag |= BOTHER;
+    tio.c_ispeed = baudRate;
+    tio.c_ospeed = baudRate;
+    
+    if (ioctl(fd, TCSETS2, &tio) != 0) {
+        return false;
+    }
+    
+    // Drivers round to the nearest rate their divisor allows; reject the
+    // request if the result is more than 2% away from what was asked for.
+    if (ioctl(fd, TCGETS2, &tio) != 0) {
+        return false;
+    }
+    uint32_t actual = tio.c_ospeed;
+    uint32_t diff = actual > baudRate ? actual - baudRate : baudRate - actual;
+    return diff <= baudRate / 50;
+}
+
+bool setLinuxLowLatency(int fd, bool enable, bool* wasEnabled)
+{
+    struct serial_struct serial;
+    if (ioctl(fd, TIOCGSERIAL, &serial) != 0) {
+        return false;
+    }
+    if (wasEnabled) {
+        *wasEnabled = (serial.flags & ASYNC_LOW_LATENCY) != 0;
+    }
+    
+    if (enable) {
+        serial.flags |= ASYNC_LOW_LATENCY;
+    } else {
+        serial.flags &= ~ASYNC_LOW_LATENCY;
+    }
+    if (ioctl(fd, TIOCSSERIAL, &serial) != 0) {
+        return false;
+    }
+    
+    // Some drivers accept the call but ignore the flag
+    if (ioctl(fd, TIOCGSERIAL, &serial) != 0) {
+        return false;
+    }
+    return ((serial.flags & ASYNC_LOW_LATENCY) != 0) == enable;
+}
@@ -0,0 +1,28 @@
+#ifndef LINUX_SERIAL_SPEED_H
+#define LINUX_SERIAL_SPEED_H
+
+#include <cstdint>
+
+/**
+ * @brief Program an arbitrary baud rate with termios2/BOTHER (Linux only)
+ *
+ * Kept in its own translation unit because <asm/termbits.h> cannot be
+ * included alongside <termios.h>.
+ *
+ * @param fd Open serial port descriptor
+ * @param baudRate Requested input and output rate in bits per second
+ * @return true if the driver accepted the rate
+ */
+bool setLinuxCustomBaudRate(int fd, uint32_t baudRate);
+
+/**
+ * @brief Set or clear ASYNC_LOW_LATENCY with TIOCGSERIAL/TIOCSSERIAL (Linux only)
+ *
+ * @param fd Open serial port descriptor
+ * @param enable Whether the flag should be set
+ * @param wasEnabled If not null, receives the flag's previous state
+ * @return true if the driver supports the call and the flag reads back as requested
+ */
+bool setLinuxLowLatency(int fd, bool enable, bool* wasEnabled);
+
+#endif // LINUX_SERIAL_SPEED_H
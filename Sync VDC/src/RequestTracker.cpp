@@ -0,0 +1,176 @@
+#include "../include/RequestTracker.h"
+
+#include <limits>
+
+namespace {
+
+const uint64_t kNoDeadline = std::numeric_limits<uint64_t>::max();
+
+} // namespace
+
+RequestTracker::RequestTracker()
+    : m_active(0)
+    , m_nextSequence(0)
+    , m_nextTicket(0)
+    , m_nextDeadlineNs(kNoDeadline)
+{
+}
+
+int RequestTracker::begin(uint8_t type, const SubmitOptions& options, ResponseCallback&& callback, uint64_t nowNs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_active == 256) {
+        return -1;
+    }
+
+    // Hand out sequence numbers round-robin so a late reply to a timed-out
+    // request is unlikely to match the next request
+    while (m_slots[m_nextSequence].active) {
+        ++m_nextSequence;
+    }
+    uint8_t sequence = m_nextSequence++;
+
+    Slot& slot = m_slots[sequence];
+    slot.active = true;
+    slot.match = options.match;
+    slot.replyType = options.replyType >= 0 ? static_cast<uint8_t>(options.replyType)
+                                            : static_cast<uint8_t>(type | FRAME_REPLY_FLAG);
+    slot.ticket = m_nextTicket++;
+    slot.submittedNs = nowNs;
+    slot.deadlineNs = nowNs + static_cast<uint64_t>(options.timeoutMs) * 1000000;
+    slot.callback = std::move(callback);
+    ++m_active;
+
+    if (slot.deadlineNs < m_nextDeadlineNs.load(std::memory_order_relaxed)) {
+        m_nextDeadlineNs.store(slot.deadlineNs, std::memory_order_release);
+    }
+    return sequence;
+}
+
+void RequestTracker::cancel(uint8_t sequence, ResponseStatus status)
+{
+    Completion completion;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_slots[sequence].active) {
+            return;
+        }
+        completion = release(sequence, status);
+    }
+    if (completion.callback) {
+        completion.callback(completion.response);
+    }
+}
+
+bool RequestTracker::onFrame(const FrameView& frame)
+{
+    Completion completion;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_active == 0) {
+            return false;
+        }
+
+        int match = -1;
+        const Slot& bySequence = m_slots[frame.sequence];
+        if (bySequence.active && bySequence.match == RequestMatch::SEQUENCE && bySequence.replyType == frame.type) {
+            match = frame.sequence;
+        } else {
+            uint64_t oldest = kNoDeadline;
+            for (int i = 0; i < 256; ++i) {
+                const Slot& slot = m_slots[i];
+                if (slot.active && slot.match == RequestMatch::OPCODE && slot.replyType == frame.type &&
+                    slot.ticket < oldest) {
+                    oldest = slot.ticket;
+                    match = i;
+                }
+            }
+        }
+        if (match < 0) {
+            return false;
+        }
+
+        uint64_t submittedNs = m_slots[match].submittedNs;
+        completion = release(static_cast<uint8_t>(match), ResponseStatus::OK);
+        completion.response.type = frame.type;
+        completion.response.payload.assign(frame.payload, frame.payload + frame.length);
+        completion.response.timestampNs = frame.timestampNs;
+        completion.response.roundTripNs = frame.timestampNs > submittedNs ? frame.timestampNs - submittedNs : 0;
+    }
+    if (completion.callback) {
+        completion.callback(completion.response);
+    }
+    return true;
+}
+
+void RequestTracker::expire(uint64_t nowNs)
+{
+    std::vector<Completion> completions;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (int i = 0; i < 256 && m_active > 0; ++i) {
+            if (m_slots[i].active && m_slots[i].deadlineNs <= nowNs) {
+                completions.push_back(release(static_cast<uint8_t>(i), ResponseStatus::TIMEOUT));
+            }
+        }
+        updateNextDeadline();
+    }
+    complete(completions);
+}
+
+void RequestTracker::failAll(ResponseStatus status)
+{
+    std::vector<Completion> completions;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (int i = 0; i < 256 && m_active > 0; ++i) {
+            if (m_slots[i].active) {
+                completions.push_back(release(static_cast<uint8_t>(i), status));
+            }
+        }
+        updateNextDeadline();
+    }
+    complete(completions);
+}
+
+size_t RequestTracker::outstanding() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_active;
+}
+
+RequestTracker::Completion RequestTracker::release(uint8_t sequence, ResponseStatus status)
+{
+    Slot& slot = m_slots[sequence];
+    Completion completion;
+    completion.callback = std::move(slot.callback);
+    completion.response.status = status;
+    completion.response.sequence = sequence;
+    slot.callback = nullptr;
+    slot.active = false;
+    --m_active;
+    if (m_active == 0) {
+        m_nextDeadlineNs.store(kNoDeadline, std::memory_order_release);
+    }
+    return completion;
+}
+
+void RequestTracker::updateNextDeadline()
+{
+    uint64_t next = kNoDeadline;
+    for (int i = 0; i < 256 && m_active > 0; ++i) {
+        if (m_slots[i].active && m_slots[i].deadlineNs < next) {
+            next = m_slots[i].deadlineNs;
+        }
+    }
+    m_nextDeadlineNs.store(next, std::memory_order_release);
+}
+
+void RequestTracker::complete(std::vector<Completion>& completions)
+{
+    for (Completion& completion : completions) {
+        if (completion.callback) {
+            completion.callback(completion.response);
+        }
+    }
+}
@@ -0,0 +1,364 @@
+#include "../include/SharedEventRing.h"
+
+#ifdef __linux__
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <new>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+std::string objectName(const std::string& name)
+{
+    return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+std::string errorText(const std::string& what, int error)
+{
+    return what + ": " + std::strerror(error);
+}
+
+size_t roundUpPowerOfTwo(size_t value)
+{
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+bool processAlive(int32_t pid)
+{
+    return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+/**
+ * @brief Whether an existing object is a ring whose writer has exited
+ */
+bool isAbandonedRing(const std::string& name)
+{
+    int fd = shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    bool abandoned = false;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && size_t(st.st_size) >= kSharedEventRingHeaderSize) {
+        void* memory = mmap(nullptr, kSharedEventRingHeaderSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (memory != MAP_FAILED) {
+            const SharedEventRingHeader* header = static_cast<const SharedEventRingHeader*>(memory);
+            abandoned = header->magic == kSharedEventRingMagic &&
+                        (header->closed.load(std::memory_order_acquire) != 0 || !processAlive(header->writerPid));
+            munmap(memory, kSharedEventRingHeaderSize);
+        }
+    }
+    ::close(fd);
+    return abandoned;
+}
+
+} // namespace
+
+SharedEventWriter::SharedEventWriter()
+    : m_header(nullptr)
+    , m_slots(nullptr)
+    , m_mappedSize(0)
+    , m_mask(0)
+    , m_wakeReaders(true)
+{
+}
+
+SharedEventWriter::~SharedEventWriter()
+{
+    close();
+}
+
+bool SharedEventWriter::create(const std::string& name, size_t capacity)
+{
+    close();
+    if (capacity == 0 || capacity > (size_t(1) << 30)) {
+        m_lastError = "Capacity must be between 1 and 2^30 events";
+        return false;
+    }
+    capacity = roundUpPowerOfTwo(capacity);
+
+    std::string path = objectName(name);
+    int fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0 && errno == EEXIST && isAbandonedRing(path)) {
+        shm_unlink(path.c_str());
+        fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    }
+    if (fd < 0) {
+        m_lastError = errno == EEXIST ? "Shared ring " + path + " is in use by a running writer"
+                                      : errorText("shm_open " + path, errno);
+        return false;
+    }
+
+    size_t size = kSharedEventRingHeaderSize + capacity * sizeof(StylusEvent);
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        m_lastError = errorText("Failed to size " + path, errno);
+        ::close(fd);
+        shm_unlink(path.c_str());
+        return false;
+    }
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        m_lastError = errorText("Failed to map " + path, errno);
+        shm_unlink(path.c_str());
+        return false;
+    }
+
+    // The object is zero-filled; readers check magic last
+    m_header = new (memory) SharedEventRingHeader;
+    m_header->version = kSharedEventRingVersion;
+    m_header->eventSize = sizeof(StylusEvent);
+    m_header->capacity = static_cast<uint32_t>(capacity);
+    m_header->writerPid = static_cast<int32_t>(getpid());
+    m_header->closed.store(0, std::memory_order_relaxed);
+    m_header->writeLimit.store(0, std::memory_order_relaxed);
+    m_header->published.store(0, std::memory_order_relaxed);
+    m_header->futexWord.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_header->magic = kSharedEventRingMagic;
+
+    m_slots = reinterpret_cast<StylusEvent*>(static_cast<uint8_t*>(memory) + kSharedEventRingHeaderSize);
+    m_mappedSize = size;
+    m_mask = capacity - 1;
+    m_name = path;
+    m_lastError.clear();
+    return true;
+}
+
+void SharedEventWriter::close()
+{
+    if (m_header == nullptr) {
+        return;
+    }
+    m_header->closed.store(1, std::memory_order_release);
+    m_header->futexWord.fetch_add(1, std::memory_order_release);
+    syscall(SYS_futex, &m_header->futexWord, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    munmap(m_header, m_mappedSize);
+    shm_unlink(m_name.c_str());
+    m_header = nullptr;
+    m_slots = nullptr;
+    m_mappedSize = 0;
+}
+
+size_t SharedEventWriter::claim(StylusEvent*& slots, size_t count)
+{
+    if (m_header == nullptr || count == 0) {
+        return 0;
+    }
+    const uint64_t published = m_header->published.load(std::memory_order_relaxed);
+    const size_t offset = static_cast<size_t>(published & m_mask);
+    const size_t room = static_cast<size_t>(m_mask + 1) - offset;
+    const size_t n = count < room ? count : room;
+
+    // Announce the overwrite before touching the slots; the fence keeps the
+    // slot stores from being seen ahead of the new limit
+    if (m_header->writeLimit.load(std::memory_order_relaxed) < published + n) {
+        m_header->writeLimit.store(published + n, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    slots = m_slots + offset;
+    return n;
+}
+
+void SharedEventWriter::commit(size_t count)
+{
+    if (m_header == nullptr || count == 0) {
+        return;
+    }
+    uint64_t published = m_header->published.load(std::memory_order_relaxed) + count;
+    m_header->published.store(published, std::memory_order_release);
+    m_header->futexWord.store(static_cast<uint32_t>(published), std::memory_order_release);
+    if (m_wakeReaders) {
+        syscall(SYS_futex, &m_header->futexWord, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+}
+
+void SharedEventWriter::publish(const StylusEvent* events, size_t count)
+{
+    while (count > 0 && m_header != nullptr) {
+        StylusEvent* slots = nullptr;
+        size_t n = claim(slots, count);
+        std::memcpy(slots, events, n * sizeof(StylusEvent));
+        commit(n);
+        events += n;
+        count -= n;
+    }
+}
+
+uint64_t SharedEventWriter::published() const
+{
+    return m_header != nullptr ? m_header->published.load(std::memory_order_relaxed) : 0;
+}
+
+SharedEventReader::SharedEventReader()
+    : m_header(nullptr)
+    , m_slots(nullptr)
+    , m_mappedSize(0)
+    , m_capacity(0)
+    , m_mask(0)
+    , m_cursor(0)
+{
+}
+
+SharedEventReader::~SharedEventReader()
+{
+    close();
+}
+
+bool SharedEventReader::open(const std::string& name)
+{
+    close();
+    std::string path = objectName(name);
+    int fd = shm_open(path.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        m_lastError = errorText("shm_open " + path, errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < kSharedEventRingHeaderSize) {
+        m_lastError = path + " is not a shared event ring";
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        m_lastError = errorText("Failed to map " + path, errno);
+        return false;
+    }
+
+    const SharedEventRingHeader* header = static_cast<const SharedEventRingHeader*>(memory);
+    uint32_t magic = header->magic;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (magic != kSharedEventRingMagic || header->version != kSharedEventRingVersion ||
+        header->eventSize != sizeof(StylusEvent) || header->capacity == 0 ||
+        (header->capacity & (header->capacity - 1)) != 0 ||
+        kSharedEventRingHeaderSize + size_t(header->capacity) * sizeof(StylusEvent) > size) {
+        m_lastError = path + " is not a compatible shared event ring";
+        munmap(memory, size);
+        return false;
+    }
+
+    m_header = header;
+    m_slots = reinterpret_cast<const StylusEvent*>(static_cast<const uint8_t*>(memory) +
+                                                   kSharedEventRingHeaderSize);
+    m_mappedSize = size;
+    m_capacity = header->capacity;
+    m_mask = m_capacity - 1;
+    m_cursor = header->published.load(std::memory_order_acquire);
+    m_lastError.clear();
+    return true;
+}
+
+void SharedEventReader::close()
+{
+    if (m_header == nullptr) {
+        return;
+    }
+    munmap(const_cast<SharedEventRingHeader*>(m_header), m_mappedSize);
+    m_header = nullptr;
+    m_slots = nullptr;
+    m_mappedSize = 0;
+}
+
+size_t SharedEventReader::read(StylusEvent* events, size_t capacity, uint64_t& lost)
+{
+    if (m_header == nullptr || capacity == 0) {
+        return 0;
+    }
+    const uint64_t published = m_header->published.load(std::memory_order_acquire);
+    if (published == m_cursor) {
+        return 0;
+    }
+    if (published - m_cursor > m_capacity) {
+        lost += published - m_capacity - m_cursor;
+        m_cursor = published - m_capacity;
+    }
+
+    uint64_t available = published - m_cursor;
+    size_t n = available < capacity ? static_cast<size_t>(available) : capacity;
+    size_t offset = static_cast<size_t>(m_cursor & m_mask);
+    size_t first = n < m_capacity - offset ? n : static_cast<size_t>(m_capacity - offset);
+    std::memcpy(events, m_slots + offset, first * sizeof(StylusEvent));
+    if (n > first) {
+        std::memcpy(events + first, m_slots, (n - first) * sizeof(StylusEvent));
+    }
+
+    // Anything the writer may have started overwriting during the copy is
+    // dropped from the front of what was copied
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t writeLimit = m_header->writeLimit.load(std::memory_order_relaxed);
+    uint64_t valid = writeLimit > m_capacity ? writeLimit - m_capacity : 0;
+    size_t torn = 0;
+    if (valid > m_cursor) {
+        torn = valid - m_cursor < n ? static_cast<size_t>(valid - m_cursor) : n;
+        std::memmove(events, events + torn, (n - torn) * sizeof(StylusEvent));
+        lost += torn;
+    }
+    m_cursor += n;
+    return n - torn;
+}
+
+size_t SharedEventReader::readWait(StylusEvent* events, size_t capacity, uint64_t& lost, uint32_t timeoutMs)
+{
+    uint64_t lostBefore = lost;
+    size_t n = read(events, capacity, lost);
+    if (n > 0 || lost != lostBefore || m_header == nullptr) {
+        return n;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t deadlineNs = uint64_t(now.tv_sec) * 1000000000ull + uint64_t(now.tv_nsec) +
+                          uint64_t(timeoutMs) * 1000000ull;
+    for (;;) {
+        // Sample the futex word before the last check: a publish after it
+        // changes the word and the wait returns at once
+        uint32_t word = m_header->futexWord.load(std::memory_order_acquire);
+        n = read(events, capacity, lost);
+        if (n > 0 || lost != lostBefore || m_header->closed.load(std::memory_order_acquire) != 0) {
+            return n;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        uint64_t nowNs = uint64_t(now.tv_sec) * 1000000000ull + uint64_t(now.tv_nsec);
+        if (nowNs >= deadlineNs) {
+            return 0;
+        }
+        // Wake up now and then to notice a writer that died without closing
+        uint64_t sliceNs = deadlineNs - nowNs < 100000000ull ? deadlineNs - nowNs : 100000000ull;
+        struct timespec timeout;
+        timeout.tv_sec = static_cast<time_t>(sliceNs / 1000000000ull);
+        timeout.tv_nsec = static_cast<long>(sliceNs % 1000000000ull);
+        if (syscall(SYS_futex, &m_header->futexWord, FUTEX_WAIT, word, &timeout, nullptr, 0) != 0 &&
+            errno == ETIMEDOUT && !processAlive(m_header->writerPid)) {
+            return 0;
+        }
+    }
+}
+
+bool SharedEventReader::writerGone() const
+{
+    return m_header == nullptr || m_header->closed.load(std::memory_order_acquire) != 0 ||
+           !processAlive(m_header->writerPid);
+}
+
+uint64_t SharedEventReader::lag() const
+{
+    return m_header != nullptr ? m_header->published.load(std::memory_order_acquire) - m_cursor : 0;
+}
+
+#endif // __linux__
@@ -0,0 +1,760 @@
+#include "../include/StreamRelay.h"
+
+#ifdef __linux__
+
+#include "../include/WT13106Connection.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// Queued messages gathered into one sendmsg() per client
+const size_t kMaxIovecs = 64;
+
+// Batches taken from the reader thread per pop
+const size_t kPopBatches = 64;
+
+// Largest non-event message a client accepts (they are all tiny)
+const uint32_t kMaxControlLength = 4096;
+
+uint64_t steadyNowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+std::string errorText(const std::string& what, int error)
+{
+    return what + ": " + std::strerror(error);
+}
+
+void closeFd(int& fd)
+{
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool unixAddress(const std::string& path, struct sockaddr_un& address)
+{
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+struct sockaddr_in loopbackAddress(int port)
+{
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return address;
+}
+
+} // namespace
+
+/**
+ * @brief One encoded message, shared by every client queue it is in
+ */
+struct StreamRelay::Batch {
+    std::vector<uint8_t> bytes;  // RelayMessageHeader + payload
+    uint64_t events = 0;
+};
+
+struct StreamRelay::Client {
+    int fd = -1;
+    std::deque<std::shared_ptr<Batch>> queue;
+    size_t headOffset = 0;         // Bytes of queue.front() already sent
+    size_t queuedBytes = 0;        // Unsent bytes in queue
+    uint64_t lost = 0;             // Events dropped since the last RELAY_LOST
+    bool waitingWritable = false;  // Registered for EPOLLOUT
+    bool closed = false;
+};
+
+StreamRelay::StreamRelay(const StreamRelayOptions& options)
+    : m_options(options)
+    , m_connection(nullptr)
+    , m_running(false)
+    , m_stopRequested(false)
+    , m_epollFd(-1)
+    , m_wakeFd(-1)
+    , m_unixFd(-1)
+    , m_tcpFd(-1)
+    , m_boundTcpPort(-1)
+    , m_wakePending(false)
+    , m_droppedEvents(0)
+    , m_clientsServed(0)
+    , m_eventsIn(0)
+    , m_batchesIn(0)
+    , m_batchesDropped(0)
+    , m_eventsLost(0)
+    , m_bytesSent(0)
+    , m_writeCalls(0)
+    , m_clientCount(0)
+{
+}
+
+StreamRelay::~StreamRelay()
+{
+    stop();
+}
+
+bool StreamRelay::start(WT13106Connection& connection)
+{
+    if (m_running) {
+        m_lastError = "Relay is already running";
+        return false;
+    }
+    if (m_options.unixPath.empty() && m_options.tcpPort < 0) {
+        m_lastError = "No socket to listen on";
+        return false;
+    }
+
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_epollFd < 0 || m_wakeFd < 0) {
+        m_lastError = errorText("Failed to create the relay's event loop", errno);
+        closeSockets();
+        return false;
+    }
+    if ((!m_options.unixPath.empty() && !listenUnix(m_options.unixPath)) ||
+        (m_options.tcpPort >= 0 && !listenTcp(m_options.tcpPort))) {
+        closeSockets();
+        return false;
+    }
+    for (int* fd : {&m_wakeFd, &m_unixFd, &m_tcpFd}) {
+        if (*fd >= 0) {
+            struct epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.ptr = fd;
+            epoll_ctl(m_epollFd, EPOLL_CTL_ADD, *fd, &event);
+        }
+    }
+
+    m_hello = std::make_shared<Batch>();
+    RelayMessageHeader header = {sizeof(RelayHello), RELAY_HELLO};
+    RelayHello hello = {kRelayProtocolVersion, sizeof(StylusEvent)};
+    m_hello->bytes.resize(sizeof(header) + sizeof(hello));
+    std::memcpy(m_hello->bytes.data(), &header, sizeof(header));
+    std::memcpy(m_hello->bytes.data() + sizeof(header), &hello, sizeof(hello));
+
+    m_pending.reset(new SpscRingBuffer<Batch*>(m_options.pendingBatches));
+    m_decoder.reset();
+    m_wakePending = false;
+    m_droppedEvents = 0;
+    for (std::atomic<uint64_t>* counter : {&m_clientsServed, &m_eventsIn, &m_batchesIn, &m_batchesDropped,
+                                           &m_eventsLost, &m_bytesSent, &m_writeCalls, &m_clientCount}) {
+        counter->store(0, std::memory_order_relaxed);
+    }
+
+    m_stopRequested = false;
+    m_running = true;
+    m_thread = std::thread(&StreamRelay::run, this);
+
+    if (!connection.startStreaming(StreamingOptions(), [this](const uint8_t* data, size_t length) {
+            onChunk(data, length);
+        })) {
+        m_lastError = connection.getLastError();
+        stop();
+        return false;
+    }
+    m_connection = &connection;
+    return true;
+}
+
+void StreamRelay::stop()
+{
+    if (m_connection) {
+        m_connection->stopStreaming();
+        m_connection = nullptr;
+    }
+    if (m_thread.joinable()) {
+        m_stopRequested = true;
+        uint64_t one = 1;
+        ssize_t ignored = write(m_wakeFd, &one, sizeof(one));
+        (void)ignored;
+        m_thread.join();
+    }
+
+    for (auto& client : m_clients) {
+        closeFd(client->fd);
+    }
+    m_clients.clear();
+    m_clientCount = 0;
+    if (m_pending) {
+        Batch* batch = nullptr;
+        while (m_pending->pop(&batch, 1) == 1) {
+            delete batch;
+        }
+        m_pending.reset();
+    }
+    m_hello.reset();
+    closeSockets();
+    m_running = false;
+}
+
+StreamRelayStats StreamRelay::getStats() const
+{
+    StreamRelayStats stats;
+    stats.clients = m_clientCount.load(std::memory_order_relaxed);
+    stats.clientsServed = m_clientsServed.load(std::memory_order_relaxed);
+    stats.eventsIn = m_eventsIn.load(std::memory_order_relaxed);
+    stats.batchesIn = m_batchesIn.load(std::memory_order_relaxed);
+    stats.batchesDropped = m_batchesDropped.load(std::memory_order_relaxed);
+    stats.eventsLost = m_eventsLost.load(std::memory_order_relaxed);
+    stats.bytesSent = m_bytesSent.load(std::memory_order_relaxed);
+    stats.writeCalls = m_writeCalls.load(std::memory_order_relaxed);
+    return stats;
+}
+
+bool StreamRelay::listenUnix(const std::string& path)
+{
+    struct sockaddr_un address;
+    if (!unixAddress(path, address)) {
+        m_lastError = "Invalid socket path " + path;
+        return false;
+    }
+
+    // A socket left behind by a relay that exited is replaced; one that
+    // still accepts connections is not
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            m_lastError = path + " exists and is not a socket";
+            return false;
+        }
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool live = probe >= 0 &&
+                    ::connect(probe, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) == 0;
+        closeFd(probe);
+        if (live) {
+            m_lastError = path + " is in use by a running relay";
+            return false;
+        }
+        unlink(path.c_str());
+    }
+
+    m_unixFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_unixFd < 0 ||
+        bind(m_unixFd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(m_unixFd, SOMAXCONN) != 0) {
+        m_lastError = errorText("Failed to listen on " + path, errno);
+        closeFd(m_unixFd);
+        return false;
+    }
+    return true;
+}
+
+bool StreamRelay::listenTcp(int port)
+{
+    struct sockaddr_in address = loopbackAddress(port);
+    int one = 1;
+    m_tcpFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_tcpFd < 0 ||
+        setsockopt(m_tcpFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+        bind(m_tcpFd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(m_tcpFd, SOMAXCONN) != 0) {
+        m_lastError = errorText("Failed to listen on 127.0.0.1:" + std::to_string(port), errno);
+        closeFd(m_tcpFd);
+        return false;
+    }
+    socklen_t length = sizeof(address);
+    getsockname(m_tcpFd, reinterpret_cast<struct sockaddr*>(&address), &length);
+    m_boundTcpPort = ntohs(address.sin_port);
+    return true;
+}
+
+void StreamRelay::closeSockets()
+{
+    if (m_unixFd >= 0) {
+        unlink(m_options.unixPath.c_str());
+    }
+    closeFd(m_unixFd);
+    closeFd(m_tcpFd);
+    closeFd(m_wakeFd);
+    closeFd(m_epollFd);
+    m_boundTcpPort = -1;
+}
+
+void StreamRelay::onChunk(const uint8_t* data, size_t length)
+{
+    const uint64_t timestampNs = steadyNowNs();
+
+    // Decode straight behind the message header; a chunk cannot complete
+    // more pen frames than it and the decoder's partial frame hold
+    std::unique_ptr<Batch> batch(new Batch);
+    size_t capacity = (m_decoder.pendingBytes() + length) / PEN_FRAME_SIZE + 1;
+    size_t produced = 0;
+    size_t offset = 0;
+    while (offset < length) {
+        batch->bytes.resize(sizeof(RelayMessageHeader) + capacity * sizeof(StylusEvent));
+        StylusEvent* events = reinterpret_cast<StylusEvent*>(batch->bytes.data() + sizeof(RelayMessageHeader));
+        size_t n = 0;
+        offset += m_decoder.decode(data + offset, length - offset, timestampNs, events + produced,
+                                   capacity - produced, n);
+        produced += n;
+        if (produced == capacity) {
+            capacity *= 2;
+        }
+    }
+    if (produced == 0) {
+        return;
+    }
+
+    RelayMessageHeader header = {static_cast<uint32_t>(produced * sizeof(StylusEvent)), RELAY_EVENTS};
+    batch->bytes.resize(sizeof(header) + header.length);
+    std::memcpy(batch->bytes.data(), &header, sizeof(header));
+    batch->events = produced;
+    m_eventsIn.fetch_add(produced, std::memory_order_relaxed);
+    m_batchesIn.fetch_add(1, std::memory_order_relaxed);
+
+    // Never wait for the relay thread: if it is that far behind, the batch is
+    // lost for every client and they are told so
+    Batch* raw = batch.get();
+    if (m_pending->push(&raw, 1) == 0) {
+        m_batchesDropped.fetch_add(1, std::memory_order_relaxed);
+        m_droppedEvents.fetch_add(produced, std::memory_order_relaxed);
+        return;
+    }
+    batch.release();
+
+    // One eventfd write per relay thread wake-up, not per chunk; pairs with
+    // the store and fence in run()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!m_wakePending.exchange(true)) {
+        uint64_t one = 1;
+        ssize_t ignored = write(m_wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+void StreamRelay::run()
+{
+    struct epoll_event events[64];
+    while (!m_stopRequested) {
+        int ready = epoll_wait(m_epollFd, events, 64, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        for (int i = 0; i < ready; ++i) {
+            void* tag = events[i].data.ptr;
+            if (tag == &m_wakeFd) {
+                uint64_t count;
+                ssize_t ignored = read(m_wakeFd, &count, sizeof(count));
+                (void)ignored;
+                m_wakePending = false;
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                distribute();
+                continue;
+            }
+            if (tag == &m_unixFd || tag == &m_tcpFd) {
+                accept(*static_cast<int*>(tag));
+                continue;
+            }
+
+            Client& client = *static_cast<Client*>(tag);
+            if (client.closed) {
+                continue;
+            }
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                closeClient(client);
+                continue;
+            }
+            if (events[i].events & EPOLLIN) {
+                // Clients have nothing to say; read only to notice them leaving
+                uint8_t discard[256];
+                ssize_t n = recv(client.fd, discard, sizeof(discard), MSG_DONTWAIT);
+                if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                    closeClient(client);
+                    continue;
+                }
+            }
+            if ((events[i].events & EPOLLOUT) && !flush(client)) {
+                closeClient(client);
+            }
+        }
+        sweepClients();
+    }
+}
+
+void StreamRelay::accept(int listenFd)
+{
+    for (;;) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        if (m_clients.size() >= m_options.maxClients) {
+            ::close(fd);
+            continue;
+        }
+        if (listenFd == m_tcpFd) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+
+        std::unique_ptr<Client> client(new Client);
+        client->fd = fd;
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.ptr = client.get();
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            ::close(fd);
+            continue;
+        }
+        client->queue.push_back(m_hello);
+        client->queuedBytes = m_hello->bytes.size();
+        m_clients.push_back(std::move(client));
+        m_clientsServed.fetch_add(1, std::memory_order_relaxed);
+        m_clientCount.store(m_clients.size(), std::memory_order_relaxed);
+        if (!flush(*m_clients.back())) {
+            closeClient(*m_clients.back());
+        }
+    }
+}
+
+void StreamRelay::distribute()
+{
+    uint64_t dropped = m_droppedEvents.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        for (auto& client : m_clients) {
+            client->lost += dropped;
+        }
+    }
+
+    Batch* taken[kPopBatches];
+    size_t count;
+    while ((count = m_pending->pop(taken, kPopBatches)) > 0) {
+        for (size_t i = 0; i < count; ++i) {
+            std::shared_ptr<Batch> batch(taken[i]);
+            for (auto& client : m_clients) {
+                if (!client->closed) {
+                    enqueue(*client, batch);
+                }
+            }
+        }
+    }
+
+    // Everything that arrived since the last wake-up goes out in as few
+    // calls as the sockets allow; clients waiting for EPOLLOUT are skipped
+    for (auto& client : m_clients) {
+        if (!client->closed && !client->waitingWritable && !client->queue.empty() && !flush(*client)) {
+            closeClient(*client);
+        }
+    }
+}
+
+void StreamRelay::enqueue(Client& client, const std::shared_ptr<Batch>& batch)
+{
+    if (client.queuedBytes + batch->bytes.size() > m_options.clientQueueBytes) {
+        client.lost += batch->events;
+        m_eventsLost.fetch_add(batch->events, std::memory_order_relaxed);
+        return;
+    }
+
+    if (client.lost > 0) {
+        std::shared_ptr<Batch> notice = std::make_shared<Batch>();
+        RelayMessageHeader header = {sizeof(uint64_t), RELAY_LOST};
+        notice->bytes.resize(sizeof(header) + sizeof(uint64_t));
+        std::memcpy(notice->bytes.data(), &header, sizeof(header));
+        std::memcpy(notice->bytes.data() + sizeof(header), &client.lost, sizeof(uint64_t));
+        client.queue.push_back(notice);
+        client.queuedBytes += notice->bytes.size();
+        client.lost = 0;
+    }
+    client.queue.push_back(batch);
+    client.queuedBytes += batch->bytes.size();
+}
+
+bool StreamRelay::flush(Client& client)
+{
+    while (!client.queue.empty()) {
+        struct iovec iov[kMaxIovecs];
+        size_t count = 0;
+        size_t total = 0;
+        for (auto it = client.queue.begin(); it != client.queue.end() && count < kMaxIovecs; ++it, ++count) {
+            size_t skip = count == 0 ? client.headOffset : 0;
+            iov[count].iov_base = (*it)->bytes.data() + skip;
+            iov[count].iov_len = (*it)->bytes.size() - skip;
+            total += iov[count].iov_len;
+        }
+
+        struct msghdr message = {};
+        message.msg_iov = iov;
+        message.msg_iovlen = count;
+        ssize_t n = sendmsg(client.fd, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+        m_writeCalls.fetch_add(1, std::memory_order_relaxed);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return false;
+            }
+            n = 0;
+        }
+
+        m_bytesSent.fetch_add(uint64_t(n), std::memory_order_relaxed);
+        client.queuedBytes -= size_t(n);
+        size_t sent = size_t(n);
+        while (sent > 0) {
+            size_t remaining = client.queue.front()->bytes.size() - client.headOffset;
+            if (sent < remaining) {
+                client.headOffset += sent;
+                break;
+            }
+            sent -= remaining;
+            client.queue.pop_front();
+            client.headOffset = 0;
+        }
+
+        if (size_t(n) < total) {
+            // Socket buffer full: continue when it drains
+            if (!client.waitingWritable) {
+                struct epoll_event event = {};
+                event.events = EPOLLIN | EPOLLOUT;
+                event.data.ptr = &client;
+                epoll_ctl(m_epollFd, EPOLL_CTL_MOD, client.fd, &event);
+                client.waitingWritable = true;
+            }
+            return true;
+        }
+    }
+
+    if (client.waitingWritable) {
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.ptr = &client;
+        epoll_ctl(m_epollFd, EPOLL_CTL_MOD, client.fd, &event);
+        client.waitingWritable = false;
+    }
+    return true;
+}
+
+void StreamRelay::closeClient(Client& client)
+{
+    if (client.closed) {
+        return;
+    }
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, client.fd, nullptr);
+    closeFd(client.fd);
+    client.queue.clear();
+    client.queuedBytes = 0;
+    client.closed = true;
+}
+
+void StreamRelay::sweepClients()
+{
+    m_clients.erase(std::remove_if(m_clients.begin(), m_clients.end(),
+                                   [](const std::unique_ptr<Client>& client) { return client->closed; }),
+                    m_clients.end());
+    m_clientCount.store(m_clients.size(), std::memory_order_relaxed);
+}
+
+RelayClient::RelayClient()
+    : m_fd(-1)
+    , m_offset(0)
+    , m_end(0)
+    , m_eventBytesLeft(0)
+{
+}
+
+RelayClient::~RelayClient()
+{
+    close();
+}
+
+bool RelayClient::connect(const std::string& address, uint32_t timeoutMs)
+{
+    close();
+    if (address.compare(0, 4, "tcp:") == 0) {
+        struct sockaddr_in inet = loopbackAddress(std::atoi(address.c_str() + 4));
+        m_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (m_fd >= 0 && ::connect(m_fd, reinterpret_cast<struct sockaddr*>(&inet), sizeof(inet)) == 0) {
+            int one = 1;
+            setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        } else {
+            m_lastError = errorText("Failed to connect to 127.0.0.1:" + address.substr(4), errno);
+            close();
+            return false;
+        }
+    } else {
+        struct sockaddr_un local;
+        if (!unixAddress(address, local)) {
+            m_lastError = "Invalid socket path " + address;
+            return false;
+        }
+        m_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (m_fd < 0 || ::connect(m_fd, reinterpret_cast<struct sockaddr*>(&local), sizeof(local)) != 0) {
+            m_lastError = errorText("Failed to connect to " + address, errno);
+            close();
+            return false;
+        }
+    }
+
+    const size_t helloSize = sizeof(RelayMessageHeader) + sizeof(RelayHello);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (m_fd >= 0 && m_end < helloSize) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0 || !fill(static_cast<uint32_t>(left.count()))) {
+            break;
+        }
+    }
+    RelayMessageHeader header = {};
+    RelayHello hello = {};
+    if (m_end >= helloSize) {
+        std::memcpy(&header, m_buffer.data(), sizeof(header));
+        std::memcpy(&hello, m_buffer.data() + sizeof(header), sizeof(hello));
+    }
+    if (header.type != RELAY_HELLO || header.length != sizeof(RelayHello) ||
+        hello.version != kRelayProtocolVersion || hello.eventSize != sizeof(StylusEvent)) {
+        m_lastError = address + " is not a compatible stream relay";
+        close();
+        return false;
+    }
+    m_offset = helloSize;
+    return true;
+}
+
+void RelayClient::close()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_offset = 0;
+    m_end = 0;
+    m_eventBytesLeft = 0;
+}
+
+size_t RelayClient::receive(StylusEvent* events, size_t capacity, uint64_t& lost, uint32_t timeoutMs)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (m_fd >= 0) {
+        bool ok = true;
+        size_t count = parse(events, capacity, lost, ok);
+        if (!ok) {
+            m_lastError = "Protocol error from stream relay";
+            close();
+            return count;
+        }
+        if (count > 0) {
+            return count;
+        }
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (!fill(static_cast<uint32_t>(std::max<int64_t>(left.count(), 0)))) {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+size_t RelayClient::parse(StylusEvent* events, size_t capacity, uint64_t& lost, bool& ok)
+{
+    size_t copied = 0;
+    while (copied < capacity) {
+        size_t available = m_end - m_offset;
+        if (m_eventBytesLeft > 0) {
+            size_t n = std::min({available, m_eventBytesLeft, (capacity - copied) * sizeof(StylusEvent)}) /
+                       sizeof(StylusEvent);
+            if (n == 0) {
+                break;
+            }
+            std::memcpy(events + copied, m_buffer.data() + m_offset, n * sizeof(StylusEvent));
+            m_offset += n * sizeof(StylusEvent);
+            m_eventBytesLeft -= n * sizeof(StylusEvent);
+            copied += n;
+            continue;
+        }
+
+        RelayMessageHeader header;
+        if (available < sizeof(header)) {
+            break;
+        }
+        std::memcpy(&header, m_buffer.data() + m_offset, sizeof(header));
+        if (header.type == RELAY_EVENTS) {
+            if (header.length % sizeof(StylusEvent) != 0) {
+                ok = false;
+                break;
+            }
+            m_offset += sizeof(header);
+            m_eventBytesLeft = header.length;
+            continue;
+        }
+        if (header.length > kMaxControlLength) {
+            ok = false;
+            break;
+        }
+        if (available < sizeof(header) + header.length) {
+            break;
+        }
+        if (header.type == RELAY_LOST && header.length == sizeof(uint64_t)) {
+            uint64_t count;
+            std::memcpy(&count, m_buffer.data() + m_offset + sizeof(header), sizeof(count));
+            lost += count;
+        }
+        // Anything else (a repeated hello, messages of later versions) is skipped
+        m_offset += sizeof(header) + header.length;
+    }
+    return copied;
+}
+
+bool RelayClient::fill(uint32_t timeoutMs)
+{
+    struct pollfd pfd = {m_fd, POLLIN, 0};
+    if (poll(&pfd, 1, static_cast<int>(timeoutMs)) <= 0) {
+        return false;
+    }
+
+    // Keep at least half a read's worth of room behind the unparsed bytes
+    const size_t readSize = 64 * 1024;
+    if (m_offset == m_end) {
+        m_offset = 0;
+        m_end = 0;
+    } else if (m_buffer.size() - m_end < readSize / 2) {
+        std::memmove(m_buffer.data(), m_buffer.data() + m_offset, m_end - m_offset);
+        m_end -= m_offset;
+        m_offset = 0;
+    }
+    if (m_buffer.size() < m_end + readSize / 2) {
+        m_buffer.resize(m_end + readSize);
+    }
+    ssize_t n = recv(m_fd, m_buffer.data() + m_end, m_buffer.size() - m_end, 0);
+    if (n > 0) {
+        m_end += size_t(n);
+    }
+    if (n == 0 || (n < 0 && errno != EINTR && errno != EAGAIN)) {
+        m_lastError = n == 0 ? "Stream relay closed the connection" : errorText("recv", errno);
+        close();
+        return false;
+    }
+    return n > 0;
+}
+
+#endif // __linux__
@@ -0,0 +1,737 @@
+#include "../include/StrokeArchive.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const uint32_t kBlockMagic = 0x424B5453;  // "STKB"
+const size_t kDirectoryEntrySize = 8 + STROKE_ARCHIVE_BLOCK_HEADER_SIZE;
+const size_t kStrokePrefixSize = 10;     // First x, y, pressure, base time step
+
+void putLE16(uint8_t* p, uint16_t value)
+{
+    p[0] = static_cast<uint8_t>(value);
+    p[1] = static_cast<uint8_t>(value >> 8);
+}
+
+void putLE32(uint8_t* p, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+        p[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+void putLE64(uint8_t* p, uint64_t value)
+{
+    for (int i = 0; i < 8; ++i) {
+        p[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint16_t getLE16(const uint8_t* p)
+{
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t getLE32(const uint8_t* p)
+{
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; --i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+uint64_t getLE64(const uint8_t* p)
+{
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+/**
+ * @brief Eight bytes starting at p as a little-endian integer (one unaligned load)
+ */
+inline uint64_t load64(const uint8_t* p)
+{
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+inline uint64_t zigzag(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+unsigned bitWidth(uint64_t value)
+{
+    unsigned width = 0;
+    while (value) {
+        ++width;
+        value >>= 1;
+    }
+    return width;
+}
+
+/**
+ * @brief Append count values of width bits each, LSB first, padded to a whole byte
+ */
+void appendPacked(std::vector<uint8_t>& out, const uint64_t* values, size_t count, unsigned width)
+{
+    if (width == 0) {
+        return;
+    }
+    size_t start = out.size();
+    out.resize(start + (count * width + 7) / 8, 0);
+    uint8_t* base = out.data() + start;
+    uint64_t position = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t value = values[i];
+        unsigned remaining = width;
+        while (remaining > 0) {
+            unsigned shift = static_cast<unsigned>(position & 7);
+            unsigned take = std::min(8 - shift, remaining);
+            base[position >> 3] |= static_cast<uint8_t>((value & ((1u << take) - 1)) << shift);
+            value >>= take;
+            position += take;
+            remaining -= take;
+        }
+    }
+}
+
+/**
+ * @brief Value i of a packed column; may read up to 8 bytes past the column
+ */
+inline uint64_t extract(const uint8_t* column, uint64_t bit, unsigned width, uint64_t mask)
+{
+    if (width <= 56) {
+        return (load64(column + (bit >> 3)) >> (bit & 7)) & mask;
+    }
+    uint64_t low = (load64(column + (bit >> 3)) >> (bit & 7)) & 0xFFFFFFFFu;
+    uint64_t high = load64(column + ((bit + 32) >> 3)) >> ((bit + 32) & 7);
+    return (low | (high << 32)) & mask;
+}
+
+inline uint64_t maskFor(unsigned width)
+{
+    return width >= 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+}
+
+/**
+ * @brief Undo the delta coding of one coordinate column into out[0 .. count)
+ */
+inline void decodeDeltas(const uint8_t* column, unsigned width, size_t count, int64_t& value, uint16_t* out)
+{
+    if (width == 0) {
+        // Constant run
+        if (out) {
+            std::fill(out, out + count, static_cast<uint16_t>(value));
+        }
+        return;
+    }
+    const uint64_t mask = maskFor(width);
+    uint64_t bit = 0;
+    for (size_t i = 0; i < count; ++i, bit += width) {
+        value += unzigzag(extract(column, bit, width, mask));
+        if (out) {
+            out[i] = static_cast<uint16_t>(value);
+        }
+    }
+}
+
+void putBlockHeader(uint8_t* p, const ArchiveBlockInfo& block)
+{
+    putLE32(p, kBlockMagic);
+    putLE32(p + 4, block.size);
+    putLE32(p + 8, block.strokeCount);
+    putLE32(p + 12, block.pointCount);
+    putLE64(p + 16, block.startNs);
+    putLE64(p + 24, block.endNs);
+    putLE16(p + 32, block.bounds.minX);
+    putLE16(p + 34, block.bounds.minY);
+    putLE16(p + 36, block.bounds.maxX);
+    putLE16(p + 38, block.bounds.maxY);
+    putLE32(p + 40, block.firstPage);
+    putLE32(p + 44, block.lastPage);
+}
+
+/**
+ * @brief Parse and sanity-check a block header located at offset in a file of fileSize bytes
+ */
+bool getBlockHeader(const uint8_t* p, uint64_t offset, uint64_t fileSize, ArchiveBlockInfo& block)
+{
+    if (getLE32(p) != kBlockMagic) {
+        return false;
+    }
+    block.offset = offset;
+    block.size = getLE32(p + 4);
+    block.strokeCount = getLE32(p + 8);
+    block.pointCount = getLE32(p + 12);
+    block.startNs = getLE64(p + 16);
+    block.endNs = getLE64(p + 24);
+    block.bounds = StrokeBounds{getLE16(p + 32), getLE16(p + 34), getLE16(p + 36), getLE16(p + 38)};
+    block.firstPage = getLE32(p + 40);
+    block.lastPage = getLE32(p + 44);
+    uint64_t minimum = STROKE_ARCHIVE_BLOCK_HEADER_SIZE +
+                       static_cast<uint64_t>(block.strokeCount) * STROKE_ARCHIVE_INDEX_ENTRY_SIZE +
+                       STROKE_ARCHIVE_BLOCK_PADDING;
+    return block.size >= minimum && offset + block.size <= fileSize;
+}
+
+bool boundsIntersect(const StrokeBounds& a, const StrokeBounds& b)
+{
+    return a.minX <= b.maxX && b.minX <= a.maxX && a.minY <= b.maxY && b.minY <= a.maxY;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// StrokeArchiveWriter
+
+StrokeArchiveWriter::StrokeArchiveWriter()
+    : m_file(nullptr)
+    , m_offset(0)
+    , m_strokeCount(0)
+    , m_pointCount(0)
+    , m_block()
+{
+}
+
+StrokeArchiveWriter::~StrokeArchiveWriter()
+{
+    if (m_file) {
+        close();
+    }
+}
+
+bool StrokeArchiveWriter::open(const std::string& path, const StrokeArchiveOptions& options)
+{
+    if (m_file) {
+        close();
+    }
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) {
+        m_lastError = "Failed to create stroke archive: " + path;
+        return false;
+    }
+
+    m_options = options;
+    if (m_options.timeResolutionNs == 0) {
+        m_options.timeResolutionNs = 1;
+    }
+    m_offset = 0;
+    m_strokeCount = 0;
+    m_pointCount = 0;
+    m_index.clear();
+    m_payload.clear();
+    m_block = ArchiveBlockInfo();
+    m_directory.clear();
+    m_columns.resize(4 * STROKE_ARCHIVE_GROUP_SIZE);
+
+    uint8_t header[STROKE_ARCHIVE_HEADER_SIZE] = {};
+    std::memcpy(header, STROKE_ARCHIVE_MAGIC, sizeof(STROKE_ARCHIVE_MAGIC));
+    putLE32(header + 8, STROKE_ARCHIVE_VERSION);
+    putLE32(header + 12, static_cast<uint32_t>(STROKE_ARCHIVE_HEADER_SIZE));
+    putLE32(header + 16, m_options.timeResolutionNs);
+    if (!writeBytes(header, sizeof(header))) {
+        std::fclose(m_file);
+        m_file = nullptr;
+        return false;
+    }
+    m_lastError = "";
+    return true;
+}
+
+bool StrokeArchiveWriter::append(const Stroke& stroke)
+{
+    if (!m_file) {
+        m_lastError = "Stroke archive is not open";
+        return false;
+    }
+    if (stroke.count == 0) {
+        return true;
+    }
+
+    encodeStroke(stroke);
+    m_strokeCount++;
+    m_pointCount += stroke.count;
+
+    if (m_block.pointCount >= m_options.pointsPerBlock) {
+        return writeBlock();
+    }
+    return true;
+}
+
+bool StrokeArchiveWriter::flush()
+{
+    if (!m_file) {
+        return false;
+    }
+    return writeBlock() && std::fflush(m_file) == 0;
+}
+
+bool StrokeArchiveWriter::close()
+{
+    if (!m_file) {
+        return false;
+    }
+
+    bool ok = writeBlock();
+
+    uint64_t directoryOffset = m_offset;
+    for (const ArchiveBlockInfo& block : m_directory) {
+        if (!ok) {
+            break;
+        }
+        uint8_t entry[kDirectoryEntrySize];
+        putLE64(entry, block.offset);
+        putBlockHeader(entry + 8, block);
+        ok = writeBytes(entry, sizeof(entry));
+    }
+
+    uint8_t trailer[STROKE_ARCHIVE_TRAILER_SIZE];
+    std::memcpy(trailer, STROKE_ARCHIVE_TRAILER_MAGIC, sizeof(STROKE_ARCHIVE_TRAILER_MAGIC));
+    putLE64(trailer + 8, directoryOffset);
+    putLE64(trailer + 16, m_directory.size());
+    putLE64(trailer + 24, m_strokeCount);
+    ok = ok && writeBytes(trailer, sizeof(trailer));
+
+    if (std::fclose(m_file) != 0) {
+        ok = false;
+    }
+    m_file = nullptr;
+    if (!ok) {
+        m_lastError = "Failed to finish stroke archive";
+    }
+    return ok;
+}
+
+void StrokeArchiveWriter::encodeStroke(const Stroke& stroke)
+{
+    const uint32_t count = stroke.count;
+    const int64_t resolution = m_options.timeResolutionNs;
+
+    // Block summary
+    if (m_block.strokeCount == 0) {
+        m_block.startNs = stroke.startNs();
+        m_block.bounds = stroke.bounds;
+        m_block.firstPage = stroke.page;
+    } else {
+        m_block.bounds.minX = std::min(m_block.bounds.minX, stroke.bounds.minX);
+        m_block.bounds.minY = std::min(m_block.bounds.minY, stroke.bounds.minY);
+        m_block.bounds.maxX = std::max(m_block.bounds.maxX, stroke.bounds.maxX);
+        m_block.bounds.maxY = std::max(m_block.bounds.maxY, stroke.bounds.maxY);
+    }
+    m_block.endNs = std::max(m_block.endNs, stroke.endNs());
+    m_block.lastPage = stroke.page;
+    m_block.strokeCount++;
+    m_block.pointCount += count;
+
+    // Times relative to the first point, in units of the resolution (rounded)
+    const uint64_t firstNs = stroke.timestampNs[0];
+    auto quantize = [&](uint32_t i) {
+        int64_t delta = static_cast<int64_t>(stroke.timestampNs[i] - firstNs);
+        return delta >= 0 ? (delta + resolution / 2) / resolution : -((-delta + resolution / 2) / resolution);
+    };
+    int64_t baseStep = count > 1 ? std::min<int64_t>(std::max<int64_t>(quantize(1), 0), 0xFFFFFFFF) : 0;
+
+    // Index entry (payload offset is relative to the payloads until the block is written)
+    const size_t payloadStart = m_payload.size();
+    size_t entryOffset = m_index.size();
+    m_index.resize(entryOffset + STROKE_ARCHIVE_INDEX_ENTRY_SIZE);
+
+    uint8_t prefix[kStrokePrefixSize];
+    putLE16(prefix, stroke.x[0]);
+    putLE16(prefix + 2, stroke.y[0]);
+    putLE16(prefix + 4, stroke.pressure[0]);
+    putLE32(prefix + 6, static_cast<uint32_t>(baseStep));
+    m_payload.insert(m_payload.end(), prefix, prefix + sizeof(prefix));
+
+    uint64_t* xs = m_columns.data();
+    uint64_t* ys = xs + STROKE_ARCHIVE_GROUP_SIZE;
+    uint64_t* pressures = ys + STROKE_ARCHIVE_GROUP_SIZE;
+    uint64_t* steps = pressures + STROKE_ARCHIVE_GROUP_SIZE;
+    int64_t previousTime = 0;
+    int64_t previousStep = baseStep;
+    for (uint32_t groupStart = 1; groupStart < count; groupStart += STROKE_ARCHIVE_GROUP_SIZE) {
+        uint32_t groupCount = std::min<uint32_t>(static_cast<uint32_t>(STROKE_ARCHIVE_GROUP_SIZE), count - groupStart);
+        uint64_t widthBits[4] = {0, 0, 0, 0};
+        for (uint32_t k = 0; k < groupCount; ++k) {
+            uint32_t i = groupStart + k;
+            int64_t time = quantize(i);
+            int64_t step = time - previousTime;
+            xs[k] = zigzag(static_cast<int64_t>(stroke.x[i]) - stroke.x[i - 1]);
+            ys[k] = zigzag(static_cast<int64_t>(stroke.y[i]) - stroke.y[i - 1]);
+            pressures[k] = zigzag(static_cast<int64_t>(stroke.pressure[i]) - stroke.pressure[i - 1]);
+            steps[k] = zigzag(step - previousStep);
+            previousTime = time;
+            previousStep = step;
+            widthBits[0] |= xs[k];
+            widthBits[1] |= ys[k];
+            widthBits[2] |= pressures[k];
+            widthBits[3] |= steps[k];
+        }
+        unsigned widths[4];
+        for (int c = 0; c < 4; ++c) {
+            widths[c] = bitWidth(widthBits[c]);
+            m_payload.push_back(static_cast<uint8_t>(widths[c]));
+        }
+        appendPacked(m_payload, xs, groupCount, widths[0]);
+        appendPacked(m_payload, ys, groupCount, widths[1]);
+        appendPacked(m_payload, pressures, groupCount, widths[2]);
+        appendPacked(m_payload, steps, groupCount, widths[3]);
+    }
+
+    uint8_t* entry = m_index.data() + entryOffset;
+    putLE64(entry, stroke.startNs());
+    putLE64(entry + 8, stroke.endNs());
+    putLE16(entry + 16, stroke.bounds.minX);
+    putLE16(entry + 18, stroke.bounds.minY);
+    putLE16(entry + 20, stroke.bounds.maxX);
+    putLE16(entry + 22, stroke.bounds.maxY);
+    putLE32(entry + 24, count);
+    putLE32(entry + 28, stroke.page);
+    putLE32(entry + 32, static_cast<uint32_t>(payloadStart));
+    putLE32(entry + 36, static_cast<uint32_t>(m_payload.size() - payloadStart));
+}
+
+bool StrokeArchiveWriter::writeBlock()
+{
+    if (m_block.strokeCount == 0) {
+        return true;
+    }
+
+    // Payload offsets become relative to the block start
+    const uint32_t payloadBase = static_cast<uint32_t>(STROKE_ARCHIVE_BLOCK_HEADER_SIZE + m_index.size());
+    for (size_t entry = 0; entry < m_index.size(); entry += STROKE_ARCHIVE_INDEX_ENTRY_SIZE) {
+        uint8_t* field = m_index.data() + entry + 32;
+        putLE32(field, getLE32(field) + payloadBase);
+    }
+
+    m_block.offset = m_offset;
+    m_block.size = static_cast<uint32_t>(payloadBase + m_payload.size() + STROKE_ARCHIVE_BLOCK_PADDING);
+    uint8_t header[STROKE_ARCHIVE_BLOCK_HEADER_SIZE];
+    putBlockHeader(header, m_block);
+    const uint8_t padding[STROKE_ARCHIVE_BLOCK_PADDING] = {};
+    if (!writeBytes(header, sizeof(header)) || !writeBytes(m_index.data(), m_index.size()) ||
+        !writeBytes(m_payload.data(), m_payload.size()) || !writeBytes(padding, sizeof(padding))) {
+        return false;
+    }
+
+    m_directory.push_back(m_block);
+    m_block = ArchiveBlockInfo();
+    m_index.clear();
+    m_payload.clear();
+    return true;
+}
+
+bool StrokeArchiveWriter::writeBytes(const void* data, size_t length)
+{
+    if (length > 0 && std::fwrite(data, 1, length, m_file) != length) {
+        m_lastError = "Failed to write stroke archive";
+        return false;
+    }
+    m_offset += length;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// StrokeArchiveReader
+
+StrokeArchiveReader::StrokeArchiveReader()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_timeResolutionNs(1)
+    , m_strokeCount(0)
+    , m_pointCount(0)
+    , m_hasTrailer(false)
+#ifdef _WIN32
+    , m_fileHandle(nullptr)
+    , m_mappingHandle(nullptr)
+#endif
+{
+}
+
+StrokeArchiveReader::~StrokeArchiveReader()
+{
+    close();
+}
+
+bool StrokeArchiveReader::open(const std::string& path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        m_lastError = "Failed to open stroke archive: " + path;
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < static_cast<LONGLONG>(STROKE_ARCHIVE_HEADER_SIZE)) {
+        CloseHandle(file);
+        m_lastError = "Not a stroke archive (too short): " + path;
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        m_lastError = "Failed to map stroke archive: " + path;
+        return false;
+    }
+    m_fileHandle = file;
+    m_mappingHandle = mapping;
+    m_data = static_cast<const uint8_t*>(view);
+    m_size = static_cast<uint64_t>(size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        m_lastError = "Failed to open stroke archive: " + path;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(STROKE_ARCHIVE_HEADER_SIZE)) {
+        ::close(fd);
+        m_lastError = "Not a stroke archive (too short): " + path;
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // The mapping keeps the file alive
+    if (view == MAP_FAILED) {
+        m_lastError = "Failed to map stroke archive: " + path;
+        return false;
+    }
+    m_data = static_cast<const uint8_t*>(view);
+    m_size = static_cast<uint64_t>(info.st_size);
+#endif
+
+    if (std::memcmp(m_data, STROKE_ARCHIVE_MAGIC, sizeof(STROKE_ARCHIVE_MAGIC)) != 0 ||
+        getLE32(m_data + 8) != STROKE_ARCHIVE_VERSION) {
+        close();
+        m_lastError = "Not a stroke archive or unsupported version: " + path;
+        return false;
+    }
+    m_timeResolutionNs = std::max<uint32_t>(getLE32(m_data + 16), 1);
+
+    m_hasTrailer = false;
+    if (m_size >= STROKE_ARCHIVE_HEADER_SIZE + STROKE_ARCHIVE_TRAILER_SIZE) {
+        const uint8_t* trailer = m_data + m_size - STROKE_ARCHIVE_TRAILER_SIZE;
+        if (std::memcmp(trailer, STROKE_ARCHIVE_TRAILER_MAGIC, sizeof(STROKE_ARCHIVE_TRAILER_MAGIC)) == 0) {
+            m_hasTrailer = loadDirectory(getLE64(trailer + 8), getLE64(trailer + 16));
+        }
+    }
+    if (!m_hasTrailer) {
+        rebuildDirectory();
+    }
+
+    m_strokeCount = 0;
+    m_pointCount = 0;
+    for (const ArchiveBlockInfo& block : m_blocks) {
+        m_strokeCount += block.strokeCount;
+        m_pointCount += block.pointCount;
+    }
+    m_lastError = "";
+    return true;
+}
+
+void StrokeArchiveReader::close()
+{
+    if (!m_data) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(static_cast<HANDLE>(m_mappingHandle));
+    CloseHandle(static_cast<HANDLE>(m_fileHandle));
+    m_mappingHandle = nullptr;
+    m_fileHandle = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(m_data), static_cast<size_t>(m_size));
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_blocks.clear();
+    m_strokeCount = 0;
+    m_pointCount = 0;
+}
+
+size_t StrokeArchiveReader::findStrokes(const ArchiveQuery& query, std::vector<ArchiveStrokeRef>& out) const
+{
+    const size_t before = out.size();
+    for (size_t b = 0; b < m_blocks.size(); ++b) {
+        const ArchiveBlockInfo& block = m_blocks[b];
+        if (block.endNs < query.fromNs || block.startNs > query.toNs || block.lastPage < query.firstPage ||
+            block.firstPage > query.lastPage || !boundsIntersect(block.bounds, query.region)) {
+            continue;
+        }
+
+        const uint8_t* entry = m_data + block.offset + STROKE_ARCHIVE_BLOCK_HEADER_SIZE;
+        for (uint32_t i = 0; i < block.strokeCount; ++i, entry += STROKE_ARCHIVE_INDEX_ENTRY_SIZE) {
+            ArchiveStrokeRef ref;
+            ref.startNs = getLE64(entry);
+            ref.endNs = getLE64(entry + 8);
+            if (ref.endNs < query.fromNs || ref.startNs > query.toNs) {
+                continue;
+            }
+            ref.page = getLE32(entry + 28);
+            if (ref.page < query.firstPage || ref.page > query.lastPage) {
+                continue;
+            }
+            ref.bounds = StrokeBounds{getLE16(entry + 16), getLE16(entry + 18), getLE16(entry + 20), getLE16(entry + 22)};
+            if (!boundsIntersect(ref.bounds, query.region)) {
+                continue;
+            }
+            ref.block = static_cast<uint32_t>(b);
+            ref.index = i;
+            ref.pointCount = getLE32(entry + 24);
+            out.push_back(ref);
+        }
+    }
+    return out.size() - before;
+}
+
+bool StrokeArchiveReader::decodeStroke(const ArchiveStrokeRef& ref, uint16_t* x, uint16_t* y, uint16_t* pressure,
+                                       uint64_t* timestampNs) const
+{
+    if (ref.block >= m_blocks.size() || ref.index >= m_blocks[ref.block].strokeCount) {
+        return false;
+    }
+    const ArchiveBlockInfo& block = m_blocks[ref.block];
+    const uint8_t* blockData = m_data + block.offset;
+    const uint8_t* entry = blockData + STROKE_ARCHIVE_BLOCK_HEADER_SIZE + ref.index * STROKE_ARCHIVE_INDEX_ENTRY_SIZE;
+    const uint64_t startNs = getLE64(entry);
+    const uint32_t count = getLE32(entry + 24);
+    const uint32_t payloadOffset = getLE32(entry + 32);
+    const uint32_t payloadSize = getLE32(entry + 36);
+    if (count != ref.pointCount || count == 0 || payloadSize < kStrokePrefixSize ||
+        static_cast<uint64_t>(payloadOffset) + payloadSize > block.size - STROKE_ARCHIVE_BLOCK_PADDING) {
+        return false;
+    }
+
+    const uint8_t* p = blockData + payloadOffset;
+    const uint8_t* end = p + payloadSize;
+    int64_t valueX = getLE16(p);
+    int64_t valueY = getLE16(p + 2);
+    int64_t valueP = getLE16(p + 4);
+    int64_t step = getLE32(p + 6);
+    p += kStrokePrefixSize;
+    if (x) {
+        x[0] = static_cast<uint16_t>(valueX);
+    }
+    if (y) {
+        y[0] = static_cast<uint16_t>(valueY);
+    }
+    if (pressure) {
+        pressure[0] = static_cast<uint16_t>(valueP);
+    }
+    if (timestampNs) {
+        timestampNs[0] = startNs;
+    }
+
+    const uint64_t resolution = m_timeResolutionNs;
+    int64_t time = 0;
+    for (uint32_t groupStart = 1; groupStart < count; groupStart += STROKE_ARCHIVE_GROUP_SIZE) {
+        const uint32_t groupCount = std::min<uint32_t>(static_cast<uint32_t>(STROKE_ARCHIVE_GROUP_SIZE),
+                                                       count - groupStart);
+        if (end - p < 4) {
+            return false;
+        }
+        unsigned widths[4];
+        size_t columnBytes[4];
+        size_t total = 4;
+        for (int c = 0; c < 4; ++c) {
+            widths[c] = p[c];
+            if (widths[c] > 64) {
+                return false;
+            }
+            columnBytes[c] = (static_cast<size_t>(groupCount) * widths[c] + 7) / 8;
+            total += columnBytes[c];
+        }
+        if (static_cast<size_t>(end - p) < total) {
+            return false;
+        }
+        const uint8_t* column = p + 4;
+        decodeDeltas(column, widths[0], groupCount, valueX, x ? x + groupStart : nullptr);
+        column += columnBytes[0];
+        decodeDeltas(column, widths[1], groupCount, valueY, y ? y + groupStart : nullptr);
+        column += columnBytes[1];
+        decodeDeltas(column, widths[2], groupCount, valueP, pressure ? pressure + groupStart : nullptr);
+        column += columnBytes[2];
+
+        const unsigned timeWidth = widths[3];
+        const uint64_t timeMask = maskFor(timeWidth);
+        uint64_t bit = 0;
+        for (uint32_t k = 0; k < groupCount; ++k, bit += timeWidth) {
+            if (timeWidth) {
+                step += unzigzag(extract(column, bit, timeWidth, timeMask));
+            }
+            time += step;
+            if (timestampNs) {
+                timestampNs[groupStart + k] = startNs + static_cast<uint64_t>(time) * resolution;
+            }
+        }
+        p += total;
+    }
+    return true;
+}
+
+bool StrokeArchiveReader::loadDirectory(uint64_t directoryOffset, uint64_t blockCount)
+{
+    m_blocks.clear();
+    if (directoryOffset < STROKE_ARCHIVE_HEADER_SIZE || directoryOffset > m_size - STROKE_ARCHIVE_TRAILER_SIZE ||
+        blockCount > (m_size - STROKE_ARCHIVE_TRAILER_SIZE - directoryOffset) / kDirectoryEntrySize) {
+        return false;
+    }
+    const uint8_t* entry = m_data + directoryOffset;
+    for (uint64_t i = 0; i < blockCount; ++i, entry += kDirectoryEntrySize) {
+        ArchiveBlockInfo block;
+        uint64_t offset = getLE64(entry);
+        if (!getBlockHeader(entry + 8, offset, directoryOffset, block) || offset < STROKE_ARCHIVE_HEADER_SIZE ||
+            getLE32(m_data + offset) != kBlockMagic) {
+            m_blocks.clear();
+            return false;
+        }
+        m_blocks.push_back(block);
+    }
+    return true;
+}
+
+void StrokeArchiveReader::rebuildDirectory()
+{
+    m_blocks.clear();
+    uint64_t offset = STROKE_ARCHIVE_HEADER_SIZE;
+    while (offset + STROKE_ARCHIVE_BLOCK_HEADER_SIZE <= m_size) {
+        ArchiveBlockInfo block;
+        if (!getBlockHeader(m_data + offset, offset, m_size, block)) {
+            break;  // Torn block at the end, or the directory of a damaged trailer
+        }
+        m_blocks.push_back(block);
+        offset += block.size;
+    }
+}
@@ -0,0 +1,157 @@
+#include "../include/StrokeBuilder.h"
+
+#include <cmath>
+#include <cstring>
+
+StrokeBuilder::StrokeBuilder(size_t arenaBlockSize)
+    : m_arena(arenaBlockSize)
+    , m_page(0)
+    , m_sampleCount(0)
+    , m_drawing(false)
+    , m_last()
+    , m_bounds{0, 0, 0, 0}
+    , m_rawCount(0)
+    , m_length(0.0)
+{
+}
+
+void StrokeBuilder::addEvent(const StylusEvent& event)
+{
+    if (event.flags & STYLUS_PAGE_CLEAR) {
+        finishStroke();
+        ++m_page;
+    }
+
+    if (!(event.flags & STYLUS_TIP_DOWN)) {
+        finishStroke();
+        return;
+    }
+
+    if (!m_drawing) {
+        m_drawing = true;
+        m_bounds = StrokeBounds{event.x, event.y, event.x, event.y};
+        m_length = 0.0;
+        m_rawCount = 0;
+    } else {
+        double dx = static_cast<double>(event.x) - m_last.x;
+        double dy = static_cast<double>(event.y) - m_last.y;
+        m_length += std::sqrt(dx * dx + dy * dy);
+        if (event.x < m_bounds.minX) {
+            m_bounds.minX = event.x;
+        }
+        if (event.x > m_bounds.maxX) {
+            m_bounds.maxX = event.x;
+        }
+        if (event.y < m_bounds.minY) {
+            m_bounds.minY = event.y;
+        }
+        if (event.y > m_bounds.maxY) {
+            m_bounds.maxY = event.y;
+        }
+    }
+
+    m_last = event;
+    ++m_rawCount;
+
+    if (m_simplifier) {
+        size_t count = m_simplifier->addPoint(event, m_simplified.data());
+        for (size_t i = 0; i < count; ++i) {
+            appendSample(m_simplified[i]);
+        }
+    } else {
+        appendSample(event);
+    }
+}
+
+void StrokeBuilder::appendSample(const StylusEvent& event)
+{
+    m_x.push_back(event.x);
+    m_y.push_back(event.y);
+    m_pressure.push_back(event.pressure);
+    m_timestampNs.push_back(event.timestampNs);
+}
+
+void StrokeBuilder::addEvents(const StylusEvent* events, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        addEvent(events[i]);
+    }
+}
+
+bool StrokeBuilder::finishStroke()
+{
+    if (!m_drawing) {
+        return false;
+    }
+    m_drawing = false;
+    if (m_simplifier) {
+        size_t count = m_simplifier->endStroke(m_simplified.data());
+        for (size_t i = 0; i < count; ++i) {
+            appendSample(m_simplified[i]);
+        }
+    }
+
+    // One arena range per stroke: timestamps first (8-byte aligned), then the
+    // three 16-bit columns
+    const size_t count = m_x.size();
+    uint8_t* storage = static_cast<uint8_t*>(m_arena.allocate(count * (sizeof(uint64_t) + 3 * sizeof(uint16_t)),
+                                                               alignof(uint64_t)));
+    uint64_t* timestamps = reinterpret_cast<uint64_t*>(storage);
+    uint16_t* xs = reinterpret_cast<uint16_t*>(timestamps + count);
+    uint16_t* ys = xs + count;
+    uint16_t* pressures = ys + count;
+    std::memcpy(timestamps, m_timestampNs.data(), count * sizeof(uint64_t));
+    std::memcpy(xs, m_x.data(), count * sizeof(uint16_t));
+    std::memcpy(ys, m_y.data(), count * sizeof(uint16_t));
+    std::memcpy(pressures, m_pressure.data(), count * sizeof(uint16_t));
+
+    m_strokes.push_back(Stroke{xs, ys, pressures, timestamps, static_cast<uint32_t>(count), m_rawCount, m_page,
+                                m_bounds, m_length});
+    m_sampleCount += count;
+
+    // Keep the scratch capacity for the next stroke
+    m_x.clear();
+    m_y.clear();
+    m_pressure.clear();
+    m_timestampNs.clear();
+
+    if (m_strokeHandler) {
+        m_strokeHandler(m_strokes.back());
+    }
+    return true;
+}
+
+Stroke StrokeBuilder::currentStroke() const
+{
+    if (!m_drawing) {
+        return Stroke{nullptr, nullptr, nullptr, nullptr, 0, 0, m_page, StrokeBounds{0, 0, 0, 0}, 0.0};
+    }
+    return Stroke{m_x.data(), m_y.data(), m_pressure.data(), m_timestampNs.data(),
+                  static_cast<uint32_t>(m_x.size()), m_rawCount, m_page, m_bounds, m_length};
+}
+
+void StrokeBuilder::setSimplification(double tolerance, size_t window, SimplifierKernel kernel)
+{
+    finishStroke();
+    if (tolerance > 0.0) {
+        m_simplifier.reset(new StrokeSimplifier(tolerance, window, kernel));
+        m_simplified.resize(m_simplifier->window());
+    } else {
+        m_simplifier.reset();
+    }
+}
+
+void StrokeBuilder::clear()
+{
+    if (m_simplifier && m_drawing) {
+        m_simplifier->endStroke(m_simplified.data());  // Discard its window
+    }
+    m_strokes.clear();
+    m_arena.reset();
+    m_sampleCount = 0;
+    m_drawing = false;
+    m_x.clear();
+    m_y.clear();
+    m_pressure.clear();
+    m_timestampNs.clear();
+}
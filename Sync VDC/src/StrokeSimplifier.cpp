@@ -0,0 +1,400 @@
+#include "../include/StrokeSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// SSE2 is part of x86-64, so it needs no run-time check
+#if defined(__x86_64__) || defined(_M_X64)
+#define WT13106_SIMPLIFIER_X86 1
+#include <immintrin.h>
+#endif
+
+// AVX2 is compiled per function and chosen at run time with GCC/Clang; MSVC
+// only uses it when the whole build targets AVX2
+#if defined(WT13106_SIMPLIFIER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define WT13106_SIMPLIFIER_AVX2 1
+#define WT13106_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(WT13106_SIMPLIFIER_X86) && defined(__AVX2__)
+#define WT13106_SIMPLIFIER_AVX2 1
+#define WT13106_TARGET_AVX2
+#endif
+
+namespace {
+
+size_t farthestScalar(const double* xs, const double* ys, size_t first, size_t last, double& maxCross)
+{
+    const double ax = xs[first];
+    const double ay = ys[first];
+    const double ex = xs[last] - ax;
+    const double ey = ys[last] - ay;
+    size_t best = first;
+    double bestCross = 0.0;
+    for (size_t i = first + 1; i < last; ++i) {
+        double cross = std::fabs(ex * (ys[i] - ay) - ey * (xs[i] - ax));
+        if (cross > bestCross) {
+            bestCross = cross;
+            best = i;
+        }
+    }
+    maxCross = bestCross;
+    return best;
+}
+
+// The SIMD kernels make two passes: the largest |cross| with vector max (no
+// per-lane index bookkeeping in the hot loop), then the first index holding
+// it. The arithmetic matches farthestScalar() operation for operation, so all
+// kernels pick the same point.
+//
+// Most RDP segments are short (half of them span fewer than 6 points), and
+// there the second pass and the less predictable branches cost more than the
+// vector max saves: with the SIMD kernels used from 8 or 16 points up, the
+// whole simplifier ran 3-8% slower than scalar. Shorter segments therefore
+// always take the scalar loop.
+const size_t kMinVectorSpan = 32;
+
+#ifdef WT13106_SIMPLIFIER_X86
+
+size_t farthestSse2(const double* xs, const double* ys, size_t first, size_t last, double& maxCross)
+{
+    const double ax = xs[first];
+    const double ay = ys[first];
+    const double ex = xs[last] - ax;
+    const double ey = ys[last] - ay;
+
+    const __m128d vax = _mm_set1_pd(ax);
+    const __m128d vay = _mm_set1_pd(ay);
+    const __m128d vex = _mm_set1_pd(ex);
+    const __m128d vey = _mm_set1_pd(ey);
+    const __m128d absMask = _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    auto crossAt = [&](size_t i) {
+        __m128d dx = _mm_sub_pd(_mm_loadu_pd(xs + i), vax);
+        __m128d dy = _mm_sub_pd(_mm_loadu_pd(ys + i), vay);
+        return _mm_and_pd(_mm_sub_pd(_mm_mul_pd(vex, dy), _mm_mul_pd(vey, dx)), absMask);
+    };
+
+    __m128d max0 = _mm_setzero_pd();
+    __m128d max1 = _mm_setzero_pd();
+    size_t i = first + 1;
+    for (; i + 4 <= last; i += 4) {
+        max0 = _mm_max_pd(max0, crossAt(i));
+        max1 = _mm_max_pd(max1, crossAt(i + 2));
+    }
+    if (i + 2 <= last) {
+        max0 = _mm_max_pd(max0, crossAt(i));
+        i += 2;
+    }
+    max0 = _mm_max_pd(max0, max1);
+    max0 = _mm_max_pd(max0, _mm_unpackhi_pd(max0, max0));
+    double bestValue = _mm_cvtsd_f64(max0);
+    const size_t vectorEnd = i;
+    for (; i < last; ++i) {
+        bestValue = std::max(bestValue, std::fabs(ex * (ys[i] - ay) - ey * (xs[i] - ax)));
+    }
+
+    maxCross = bestValue;
+    if (bestValue == 0.0) {
+        return first;
+    }
+    const __m128d target = _mm_set1_pd(bestValue);
+    for (i = first + 1; i < vectorEnd; i += 2) {
+        int mask = _mm_movemask_pd(_mm_cmpeq_pd(crossAt(i), target));
+        if (mask) {
+            return i + (mask & 1 ? 0 : 1);
+        }
+    }
+    for (; i < last; ++i) {
+        if (std::fabs(ex * (ys[i] - ay) - ey * (xs[i] - ax)) == bestValue) {
+            return i;
+        }
+    }
+    return first;
+}
+
+#endif
+
+#ifdef WT13106_SIMPLIFIER_AVX2
+
+WT13106_TARGET_AVX2
+inline __m256d crossAvx2(const double* xs, const double* ys, __m256d ax, __m256d ay, __m256d ex, __m256d ey,
+                         __m256d absMask)
+{
+    __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(xs), ax);
+    __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(ys), ay);
+    return _mm256_and_pd(_mm256_sub_pd(_mm256_mul_pd(ex, dy), _mm256_mul_pd(ey, dx)), absMask);
+}
+
+WT13106_TARGET_AVX2
+size_t farthestAvx2(const double* xs, const double* ys, size_t first, size_t last, double& maxCross)
+{
+    const double ax = xs[first];
+    const double ay = ys[first];
+    const double ex = xs[last] - ax;
+    const double ey = ys[last] - ay;
+
+    const __m256d vax = _mm256_set1_pd(ax);
+    const __m256d vay = _mm256_set1_pd(ay);
+    const __m256d vex = _mm256_set1_pd(ex);
+    const __m256d vey = _mm256_set1_pd(ey);
+    const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+
+    __m256d max0 = _mm256_setzero_pd();
+    __m256d max1 = _mm256_setzero_pd();
+    size_t i = first + 1;
+    for (; i + 8 <= last; i += 8) {
+        max0 = _mm256_max_pd(max0, crossAvx2(xs + i, ys + i, vax, vay, vex, vey, absMask));
+        max1 = _mm256_max_pd(max1, crossAvx2(xs + i + 4, ys + i + 4, vax, vay, vex, vey, absMask));
+    }
+    if (i + 4 <= last) {
+        max0 = _mm256_max_pd(max0, crossAvx2(xs + i, ys + i, vax, vay, vex, vey, absMask));
+        i += 4;
+    }
+    max0 = _mm256_max_pd(max0, max1);
+    __m128d half = _mm_max_pd(_mm256_castpd256_pd128(max0), _mm256_extractf128_pd(max0, 1));
+    half = _mm_max_pd(half, _mm_unpackhi_pd(half, half));
+    double bestValue = _mm_cvtsd_f64(half);
+    const size_t vectorEnd = i;
+    for (; i < last; ++i) {
+        bestValue = std::max(bestValue, std::fabs(ex * (ys[i] - ay) - ey * (xs[i] - ax)));
+    }
+
+    maxCross = bestValue;
+    if (bestValue == 0.0) {
+        return first;
+    }
+    const __m256d target = _mm256_set1_pd(bestValue);
+    for (i = first + 1; i < vectorEnd; i += 4) {
+        __m256d cross = crossAvx2(xs + i, ys + i, vax, vay, vex, vey, absMask);
+        int mask = _mm256_movemask_pd(_mm256_cmp_pd(cross, target, _CMP_EQ_OQ));
+        if (mask) {
+            return i + ((mask & 1) ? 0 : (mask & 2) ? 1 : (mask & 4) ? 2 : 3);
+        }
+    }
+    for (; i < last; ++i) {
+        if (std::fabs(ex * (ys[i] - ay) - ey * (xs[i] - ax)) == bestValue) {
+            return i;
+        }
+    }
+    return first;
+}
+
+#endif
+
+bool cpuHasAvx2()
+{
+#if defined(WT13106_SIMPLIFIER_AVX2) && (defined(__GNUC__) || defined(__clang__))
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    return hasAvx2;
+#elif defined(WT13106_SIMPLIFIER_AVX2)
+    return true;
+#else
+    return false;
+#endif
+}
+
+SimplifierKernel bestKernel()
+{
+    if (cpuHasAvx2()) {
+        return SimplifierKernel::AVX2;
+    }
+#ifdef WT13106_SIMPLIFIER_X86
+    return SimplifierKernel::SSE2;
+#else
+    return SimplifierKernel::SCALAR;
+#endif
+}
+
+} // namespace
+
+StrokeSimplifier::StrokeSimplifier(double tolerance, size_t window, SimplifierKernel kernel)
+    : m_tolerance(tolerance > 0.0 ? tolerance : 0.0)
+    , m_window(window < 3 ? 3 : window)
+    , m_kernel(kernel == SimplifierKernel::AUTO || !isSupported(kernel) ? bestKernel() : kernel)
+    , m_count(0)
+    , m_xs(m_window)
+    , m_ys(m_window)
+    , m_points(m_window)
+    , m_keep(m_window)
+    , m_segmentError(m_window)
+{
+    m_stack.reserve(2 * m_window);
+    m_stats.tolerance = m_tolerance;
+}
+
+size_t StrokeSimplifier::addPoint(const StylusEvent& point, StylusEvent* out)
+{
+    ++m_stats.inputPoints;
+    m_xs[m_count] = point.x;
+    m_ys[m_count] = point.y;
+    m_points[m_count] = point;
+    ++m_count;
+
+    if (m_count == 1) {
+        // First point of a stroke is always kept
+        out[0] = point;
+        ++m_stats.outputPoints;
+        return 1;
+    }
+    if (m_count < m_window) {
+        return 0;
+    }
+
+    simplifyWindow();
+    size_t last = m_count - 1;
+    size_t end = 0;
+    for (size_t i = last - 1; i > 0; --i) {
+        if (m_keep[i]) {
+            end = i;
+            break;
+        }
+    }
+    if (end == 0 || last - end > m_window / 2) {
+        end = last;
+    }
+    return emitUpTo(end, out);
+}
+
+size_t StrokeSimplifier::endStroke(StylusEvent* out)
+{
+    size_t written = 0;
+    if (m_count > 1) {
+        simplifyWindow();
+        written = emitUpTo(m_count - 1, out);
+    }
+    m_count = 0;
+    return written;
+}
+
+void StrokeSimplifier::resetStats()
+{
+    m_stats = SimplifierStats();
+    m_stats.tolerance = m_tolerance;
+}
+
+void StrokeSimplifier::simplifyWindow()
+{
+    const size_t last = m_count - 1;
+    std::memset(m_keep.data(), 0, m_count);
+    m_keep[0] = 1;
+    m_keep[last] = 1;
+
+    m_stack.clear();
+    m_stack.push_back(0);
+    m_stack.push_back(static_cast<uint32_t>(last));
+    while (!m_stack.empty()) {
+        size_t segmentLast = m_stack.back();
+        m_stack.pop_back();
+        size_t segmentFirst = m_stack.back();
+        m_stack.pop_back();
+
+        double ex = m_xs[segmentLast] - m_xs[segmentFirst];
+        double ey = m_ys[segmentLast] - m_ys[segmentFirst];
+        double length = std::sqrt(ex * ex + ey * ey);
+        size_t farthest = segmentFirst;
+        double distance = 0.0;
+        if (length > 0.0) {
+            double maxCross = 0.0;
+            farthest = farthestPoint(m_kernel, m_xs.data(), m_ys.data(), segmentFirst, segmentLast, maxCross);
+            distance = maxCross / length;
+        } else {
+            // Stroke came back to the same point: distance to that point
+            for (size_t i = segmentFirst + 1; i < segmentLast; ++i) {
+                double dx = m_xs[i] - m_xs[segmentFirst];
+                double dy = m_ys[i] - m_ys[segmentFirst];
+                double d = std::sqrt(dx * dx + dy * dy);
+                if (d > distance) {
+                    distance = d;
+                    farthest = i;
+                }
+            }
+        }
+
+        if (farthest != segmentFirst && distance > m_tolerance) {
+            m_keep[farthest] = 1;
+            m_stack.push_back(static_cast<uint32_t>(segmentFirst));
+            m_stack.push_back(static_cast<uint32_t>(farthest));
+            m_stack.push_back(static_cast<uint32_t>(farthest));
+            m_stack.push_back(static_cast<uint32_t>(segmentLast));
+        } else {
+            m_segmentError[segmentFirst] = distance;
+        }
+    }
+}
+
+size_t StrokeSimplifier::emitUpTo(size_t end, StylusEvent* out)
+{
+    size_t written = 0;
+    size_t segmentStart = 0;
+    for (size_t i = 1; i <= end; ++i) {
+        if (!m_keep[i]) {
+            continue;
+        }
+        if (m_segmentError[segmentStart] > m_stats.maxError) {
+            m_stats.maxError = m_segmentError[segmentStart];
+        }
+        out[written++] = m_points[i];
+        segmentStart = i;
+    }
+    m_stats.outputPoints += written;
+
+    // end becomes the anchor of the next window
+    size_t remaining = m_count - end;
+    std::memmove(m_xs.data(), m_xs.data() + end, remaining * sizeof(double));
+    std::memmove(m_ys.data(), m_ys.data() + end, remaining * sizeof(double));
+    std::memmove(m_points.data(), m_points.data() + end, remaining * sizeof(StylusEvent));
+    m_count = remaining;
+    return written;
+}
+
+size_t StrokeSimplifier::farthestPoint(SimplifierKernel kernel, const double* xs, const double* ys,
+                                       size_t first, size_t last, double& maxCross)
+{
+    if (last - first < kMinVectorSpan) {
+        return farthestScalar(xs, ys, first, last, maxCross);
+    }
+    switch (kernel) {
+#ifdef WT13106_SIMPLIFIER_AVX2
+    case SimplifierKernel::AVX2:
+        return farthestAvx2(xs, ys, first, last, maxCross);
+#endif
+#ifdef WT13106_SIMPLIFIER_X86
+    case SimplifierKernel::SSE2:
+        return farthestSse2(xs, ys, first, last, maxCross);
+#endif
+    default:
+        return farthestScalar(xs, ys, first, last, maxCross);
+    }
+}
+
+const char* StrokeSimplifier::kernelName(SimplifierKernel kernel)
+{
+    switch (kernel) {
+    case SimplifierKernel::AUTO:
+        return "auto";
+    case SimplifierKernel::SCALAR:
+        return "scalar";
+    case SimplifierKernel::SSE2:
+        return "sse2";
+    case SimplifierKernel::AVX2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+bool StrokeSimplifier::isSupported(SimplifierKernel kernel)
+{
+    switch (kernel) {
+    case SimplifierKernel::AUTO:
+    case SimplifierKernel::SCALAR:
+        return true;
+    case SimplifierKernel::SSE2:
+#ifdef WT13106_SIMPLIFIER_X86
+        return true;
+#else
+        return false;
+#endif
+    case SimplifierKernel::AVX2:
+        return cpuHasAvx2();
+    }
+    return false;
+}
@@ -0,0 +1,944 @@
+#include "../include/Transport.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#include <setupapi.h>
+#include <initguid.h>
+#pragma comment(lib, "setupapi.lib")
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <termios.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include "LinuxSerialSpeed.h"
+#elif defined(__APPLE__)
+#include <sys/ioctl.h>
+#include <IOKit/serial/ioss.h>
+#endif
+#endif
+
+namespace {
+
+#ifdef _WIN32
+// A read waits at most this long per ReadFile(); read() loops until its deadline
+const DWORD kReadSliceMs = 10;
+#endif
+
+uint64_t steadyNowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+std::chrono::steady_clock::time_point steadyFromNs(uint64_t ns)
+{
+    return std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(ns)));
+}
+
+/**
+ * @brief Strip an optional "@baud" suffix from endpoint.path into endpoint.baudRate
+ * @return true if there was no suffix or it was a valid rate
+ */
+bool parseBaudSuffix(TransportEndpoint& endpoint, std::string& error)
+{
+    // Optional "@<baud>" suffix, e.g. "BT:/dev/ttyUSB0@921600"
+    size_t atPos = endpoint.path.rfind('@');
+    if (atPos == std::string::npos) {
+        return true;
+    }
+
+    std::string baudText = endpoint.path.substr(atPos + 1);
+    endpoint.path.erase(atPos);
+
+    if (baudText.empty() || baudText.find_first_not_of("0123456789") != std::string::npos) {
+        error = "Invalid baud rate '" + baudText + "'. Use e.g. 'BT:/dev/ttyUSB0@921600'";
+        return false;
+    }
+
+    try {
+        unsigned long baud = std::stoul(baudText);
+        if (baud == 0 || baud > 0xFFFFFFFFul) {
+            throw std::out_of_range("baud");
+        }
+        endpoint.baudRate = static_cast<uint32_t>(baud);
+    } catch (...) {
+        error = "Baud rate out of range: " + baudText;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Strip an optional "@speed" suffix from endpoint.path into endpoint.replaySpeed
+ * @return true if there was no suffix or it was a valid speed
+ */
+bool parseReplaySpeed(TransportEndpoint& endpoint, std::string& error)
+{
+    // Optional "@<speed>" suffix after the file name: "@2" (2x), "@0.5", "@max"
+    size_t atPos = endpoint.path.rfind('@');
+    size_t slashPos = endpoint.path.find_last_of("/\\");
+    if (atPos == std::string::npos || (slashPos != std::string::npos && atPos < slashPos)) {
+        return true;
+    }
+
+    std::string speedText = endpoint.path.substr(atPos + 1);
+    endpoint.path.erase(atPos);
+
+    if (speedText == "max") {
+        endpoint.replaySpeed = 0;
+        return true;
+    }
+
+    try {
+        size_t used = 0;
+        double speed = std::stod(speedText, &used);
+        if (used != speedText.size() || speed < 0) {
+            throw std::invalid_argument("speed");
+        }
+        endpoint.replaySpeed = speed;
+    } catch (...) {
+        error = "Invalid replay speed '" + speedText + "'. Use e.g. 'REPLAY:session.wtcap@2' or '@max'";
+        return false;
+    }
+
+    return true;
+}
+
+#ifndef _WIN32
+/**
+ * @brief Map a numeric baud rate to its termios speed constant
+ * @return true if the rate has a standard Bxxx constant on this platform
+ */
+bool toTermiosSpeed(uint32_t baudRate, speed_t& speed)
+{
+    switch (baudRate) {
+    case 1200: speed = B1200; return true;
+    case 2400: speed = B2400; return true;
+    case 4800: speed = B4800; return true;
+    case 9600: speed = B9600; return true;
+    case 19200: speed = B19200; return true;
+    case 38400: speed = B38400; return true;
+    case 57600: speed = B57600; return true;
+    case 115200: speed = B115200; return true;
+    case 230400: speed = B230400; return true;
+#ifdef B460800
+    case 460800: speed = B460800; return true;
+#endif
+#ifdef B500000
+    case 500000: speed = B500000; return true;
+#endif
+#ifdef B576000
+    case 576000: speed = B576000; return true;
+#endif
+#ifdef B921600
+    case 921600: speed = B921600; return true;
+#endif
+#ifdef B1000000
+    case 1000000: speed = B1000000; return true;
+#endif
+#ifdef B1152000
+    case 1152000: speed = B1152000; return true;
+#endif
+#ifdef B1500000
+    case 1500000: speed = B1500000; return true;
+#endif
+#ifdef B2000000
+    case 2000000: speed = B2000000; return true;
+#endif
+#ifdef B2500000
+    case 2500000: speed = B2500000; return true;
+#endif
+#ifdef B3000000
+    case 3000000: speed = B3000000; return true;
+#endif
+#ifdef B3500000
+    case 3500000: speed = B3500000; return true;
+#endif
+#ifdef B4000000
+    case 4000000: speed = B4000000; return true;
+#endif
+    default: return false;
+    }
+}
+#endif
+
+} // namespace
+
+bool parseEndpoint(const std::string& connectionString, TransportEndpoint& endpoint, std::string& error)
+{
+    endpoint = TransportEndpoint();
+    if (connectionString.empty()) {
+        error = "Connection string is empty";
+        return false;
+    }
+
+    // Check for Bluetooth connection (format: "BT:COM5" or "BT:/dev/ttyUSB0")
+    if (connectionString.compare(0, 3, "BT:") == 0) {
+        endpoint.type = ConnectionType::BLUETOOTH;
+        endpoint.path = connectionString.substr(3);
+        if (!parseBaudSuffix(endpoint, error)) {
+            return false;
+        }
+        if (endpoint.path.empty()) {
+            error = "Invalid Bluetooth connection string format. Use 'BT:COM5' or 'BT:/dev/ttyUSB0'";
+            return false;
+        }
+        return true;
+    }
+
+    // Check for USB connection (format: "USB:1234:5678" or "USB:1234:5678:SERIAL")
+    if (connectionString.compare(0, 4, "USB:") == 0) {
+        endpoint.type = ConnectionType::USB;
+        std::string usbParams = connectionString.substr(4);
+        size_t colonPos = usbParams.find(':');
+
+        if (colonPos == std::string::npos) {
+            error = "Invalid USB connection string format. Use 'USB:VID:PID' (e.g., 'USB:1234:5678')";
+            return false;
+        }
+
+        size_t serialPos = usbParams.find(':', colonPos + 1);
+        endpoint.usbSerial = serialPos == std::string::npos ? "" : usbParams.substr(serialPos + 1);
+        std::string vidText = usbParams.substr(0, colonPos);
+        std::string pidText = usbParams.substr(colonPos + 1, serialPos - colonPos - 1);
+        try {
+            if (vidText.size() > 4 || pidText.size() > 4 ||
+                vidText.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos ||
+                pidText.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+                throw std::invalid_argument("vid/pid");
+            }
+            endpoint.vid = static_cast<uint16_t>(std::stoul(vidText, nullptr, 16));
+            endpoint.pid = static_cast<uint16_t>(std::stoul(pidText, nullptr, 16));
+        } catch (...) {
+            error = "Invalid VID/PID format. Use up to four hexadecimal digits each (e.g., 'USB:1234:5678')";
+            return false;
+        }
+
+        return true;
+    }
+
+    // Check for capture replay (format: "REPLAY:session.wtcap[@speed]")
+    if (connectionString.compare(0, 7, "REPLAY:") == 0) {
+        endpoint.type = ConnectionType::REPLAY;
+        endpoint.path = connectionString.substr(7);
+        if (!parseReplaySpeed(endpoint, error)) {
+            return false;
+        }
+        if (endpoint.path.empty()) {
+            error = "Invalid replay connection string format. Use 'REPLAY:session.wtcap[@speed]'";
+            return false;
+        }
+        return true;
+    }
+
+    // Check for a pseudo-terminal (format: "PTY:/dev/pts/3")
+    if (connectionString.compare(0, 4, "PTY:") == 0) {
+#ifdef _WIN32
+        error = "PTY connections need a POSIX system";
+        return false;
+#else
+        endpoint.type = ConnectionType::PTY;
+        endpoint.path = connectionString.substr(4);
+        if (endpoint.path.empty()) {
+            error = "Invalid PTY connection string format. Use 'PTY:/dev/pts/3'";
+            return false;
+        }
+        return true;
+#endif
+    }
+
+    // In-memory loopback (format: "LOOPBACK:" or "LOOPBACK:name"; the name is ignored)
+    if (connectionString.compare(0, 9, "LOOPBACK:") == 0) {
+        endpoint.type = ConnectionType::LOOPBACK;
+        endpoint.path = connectionString.substr(9);
+        return true;
+    }
+
+    // Legacy support: if it starts with COM or /dev, assume Bluetooth
+    if (connectionString.find("COM") == 0 || connectionString.find("/dev/") == 0) {
+        endpoint.type = ConnectionType::BLUETOOTH;
+        endpoint.path = connectionString;
+        return parseBaudSuffix(endpoint, error);
+    }
+
+    error = "Unknown connection string format. Use 'BT:COM5' for Bluetooth or 'USB:1234:5678' for USB";
+    return false;
+}
+
+#ifndef _WIN32
+void FdTransport::close()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+TransportResult FdTransport::read(uint8_t* buffer, size_t capacity, TransportDeadline deadline)
+{
+    if (m_fd < 0) {
+        m_lastError = "Serial port closed";
+        return {0, TransportStatus::CLOSED};
+    }
+
+    for (;;) {
+        ssize_t bytesRead = ::read(m_fd, buffer, capacity);
+        if (bytesRead > 0) {
+            return {static_cast<size_t>(bytesRead), TransportStatus::OK};
+        }
+        // With VMIN = VTIME = 0 an empty tty returns 0 rather than EAGAIN
+        if (bytesRead < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytesRead < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            m_lastError = "Failed to read from serial port";
+            return {0, TransportStatus::CLOSED};  // Hard error: the port is gone
+        }
+
+        int ready = wait(POLLIN, deadline);
+        if (ready == 0) {
+            return {0, TransportStatus::TIMEOUT};
+        }
+        if (ready == -2) {
+            m_lastError = "Serial port closed";
+            return {0, TransportStatus::CLOSED};
+        }
+        if (ready < 0) {
+            m_lastError = "Failed to poll serial port";
+            return {0, TransportStatus::FAILED};
+        }
+    }
+}
+
+TransportResult FdTransport::write(const CommandBuffer* segments, size_t count, TransportDeadline deadline)
+{
+    if (m_fd < 0) {
+        m_lastError = "Serial link is down";
+        return {0, TransportStatus::FAILED};
+    }
+
+    struct iovec iov[kMaxWriteSegments];
+    int iovCount = static_cast<int>(std::min(count, kMaxWriteSegments));
+    for (int i = 0; i < iovCount; ++i) {
+        iov[i].iov_base = const_cast<uint8_t*>(segments[i].data);
+        iov[i].iov_len = segments[i].length;
+    }
+
+    for (;;) {
+        ssize_t bytesWritten = writev(m_fd, iov, iovCount);
+        if (bytesWritten >= 0) {
+            return {static_cast<size_t>(bytesWritten), TransportStatus::OK};
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            m_lastError = "Failed to write to serial port";
+            return {0, TransportStatus::FAILED};
+        }
+
+        // The port's output buffer is full; wait until it drains
+        int ready = wait(POLLOUT, deadline);
+        if (ready == 0) {
+            return {0, TransportStatus::TIMEOUT};
+        }
+        if (ready < 0) {
+            m_lastError = ready == -2 ? "Serial port closed" : "Failed to poll serial port";
+            return {0, ready == -2 ? TransportStatus::CLOSED : TransportStatus::FAILED};
+        }
+    }
+}
+
+int FdTransport::wait(short events, TransportDeadline deadline)
+{
+    struct pollfd pfd = {};
+    pfd.fd = m_fd;
+    pfd.events = events;
+
+    for (;;) {
+        auto remaining = deadline - std::chrono::steady_clock::now();
+        if (remaining <= std::chrono::steady_clock::duration::zero()) {
+            return 0;
+        }
+
+#ifdef __linux__
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(remaining).count();
+        struct timespec ts;
+        ts.tv_sec = static_cast<time_t>(ns / 1000000000);
+        ts.tv_nsec = static_cast<long>(ns % 1000000000);
+        int result = ppoll(&pfd, 1, &ts, nullptr);
+#else
+        // Round up so we never wake before the deadline
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(remaining).count();
+        int result = poll(&pfd, 1, static_cast<int>((us + 999) / 1000));
+#endif
+        if (result > 0) {
+            // The preceding read()/write() could not proceed, so a hang-up
+            // here means the port is gone (ttys report POLLIN together with
+            // POLLHUP).
+            if (pfd.revents & (POLLHUP | POLLERR | POLLNVAL)) {
+                return -2;
+            }
+            return 1;
+        }
+        if (result < 0 && errno != EINTR) {
+            return -1;
+        }
+    }
+}
+
+bool SerialTransport::open(const TransportEndpoint& endpoint, std::string& error)
+{
+    close();
+    int fd = ::open(endpoint.path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+    if (fd < 0) {
+        error = "Failed to open serial port: " + endpoint.path;
+        return false;
+    }
+
+    // Configure serial port settings
+    struct termios tty;
+    if (tcgetattr(fd, &tty) != 0) {
+        ::close(fd);
+        error = "Failed to get serial port attributes";
+        return false;
+    }
+
+    // Set baud rate: standard rates go through termios directly, anything
+    // else is programmed after tcsetattr() with a driver-specific call.
+    speed_t speed = B9600;
+    bool standardRate = toTermiosSpeed(endpoint.baudRate, speed);
+    cfsetospeed(&tty, speed);
+    cfsetispeed(&tty, speed);
+
+    // 8N1 configuration
+    tty.c_cflag &= ~PARENB;  // No parity
+    tty.c_cflag &= ~CSTOPB;  // 1 stop bit
+    tty.c_cflag &= ~CSIZE;
+    tty.c_cflag |= CS8;      // 8 data bits
+    tty.c_cflag &= ~CRTSCTS; // No hardware flow control
+    tty.c_cflag |= CREAD | CLOCAL; // Enable receiver, ignore modem control
+
+    // Disable canonical mode
+    tty.c_lflag &= ~ICANON;
+    tty.c_lflag &= ~ECHO;
+    tty.c_lflag &= ~ECHOE;
+    tty.c_lflag &= ~ISIG;
+
+    // Disable software flow control
+    tty.c_iflag &= ~(IXON | IXOFF | IXANY);
+
+    // Binary input: no CR/NL translation, stripping or break/parity marking,
+    // otherwise frame bytes such as 0x0D are rewritten by the line discipline
+    tty.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL);
+    tty.c_lflag &= ~(ECHONL | IEXTEN);
+
+    // Raw output
+    tty.c_oflag &= ~OPOST;
+
+    // Pure non-blocking reads; receive timeouts are handled with poll()
+    tty.c_cc[VTIME] = 0;
+    tty.c_cc[VMIN] = 0;
+
+    if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+        ::close(fd);
+        error = "Failed to set serial port attributes";
+        return false;
+    }
+
+    if (!standardRate) {
+#if defined(__linux__)
+        bool rateSet = setLinuxCustomBaudRate(fd, endpoint.baudRate);
+#elif defined(__APPLE__)
+        speed_t customSpeed = endpoint.baudRate;
+        bool rateSet = ioctl(fd, IOSSIOSPEED, &customSpeed) == 0;
+#else
+        bool rateSet = false;
+#endif
+        if (!rateSet) {
+            ::close(fd);
+            error = "Serial port does not support baud rate " + std::to_string(endpoint.baudRate);
+            return false;
+        }
+    }
+
+    m_fd = fd;
+    return true;
+}
+
+bool PtyTransport::open(const TransportEndpoint& endpoint, std::string& error)
+{
+    close();
+    int fd = ::open(endpoint.path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) {
+        error = "Failed to open pty: " + endpoint.path;
+        return false;
+    }
+
+    struct termios tty;
+    if (tcgetattr(fd, &tty) != 0) {
+        ::close(fd);
+        error = "Not a terminal: " + endpoint.path;
+        return false;
+    }
+    cfmakeraw(&tty);
+    tty.c_cc[VTIME] = 0;
+    tty.c_cc[VMIN] = 0;
+    if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+        ::close(fd);
+        error = "Failed to set pty attributes";
+        return false;
+    }
+
+    m_fd = fd;
+    return true;
+}
+#else
+SerialTransport::SerialTransport()
+    : m_handle(INVALID_HANDLE_VALUE)
+    , m_appliedTimeoutMs(MAXDWORD)
+{
+}
+
+SerialTransport::~SerialTransport()
+{
+    close();
+}
+
+bool SerialTransport::open(const TransportEndpoint& endpoint, std::string& error)
+{
+    close();
+
+    // Windows: Open COM port
+    std::string portPath = "\\\\.\\" + endpoint.path;  // Use \\.\ prefix for COM ports > COM9
+
+    m_handle = CreateFileA(
+        portPath.c_str(),
+        GENERIC_READ | GENERIC_WRITE,
+        0,
+        NULL,
+        OPEN_EXISTING,
+        0,
+        NULL
+    );
+
+    if (m_handle == INVALID_HANDLE_VALUE) {
+        DWORD code = GetLastError();
+        error = "Failed to open COM port: " + endpoint.path + " (Error: " + std::to_string(code) + ")";
+        return false;
+    }
+
+    // Configure serial port settings
+    DCB dcb = {0};
+    dcb.DCBlength = sizeof(DCB);
+
+    if (!GetCommState(m_handle, &dcb)) {
+        close();
+        error = "Failed to get COM port state";
+        return false;
+    }
+
+    // Set serial port parameters
+    dcb.BaudRate = endpoint.baudRate;
+    dcb.ByteSize = 8;
+    dcb.Parity = NOPARITY;
+    dcb.StopBits = ONESTOPBIT;
+    dcb.fDtrControl = DTR_CONTROL_ENABLE;
+    dcb.fRtsControl = RTS_CONTROL_ENABLE;
+
+    if (!SetCommState(m_handle, &dcb)) {
+        close();
+        error = "Failed to set COM port state";
+        return false;
+    }
+
+    // Set timeouts
+    COMMTIMEOUTS timeouts = {0};
+    timeouts.ReadIntervalTimeout = 50;
+    timeouts.ReadTotalTimeoutConstant = 50;
+    timeouts.ReadTotalTimeoutMultiplier = 10;
+    timeouts.WriteTotalTimeoutConstant = 50;
+    timeouts.WriteTotalTimeoutMultiplier = 10;
+    SetCommTimeouts(m_handle, &timeouts);
+    m_appliedTimeoutMs = MAXDWORD;
+
+    return true;
+}
+
+void SerialTransport::close()
+{
+    if (m_handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_handle);
+        m_handle = INVALID_HANDLE_VALUE;
+    }
+}
+
+TransportResult SerialTransport::read(uint8_t* buffer, size_t capacity, TransportDeadline deadline)
+{
+    // Two settings only, so the port is not reprogrammed on every call:
+    // MAXDWORD/0/0 returns at once with whatever is buffered, and
+    // MAXDWORD/MAXDWORD/slice returns as soon as a byte arrives or the slice
+    // ends. Longer waits loop over slices, overshooting by up to one slice.
+    bool poll = std::chrono::steady_clock::now() >= deadline;
+    DWORD timeoutMs = poll ? 0 : kReadSliceMs;
+    if (timeoutMs != m_appliedTimeoutMs) {
+        COMMTIMEOUTS timeouts = {0};
+        timeouts.ReadIntervalTimeout = MAXDWORD;
+        timeouts.ReadTotalTimeoutMultiplier = poll ? 0 : MAXDWORD;
+        timeouts.ReadTotalTimeoutConstant = timeoutMs;
+        timeouts.WriteTotalTimeoutConstant = 50;
+        timeouts.WriteTotalTimeoutMultiplier = 10;
+        SetCommTimeouts(m_handle, &timeouts);
+        m_appliedTimeoutMs = timeoutMs;
+    }
+
+    for (;;) {
+        DWORD bytesRead = 0;
+        if (!ReadFile(m_handle, buffer, static_cast<DWORD>(capacity), &bytesRead, NULL)) {
+            m_lastError = "Failed to read from serial port";
+            return {0, TransportStatus::FAILED};
+        }
+        if (bytesRead > 0) {
+            return {bytesRead, TransportStatus::OK};
+        }
+        if (poll || std::chrono::steady_clock::now() >= deadline) {
+            return {0, TransportStatus::TIMEOUT};  // Deadline reached
+        }
+    }
+}
+
+TransportResult SerialTransport::write(const CommandBuffer* segments, size_t count, TransportDeadline deadline)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        DWORD bytesWritten = 0;
+        if (!WriteFile(m_handle, segments[i].data, static_cast<DWORD>(segments[i].length), &bytesWritten, NULL)) {
+            m_lastError = "Failed to write to serial port";
+            return total > 0 ? TransportResult{total, TransportStatus::OK}
+                             : TransportResult{0, TransportStatus::FAILED};
+        }
+        total += bytesWritten;
+        if (bytesWritten < segments[i].length) {
+            break;
+        }
+    }
+    if (total == 0 && std::chrono::steady_clock::now() >= deadline) {
+        return {0, TransportStatus::TIMEOUT};
+    }
+    return {total, TransportStatus::OK};
+}
+#endif
+
+bool UsbTransport::open(const TransportEndpoint& endpoint, std::string& error)
+{
+#ifdef _WIN32
+    // Windows USB implementation using SetupAPI
+    // This is a basic implementation - full USB support requires WinUSB or libusb
+
+    GUID guid = {0};  // USB device GUID
+    HDEVINFO deviceInfoSet = SetupDiGetClassDevs(&guid, NULL, NULL, DIGCF_PRESENT | DIGCF_DEVICEINTERFACE);
+
+    if (deviceInfoSet == INVALID_HANDLE_VALUE) {
+        error = "Failed to enumerate USB devices";
+        return false;
+    }
+
+    // Search for device with matching VID/PID
+    SP_DEVICE_INTERFACE_DATA deviceInterfaceData;
+    deviceInterfaceData.cbSize = sizeof(SP_DEVICE_INTERFACE_DATA);
+
+    bool found = false;
+    for (DWORD i = 0; SetupDiEnumDeviceInterfaces(deviceInfoSet, NULL, &guid, i, &deviceInterfaceData); i++) {
+        // Get device path and check VID/PID
+        // Full implementation would parse device path and match VID/PID
+    }
+
+    SetupDiDestroyDeviceInfoList(deviceInfoSet);
+
+    if (!found) {
+        error = "USB device not found (VID: " + std::to_string(endpoint.vid) +
+                ", PID: " + std::to_string(endpoint.pid) + ")";
+        return false;
+    }
+
+    error = "USB connection requires full WinUSB or libusb implementation. "
+            "For now, use Bluetooth connection (BT:COMx)";
+    return false;
+#elif defined(WT13106_HAVE_LIBUSB)
+    // Keep the device handle open for the whole connection and stream the
+    // bulk IN endpoint with several asynchronous transfers in flight
+    std::unique_ptr<UsbBulkEngine> usb(new UsbBulkEngine());
+    if (!usb->open(endpoint.vid, endpoint.pid)) {
+        error = usb->getLastError();
+        return false;
+    }
+    m_usb = std::move(usb);
+    return true;
+#else
+    (void)endpoint;
+    error = "USB connection requires libusb. Install with: sudo apt-get install libusb-1.0-0-dev";
+    return false;
+#endif
+}
+
+void UsbTransport::close()
+{
+#ifdef WT13106_HAVE_LIBUSB
+    // Cancels in-flight transfers, joins the event thread and closes the handle
+    m_usb.reset();
+#endif
+}
+
+bool UsbTransport::isOpen() const
+{
+#ifdef WT13106_HAVE_LIBUSB
+    return m_usb != nullptr;
+#else
+    return false;
+#endif
+}
+
+TransportResult UsbTransport::read(uint8_t* buffer, size_t capacity, TransportDeadline deadline)
+{
+#ifdef WT13106_HAVE_LIBUSB
+    if (!m_usb) {
+        m_lastError = "USB device is not open";
+        return {0, TransportStatus::FAILED};
+    }
+    size_t bytesRead = m_usb->read(buffer, capacity, 1, deadline);
+    if (bytesRead > 0) {
+        return {bytesRead, TransportStatus::OK};
+    }
+    if (m_usb->hasFailed()) {
+        m_lastError = m_usb->getLastError();
+        return {0, TransportStatus::CLOSED};
+    }
+    return {0, TransportStatus::TIMEOUT};
+#else
+    (void)buffer;
+    (void)capacity;
+    (void)deadline;
+    m_lastError = "USB receive requires libusb support";
+    return {0, TransportStatus::FAILED};
+#endif
+}
+
+TransportResult UsbTransport::write(const CommandBuffer* segments, size_t count, TransportDeadline deadline)
+{
+#ifdef WT13106_HAVE_LIBUSB
+    if (!m_usb) {
+        m_lastError = "USB device is not open";
+        return {0, TransportStatus::FAILED};
+    }
+    // One bulk OUT write per segment; a failed one may still have sent a prefix
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        size_t written = 0;
+        bool ok = m_usb->write(segments[i].data, segments[i].length,
+                               static_cast<unsigned int>(remaining > 0 ? remaining : 1), &written);
+        total += written;
+        if (!ok) {
+            m_lastError = m_usb->getLastError();
+            if (total > 0) {
+                return {total, TransportStatus::OK};
+            }
+            return {0, std::chrono::steady_clock::now() >= deadline ? TransportStatus::TIMEOUT
+                                                                     : TransportStatus::FAILED};
+        }
+    }
+    return {total, TransportStatus::OK};
+#else
+    (void)segments;
+    (void)count;
+    (void)deadline;
+    m_lastError = "USB send requires libusb support";
+    return {0, TransportStatus::FAILED};
+#endif
+}
+
+bool ReplayTransport::open(const TransportEndpoint& endpoint, std::string& error)
+{
+    std::unique_ptr<CaptureReplay> replay(new CaptureReplay());
+    if (!replay->open(endpoint.path, endpoint.replaySpeed)) {
+        error = replay->reader().getLastError();
+        return false;
+    }
+    m_replay = std::move(replay);
+    return true;
+}
+
+void ReplayTransport::close()
+{
+    m_replay.reset();
+}
+
+TransportResult ReplayTransport::read(uint8_t* buffer, size_t capacity, TransportDeadline deadline)
+{
+    if (!m_replay) {
+        m_lastError = "Replay is not open";
+        return {0, TransportStatus::FAILED};
+    }
+
+    for (;;) {
+        uint64_t now = steadyNowNs();
+        size_t bytesRead = m_replay->readDue(buffer, capacity, now);
+        if (bytesRead > 0) {
+            return {bytesRead, TransportStatus::OK};
+        }
+
+        uint64_t due = m_replay->nextDueNs(now);
+        if (due == std::numeric_limits<uint64_t>::max()) {
+            m_lastError = "Replay finished";
+            return {0, TransportStatus::CLOSED};
+        }
+        if (due == 0) {
+            continue;
+        }
+
+        auto dueTime = steadyFromNs(due);
+        if (dueTime > deadline) {
+            std::this_thread::sleep_until(deadline);
+            return {0, TransportStatus::TIMEOUT};
+        }
+        std::this_thread::sleep_until(dueTime);
+    }
+}
+
+TransportResult ReplayTransport::write(const CommandBuffer* segments, size_t count, TransportDeadline)
+{
+    // A recording has nobody to answer; commands are accepted and dropped
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total += segments[i].length;
+    }
+    return {total, TransportStatus::OK};
+}
+
+LoopbackTransport::LoopbackTransport()
+    : m_readOffset(0)
+    , m_open(false)
+    , m_eventFd(-1)
+{
+}
+
+LoopbackTransport::~LoopbackTransport()
+{
+    close();
+}
+
+bool LoopbackTransport::open(const TransportEndpoint&, std::string& error)
+{
+    close();
+#ifdef __linux__
+    m_eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_eventFd < 0) {
+        error = "Failed to create loopback eventfd";
+        return false;
+    }
+#else
+    (void)error;
+#endif
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.clear();
+    m_readOffset = 0;
+    m_open = true;
+    return true;
+}
+
+void LoopbackTransport::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_open = false;
+        m_queue.clear();
+        m_readOffset = 0;
+    }
+    m_readable.notify_all();
+#ifdef __linux__
+    if (m_eventFd >= 0) {
+        ::close(m_eventFd);
+        m_eventFd = -1;
+    }
+#endif
+}
+
+bool LoopbackTransport::isOpen() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_open;
+}
+
+TransportResult LoopbackTransport::read(uint8_t* buffer, size_t capacity, TransportDeadline deadline)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_readable.wait_until(lock, deadline, [this] {
+        return m_readOffset < m_queue.size() || !m_open;
+    });
+    if (!m_open) {
+        return {0, TransportStatus::CLOSED};
+    }
+    size_t available = m_queue.size() - m_readOffset;
+    if (available == 0) {
+        return {0, TransportStatus::TIMEOUT};
+    }
+
+    size_t bytesRead = std::min(available, capacity);
+    std::copy(m_queue.begin() + m_readOffset, m_queue.begin() + m_readOffset + bytesRead, buffer);
+    m_readOffset += bytesRead;
+    if (m_readOffset == m_queue.size()) {
+        // Drained: rewind (the capacity is kept) and make the eventfd unreadable
+        m_queue.clear();
+        m_readOffset = 0;
+#ifdef __linux__
+        uint64_t value;
+        ssize_t ignored = ::read(m_eventFd, &value, sizeof(value));
+        (void)ignored;
+#endif
+    } else if (m_readOffset > m_queue.size() / 2) {
+        // A reader that never quite catches up would otherwise keep every
+        // byte ever written; moving the unread rest costs less than what was read
+        m_queue.erase(m_queue.begin(), m_queue.begin() + m_readOffset);
+        m_readOffset = 0;
+    }
+    return {bytesRead, TransportStatus::OK};
+}
+
+TransportResult LoopbackTransport::write(const CommandBuffer* segments, size_t count, TransportDeadline)
+{
+    size_t total = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_open) {
+            return {0, TransportStatus::CLOSED};
+        }
+        bool wasEmpty = m_readOffset == m_queue.size();
+        for (size_t i = 0; i < count; ++i) {
+            m_queue.insert(m_queue.end(), segments[i].data, segments[i].data + segments[i].length);
+            total += segments[i].length;
+        }
+#ifdef __linux__
+        if (wasEmpty && total > 0) {
+            uint64_t one = 1;
+            ssize_t ignored = ::write(m_eventFd, &one, sizeof(one));
+            (void)ignored;
+        }
+#else
+        (void)wasEmpty;
+#endif
+    }
+    m_readable.notify_one();
+    return {total, TransportStatus::OK};
+}
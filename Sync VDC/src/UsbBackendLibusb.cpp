@@ -0,0 +1,177 @@
+#include "../include/UsbBackend.h"
+
+#include <libusb.h>
+
+namespace {
+
+libusb_context* contextOf(void* context)
+{
+    return static_cast<libusb_context*>(context);
+}
+
+libusb_device_handle* deviceOf(void* device)
+{
+    return static_cast<libusb_device_handle*>(device);
+}
+
+libusb_transfer* transferOf(UsbTransfer* transfer)
+{
+    return static_cast<libusb_transfer*>(transfer->backendData);
+}
+
+void LIBUSB_CALL onTransfer(libusb_transfer* raw)
+{
+    UsbTransfer* transfer = static_cast<UsbTransfer*>(raw->user_data);
+    UsbTransferStatus status;
+    switch (raw->status) {
+    case LIBUSB_TRANSFER_COMPLETED: status = UsbTransferStatus::COMPLETED; break;
+    case LIBUSB_TRANSFER_TIMED_OUT: status = UsbTransferStatus::TIMED_OUT; break;
+    case LIBUSB_TRANSFER_CANCELLED: status = UsbTransferStatus::CANCELLED; break;
+    case LIBUSB_TRANSFER_NO_DEVICE: status = UsbTransferStatus::NO_DEVICE; break;
+    default: status = UsbTransferStatus::FAILED; break;
+    }
+    size_t actualLength = raw->actual_length > 0 ? static_cast<size_t>(raw->actual_length) : 0;
+    transfer->callback(transfer, status, actualLength);
+}
+
+int initContext(void** context)
+{
+    libusb_context* raw = nullptr;
+    int result = libusb_init(&raw);
+    *context = result < 0 ? nullptr : raw;
+    return result < 0 ? result : 0;
+}
+
+void exitContext(void* context)
+{
+    libusb_exit(contextOf(context));
+}
+
+void* openDevice(void* context, uint16_t vid, uint16_t pid)
+{
+    return libusb_open_device_with_vid_pid(contextOf(context), vid, pid);
+}
+
+void closeDevice(void* device)
+{
+    libusb_close(deviceOf(device));
+}
+
+int claimInterface(void* device, int interfaceNumber)
+{
+    // Let libusb unbind e.g. cdc_acm while we own the interface (no-op where unsupported)
+    libusb_set_auto_detach_kernel_driver(deviceOf(device), 1);
+    int result = libusb_claim_interface(deviceOf(device), interfaceNumber);
+    return result < 0 ? result : 0;
+}
+
+void releaseInterface(void* device, int interfaceNumber)
+{
+    libusb_release_interface(deviceOf(device), interfaceNumber);
+}
+
+int findBulkEndpoints(void* device, int interfaceNumber, uint8_t* inEndpoint, uint8_t* outEndpoint)
+{
+    libusb_config_descriptor* config = nullptr;
+    int result = libusb_get_active_config_descriptor(libusb_get_device(deviceOf(device)), &config);
+    if (result < 0) {
+        return result;
+    }
+
+    *inEndpoint = 0;
+    *outEndpoint = 0;
+    for (int i = 0; i < config->bNumInterfaces; ++i) {
+        const libusb_interface& iface = config->interface[i];
+        if (iface.num_altsetting < 1 || iface.altsetting[0].bInterfaceNumber != interfaceNumber) {
+            continue;
+        }
+
+        const libusb_interface_descriptor& alt = iface.altsetting[0];
+        for (int e = 0; e < alt.bNumEndpoints; ++e) {
+            const libusb_endpoint_descriptor& ep = alt.endpoint[e];
+            if ((ep.bmAttributes & LIBUSB_TRANSFER_TYPE_MASK) != LIBUSB_TRANSFER_TYPE_BULK) {
+                continue;
+            }
+            if ((ep.bEndpointAddress & LIBUSB_ENDPOINT_DIR_MASK) == LIBUSB_ENDPOINT_IN) {
+                if (*inEndpoint == 0) {
+                    *inEndpoint = ep.bEndpointAddress;
+                }
+            } else if (*outEndpoint == 0) {
+                *outEndpoint = ep.bEndpointAddress;
+            }
+        }
+    }
+    libusb_free_config_descriptor(config);
+    return 0;
+}
+
+int prepareTransfer(void* device, UsbTransfer* transfer)
+{
+    libusb_transfer* raw = libusb_alloc_transfer(0);
+    if (!raw) {
+        return LIBUSB_ERROR_NO_MEM;
+    }
+    libusb_fill_bulk_transfer(raw, deviceOf(device), transfer->endpoint, transfer->buffer,
+                              static_cast<int>(transfer->length), &onTransfer, transfer, 0);
+    transfer->backendData = raw;
+    return 0;
+}
+
+void releaseTransfer(UsbTransfer* transfer)
+{
+    libusb_free_transfer(transferOf(transfer));
+    transfer->backendData = nullptr;
+}
+
+int submitTransfer(UsbTransfer* transfer)
+{
+    return libusb_submit_transfer(transferOf(transfer));
+}
+
+int cancelTransfer(UsbTransfer* transfer)
+{
+    return libusb_cancel_transfer(transferOf(transfer));  // LIBUSB_ERROR_NOT_FOUND if already retired
+}
+
+int handleEvents(void* context, int timeoutMs)
+{
+    struct timeval tv = {timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+    int result = libusb_handle_events_timeout_completed(contextOf(context), &tv, nullptr);
+    return result == LIBUSB_ERROR_INTERRUPTED ? 0 : result;
+}
+
+void interruptEvents(void* context)
+{
+#if defined(LIBUSB_API_VERSION) && LIBUSB_API_VERSION >= 0x01000105
+    libusb_interrupt_event_handler(contextOf(context));
+#else
+    (void)context;  // handleEvents() callers poll with a short timeout instead
+#endif
+}
+
+int bulkWrite(void* device, uint8_t endpoint, const uint8_t* data, size_t length,
+              size_t* transferred, unsigned int timeoutMs)
+{
+    int count = 0;
+    int result = libusb_bulk_transfer(deviceOf(device), endpoint, const_cast<uint8_t*>(data),
+                                      static_cast<int>(length), &count, timeoutMs);
+    *transferred = count > 0 ? static_cast<size_t>(count) : 0;
+    return result;
+}
+
+const char* errorName(int error)
+{
+    return libusb_error_name(error);
+}
+
+} // namespace
+
+const UsbBackend& libusbBackend()
+{
+    static const UsbBackend backend = {
+        initContext, exitContext, openDevice, closeDevice, claimInterface, releaseInterface,
+        findBulkEndpoints, prepareTransfer, releaseTransfer, submitTransfer, cancelTransfer,
+        handleEvents, interruptEvents, bulkWrite, errorName
+    };
+    return backend;
+}
@@ -0,0 +1,349 @@
+#include "../include/UsbBulkEngine.h"
+
+namespace {
+
+// Event thread poll interval, a fallback for backends that cannot interrupt event handling
+const int kEventTimeoutMs = 100;
+
+} // namespace
+
+#ifdef WT13106_HAVE_LIBUSB
+UsbBulkEngine::UsbBulkEngine()
+    : UsbBulkEngine(libusbBackend())
+{
+}
+#endif
+
+UsbBulkEngine::UsbBulkEngine(const UsbBackend& backend)
+    : m_backend(backend)
+    , m_context(nullptr)
+    , m_handle(nullptr)
+    , m_inEndpoint(0)
+    , m_outEndpoint(0)
+    , m_interfaceClaimed(false)
+    , m_stopRequested(false)
+    , m_failed(false)
+    , m_activeTransfers(0)
+    , m_readerWaiting(false)
+    , m_droppedBytes(0)
+{
+}
+
+UsbBulkEngine::~UsbBulkEngine()
+{
+    close();
+}
+
+bool UsbBulkEngine::open(uint16_t vid, uint16_t pid, const UsbBulkOptions& options)
+{
+    if (m_handle) {
+        setError("USB device already open");
+        return false;
+    }
+
+    if (options.transferSize == 0 || options.transfersInFlight == 0 || options.ringCapacity == 0) {
+        setError("USB transfer size, transfer count and ring capacity must be non-zero");
+        return false;
+    }
+
+    m_options = options;
+
+    int result = m_backend.init(&m_context);
+    if (result < 0) {
+        m_context = nullptr;
+        setError(backendError("Failed to initialize libusb", result));
+        return false;
+    }
+
+    m_handle = m_backend.openDevice(m_context, vid, pid);
+    if (!m_handle) {
+        setError("USB device not found (VID: " + std::to_string(vid) +
+                 ", PID: " + std::to_string(pid) + ")");
+        close();
+        return false;
+    }
+
+    result = m_backend.claimInterface(m_handle, m_options.interfaceNumber);
+    if (result < 0) {
+        setError(backendError("Failed to claim USB interface", result));
+        close();
+        return false;
+    }
+    m_interfaceClaimed = true;
+
+    if (!findBulkEndpoints()) {
+        close();
+        return false;
+    }
+
+    m_ring.reset(new SpscRingBuffer<uint8_t>(m_options.ringCapacity));
+    m_droppedBytes = 0;
+    m_failed = false;
+    m_stopRequested = false;
+
+    if (!submitTransfers()) {
+        close();
+        return false;
+    }
+
+    m_eventThread = std::thread(&UsbBulkEngine::eventLoop, this);
+    setError("");
+    return true;
+}
+
+void UsbBulkEngine::close()
+{
+    if (m_eventThread.joinable()) {
+        m_stopRequested = true;
+        for (std::unique_ptr<UsbTransfer>& transfer : m_transfers) {
+            m_backend.cancelTransfer(transfer.get());  // Fails harmlessly if already retired
+        }
+        m_backend.interruptEvents(m_context);
+        m_eventThread.join();
+    } else if (m_activeTransfers > 0) {
+        // Transfers were submitted but the event thread never started
+        m_stopRequested = true;
+        for (std::unique_ptr<UsbTransfer>& transfer : m_transfers) {
+            m_backend.cancelTransfer(transfer.get());
+        }
+        while (m_activeTransfers > 0) {
+            if (m_backend.handleEvents(m_context, kEventTimeoutMs) < 0) {
+                break;
+            }
+        }
+    }
+
+    for (std::unique_ptr<UsbTransfer>& transfer : m_transfers) {
+        if (transfer->backendData) {
+            m_backend.releaseTransfer(transfer.get());
+        }
+    }
+    m_transfers.clear();
+    m_transferBuffers.clear();
+
+    if (m_handle) {
+        if (m_interfaceClaimed) {
+            m_backend.releaseInterface(m_handle, m_options.interfaceNumber);
+            m_interfaceClaimed = false;
+        }
+        m_backend.closeDevice(m_handle);
+        m_handle = nullptr;
+    }
+
+    if (m_context) {
+        m_backend.exit(m_context);
+        m_context = nullptr;
+    }
+
+    {
+        // Release any reader blocked in read()
+        std::lock_guard<std::mutex> lock(m_waitMutex);
+        m_dataAvailable.notify_all();
+    }
+}
+
+bool UsbBulkEngine::isOpen() const
+{
+    return m_handle != nullptr;
+}
+
+bool UsbBulkEngine::write(const uint8_t* data, size_t length, unsigned int timeoutMs, size_t* written)
+{
+    size_t sent = 0;
+    if (written) {
+        *written = 0;
+    }
+    if (!m_handle) {
+        setError("USB device not open");
+        return false;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (sent < length) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (sent > 0 && remaining <= 0) {
+            setError("USB bulk write timed out");
+            return false;
+        }
+        size_t transferred = 0;
+        int result = m_backend.bulkWrite(m_handle, m_outEndpoint, data + sent, length - sent,
+                                         &transferred, static_cast<unsigned int>(remaining > 0 ? remaining : 1));
+        sent += transferred;
+        if (written) {
+            *written = sent;
+        }
+        if (result < 0) {
+            setError(backendError("USB bulk write failed", result));
+            return false;
+        }
+        // Retrying a transfer that moved nothing would spin forever
+        if (transferred == 0) {
+            setError("USB bulk write made no progress");
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t UsbBulkEngine::read(uint8_t* buffer, size_t capacity, size_t minBytes,
+                           std::chrono::steady_clock::time_point deadline)
+{
+    if (!m_ring) {
+        setError("USB device not open");
+        return 0;
+    }
+
+    size_t total = 0;
+    for (;;) {
+        total += m_ring->pop(buffer + total, capacity - total);
+        if (total >= minBytes || total == capacity || m_failed) {
+            return total;
+        }
+
+        // Same wake-up protocol as the serial streaming reader: the fence
+        // pairs with the one in onTransferComplete().
+        m_readerWaiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        bool woke;
+        {
+            std::unique_lock<std::mutex> lock(m_waitMutex);
+            woke = m_dataAvailable.wait_until(lock, deadline, [this] {
+                return !m_ring->empty() || m_failed;
+            });
+        }
+
+        m_readerWaiting.store(false, std::memory_order_relaxed);
+        if (!woke) {
+            return total + m_ring->pop(buffer + total, capacity - total);
+        }
+    }
+}
+
+uint64_t UsbBulkEngine::droppedBytes() const
+{
+    return m_droppedBytes;
+}
+
+bool UsbBulkEngine::hasFailed() const
+{
+    return m_failed;
+}
+
+std::string UsbBulkEngine::getLastError() const
+{
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+    return m_lastError;
+}
+
+bool UsbBulkEngine::findBulkEndpoints()
+{
+    int result = m_backend.findBulkEndpoints(m_handle, m_options.interfaceNumber, &m_inEndpoint, &m_outEndpoint);
+    if (result < 0) {
+        setError(backendError("Failed to read USB configuration", result));
+        return false;
+    }
+
+    if (m_inEndpoint == 0 || m_outEndpoint == 0) {
+        setError("USB interface " + std::to_string(m_options.interfaceNumber) +
+                 " has no bulk IN/OUT endpoint pair");
+        return false;
+    }
+    return true;
+}
+
+bool UsbBulkEngine::submitTransfers()
+{
+    for (size_t i = 0; i < m_options.transfersInFlight; ++i) {
+        m_transferBuffers.emplace_back(new uint8_t[m_options.transferSize]);
+        m_transfers.emplace_back(new UsbTransfer());
+        UsbTransfer* transfer = m_transfers.back().get();
+        transfer->endpoint = m_inEndpoint;
+        transfer->buffer = m_transferBuffers.back().get();
+        transfer->length = m_options.transferSize;
+        transfer->callback = &UsbBulkEngine::onTransferComplete;
+        transfer->userData = this;
+
+        int result = m_backend.prepareTransfer(m_handle, transfer);
+        if (result < 0) {
+            setError(backendError("Failed to allocate USB transfer", result));
+            return false;
+        }
+
+        result = m_backend.submitTransfer(transfer);
+        if (result < 0) {
+            setError(backendError("Failed to submit USB transfer", result));
+            return false;
+        }
+        m_activeTransfers.fetch_add(1);
+    }
+    return true;
+}
+
+void UsbBulkEngine::eventLoop()
+{
+    while (m_activeTransfers > 0) {
+        // The timeout bounds close() for backends without interruptEvents()
+        int result = m_backend.handleEvents(m_context, kEventTimeoutMs);
+        if (result < 0) {
+            setError(backendError("libusb event handling failed", result));
+            m_failed = true;
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_waitMutex);
+    m_dataAvailable.notify_all();
+}
+
+void UsbBulkEngine::onTransferComplete(UsbTransfer* transfer, UsbTransferStatus status, size_t actualLength)
+{
+    UsbBulkEngine* engine = static_cast<UsbBulkEngine*>(transfer->userData);
+    if (status == UsbTransferStatus::COMPLETED && actualLength > 0) {
+        size_t pushed = engine->m_ring->push(transfer->buffer, actualLength);
+        if (pushed < actualLength) {
+            engine->m_droppedBytes.fetch_add(actualLength - pushed, std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (engine->m_readerWaiting.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(engine->m_waitMutex);
+            engine->m_dataAvailable.notify_one();
+        }
+    }
+
+    bool resubmit = !engine->m_stopRequested &&
+                    (status == UsbTransferStatus::COMPLETED || status == UsbTransferStatus::TIMED_OUT);
+    if (resubmit) {
+        int result = engine->m_backend.submitTransfer(transfer);
+        if (result == 0) {
+            return;
+        }
+        engine->setError(engine->backendError("Failed to resubmit USB transfer", result));
+        engine->m_failed = true;
+    } else if (status == UsbTransferStatus::NO_DEVICE) {
+        engine->setError("USB device disconnected");
+        engine->m_failed = true;
+    } else if (status == UsbTransferStatus::FAILED) {
+        engine->setError("USB bulk IN transfer failed");
+        engine->m_failed = true;
+    }
+
+    engine->m_activeTransfers.fetch_sub(1);
+    if (engine->m_failed) {
+        std::lock_guard<std::mutex> lock(engine->m_waitMutex);
+        engine->m_dataAvailable.notify_all();
+    }
+}
+
+std::string UsbBulkEngine::backendError(const char* what, int result) const
+{
+    return std::string(what) + ": " + m_backend.errorName(result);
+}
+
+void UsbBulkEngine::setError(const std::string& message)
+{
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+    m_lastError = message;
+}
@@ -3,33 +3,143 @@
 #include <cstring>
 #include <sstream>
 #include <algorithm>
+#include <chrono>
+#include <limits>
+#include <type_traits>
 
-#ifdef _WIN32
-#include <setupapi.h>
-#include <initguid.h>
-#pragma comment(lib, "setupapi.lib")
-#else
-// libusb is optional - only include if available
-// Uncomment and install libusb-dev package for USB support on Linux
-// #include <libusb-1.0/libusb.h>
+#ifndef _WIN32
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#endif
+#include <cerrno>
+#include <poll.h>
+#ifdef __linux__
+#include "LinuxSerialSpeed.h"
+#include "../include/DeviceDiscovery.h"
+#endif
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+uint64_t steadyNowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+std::chrono::steady_clock::time_point steadyFromNs(uint64_t ns)
+{
+    return std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(ns)));
+}
+
+/**
+ * @brief One busy-poll iteration
+ *
+ * Mostly a pause hint (lets the sibling hyperthread run and saves power);
+ * every 64th call yields, so a spinner sharing its core with the thread it
+ * waits for (the streaming reader, the simulator, the device's driver
+ * thread) does not hold it for a whole timeslice.
+ */
+inline void spinPause(unsigned& spins)
+{
+    if ((++spins & 63) == 0) {
+        std::this_thread::yield();
+        return;
+    }
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// Longest a streaming reader without a wake-up descriptor waits in one read
+const int kReaderSliceMs = 10;
+
+// Read-latency stamps for chunks still in the ring. A chunk that finds this
+// full goes unmeasured; its bytes are delivered all the same
+const size_t kChunkStamps = 1024;
+
+#ifndef _WIN32
+// While reconnecting, how often to retry the open without an inotify event
+const int kReconnectRetryMs = 100;
+#endif
+
+// Where publishEvents() decodes to. A BroadcastRing waits for BLOCK
+// subscribers in short slices so a stop request is noticed
+size_t claimEvents(BroadcastRing<StylusEvent>& ring, StylusEvent*& slots, size_t count)
+{
+    return ring.claim(slots, count, std::chrono::steady_clock::now() + std::chrono::milliseconds(100));
+}
+
+bool sinkClosed(const BroadcastRing<StylusEvent>& ring)
+{
+    return ring.isClosed();
+}
+
+#ifdef __linux__
+size_t claimEvents(SharedEventWriter& writer, StylusEvent*& slots, size_t count)
+{
+    return writer.claim(slots, count);
+}
+
+bool sinkClosed(const SharedEventWriter& writer)
+{
+    return !writer.isOpen();
+}
 #endif
 
+} // namespace
+
 WT13106Connection::WT13106Connection(const std::string& connectionString)
     : m_connectionString(connectionString)
-    , m_connectionType(ConnectionType::BLUETOOTH)
     , m_isConnected(false)
+    , m_linkUp(false)
     , m_lastError("")
-    , m_vid(0)
-    , m_pid(0)
-    , m_baudRate(9600)  // Default baud rate, adjust based on device specs
+    , m_sendQueuedSinceNs(0)
+    , m_sendPending(false)
+    , m_sendFlushDueNs(std::numeric_limits<uint64_t>::max())
+    , m_flushFailed(false)
+    , m_asyncLowLatency(false)
+    , m_restoreAsyncLowLatency(false)
+    , m_busyPollUs(0)
+    , m_readerRealtime(false)
+    , m_readerPinned(false)
+    , m_reconnects(0)
+    , m_linkLostNs(0)
+    , m_captureWriter(nullptr)
+    , m_rxOffset(0)
+    , m_rxLength(0)
+    , m_rxTimestampNs(0)
+    , m_lastEventNs(0)
+    , m_bytesPushed(0)
+    , m_bytesPopped(0)
+    , m_streaming(false)
+    , m_stopRequested(false)
+    , m_readerDecodes(false)
+    , m_consumerWaiting(false)
+    , m_droppedBytes(0)
 {
-#ifdef _WIN32
-    m_serialHandle = INVALID_HANDLE_VALUE;
-    m_usbHandle = INVALID_HANDLE_VALUE;
-#else
-    m_serialFd = -1;
-    m_usbFd = -1;
+#ifndef _WIN32
+    m_wakeFd = -1;
+    m_hotplugFd = -1;
 #endif
+    
+    // Replies to submit() are claimed first; everything else goes to the application
+    m_decoder.setFrameHandler([this](const FrameView& frame) {
+        if (!m_requests.onFrame(frame) && m_frameHandler) {
+            m_frameHandler(frame);
+        }
+    });
 }
 
 WT13106Connection::~WT13106Connection()
@@ -42,24 +152,29 @@ WT13106Connection::~WT13106Connection()
 bool WT13106Connection::connect()
 {
     if (m_isConnected) {
-        m_lastError = "Already connected";
-        return false;
+        if (m_linkUp) {
+            m_lastError = "Already connected";
+            return false;
+        }
+        disconnect();  // Start over after a dropped link
     }
     
-    if (!parseConnectionString()) {
+    if (!parseEndpoint(m_connectionString, m_endpoint, m_lastError)) {
         return false;
     }
     
-    bool success = false;
-    if (m_connectionType == ConnectionType::BLUETOOTH) {
-        success = initializeBluetooth();
-    } else if (m_connectionType == ConnectionType::USB) {
-        success = initializeUSB();
-    }
+    bool success = openTransport();
     
     if (success) {
+        if (m_lowLatency.asyncLowLatency) {
+            applyAsyncLowLatency();
+        }
+        m_linkUp = true;
         m_isConnected = true;
         m_lastError = "";
+        m_decoder.reset();
+        m_rxOffset = 0;
+        m_rxLength = 0;
     }
     
     return success;
@@ -72,398 +187,1551 @@ bool WT13106Connection::disconnect()
         return false;
     }
     
+    stopStreaming();
+    {
+        std::lock_guard<std::mutex> lock(m_sendMutex);
+        m_sendQueue.clear();
+        m_sendQueueFrames.clear();
+        m_sendPending.store(false, std::memory_order_relaxed);
+        updateFlushDue();
+    }
     cleanupConnection();
     m_isConnected = false;
+    m_requests.failAll(ResponseStatus::DISCONNECTED);
     m_lastError = "";
     return true;
 }
 
 bool WT13106Connection::isConnected() const
 {
-    return m_isConnected;
+    return m_isConnected && m_linkUp;
 }
 
-bool WT13106Connection::sendCommand(const std::vector<uint8_t>& command)
+void WT13106Connection::setReconnectOptions(const ReconnectOptions& options, LinkStateCallback callback)
 {
-    if (!m_isConnected) {
-        m_lastError = "Not connected to device";
-        return false;
+    m_reconnect = options;
+    m_linkCallback = std::move(callback);
+}
+
+ReconnectOptions WT13106Connection::getReconnectOptions() const
+{
+    return m_reconnect;
+}
+
+uint64_t WT13106Connection::reconnectCount() const
+{
+    return m_reconnects;
+}
+
+bool WT13106Connection::openTransport()
+{
+    bool success = false;
+    switch (m_endpoint.type) {
+    case ConnectionType::BLUETOOTH:
+        success = m_transport.emplace<SerialTransport>().open(m_endpoint, m_lastError);
+        break;
+    case ConnectionType::USB:
+        success = initializeUSB();
+        break;
+    case ConnectionType::REPLAY:
+        success = m_transport.emplace<ReplayTransport>().open(m_endpoint, m_lastError);
+        break;
+    case ConnectionType::PTY:
+#ifndef _WIN32
+        success = m_transport.emplace<PtyTransport>().open(m_endpoint, m_lastError);
+#endif
+        break;
+    case ConnectionType::LOOPBACK:
+        success = m_transport.emplace<LoopbackTransport>().open(m_endpoint, m_lastError);
+        break;
     }
     
-    if (command.empty()) {
-        m_lastError = "Command is empty";
-        return false;
+    if (!success) {
+        m_transport.emplace<NullTransport>();
     }
-    
-    if (m_connectionType == ConnectionType::BLUETOOTH) {
-#ifdef _WIN32
-        DWORD bytesWritten = 0;
-        if (!WriteFile(m_serialHandle, command.data(), command.size(), &bytesWritten, NULL)) {
-            m_lastError = "Failed to write to serial port";
-            return false;
-        }
-        if (bytesWritten != command.size()) {
-            m_lastError = "Partial write to serial port";
-            return false;
-        }
-#else
-        ssize_t bytesWritten = write(m_serialFd, command.data(), command.size());
-        if (bytesWritten < 0) {
-            m_lastError = "Failed to write to serial port";
-            return false;
-        }
-        if (bytesWritten != static_cast<ssize_t>(command.size())) {
-            m_lastError = "Partial write to serial port";
-            return false;
-        }
-#endif
-    } else if (m_connectionType == ConnectionType::USB) {
-        // TODO: Implement USB send logic
-        // For now, USB uses serial-like interface
-        // In production, use libusb_bulk_transfer or similar
-        m_lastError = "USB send not fully implemented";
-        return false;
+    return success;
+}
+
+void WT13106Connection::onLinkLost(const LinkStateCallback& callback)
+{
+    {
+        // Writers use the transport under m_sendMutex
+        std::lock_guard<std::mutex> lock(m_sendMutex);
+        std::visit([](auto& transport) { transport.close(); }, m_transport);
+    }
+    m_linkLostNs = steadyNowNs();
+    m_linkUp = false;
+    if (callback) {
+        callback(false);
     }
-    
-    m_lastError = "";
-    return true;
 }
 
-std::vector<uint8_t> WT13106Connection::receiveResponse(uint32_t timeoutMs)
+#ifndef _WIN32
+void WT13106Connection::drainHotplugEvents()
 {
-    std::vector<uint8_t> response;
+    if (m_hotplugFd < 0) {
+        return;
+    }
+    uint8_t events[4096];
+    while (read(m_hotplugFd, events, sizeof(events)) > 0) {
+    }
+}
+
+bool WT13106Connection::reopenTransport(const ReconnectOptions& options, const LinkStateCallback& callback,
+                                        std::chrono::steady_clock::time_point deadline, int wakeFd)
+{
+    bool reconnectable = std::visit([](const auto& transport) {
+        return std::decay_t<decltype(transport)>::kReconnectable;
+    }, m_transport);
+    if (!reconnectable) {
+        return false;
+    }
     
-    if (!m_isConnected) {
-        m_lastError = "Not connected to device";
-        return response;
+    const std::string& path = m_endpoint.path;
+    std::string directory = options.watchDirectory;
+    if (directory.empty()) {
+        size_t slash = path.rfind('/');
+        directory = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
     }
     
-    if (m_connectionType == ConnectionType::BLUETOOTH) {
-#ifdef _WIN32
-        // Set timeout
-        COMMTIMEOUTS timeouts = {0};
-        timeouts.ReadIntervalTimeout = timeoutMs;
-        timeouts.ReadTotalTimeoutConstant = timeoutMs;
-        timeouts.ReadTotalTimeoutMultiplier = 0;
-        timeouts.WriteTotalTimeoutConstant = timeoutMs;
-        timeouts.WriteTotalTimeoutMultiplier = 0;
-        SetCommTimeouts(m_serialHandle, &timeouts);
-        
-        // Read available data
-        uint8_t buffer[1024];
-        DWORD bytesRead = 0;
-        if (ReadFile(m_serialHandle, buffer, sizeof(buffer), &bytesRead, NULL)) {
-            if (bytesRead > 0) {
-                response.assign(buffer, buffer + bytesRead);
-            }
-        } else {
-            DWORD error = GetLastError();
-            if (error != ERROR_IO_PENDING) {
-                m_lastError = "Failed to read from serial port";
+    // The watch stays open until disconnect(): closing an inotify descriptor
+    // waits out an RCU grace period, several milliseconds that would
+    // otherwise sit between the open() and the link-up callback
+    bool watching = false;
+    bool reopened = false;
+    for (;;) {
+#ifdef __linux__
+        // A board reached through "USB:VID:PID" may come back as another ttyACM
+        if (m_endpoint.type == ConnectionType::USB) {
+            std::string ignored;
+            resolveUsbSerialPort(ignored);
+        }
+#endif
+        {
+            std::string error;
+            std::lock_guard<std::mutex> lock(m_sendMutex);
+            reopened = std::visit([&](auto& transport) {
+                if constexpr (std::decay_t<decltype(transport)>::kReconnectable) {
+                    return transport.open(m_endpoint, error);
+                } else {
+                    return false;
+                }
+            }, m_transport);
+#ifdef __linux__
+            const SerialTransport* serial = std::get_if<SerialTransport>(&m_transport);
+            if (reopened && serial != nullptr && m_asyncLowLatency) {
+                m_asyncLowLatency = setLinuxLowLatency(serial->nativeHandle(), true, nullptr);
             }
+#endif
         }
-#else
-        // Set timeout
-        struct termios tty;
-        if (tcgetattr(m_serialFd, &tty) == 0) {
-            tty.c_cc[VTIME] = timeoutMs / 100;  // Timeout in tenths of seconds
-            tty.c_cc[VMIN] = 0;  // Non-blocking
-            tcsetattr(m_serialFd, TCSANOW, &tty);
+        if (reopened) {
+            break;
         }
         
-        // Read available data
-        uint8_t buffer[1024];
-        ssize_t bytesRead = read(m_serialFd, buffer, sizeof(buffer));
-        if (bytesRead > 0) {
-            response.assign(buffer, buffer + bytesRead);
-        } else if (bytesRead < 0) {
-            m_lastError = "Failed to read from serial port";
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0) {
+            break;
         }
+        
+        if (!watching) {
+            watching = true;
+#ifdef __linux__
+            // IN_ATTRIB catches udev fixing up the permissions of a node
+            // that appeared a moment earlier (the open failed with EACCES)
+            if (m_hotplugFd < 0) {
+                m_hotplugFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+                if (m_hotplugFd >= 0 &&
+                    inotify_add_watch(m_hotplugFd, directory.c_str(), IN_CREATE | IN_ATTRIB | IN_MOVED_TO) < 0) {
+                    close(m_hotplugFd);
+                    m_hotplugFd = -1;  // Fall back to retrying on a timer
+                }
+            }
+            drainHotplugEvents();  // Left over from while the link was up
+#else
+            (void)directory;
 #endif
-    } else if (m_connectionType == ConnectionType::USB) {
-        // TODO: Implement USB receive logic
-        m_lastError = "USB receive not fully implemented";
+            continue;  // Try again now that a node created meanwhile cannot be missed
+        }
+        
+        struct pollfd fds[2];
+        nfds_t count = 0;
+        if (m_hotplugFd >= 0) {
+            fds[count].fd = m_hotplugFd;
+            fds[count].events = POLLIN;
+            ++count;
+        }
+        if (wakeFd >= 0) {
+            fds[count].fd = wakeFd;
+            fds[count].events = POLLIN;
+            ++count;
+        }
+        int ready = poll(fds, count, static_cast<int>(std::min<long long>(remaining, kReconnectRetryMs)));
+        if (ready > 0 && wakeFd >= 0 && (fds[count - 1].revents & POLLIN)) {
+            if (m_stopRequested) {
+                break;
+            }
+            // A submit() wake-up; requests fail while the link is down anyway
+            uint64_t wakeups;
+            ssize_t ignored = read(wakeFd, &wakeups, sizeof(wakeups));
+            (void)ignored;
+        }
+        // Any change in the directory is worth another open()
+        drainHotplugEvents();
     }
     
-    return response;
+    if (reopened) {
+        m_reconnects.fetch_add(1, std::memory_order_relaxed);
+        m_linkUp = true;
+        if (callback) {
+            callback(true);
+        }
+    }
+    return reopened;
 }
+#endif
 
-std::vector<uint8_t> WT13106Connection::sendCommandAndReceive(
-    const std::vector<uint8_t>& command, 
-    uint32_t timeoutMs)
+int WT13106Connection::getNativeHandle() const
 {
-    if (!sendCommand(command)) {
-        return std::vector<uint8_t>();
+    if (!m_isConnected) {
+        return -1;
     }
-    
-    return receiveResponse(timeoutMs);
+    return std::visit([](const auto& transport) { return transport.nativeHandle(); }, m_transport);
 }
 
-std::string WT13106Connection::getLastError() const
+void WT13106Connection::recordExternalRead(const uint8_t* data, size_t length)
 {
-    return m_lastError;
+    captureChunk(data, length);
+    if (m_metrics.enabled()) {
+        ConnectionMetrics::add(m_metrics.readCalls);
+        ConnectionMetrics::add(m_metrics.bytesIn, length);
+    }
 }
 
-bool WT13106Connection::parseConnectionString()
+void WT13106Connection::recordExternalWrite(size_t length)
 {
-    if (m_connectionString.empty()) {
-        m_lastError = "Connection string is empty";
+    if (m_metrics.enabled()) {
+        ConnectionMetrics::add(m_metrics.writeCalls);
+        ConnectionMetrics::add(m_metrics.bytesOut, length);
+    }
+}
+
+bool WT13106Connection::sendCommand(const std::vector<uint8_t>& command)
+{
+    return sendCommand(command.data(), command.size());
+}
+
+bool WT13106Connection::sendCommand(const uint8_t* data, size_t length)
+{
+    if (!m_isConnected) {
+        m_lastError = "Not connected to device";
         return false;
     }
     
-    // Check for Bluetooth connection (format: "BT:COM5" or "BT:/dev/ttyUSB0")
-    if (m_connectionString.substr(0, 3) == "BT:") {
-        m_connectionType = ConnectionType::BLUETOOTH;
-        m_portName = m_connectionString.substr(3);
-        if (m_portName.empty()) {
-            m_lastError = "Invalid Bluetooth connection string format. Use 'BT:COM5' or 'BT:/dev/ttyUSB0'";
-            return false;
-        }
-        return true;
+    if (data == nullptr || length == 0) {
+        m_lastError = "Command is empty";
+        return false;
     }
     
-    // Check for USB connection (format: "USB:1234:5678")
-    if (m_connectionString.substr(0, 4) == "USB:") {
-        m_connectionType = ConnectionType::USB;
-        std::string usbParams = m_connectionString.substr(4);
-        size_t colonPos = usbParams.find(':');
-        
-        if (colonPos == std::string::npos) {
-            m_lastError = "Invalid USB connection string format. Use 'USB:VID:PID' (e.g., 'USB:1234:5678')";
-            return false;
+    std::unique_lock<std::mutex> lock(m_sendMutex);
+    bool ok = true;
+    bool started = false;
+    if (m_sendOptions.policy == FlushPolicy::IMMEDIATE) {
+        CommandBuffer command = {data, length};
+        ok = writeGathered(&command, 1, m_lastError);
+    } else {
+        uint64_t now = steadyNowNs();
+        started = m_sendQueue.empty();
+        if (started) {
+            m_sendQueuedSinceNs = now;
         }
+        m_sendQueue.insert(m_sendQueue.end(), data, data + length);
+        m_sendQueueFrames.push_back(length);
+        m_sendPending.store(true, std::memory_order_relaxed);
         
-        try {
-            m_vid = static_cast<uint16_t>(std::stoul(usbParams.substr(0, colonPos), nullptr, 16));
-            m_pid = static_cast<uint16_t>(std::stoul(usbParams.substr(colonPos + 1), nullptr, 16));
-        } catch (...) {
-            m_lastError = "Invalid VID/PID format. Use hexadecimal (e.g., 'USB:1234:5678')";
-            return false;
+        bool due = m_sendOptions.policy == FlushPolicy::SIZE_THRESHOLD
+                       ? m_sendQueue.size() >= m_sendOptions.sizeThreshold
+                       : now - m_sendQueuedSinceNs >= uint64_t(m_sendOptions.windowUs) * 1000;
+        if (due) {
+            ok = writeGathered(nullptr, 0, m_lastError);
+        } else if (started) {
+            updateFlushDue();
         }
-        
-        return true;
     }
     
-    // Legacy support: if it starts with COM or /dev, assume Bluetooth
-    if (m_connectionString.find("COM") == 0 || m_connectionString.find("/dev/") == 0) {
-        m_connectionType = ConnectionType::BLUETOOTH;
-        m_portName = m_connectionString;
-        return true;
+    if (ok && !takeFlushError()) {
+        m_lastError.clear();
     }
+    lock.unlock();
     
-    m_lastError = "Unknown connection string format. Use 'BT:COM5' for Bluetooth or 'USB:1234:5678' for USB";
-    return false;
+    // The reader may be asleep without a deadline; have it time the window
+    if (started && m_sendPending.load(std::memory_order_relaxed) &&
+        m_sendFlushDueNs.load(std::memory_order_relaxed) != std::numeric_limits<uint64_t>::max()) {
+        wakeReader();
+    }
+    return ok;
 }
 
-bool WT13106Connection::initializeBluetooth()
+bool WT13106Connection::sendBatch(const CommandBuffer* commands, size_t count)
 {
-#ifdef _WIN32
-    // Windows: Open COM port
-    std::string portPath = "\\\\.\\" + m_portName;  // Use \\.\ prefix for COM ports > COM9
-    
-    m_serialHandle = CreateFileA(
-        portPath.c_str(),
-        GENERIC_READ | GENERIC_WRITE,
-        0,
-        NULL,
-        OPEN_EXISTING,
-        0,
-        NULL
-    );
-    
-    if (m_serialHandle == INVALID_HANDLE_VALUE) {
-        DWORD error = GetLastError();
-        m_lastError = "Failed to open COM port: " + m_portName + " (Error: " + std::to_string(error) + ")";
+    if (!m_isConnected) {
+        m_lastError = "Not connected to device";
         return false;
     }
     
-    // Configure serial port settings
-    DCB dcb = {0};
-    dcb.DCBlength = sizeof(DCB);
-    
-    if (!GetCommState(m_serialHandle, &dcb)) {
-        CloseHandle(m_serialHandle);
-        m_serialHandle = INVALID_HANDLE_VALUE;
-        m_lastError = "Failed to get COM port state";
+    if (commands == nullptr || count == 0) {
+        m_lastError = "Command batch is empty";
         return false;
     }
+    for (size_t i = 0; i < count; ++i) {
+        if (commands[i].data == nullptr && commands[i].length > 0) {
+            m_lastError = "Command batch contains a null buffer";
+            return false;
+        }
+    }
     
-    // Set serial port parameters
-    dcb.BaudRate = m_baudRate;
-    dcb.ByteSize = 8;
-    dcb.Parity = NOPARITY;
-    dcb.StopBits = ONESTOPBIT;
-    dcb.fDtrControl = DTR_CONTROL_ENABLE;
-    dcb.fRtsControl = RTS_CONTROL_ENABLE;
-    
-    if (!SetCommState(m_serialHandle, &dcb)) {
-        CloseHandle(m_serialHandle);
-        m_serialHandle = INVALID_HANDLE_VALUE;
-        m_lastError = "Failed to set COM port state";
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    if (!writeGathered(commands, count, m_lastError)) {
         return false;
     }
-    
-    // Set timeouts
-    COMMTIMEOUTS timeouts = {0};
-    timeouts.ReadIntervalTimeout = 50;
-    timeouts.ReadTotalTimeoutConstant = 50;
-    timeouts.ReadTotalTimeoutMultiplier = 10;
-    timeouts.WriteTotalTimeoutConstant = 50;
-    timeouts.WriteTotalTimeoutMultiplier = 10;
-    SetCommTimeouts(m_serialHandle, &timeouts);
-    
+    if (!takeFlushError()) {
+        m_lastError.clear();
+    }
     return true;
-#else
-    // Linux/macOS: Open serial port
-    m_serialFd = open(m_portName.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
-    
-    if (m_serialFd < 0) {
-        m_lastError = "Failed to open serial port: " + m_portName;
+}
+
+void WT13106Connection::setSendOptions(const SendOptions& options)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sendMutex);
+        m_sendOptions = options;
+        updateFlushDue();
+    }
+    wakeReader();
+}
+
+void WT13106Connection::updateFlushDue()
+{
+    uint64_t due = std::numeric_limits<uint64_t>::max();
+    if (!m_sendQueue.empty() && m_sendOptions.policy == FlushPolicy::TIME_WINDOW) {
+        due = m_sendQueuedSinceNs + uint64_t(m_sendOptions.windowUs) * 1000;
+    }
+    m_sendFlushDueNs.store(due, std::memory_order_relaxed);
+}
+
+void WT13106Connection::flushDueCommands()
+{
+    if (m_sendFlushDueNs.load(std::memory_order_relaxed) > steadyNowNs()) {
+        return;
+    }
+    // m_lastError belongs to the application thread; leave the failure for
+    // its next send call to pick up
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    std::string error;
+    if (!m_sendQueue.empty() && !writeGathered(nullptr, 0, error)) {
+        m_flushError = error;
+        m_flushFailed.store(true, std::memory_order_relaxed);
+    }
+}
+
+bool WT13106Connection::takeFlushError()
+{
+    if (!m_flushFailed.load(std::memory_order_relaxed)) {
         return false;
     }
-    
-    // Configure serial port settings
-    struct termios tty;
-    if (tcgetattr(m_serialFd, &tty) != 0) {
-        close(m_serialFd);
-        m_serialFd = -1;
-        m_lastError = "Failed to get serial port attributes";
+    m_flushFailed.store(false, std::memory_order_relaxed);
+    m_lastError = "Queued commands failed to write: " + m_flushError;
+    return true;
+}
+
+void WT13106Connection::wakeReader()
+{
+#ifdef __linux__
+    if (m_streaming && m_wakeFd >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = write(m_wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+#endif
+}
+
+SendOptions WT13106Connection::getSendOptions() const
+{
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    return m_sendOptions;
+}
+
+void WT13106Connection::setLowLatencyOptions(const LowLatencyOptions& options)
+{
+    m_lowLatency = options;
+    m_busyPollUs.store(options.busyPollUs, std::memory_order_relaxed);
+    if (m_isConnected) {
+        applyAsyncLowLatency();
+    }
+}
+
+LowLatencyOptions WT13106Connection::getLowLatencyOptions() const
+{
+    return m_lowLatency;
+}
+
+LowLatencyStatus WT13106Connection::getLowLatencyStatus() const
+{
+    LowLatencyStatus status;
+    status.asyncLowLatency = m_asyncLowLatency;
+    status.realtimeScheduling = m_readerRealtime;
+    status.cpuPinned = m_readerPinned;
+    return status;
+}
+
+void WT13106Connection::applyAsyncLowLatency()
+{
+#ifdef __linux__
+    // Only real serial ports have a driver to ask
+    const SerialTransport* serial = std::get_if<SerialTransport>(&m_transport);
+    if (serial == nullptr || !serial->isOpen()) {
+        return;
+    }
+    int fd = serial->nativeHandle();
+    if (m_lowLatency.asyncLowLatency) {
+        bool wasEnabled = false;
+        m_asyncLowLatency = setLinuxLowLatency(fd, true, &wasEnabled);
+        if (m_asyncLowLatency && !wasEnabled) {
+            m_restoreAsyncLowLatency = true;
+        }
+    } else if (m_restoreAsyncLowLatency) {
+        setLinuxLowLatency(fd, false, nullptr);
+        m_restoreAsyncLowLatency = false;
+        m_asyncLowLatency = false;
+    }
+#endif
+}
+
+bool WT13106Connection::flush()
+{
+    if (!m_isConnected) {
+        m_lastError = "Not connected to device";
         return false;
     }
     
-    // Set baud rate
-    cfsetospeed(&tty, B9600);  // Adjust based on device specs
-    cfsetispeed(&tty, B9600);
-    
-    // 8N1 configuration
-    tty.c_cflag &= ~PARENB;  // No parity
-    tty.c_cflag &= ~CSTOPB;  // 1 stop bit
-    tty.c_cflag &= ~CSIZE;
-    tty.c_cflag |= CS8;      // 8 data bits
-    tty.c_cflag &= ~CRTSCTS; // No hardware flow control
-    tty.c_cflag |= CREAD | CLOCAL; // Enable receiver, ignore modem control
-    
-    // Disable canonical mode
-    tty.c_lflag &= ~ICANON;
-    tty.c_lflag &= ~ECHO;
-    tty.c_lflag &= ~ECHOE;
-    tty.c_lflag &= ~ISIG;
-    
-    // Disable software flow control
-    tty.c_iflag &= ~(IXON | IXOFF | IXANY);
-    
-    // Raw output
-    tty.c_oflag &= ~OPOST;
-    
-    // Set timeouts
-    tty.c_cc[VTIME] = 1;  // 0.1 second timeout
-    tty.c_cc[VMIN] = 0;   // Non-blocking
-    
-    if (tcsetattr(m_serialFd, TCSANOW, &tty) != 0) {
-        close(m_serialFd);
-        m_serialFd = -1;
-        m_lastError = "Failed to set serial port attributes";
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    if (!m_sendQueue.empty() && !writeGathered(nullptr, 0, m_lastError)) {
         return false;
     }
-    
+    takeFlushError();
     return true;
-#endif
 }
 
-bool WT13106Connection::initializeUSB()
+size_t WT13106Connection::pendingSendBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    return m_sendQueue.size();
+}
+
+bool WT13106Connection::writeGathered(const CommandBuffer* buffers, size_t count, std::string& error)
+{
+    return std::visit([&](auto& transport) { return writeTo(transport, buffers, count, error); }, m_transport);
+}
+
+template <class T>
+bool WT13106Connection::writeTo(T& transport, const CommandBuffer* buffers, size_t count, std::string& error)
 {
-    // USB initialization - placeholder implementation
-    // In production, use libusb or Windows USB APIs
+    ConnectionMetrics* metrics = m_metrics.enabled() ? &m_metrics : nullptr;
     
-#ifdef _WIN32
-    // Windows USB implementation using SetupAPI
-    // This is a basic implementation - full USB support requires WinUSB or libusb
+    // Segment 0 is the queue (earlier commands go first), then the caller's buffers
+    auto segmentData = [&](size_t i) {
+        return i == 0 ? m_sendQueue.data() : buffers[i - 1].data;
+    };
+    auto segmentLength = [&](size_t i) {
+        return i == 0 ? m_sendQueue.size() : buffers[i - 1].length;
+    };
+    const size_t segments = count + 1;
+    size_t segment = 0;
+    size_t offset = 0;  // Bytes of the current segment already written
     
-    GUID guid = {0};  // USB device GUID
-    HDEVINFO deviceInfoSet = SetupDiGetClassDevs(&guid, NULL, NULL, DIGCF_PRESENT | DIGCF_DEVICEINTERFACE);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_sendOptions.writeTimeoutMs);
+    bool timedOut = false;
+    bool failed = false;
     
-    if (deviceInfoSet == INVALID_HANDLE_VALUE) {
-        m_lastError = "Failed to enumerate USB devices";
-        return false;
+    for (;;) {
+        while (segment < segments && offset == segmentLength(segment)) {
+            ++segment;
+            offset = 0;
+        }
+        if (segment == segments) {
+            break;
+        }
+        
+        // Hand the transport everything left, a bounded number of segments at a time
+        CommandBuffer pending[kMaxWriteSegments];
+        size_t pendingCount = 0;
+        size_t requested = 0;
+        for (size_t i = segment, first = offset; i < segments && pendingCount < kMaxWriteSegments; ++i, first = 0) {
+            size_t length = segmentLength(i) - first;
+            if (length > 0) {
+                pending[pendingCount].data = segmentData(i) + first;
+                pending[pendingCount].length = length;
+                requested += length;
+                ++pendingCount;
+            }
+        }
+        
+        TransportResult result = transport.write(pending, pendingCount, deadline);
+        if (result.status == TransportStatus::TIMEOUT) {
+            timedOut = true;
+            break;
+        }
+        if (result.status != TransportStatus::OK) {
+            error = transport.getLastError();
+            failed = true;
+            break;
+        }
+        size_t written = result.bytes;
+        
+        if (metrics) {
+            ConnectionMetrics::add(metrics->writeCalls);
+            ConnectionMetrics::add(metrics->bytesOut, written);
+            if (written < requested) {
+                ConnectionMetrics::add(metrics->partialWrites);
+            }
+        }
+        
+        // Advance the cursor across as many segments as the write covered
+        while (written > 0) {
+            size_t step = std::min(written, segmentLength(segment) - offset);
+            offset += step;
+            written -= step;
+            if (offset == segmentLength(segment)) {
+                ++segment;
+                offset = 0;
+            }
+        }
     }
     
-    // Search for device with matching VID/PID
-    SP_DEVICE_INTERFACE_DATA deviceInterfaceData;
-    deviceInterfaceData.cbSize = sizeof(SP_DEVICE_INTERFACE_DATA);
-    
-    bool found = false;
-    for (DWORD i = 0; SetupDiEnumDeviceInterfaces(deviceInfoSet, NULL, &guid, i, &deviceInterfaceData); i++) {
-        // Get device path and check VID/PID
-        // Full implementation would parse device path and match VID/PID
+    if (segment == segments) {
+        if (metrics) {
+            ConnectionMetrics::add(metrics->framesOut, m_sendQueueFrames.size() + count);
+        }
+        m_sendQueue.clear();
+        m_sendQueueFrames.clear();
+        m_sendPending.store(false, std::memory_order_relaxed);
+        updateFlushDue();
+        return !failed;
     }
     
-    SetupDiDestroyDeviceInfoList(deviceInfoSet);
-    
-    if (!found) {
-        m_lastError = "USB device not found (VID: " + std::to_string(m_vid) + 
-                      ", PID: " + std::to_string(m_pid) + ")";
-        return false;
+    // Count the commands whose last byte went out; the others, the first of
+    // them possibly cut short, make up the unsent tail
+    size_t sentFrames = 0;
+    std::vector<size_t> restFrames;
+    size_t queueWritten = segment > 0 ? m_sendQueue.size() : offset;
+    size_t frameEnd = 0;
+    for (size_t length : m_sendQueueFrames) {
+        frameEnd += length;
+        if (frameEnd <= queueWritten) {
+            ++sentFrames;
+        } else {
+            restFrames.push_back(std::min(length, frameEnd - queueWritten));
+        }
     }
-    
-    m_lastError = "USB connection requires full WinUSB or libusb implementation. "
-                  "For now, use Bluetooth connection (BT:COMx)";
-    return false;
-#else
-    // Linux USB implementation - requires libusb
-    // Uncomment and install libusb-dev for USB support:
-    /*
-    libusb_context* ctx = nullptr;
-    libusb_device_handle* handle = nullptr;
-    
-    int result = libusb_init(&ctx);
-    if (result < 0) {
-        m_lastError = "Failed to initialize libusb";
-        return false;
+    for (size_t i = 1; i < segments; ++i) {
+        size_t written = i < segment ? segmentLength(i) : (i == segment ? offset : 0);
+        if (written == segmentLength(i)) {
+            ++sentFrames;
+        } else {
+            restFrames.push_back(segmentLength(i) - written);
+        }
     }
-    
-    handle = libusb_open_device_with_vid_pid(ctx, m_vid, m_pid);
-    if (!handle) {
-        libusb_exit(ctx);
-        m_lastError = "USB device not found (VID: " + std::to_string(m_vid) + 
-                      ", PID: " + std::to_string(m_pid) + ")";
-        return false;
+    if (metrics) {
+        ConnectionMetrics::add(metrics->framesOut, sentFrames);
     }
     
-    // Claim interface (assuming interface 0)
-    if (libusb_claim_interface(handle, 0) < 0) {
-        libusb_close(handle);
-        libusb_exit(ctx);
-        m_lastError = "Failed to claim USB interface";
+    if (timedOut) {
+        // Keep the unsent tail, starting at the exact byte the port stopped at,
+        // so the next write resumes the interrupted command instead of
+        // corrupting the stream
+        std::vector<uint8_t> rest;
+        for (size_t i = segment, first = offset; i < segments; ++i, first = 0) {
+            rest.insert(rest.end(), segmentData(i) + first, segmentData(i) + segmentLength(i));
+        }
+        m_sendQueue.swap(rest);
+        m_sendQueueFrames.swap(restFrames);
+        m_sendQueuedSinceNs = steadyNowNs();
+        m_sendPending.store(true, std::memory_order_relaxed);
+        updateFlushDue();
+        error = "Timed out writing to the port; " + std::to_string(m_sendQueue.size()) +
+                " bytes remain queued";
         return false;
     }
     
-    // Store handle (in production, store ctx and handle as member variables)
-    libusb_release_interface(handle, 0);
-    libusb_close(handle);
-    libusb_exit(ctx);
-    */
+    m_sendQueue.clear();
+    m_sendQueueFrames.clear();
+    m_sendPending.store(false, std::memory_order_relaxed);
+    updateFlushDue();
+    return false;
+}
+
+std::vector<uint8_t> WT13106Connection::receiveResponse(uint32_t timeoutMs)
+{
+    uint8_t buffer[1024];
+    size_t bytesRead = receiveInto(buffer, sizeof(buffer), timeoutMs);
+    return std::vector<uint8_t>(buffer, buffer + bytesRead);
+}
+
+size_t WT13106Connection::receiveInto(std::vector<uint8_t>& buffer, uint32_t timeoutMs)
+{
+    // Read straight into the spare capacity; only the bytes actually read are kept
+    size_t oldSize = buffer.size();
+    size_t room = buffer.capacity() > oldSize ? buffer.capacity() - oldSize : 1024;
+    buffer.resize(oldSize + room);
+    size_t bytesRead = receiveInto(buffer.data() + oldSize, room, timeoutMs);
+    buffer.resize(oldSize + bytesRead);
+    return bytesRead;
+}
+
+size_t WT13106Connection::receiveInto(uint8_t* buffer, size_t capacity, uint32_t timeoutMs)
+{
+    return receiveUntil(buffer, capacity, 1,
+                        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs));
+}
+
+size_t WT13106Connection::receiveExact(uint8_t* buffer, size_t length, uint32_t timeoutMs)
+{
+    return receiveUntil(buffer, length, length,
+                        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs));
+}
+
+size_t WT13106Connection::receiveExact(uint8_t* buffer, size_t length,
+                                       std::chrono::steady_clock::time_point deadline)
+{
+    return receiveUntil(buffer, length, length, deadline);
+}
+
+size_t WT13106Connection::receiveUntil(uint8_t* buffer, size_t capacity, size_t minBytes,
+                                       std::chrono::steady_clock::time_point deadline)
+{
+    if (!m_isConnected) {
+        m_lastError = "Not connected to device";
+        return 0;
+    }
+    
+    if (m_streaming) {
+        m_lastError = "Streaming mode is active; use pop() to read data";
+        return 0;
+    }
+    
+    if (buffer == nullptr || capacity == 0) {
+        m_lastError = "Receive buffer is empty";
+        return 0;
+    }
+    
+    m_lastError.clear();
+    if (m_sendPending.load(std::memory_order_relaxed)) {
+        flush();
+    }
+    
+    ConnectionMetrics* metrics = m_metrics.enabled() ? &m_metrics : nullptr;
+    auto started = metrics ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    
+    uint64_t readyNs = 0;
+    size_t total = std::visit([&](auto& transport) {
+        return receiveFrom(transport, buffer, capacity, minBytes, deadline, metrics, readyNs);
+    }, m_transport);
+    
+    if (total > 0) {
+        captureChunk(buffer, total);
+    }
+    if (metrics && total > 0) {
+        metrics->receiveWait.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - started).count()));
+        metrics->readLatency.record(steadyNowNs() - readyNs);
+    }
+    return total;
+}
+
+template <class T>
+size_t WT13106Connection::receiveFrom(T& transport, uint8_t* buffer, size_t capacity, size_t minBytes,
+                                      std::chrono::steady_clock::time_point deadline, ConnectionMetrics* metrics,
+                                      uint64_t& readyNs)
+{
+    // Each read waits in the transport against the monotonic deadline; while
+    // the busy-poll window is open it only takes what is already there
+    const uint64_t busyPollNs = m_busyPollUs.load(std::memory_order_relaxed) * uint64_t(1000);
+    uint64_t spinUntilNs = 0;
+    unsigned spins = 0;
+    size_t total = 0;
+    for (;;) {
+#ifndef _WIN32
+        if (T::kReconnectable && !transport.isOpen()) {
+            // The link dropped; wait for the port within this call's deadline
+            auto giveUp = deadline;
+            if (m_reconnect.timeoutMs > 0) {
+                giveUp = std::min(giveUp, steadyFromNs(m_linkLostNs) +
+                                          std::chrono::milliseconds(m_reconnect.timeoutMs));
+            }
+            if (!m_reconnect.enabled || !reopenTransport(m_reconnect, m_linkCallback, giveUp, -1)) {
+                m_lastError = m_reconnect.enabled ? "Serial link is down; waiting for the port to reappear"
+                                                  : "Serial port closed";
+                break;
+            }
+        }
+#endif
+        
+        auto waitUntil = deadline;
+        if (busyPollNs > 0) {
+            uint64_t now = steadyNowNs();
+            if (spinUntilNs == 0) {
+                spinUntilNs = now + busyPollNs;
+            }
+            if (now < spinUntilNs) {
+                waitUntil = TransportDeadline();
+            }
+        }
+        
+        TransportResult result = transport.read(buffer + total, capacity - total, waitUntil);
+        if (metrics) {
+            ConnectionMetrics::add(metrics->readCalls);
+            if (result.bytes > 0) {
+                ConnectionMetrics::add(metrics->bytesIn, result.bytes);
+                if (total == 0) {
+                    readyNs = steadyNowNs();  // The transport returns as soon as data is there
+                }
+            } else {
+                ConnectionMetrics::add(metrics->emptyReads);
+            }
+        }
+        if (result.bytes > 0) {
+            total += result.bytes;
+            if (total >= minBytes || total == capacity) {
+                break;
+            }
+            continue;
+        }
+        
+        if (result.status == TransportStatus::TIMEOUT) {
+            // Bounded busy-poll: retry the read for a while before sleeping
+            if (waitUntil < deadline && std::chrono::steady_clock::now() < deadline) {
+                spinPause(spins);
+                continue;
+            }
+            if (metrics) {
+                ConnectionMetrics::add(metrics->timeouts);
+            }
+            break;
+        }
+        
+#ifndef _WIN32
+        if (T::kReconnectable && result.status == TransportStatus::CLOSED) {
+            onLinkLost(m_linkCallback);
+            if (m_reconnect.enabled) {
+                continue;
+            }
+        }
+#endif
+        m_lastError = transport.getLastError();
+        break;
+    }
+    return total;
+}
+
+size_t WT13106Connection::receiveEvents(StylusEvent* events, size_t capacity, uint32_t timeoutMs)
+{
+    if (events == nullptr || capacity == 0) {
+        m_lastError = "Event buffer is empty";
+        return 0;
+    }
+    
+    if (m_streaming && !m_ring) {
+        m_lastError = "Streaming callback is active; decode chunks with a FrameDecoder";
+        return 0;
+    }
+    
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    for (;;) {
+        if (m_rxOffset < m_rxLength) {
+            size_t produced = 0;
+            FrameDecoderStats before = m_decoder.stats();
+            m_rxOffset += m_decoder.decode(m_rxBuffer + m_rxOffset, m_rxLength - m_rxOffset,
+                                           m_rxTimestampNs, events, capacity, produced);
+            if (m_metrics.enabled()) {
+                recordDecodeMetrics(before, events, produced);
+            }
+            if (produced > 0) {
+                return produced;
+            }
+        }
+        
+        // Everything buffered has been decoded; fetch the next chunk, waking
+        // up early if a submitted request times out first
+        auto waitUntil = deadline;
+        uint64_t requestDeadlineNs = m_requests.nextDeadlineNs();
+        if (requestDeadlineNs != std::numeric_limits<uint64_t>::max()) {
+            waitUntil = std::min(waitUntil, steadyFromNs(requestDeadlineNs));
+        }
+        
+        size_t bytesRead = (m_ring && (m_streaming || !m_ring->empty()))
+                               ? popUntil(m_rxBuffer, sizeof(m_rxBuffer), waitUntil)
+                               : receiveUntil(m_rxBuffer, sizeof(m_rxBuffer), 1, waitUntil);
+        uint64_t now = steadyNowNs();
+        if (m_requests.nextDeadlineNs() <= now) {
+            m_requests.expire(now);
+        }
+        if (bytesRead == 0) {
+            // Keep waiting only if we woke up for a request deadline rather
+            // than because of an error or the end of streaming
+            if (waitUntil < deadline && std::chrono::steady_clock::now() >= waitUntil) {
+                continue;
+            }
+            return 0;
+        }
+        m_rxOffset = 0;
+        m_rxLength = bytesRead;
+        m_rxTimestampNs = now;
+    }
+}
+
+void WT13106Connection::recordDecodeMetrics(const FrameDecoderStats& before,
+                                            const StylusEvent* events, size_t produced)
+{
+    const FrameDecoderStats& after = m_decoder.stats();
+    ConnectionMetrics::add(m_metrics.framesIn, (after.penFrames - before.penFrames) +
+                                               (after.otherFrames - before.otherFrames));
+    ConnectionMetrics::add(m_metrics.frameErrors, after.checksumErrors - before.checksumErrors);
     
-    m_lastError = "USB connection requires libusb. Install with: sudo apt-get install libusb-1.0-0-dev";
+    for (size_t i = 0; i < produced; ++i) {
+        if (m_lastEventNs != 0) {
+            m_metrics.interFrameGap.record(events[i].timestampNs - m_lastEventNs);
+        }
+        m_lastEventNs = events[i].timestampNs;
+    }
+}
+
+void WT13106Connection::expireRequests()
+{
+    uint64_t now = steadyNowNs();
+    if (m_requests.nextDeadlineNs() <= now) {
+        m_requests.expire(now);
+    }
+}
+
+#ifdef __linux__
+int WT13106Connection::readerWaitMs() const
+{
+    uint64_t deadlineNs = m_sendFlushDueNs.load(std::memory_order_relaxed);
+    if (m_readerDecodes) {
+        deadlineNs = std::min(deadlineNs, m_requests.nextDeadlineNs());
+    }
+    if (deadlineNs == std::numeric_limits<uint64_t>::max()) {
+        return -1;
+    }
+    uint64_t now = steadyNowNs();
+    // Round up so the reader does not wake just before the deadline
+    return deadlineNs <= now ? 0 : static_cast<int>(std::min<uint64_t>((deadlineNs - now + 999999) / 1000000,
+                                                                       INT32_MAX));
+}
+#endif
+
+void WT13106Connection::setFrameHandler(FrameDecoder::FrameHandler handler)
+{
+    m_frameHandler = std::move(handler);
+}
+
+const FrameDecoderStats& WT13106Connection::getFrameStats() const
+{
+    return m_decoder.stats();
+}
+
+std::vector<uint8_t> WT13106Connection::sendCommandAndReceive(
+    const std::vector<uint8_t>& command, 
+    uint32_t timeoutMs)
+{
+    if (!sendCommand(command)) {
+        return std::vector<uint8_t>();
+    }
+    
+    return receiveResponse(timeoutMs);
+}
+
+std::future<Response> WT13106Connection::submit(uint8_t type, const uint8_t* payload, uint8_t length,
+                                                const SubmitOptions& options)
+{
+    auto promise = std::make_shared<std::promise<Response>>();
+    std::future<Response> future = promise->get_future();
+    submit(type, payload, length, [promise](const Response& response) {
+        promise->set_value(response);
+    }, options);
+    return future;
+}
+
+bool WT13106Connection::submit(uint8_t type, const uint8_t* payload, uint8_t length, ResponseCallback callback,
+                               const SubmitOptions& options)
+{
+    Response failed;
+    failed.status = ResponseStatus::SEND_FAILED;
+    
+    if (!m_isConnected) {
+        m_lastError = "Not connected to device";
+    } else if (m_streaming && !m_ring && !m_readerDecodes) {
+        m_lastError = "Streaming callback is active; requests need receiveEvents()";
+    } else if (payload == nullptr && length > 0) {
+        m_lastError = "Request payload is empty";
+    } else {
+        int sequence = m_requests.begin(type, options, std::move(callback), steadyNowNs());
+        if (sequence < 0) {
+            m_lastError = "Too many outstanding requests";
+        } else {
+            uint8_t frame[FRAME_MAX_SIZE];
+            size_t frameLength = encodeFrame(type, static_cast<uint8_t>(sequence), payload, length, frame);
+            // A write that timed out leaves the rest of the frame queued; it
+            // still goes out, so the request stays outstanding
+            if (!sendCommand(frame, frameLength) && pendingSendBytes() == 0) {
+                m_requests.cancel(static_cast<uint8_t>(sequence), ResponseStatus::SEND_FAILED);
+                return false;
+            }
+            // A decoding reader may be asleep with no deadline; have it pick this one up
+            if (m_readerDecodes) {
+                wakeReader();
+            }
+            return true;
+        }
+    }
+    
+    if (callback) {
+        callback(failed);
+    }
     return false;
+}
+
+size_t WT13106Connection::outstandingRequests() const
+{
+    return m_requests.outstanding();
+}
+
+std::string WT13106Connection::getLastError() const
+{
+    return m_lastError;
+}
+
+void WT13106Connection::setMetricsEnabled(bool enabled)
+{
+    m_metrics.setEnabled(enabled);
+}
+
+bool WT13106Connection::metricsEnabled() const
+{
+    return m_metrics.enabled();
+}
+
+ConnectionMetricsSnapshot WT13106Connection::getMetrics() const
+{
+    return m_metrics.snapshot();
+}
+
+void WT13106Connection::resetMetrics()
+{
+    m_metrics.reset();
+    m_lastEventNs = 0;
+}
+
+bool WT13106Connection::startStreaming(const StreamingOptions& options, StreamDataCallback callback)
+{
+    if (!m_isConnected) {
+        m_lastError = "Not connected to device";
+        return false;
+    }
+    
+    if (m_streaming) {
+        m_lastError = "Streaming mode already active";
+        return false;
+    }
+    
+    // Reap a reader that exited on its own (e.g. the port hung up)
+    stopStreaming();
+    
+    if (options.ringCapacity == 0 || options.readChunkSize == 0) {
+        m_lastError = "Ring capacity and read chunk size must be non-zero";
+        return false;
+    }
+    
+    if (!m_linkUp) {
+        m_lastError = "Serial link is down";
+        return false;
+    }
+    
+#ifdef __linux__
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0) {
+        m_lastError = "Failed to create reader wake-up eventfd";
+        return false;
+    }
 #endif
+    
+    m_streamOptions = options;
+    m_streamCallback = std::move(callback);
+    m_ring.reset(m_streamCallback ? nullptr : new SpscRingBuffer<uint8_t>(options.ringCapacity));
+    m_chunkStamps.reset(m_streamCallback ? nullptr : new SpscRingBuffer<ChunkStamp>(kChunkStamps));
+    m_bytesPushed = 0;
+    m_bytesPopped = 0;
+    m_droppedBytes = 0;
+    m_stopRequested = false;
+    m_readerRealtime = false;
+    m_readerPinned = false;
+    m_streaming = true;
+    
+    try {
+        LowLatencyOptions tuning = m_lowLatency;
+        ReconnectOptions reconnect = m_reconnect;
+        LinkStateCallback linkCallback = m_linkCallback;
+        m_readerThread = std::thread([this, tuning, reconnect, linkCallback]() {
+            applyReaderThreadTuning(tuning);
+            readerLoop(reconnect, linkCallback);
+        });
+    } catch (const std::system_error&) {
+        m_streaming = false;
+#ifndef _WIN32
+        if (m_wakeFd >= 0) {
+            close(m_wakeFd);
+            m_wakeFd = -1;
+        }
+#endif
+        m_lastError = "Failed to start reader thread";
+        return false;
+    }
+    
+    m_lastError = "";
+    return true;
 }
 
-void WT13106Connection::cleanupConnection()
+bool WT13106Connection::startBroadcast(BroadcastRing<StylusEvent>& ring, const StreamingOptions& options)
 {
-    if (m_connectionType == ConnectionType::BLUETOOTH) {
-#ifdef _WIN32
-        if (m_serialHandle != INVALID_HANDLE_VALUE) {
-            CloseHandle(m_serialHandle);
-            m_serialHandle = INVALID_HANDLE_VALUE;
+    BroadcastRing<StylusEvent>* target = &ring;
+    if (!startStreaming(options, [this, target](const uint8_t* data, size_t length) {
+            publishEvents(*target, data, length);
+        })) {
+        return false;
+    }
+    m_readerDecodes = true;
+    return true;
+}
+
+#ifdef __linux__
+bool WT13106Connection::startSharedExport(SharedEventWriter& writer, const StreamingOptions& options)
+{
+    if (!writer.isOpen()) {
+        m_lastError = "Shared event ring is not open";
+        return false;
+    }
+    SharedEventWriter* target = &writer;
+    if (!startStreaming(options, [this, target](const uint8_t* data, size_t length) {
+            publishEvents(*target, data, length);
+        })) {
+        return false;
+    }
+    m_readerDecodes = true;
+    return true;
+}
+#endif
+
+bool WT13106Connection::stopStreaming()
+{
+    if (!m_readerThread.joinable()) {
+        return false;
+    }
+    
+    m_stopRequested = true;
+#ifndef _WIN32
+    if (m_wakeFd >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = write(m_wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+#endif
+    m_readerThread.join();
+    m_readerRealtime = false;
+    m_readerPinned = false;
+    
+#ifndef _WIN32
+    if (m_wakeFd >= 0) {
+        close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+#endif
+    
+    m_streaming = false;
+    m_readerDecodes = false;
+    {
+        // Release any consumer blocked in pop()
+        std::lock_guard<std::mutex> lock(m_waitMutex);
+        m_dataAvailable.notify_all();
+    }
+    m_streamCallback = nullptr;
+    return true;
+}
+
+bool WT13106Connection::isStreaming() const
+{
+    return m_streaming;
+}
+
+size_t WT13106Connection::tryPop(uint8_t* buffer, size_t capacity)
+{
+    if (!m_ring || capacity == 0) {
+        return 0;
+    }
+    size_t n = m_ring->pop(buffer, capacity);
+    if (n > 0) {
+        recordChunksHandedOut(n);
+    }
+    return n;
+}
+
+void WT13106Connection::recordChunksHandedOut(size_t popped)
+{
+    m_bytesPopped += popped;
+    uint64_t now = 0;
+    ChunkStamp stamp;
+    while (m_chunkStamps->peek(&stamp, 1) == 1 && stamp.endBytes <= m_bytesPopped) {
+        m_chunkStamps->consume(1);
+        if (m_metrics.enabled()) {
+            now = now ? now : steadyNowNs();
+            m_metrics.readLatency.record(now - stamp.readyNs);
         }
+    }
+}
+
+size_t WT13106Connection::pop(uint8_t* buffer, size_t capacity, uint32_t timeoutMs)
+{
+    return popUntil(buffer, capacity,
+                    std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs));
+}
+
+size_t WT13106Connection::popUntil(uint8_t* buffer, size_t capacity,
+                                   std::chrono::steady_clock::time_point deadline)
+{
+    size_t n = tryPop(buffer, capacity);
+    if (n > 0 || !m_ring || !m_streaming) {
+        return n;
+    }
+    
+    if (m_sendPending.load(std::memory_order_relaxed)) {
+        flush();
+    }
+    
+    ConnectionMetrics* metrics = m_metrics.enabled() ? &m_metrics : nullptr;
+    auto started = metrics ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    
+    // Bounded busy-poll on the ring before sleeping on the condition variable
+    const uint64_t busyPollNs = m_busyPollUs.load(std::memory_order_relaxed) * uint64_t(1000);
+    if (busyPollNs > 0) {
+        uint64_t spinUntilNs = steadyNowNs() + busyPollNs;
+        unsigned spins = 0;
+        for (;;) {
+            n = tryPop(buffer, capacity);
+            if (n > 0 || !m_streaming) {
+                if (metrics && n > 0) {
+                    metrics->receiveWait.record(static_cast<uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - started).count()));
+                }
+                return n;
+            }
+            uint64_t now = steadyNowNs();
+            if (now >= spinUntilNs || steadyFromNs(now) >= deadline) {
+                break;
+            }
+            spinPause(spins);
+        }
+    }
+    
+    // Announce that we are about to sleep; the fence pairs with the one in
+    // deliverChunk() so either we see the new data or the reader sees the flag.
+    m_consumerWaiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    
+    {
+        std::unique_lock<std::mutex> lock(m_waitMutex);
+        m_dataAvailable.wait_until(lock, deadline, [this] {
+            return !m_ring->empty() || !m_streaming;
+        });
+    }
+    
+    m_consumerWaiting.store(false, std::memory_order_relaxed);
+    n = tryPop(buffer, capacity);
+    if (metrics) {
+        if (n > 0) {
+            metrics->receiveWait.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - started).count()));
+        } else {
+            ConnectionMetrics::add(metrics->timeouts);
+        }
+    }
+    return n;
+}
+
+uint64_t WT13106Connection::droppedBytes() const
+{
+    return m_droppedBytes;
+}
+
+void WT13106Connection::deliverChunk(const uint8_t* data, size_t length, uint64_t readyNs)
+{
+    captureChunk(data, length);
+    
+    if (m_streamCallback) {
+        m_streamCallback(data, length);
+        if (m_metrics.enabled()) {
+            m_metrics.readLatency.record(steadyNowNs() - readyNs);
+        }
+        return;
+    }
+    
+    // The consumer records the latency when it pops the chunk's last byte
+    size_t pushed = m_ring->push(data, length);
+    if (pushed > 0 && m_metrics.enabled()) {
+        ChunkStamp stamp = {m_bytesPushed + pushed, readyNs};
+        m_chunkStamps->push(&stamp, 1);
+    }
+    m_bytesPushed += pushed;
+    if (pushed < length) {
+        m_droppedBytes.fetch_add(length - pushed, std::memory_order_relaxed);
+        if (m_metrics.enabled()) {
+            ConnectionMetrics::add(m_metrics.ringOverflows);
+            ConnectionMetrics::add(m_metrics.ringDroppedBytes, length - pushed);
+        }
+    }
+    
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_consumerWaiting.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(m_waitMutex);
+        m_dataAvailable.notify_one();
+    }
+}
+
+template <class Sink>
+void WT13106Connection::publishEvents(Sink& sink, const uint8_t* data, size_t length)
+{
+    const uint64_t timestampNs = steadyNowNs();
+    size_t offset = 0;
+    while (offset < length) {
+        // Claim no more slots than pen frames can complete, so BLOCK
+        // subscribers are only waited for when the events really need room
+        size_t most = std::max<size_t>(1, (m_decoder.pendingBytes() + length - offset) / PEN_FRAME_SIZE);
+        StylusEvent* slots = nullptr;
+        size_t room = 0;
+        while (room == 0) {
+            if (m_stopRequested || sinkClosed(sink)) {
+                m_droppedBytes.fetch_add(length - offset, std::memory_order_relaxed);
+                if (m_metrics.enabled()) {
+                    ConnectionMetrics::add(m_metrics.ringOverflows);
+                    ConnectionMetrics::add(m_metrics.ringDroppedBytes, length - offset);
+                }
+                return;
+            }
+            room = claimEvents(sink, slots, most);
+        }
+        
+        size_t produced = 0;
+        FrameDecoderStats before = m_decoder.stats();
+        offset += m_decoder.decode(data + offset, length - offset, timestampNs, slots, room, produced);
+        if (m_metrics.enabled()) {
+            recordDecodeMetrics(before, slots, produced);
+        }
+        sink.commit(produced);
+    }
+}
+
+void WT13106Connection::applyReaderThreadTuning(const LowLatencyOptions& options)
+{
+#ifdef _WIN32
+    if (options.realtimePriority > 0) {
+        m_readerRealtime = SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+    }
+    if (options.cpu >= 0 && options.cpu < static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+        m_readerPinned = SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << options.cpu) != 0;
+    }
+#elif defined(__linux__)
+    if (options.realtimePriority > 0) {
+        struct sched_param param = {};
+        param.sched_priority = std::min(std::max(options.realtimePriority, sched_get_priority_min(SCHED_FIFO)),
+                                        sched_get_priority_max(SCHED_FIFO));
+        m_readerRealtime = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+    }
+    if (options.cpu >= 0 && options.cpu < CPU_SETSIZE) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(options.cpu, &cpus);
+        m_readerPinned = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+    }
 #else
-        if (m_serialFd >= 0) {
-            close(m_serialFd);
-            m_serialFd = -1;
+    (void)options;
+#endif
+}
+
+void WT13106Connection::readerLoop(const ReconnectOptions& reconnect, const LinkStateCallback& linkCallback)
+{
+    std::vector<uint8_t> chunk(m_streamOptions.readChunkSize);
+    
+    std::visit([&](auto& transport) {
+#ifdef __linux__
+        if (transport.nativeHandle() >= 0) {
+            streamFromDescriptor(transport, chunk.data(), chunk.size(), reconnect, linkCallback);
+            return;
+        }
+#endif
+        streamFrom(transport, chunk.data(), chunk.size(), reconnect, linkCallback);
+    }, m_transport);
+    
+    m_streaming = false;
+    std::lock_guard<std::mutex> lock(m_waitMutex);
+    m_dataAvailable.notify_all();
+}
+
+template <class T>
+void WT13106Connection::streamFrom(T& transport, uint8_t* chunk, size_t chunkSize,
+                                   const ReconnectOptions& reconnect, const LinkStateCallback& linkCallback)
+{
+    // Without a wake-up descriptor, wait in short slices so stopStreaming()
+    // is noticed promptly
+    const auto slice = std::chrono::milliseconds(kReaderSliceMs);
+    
+    while (!m_stopRequested) {
+        if (m_readerDecodes) {
+            expireRequests();
+        }
+        flushDueCommands();
+        TransportResult result = transport.read(chunk, chunkSize, std::chrono::steady_clock::now() + slice);
+        const uint64_t readyNs = steadyNowNs();  // The read returns as soon as data is there
+        if (m_metrics.enabled()) {
+            ConnectionMetrics::add(m_metrics.readCalls);
+            if (result.bytes > 0) {
+                ConnectionMetrics::add(m_metrics.bytesIn, result.bytes);
+            } else {
+                ConnectionMetrics::add(m_metrics.emptyReads);
+            }
+        }
+        if (result.bytes > 0) {
+            deliverChunk(chunk, result.bytes, readyNs);
+            continue;
+        }
+        if (result.status == TransportStatus::TIMEOUT) {
+            continue;
+        }
+        
+#ifndef _WIN32
+        if (T::kReconnectable && result.status == TransportStatus::CLOSED) {
+            onLinkLost(linkCallback);
+            auto giveUp = reconnect.timeoutMs > 0
+                              ? std::chrono::steady_clock::now() + std::chrono::milliseconds(reconnect.timeoutMs)
+                              : std::chrono::steady_clock::time_point::max();
+            while (reconnect.enabled && !m_stopRequested) {
+                auto now = std::chrono::steady_clock::now();
+                if (now >= giveUp || reopenTransport(reconnect, linkCallback, std::min(giveUp, now + slice), -1)) {
+                    break;
+                }
+            }
+            if (transport.isOpen()) {
+                continue;
+            }
         }
 #endif
-    } else if (m_connectionType == ConnectionType::USB) {
-        // Cleanup USB resources
-        // Implementation depends on USB library used
+        break;  // The end of a capture, a hang-up without reconnect, or a failure
     }
+#ifdef _WIN32
+    (void)reconnect;
+    (void)linkCallback;
+#endif
+}
+
+#ifdef __linux__
+template <class T>
+void WT13106Connection::streamFromDescriptor(T& transport, uint8_t* chunk, size_t chunkSize,
+                                             const ReconnectOptions& reconnect,
+                                             const LinkStateCallback& linkCallback)
+{
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        return;
+    }
+    
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = transport.nativeHandle();
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, ev.data.fd, &ev);
+    ev.data.fd = m_wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, m_wakeFd, &ev);
+    
+    // A deadline in the past: take what is buffered without waiting
+    auto readPort = [this, &transport, chunk, chunkSize]() {
+        TransportResult result = transport.read(chunk, chunkSize, TransportDeadline());
+        if (m_metrics.enabled()) {
+            ConnectionMetrics::add(m_metrics.readCalls);
+            if (result.bytes > 0) {
+                ConnectionMetrics::add(m_metrics.bytesIn, result.bytes);
+            } else {
+                ConnectionMetrics::add(m_metrics.emptyReads);
+            }
+        }
+        return result;
+    };
+    
+    bool running = true;
+    while (running && !m_stopRequested) {
+        struct epoll_event events[2];
+        bool linkLost = false;
+        int count = epoll_wait(epollFd, events, 2, readerWaitMs());
+        const uint64_t wokenNs = steadyNowNs();
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (m_readerDecodes) {
+            expireRequests();
+        }
+        flushDueCommands();
+        
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.fd == m_wakeFd) {
+                // stopStreaming(), or submit()/sendCommand() telling us about a new deadline
+                uint64_t wakeups;
+                ssize_t ignored = read(m_wakeFd, &wakeups, sizeof(wakeups));
+                (void)ignored;
+                if (m_stopRequested) {
+                    running = false;
+                    break;
+                }
+                continue;
+            }
+            
+            // Drain everything the kernel has buffered before waiting again
+            for (;;) {
+                TransportResult result = readPort();
+                if (result.bytes > 0) {
+                    deliverChunk(chunk, result.bytes, wokenNs);
+                    continue;
+                }
+                if (result.status != TransportStatus::TIMEOUT) {
+                    linkLost = true;  // Hard error: the port is gone
+                }
+                break;
+            }
+            
+            if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                linkLost = true;  // Hang-up after draining what was left
+            }
+        }
+        
+        if (linkLost && running) {
+            if (!T::kReconnectable) {
+                break;
+            }
+            // Closing the descriptor also removes it from the epoll set. The
+            // ring is left alone, so the consumer keeps what was received.
+            onLinkLost(linkCallback);
+            auto giveUp = reconnect.timeoutMs > 0
+                              ? std::chrono::steady_clock::now() + std::chrono::milliseconds(reconnect.timeoutMs)
+                              : std::chrono::steady_clock::time_point::max();
+            if (!reconnect.enabled || !reopenTransport(reconnect, linkCallback, giveUp, m_wakeFd)) {
+                break;
+            }
+            ev.data.fd = transport.nativeHandle();
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, ev.data.fd, &ev);
+            continue;
+        }
+        
+        // Bounded busy-poll: keep reading until busyPollUs pass without
+        // data, then go back to sleep in epoll_wait()
+        const uint64_t busyPollNs = m_busyPollUs.load(std::memory_order_relaxed) * uint64_t(1000);
+        uint64_t spinUntilNs = steadyNowNs() + busyPollNs;
+        unsigned spins = 0;
+        while (busyPollNs > 0 && running && !m_stopRequested) {
+            uint64_t polledNs = steadyNowNs();
+            TransportResult result = readPort();
+            if (result.bytes > 0) {
+                deliverChunk(chunk, result.bytes, polledNs);
+                spinUntilNs = steadyNowNs() + busyPollNs;
+                continue;
+            }
+            if (result.status != TransportStatus::TIMEOUT) {
+                break;  // Hard error; epoll_wait() reports the hang-up next
+            }
+            if (steadyNowNs() >= spinUntilNs) {
+                break;
+            }
+            spinPause(spins);
+        }
+    }
+    
+    close(epollFd);
+}
+#endif
+
+bool WT13106Connection::initializeUSB()
+{
+#ifdef __linux__
+    // A board that enumerates as a CDC-ACM or usb-serial port is opened as a
+    // serial port; libusb is only needed for a vendor-specific interface
+    if (resolveUsbSerialPort(m_lastError)) {
+        return m_transport.emplace<SerialTransport>().open(m_endpoint, m_lastError);
+    }
+#ifndef WT13106_HAVE_LIBUSB
+    m_lastError += "; other USB devices require libusb. Install with: sudo apt-get install libusb-1.0-0-dev";
+    return false;
+#endif
+#endif
+    
+    return m_transport.emplace<UsbTransport>().open(m_endpoint, m_lastError);
+}
+
+#ifdef __linux__
+bool WT13106Connection::resolveUsbSerialPort(std::string& error)
+{
+    DeviceMatch match;
+    match.vid = m_endpoint.vid;
+    match.pid = m_endpoint.pid;
+    match.serial = m_endpoint.usbSerial;
+    DiscoveredDevice device;
+    if (!DeviceDiscovery::shared().findSerialPort(match, device)) {
+        error = DeviceDiscovery::shared().getLastError();
+        return false;
+    }
+    m_endpoint.path = device.devicePath;
+    return true;
+}
+#endif
+
+void WT13106Connection::setCaptureWriter(CaptureWriter* writer)
+{
+    m_captureWriter.store(writer, std::memory_order_release);
+}
+
+void WT13106Connection::captureChunk(const uint8_t* data, size_t length)
+{
+    CaptureWriter* writer = m_captureWriter.load(std::memory_order_acquire);
+    if (writer) {
+        writer->append(steadyNowNs(), data, length);
+    }
+}
+
+void WT13106Connection::cleanupConnection()
+{
+#ifdef __linux__
+    // The flag outlives the descriptor on most drivers
+    const SerialTransport* serial = std::get_if<SerialTransport>(&m_transport);
+    if (serial != nullptr && serial->isOpen() && m_restoreAsyncLowLatency) {
+        setLinuxLowLatency(serial->nativeHandle(), false, nullptr);
+    }
+#endif
+    
+    // Destroying the backend closes it (for USB this cancels the in-flight
+    // transfers and joins the libusb event thread)
+    m_transport.emplace<NullTransport>();
+#ifndef _WIN32
+    if (m_hotplugFd >= 0) {
+        close(m_hotplugFd);
+        m_hotplugFd = -1;
+    }
+#endif
+    m_asyncLowLatency = false;
+    m_restoreAsyncLowLatency = false;
 }
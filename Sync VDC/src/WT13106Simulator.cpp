@@ -0,0 +1,397 @@
+#include "../include/WT13106Simulator.h"
+#include "../include/FrameDecoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <random>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+#ifdef __APPLE__
+#include <util.h>
+#else
+#include <pty.h>
+#endif
+
+namespace {
+
+const size_t kCounterSlots = 65536;
+const uint8_t kReplyFlag = 0x80;
+
+uint64_t steadyNowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+bool setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+/**
+ * @brief Produces successive samples of the configured trace
+ */
+class TraceGenerator {
+public:
+    explicit TraceGenerator(SimulatorPattern pattern)
+        : m_pattern(pattern)
+        , m_index(0)
+        , m_x(10000)
+        , m_y(7500)
+        , m_rng(4242)
+    {
+    }
+
+    StylusEvent next()
+    {
+        StylusEvent event = {};
+        event.sequence = static_cast<uint8_t>(m_index);
+
+        switch (m_pattern) {
+        case SimulatorPattern::CIRCLE: {
+            double angle = (m_index % 400) * (2.0 * 3.14159265358979 / 400.0);
+            event.x = static_cast<uint16_t>(10000 + 5000 * std::cos(angle));
+            event.y = static_cast<uint16_t>(7500 + 5000 * std::sin(angle));
+            event.pressure = static_cast<uint16_t>(512 + 300 * std::sin(angle * 3));
+            event.flags = STYLUS_IN_RANGE | STYLUS_TIP_DOWN;
+            break;
+        }
+        case SimulatorPattern::SCRIBBLE: {
+            std::uniform_int_distribution<int> step(-40, 40);
+            m_x = std::min(20000, std::max(0, m_x + step(m_rng)));
+            m_y = std::min(15000, std::max(0, m_y + step(m_rng)));
+            event.x = static_cast<uint16_t>(m_x);
+            event.y = static_cast<uint16_t>(m_y);
+            // 300-sample strokes separated by 30 samples hovering
+            bool down = (m_index % 330) < 300;
+            event.pressure = down ? static_cast<uint16_t>(400 + step(m_rng)) : 0;
+            event.flags = down ? (STYLUS_IN_RANGE | STYLUS_TIP_DOWN) : STYLUS_IN_RANGE;
+            break;
+        }
+        case SimulatorPattern::COUNTER:
+            event.x = static_cast<uint16_t>(m_index);
+            event.y = static_cast<uint16_t>(m_index >> 16);
+            event.pressure = 1;
+            event.flags = STYLUS_IN_RANGE | STYLUS_TIP_DOWN;
+            break;
+        }
+
+        m_index++;
+        return event;
+    }
+
+    /**
+     * @brief Skip a sample without producing it (dropped on a full link)
+     */
+    void skip() { next(); }
+
+    uint64_t index() const { return m_index; }
+
+private:
+    SimulatorPattern m_pattern;
+    uint64_t m_index;
+    int m_x;
+    int m_y;
+    std::mt19937 m_rng;
+};
+
+} // namespace
+
+WT13106Simulator::WT13106Simulator()
+    : m_masterFd(-1)
+    , m_slaveFd(-1)
+    , m_wakeFd(-1)
+    , m_wakeWriteFd(-1)
+    , m_running(false)
+    , m_stopRequested(false)
+    , m_paused(false)
+    , m_framesSent(0)
+    , m_framesDropped(0)
+    , m_bytesUnread(0)
+    , m_commandsAnswered(0)
+    , m_sendTimes(new std::atomic<uint64_t>[kCounterSlots])
+{
+    for (size_t i = 0; i < kCounterSlots; ++i) {
+        m_sendTimes[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+WT13106Simulator::~WT13106Simulator()
+{
+    stop();
+}
+
+bool WT13106Simulator::start(const SimulatorOptions& options)
+{
+    if (m_running) {
+        m_lastError = "Simulator already running";
+        return false;
+    }
+
+    if (options.sampleRateHz < 0 || options.framesPerWrite == 0) {
+        m_lastError = "Sample rate must be >= 0 and framesPerWrite non-zero";
+        return false;
+    }
+
+    m_options = options;
+    m_framesSent = 0;
+    m_framesDropped = 0;
+    m_bytesUnread = 0;
+    m_commandsAnswered = 0;
+
+    // Raw from the start so nothing is echoed or translated before a client
+    // configures the port
+    struct termios raw;
+    std::memset(&raw, 0, sizeof(raw));
+    cfmakeraw(&raw);
+    char name[128];
+    if (openpty(&m_masterFd, &m_slaveFd, name, &raw, nullptr) != 0) {
+        m_lastError = std::string("openpty failed: ") + std::strerror(errno);
+        return false;
+    }
+    m_devicePath = name;
+
+    int wakePipe[2];
+    if (pipe(wakePipe) != 0) {
+        m_lastError = "Failed to create simulator wake-up pipe";
+        closeDescriptors();
+        return false;
+    }
+    m_wakeFd = wakePipe[0];
+    m_wakeWriteFd = wakePipe[1];
+
+    if (!setNonBlocking(m_masterFd) || !setNonBlocking(m_wakeFd)) {
+        m_lastError = "Failed to make simulator descriptors non-blocking";
+        closeDescriptors();
+        return false;
+    }
+
+    m_stopRequested = false;
+    m_paused = options.startPaused;
+    m_running = true;
+    m_thread = std::thread(&WT13106Simulator::run, this);
+    m_lastError = "";
+    return true;
+}
+
+void WT13106Simulator::stop()
+{
+    if (m_thread.joinable()) {
+        m_stopRequested = true;
+        char wake = 1;
+        ssize_t ignored = write(m_wakeWriteFd, &wake, 1);
+        (void)ignored;
+        m_thread.join();
+    }
+    closeDescriptors();
+    m_running = false;
+}
+
+void WT13106Simulator::setPaused(bool paused)
+{
+    m_paused = paused;
+    if (m_wakeWriteFd >= 0) {
+        char wake = 1;
+        ssize_t ignored = write(m_wakeWriteFd, &wake, 1);
+        (void)ignored;
+    }
+}
+
+uint64_t WT13106Simulator::sendTimeNs(uint16_t counter) const
+{
+    return m_sendTimes[counter].load(std::memory_order_relaxed);
+}
+
+void WT13106Simulator::closeDescriptors()
+{
+    int* fds[] = {&m_masterFd, &m_slaveFd, &m_wakeFd, &m_wakeWriteFd};
+    for (int* fd : fds) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+void WT13106Simulator::run()
+{
+    TraceGenerator trace(m_options.pattern);
+    const bool paced = m_options.sampleRateHz > 0;
+    const uint64_t periodNs = paced
+        ? static_cast<uint64_t>(1e9 * m_options.framesPerWrite / m_options.sampleRateHz)
+        : 0;
+    const size_t burstBytes = m_options.framesPerWrite * PEN_FRAME_SIZE;
+
+    std::vector<uint8_t> backlog;
+    backlog.reserve(m_options.maxBacklogBytes + burstBytes + FRAME_MAX_SIZE);
+    size_t backlogOffset = 0;
+
+    // Commands arrive as frames; acknowledge each one by echoing it back
+    FrameDecoder commands;
+    commands.setFrameHandler([&](const FrameView& frame) {
+        uint8_t reply[FRAME_MAX_SIZE];
+        size_t n = encodeFrame(static_cast<uint8_t>(frame.type | kReplyFlag), frame.sequence,
+                               frame.payload, frame.length, reply);
+        backlog.insert(backlog.end(), reply, reply + n);
+        m_commandsAnswered++;
+    });
+    StylusEvent ignoredEvents[32];
+    uint8_t readBuffer[4096];
+
+    uint64_t nextTickNs = steadyNowNs();
+
+    while (!m_stopRequested) {
+        uint64_t now = steadyNowNs();
+        size_t pending = backlog.size() - backlogOffset;
+        const bool paused = m_paused;
+
+        if (paused) {
+            nextTickNs = now;  // Resume with a sample, then on schedule
+        } else if (paced ? now >= nextTickNs : pending == 0) {
+            if (pending + burstBytes > m_options.maxBacklogBytes) {
+                // The host isn't reading; the board keeps sampling regardless
+                for (size_t i = 0; i < m_options.framesPerWrite; ++i) {
+                    trace.skip();
+                }
+                m_framesDropped += m_options.framesPerWrite;
+            } else {
+                for (size_t i = 0; i < m_options.framesPerWrite; ++i) {
+                    m_sendTimes[trace.index() % kCounterSlots].store(now, std::memory_order_relaxed);
+                    StylusEvent event = trace.next();
+                    size_t offset = backlog.size();
+                    backlog.resize(offset + PEN_FRAME_SIZE);
+                    encodePenFrame(event, backlog.data() + offset);
+                }
+                m_framesSent += m_options.framesPerWrite;
+            }
+            if (paced) {
+                nextTickNs += periodNs;
+                if (now > nextTickNs + 100000000ULL) {
+                    nextTickNs = now + periodNs;  // Stalled for >100 ms; don't burst to catch up
+                }
+            }
+            pending = backlog.size() - backlogOffset;
+        }
+
+        if (pending > 0) {
+            ssize_t written = write(m_masterFd, backlog.data() + backlogOffset, pending);
+            if (written > 0) {
+                backlogOffset += static_cast<size_t>(written);
+                pending -= static_cast<size_t>(written);
+            }
+            if (pending == 0) {
+                backlog.clear();
+                backlogOffset = 0;
+            }
+        }
+
+        // Wait for the next tick, room in the pty, a command, or stop()/setPaused()
+        int timeoutMs = -1;
+        uint64_t waitNs = 0;
+        if (paused) {
+            // No tick to wait for
+        } else if (paced) {
+            now = steadyNowNs();
+            waitNs = nextTickNs > now ? nextTickNs - now : 0;
+        } else if (pending == 0) {
+            timeoutMs = 0;
+        }
+
+        struct pollfd fds[2] = {};
+        fds[0].fd = m_masterFd;
+        fds[0].events = POLLIN | (pending > 0 ? POLLOUT : 0);
+        fds[1].fd = m_wakeFd;
+        fds[1].events = POLLIN;
+
+        int ready;
+#ifdef __linux__
+        struct timespec ts;
+        ts.tv_sec = static_cast<time_t>(waitNs / 1000000000ULL);
+        ts.tv_nsec = static_cast<long>(waitNs % 1000000000ULL);
+        ready = ppoll(fds, 2, (!paused && (paced || timeoutMs == 0)) ? &ts : nullptr, nullptr);
+#else
+        if (paced && !paused) {
+            timeoutMs = static_cast<int>((waitNs + 999999) / 1000000);
+        }
+        ready = poll(fds, 2, timeoutMs);
+#endif
+        if (ready < 0 && errno != EINTR) {
+            break;
+        }
+        if (ready <= 0) {
+            continue;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            char wake[16];
+            while (read(m_wakeFd, wake, sizeof(wake)) > 0) {
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            ssize_t bytesRead = read(m_masterFd, readBuffer, sizeof(readBuffer));
+            const uint8_t* data = readBuffer;
+            size_t remaining = bytesRead > 0 ? static_cast<size_t>(bytesRead) : 0;
+            while (remaining > 0) {
+                size_t produced = 0;
+                size_t used = commands.decode(data, remaining, 0, ignoredEvents, 32, produced);
+                data += used;
+                remaining -= used;
+            }
+        }
+    }
+
+    if (m_stopRequested) {
+        m_bytesUnread = drain(backlog.data() + backlogOffset, backlog.size() - backlogOffset);
+    }
+    m_running = false;
+}
+
+size_t WT13106Simulator::drain(const uint8_t* backlog, size_t pending)
+{
+    // Both phases give up after kDrainIdleMs without progress
+    uint64_t idleSinceNs = steadyNowNs();
+    const uint64_t idleLimitNs = uint64_t(kDrainIdleMs) * 1000000ULL;
+
+    while (pending > 0 && steadyNowNs() - idleSinceNs < idleLimitNs) {
+        ssize_t written = write(m_masterFd, backlog, pending);
+        if (written > 0) {
+            backlog += written;
+            pending -= static_cast<size_t>(written);
+            idleSinceNs = steadyNowNs();
+            continue;
+        }
+        if (written < 0 && errno != EAGAIN && errno != EINTR) {
+            return pending;
+        }
+        struct pollfd out = {m_masterFd, POLLOUT, 0};
+        poll(&out, 1, 1);
+    }
+
+    // The slave's input queue only empties as the host reads it. The pty
+    // moves written bytes into that queue asynchronously, so it has to stay
+    // empty for a few checks in a row (about 0.3 ms when the host keeps up).
+    int unread = 0;
+    int lastUnread = -1;
+    int emptyChecks = 0;
+    while (emptyChecks < 3 && steadyNowNs() - idleSinceNs < idleLimitNs) {
+        if (ioctl(m_slaveFd, FIONREAD, &unread) != 0) {
+            break;
+        }
+        if (unread != lastUnread) {
+            idleSinceNs = steadyNowNs();
+            lastUnread = unread;
+        }
+        emptyChecks = unread == 0 ? emptyChecks + 1 : 0;
+        usleep(100);
+    }
+    return pending + static_cast<size_t>(unread > 0 ? unread : 0);
+}
@@ -52,50 +52,37 @@ int main(int argc, char* argv[])
     std::cout << "Reading input signals (press Ctrl+C to stop)..." << std::endl;
     std::cout << std::endl;
     
-    // Continuous signal reading loop
+    // Stream data from a background reader thread; reads wake up as soon as
+    // bytes arrive instead of sleeping between polled reads.
+    if (!device.startStreaming()) {
+        std::cerr << "Failed to start streaming: " << device.getLastError() << std::endl;
+        device.disconnect();
+        return 1;
+    }
+    
+    // Continuous signal reading loop: the connection reassembles frames that
+    // are split across reads and decodes them into typed pen samples
     int sampleCount = 0;
-    while (device.isConnected()) {
-        // Read signals from the device
-        std::vector<uint8_t> signalData = device.receiveResponse(1000); // 1 second timeout
+    StylusEvent events[64];
+    device.setFrameHandler([](const FrameView& frame) {
+        std::cout << "  -> Frame type 0x" << std::hex << static_cast<int>(frame.type) << std::dec
+                  << " (" << static_cast<int>(frame.length) << " byte payload)" << std::endl;
+    });
+    
+    while (device.isStreaming()) {
+        size_t count = device.receiveEvents(events, 64, 1000); // 1 second timeout
         
-        if (!signalData.empty()) {
+        for (size_t i = 0; i < count; ++i) {
+            const StylusEvent& event = events[i];
             sampleCount++;
-            std::cout << "Sample #" << sampleCount << " - Received " << signalData.size() << " bytes: ";
-            
-            // Print raw hex data
-            for (size_t i = 0; i < signalData.size(); ++i) {
-                printf("%02X ", signalData[i]);
-            }
-            std::cout << "| ";
-            
-            // Print as ASCII if printable
-            for (uint8_t byte : signalData) {
-                if (byte >= 32 && byte < 127) {
-                    std::cout << static_cast<char>(byte);
-                } else {
-                    std::cout << ".";
-                }
-            }
-            std::cout << std::endl;
-            
-            // Example: Parse signal data (adjust based on your protocol)
-            if (signalData.size() >= 2) {
-                // Assuming first byte is signal type, second is value
-                uint8_t signalType = signalData[0];
-                uint8_t signalValue = signalData[1];
-                
-                std::cout << "  -> Signal Type: " << static_cast<int>(signalType) 
-                          << ", Value: " << static_cast<int>(signalValue) << std::endl;
-            }
-        } else {
-            // No data received (timeout)
-            // Uncomment to see timeout messages:
-            // std::cout << "Waiting for data..." << std::endl;
+            std::cout << "Sample #" << sampleCount
+                      << " x=" << event.x << " y=" << event.y
+                      << " pressure=" << event.pressure
+                      << (event.flags & STYLUS_TIP_DOWN ? " [down]" : "")
+                      << (event.flags & STYLUS_BUTTON ? " [button]" : "")
+                      << std::endl;
         }
         
-        // Small delay between reads to avoid CPU spinning
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        
         // Limit samples for demo (remove in production)
         if (sampleCount >= 100) {
             std::cout << std::endl << "Read 100 samples. Stopping..." << std::endl;
@@ -103,6 +90,8 @@ int main(int argc, char* argv[])
         }
     }
     
+    device.stopStreaming();
+    
     // Example: Send a command to the device
     std::cout << std::endl << "Sending test command..." << std::endl;
     std::vector<uint8_t> command = {0x01, 0x02, 0x03, 0x04}; // Replace with actual command
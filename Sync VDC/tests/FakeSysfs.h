@@ -0,0 +1,129 @@
+#ifndef WT13106_FAKE_SYSFS_H
+#define WT13106_FAKE_SYSFS_H
+
+/**
+ * @file FakeSysfs.h
+ * @brief A fake /sys tree and uevent messages for DeviceDiscovery
+ *
+ * Shared by tests/test_device_discovery.cpp and bench/bench_device_discovery.cpp.
+ */
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace test {
+
+inline bool makeDirectories(const std::string& path)
+{
+    for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+        std::string prefix = path.substr(0, slash);
+        if (mkdir(prefix.c_str(), 0755) < 0 && errno != EEXIST) {
+            return false;
+        }
+        if (slash == std::string::npos) {
+            return true;
+        }
+    }
+}
+
+inline bool writeFile(const std::string& path, const std::string& contents)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    std::string line = contents + "\n";
+    bool ok = write(fd, line.data(), line.size()) == static_cast<ssize_t>(line.size());
+    close(fd);
+    return ok;
+}
+
+/**
+ * @brief Fake /sys with the same links and attributes the kernel creates
+ */
+class FakeSysfs {
+public:
+    explicit FakeSysfs(const std::string& root) : m_root(root), m_ok(true) {}
+
+    bool ok() const { return m_ok; }
+
+    void addUsbDevice(const std::string& devpath, uint16_t vid, uint16_t pid, const std::string& serial,
+                      const std::string& product)
+    {
+        char text[8];
+        std::string directory = m_root + devpath;
+        m_ok = m_ok && makeDirectories(directory);
+        std::snprintf(text, sizeof(text), "%04x", vid);
+        m_ok = m_ok && writeFile(directory + "/idVendor", text);
+        std::snprintf(text, sizeof(text), "%04x", pid);
+        m_ok = m_ok && writeFile(directory + "/idProduct", text);
+        if (!serial.empty()) {
+            m_ok = m_ok && writeFile(directory + "/serial", serial);
+        }
+        m_ok = m_ok && writeFile(directory + "/manufacturer", "Example") &&
+               writeFile(directory + "/product", product);
+        link("/bus/usb/devices/" + devpath.substr(devpath.rfind('/') + 1), "../../.." + devpath);
+    }
+
+    void addTty(const std::string& devpath)
+    {
+        m_ok = m_ok && makeDirectories(m_root + devpath);
+        link("/class/tty/" + devpath.substr(devpath.rfind('/') + 1), "../.." + devpath);
+    }
+
+    /**
+     * @brief Remove a device's or tty's link, as the kernel does when it goes away
+     */
+    void removeLink(const std::string& devpath, bool tty)
+    {
+        std::string name = devpath.substr(devpath.rfind('/') + 1);
+        std::string path = m_root + (tty ? "/class/tty/" : "/bus/usb/devices/") + name;
+        m_ok = m_ok && unlink(path.c_str()) == 0;
+    }
+
+private:
+    std::string m_root;
+    bool m_ok;
+
+    void link(const std::string& path, const std::string& target)
+    {
+        std::string full = m_root + path;
+        m_ok = m_ok && makeDirectories(full.substr(0, full.rfind('/'))) &&
+               symlink(target.c_str(), full.c_str()) == 0;
+    }
+};
+
+/**
+ * @brief A kernel uevent message as DeviceDiscovery::applyUevent() receives it
+ */
+inline std::string uevent(const std::string& action, const std::string& devpath, const std::string& subsystem,
+                                 const std::string& devtype, const std::string& devName)
+{
+    std::string message = action + "@" + devpath;
+    message += '\0';
+    message += "ACTION=" + action;
+    message += '\0';
+    message += "DEVPATH=" + devpath;
+    message += '\0';
+    message += "SUBSYSTEM=" + subsystem;
+    message += '\0';
+    if (!devtype.empty()) {
+        message += "DEVTYPE=" + devtype;
+        message += '\0';
+    }
+    if (!devName.empty()) {
+        message += "DEVNAME=" + devName;
+        message += '\0';
+    }
+    return message;
+}
+
+} // namespace test
+
+#endif // WT13106_FAKE_SYSFS_H
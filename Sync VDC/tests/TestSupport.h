@@ -0,0 +1,56 @@
+#ifndef WT13106_TEST_SUPPORT_H
+#define WT13106_TEST_SUPPORT_H
+
+/**
+ * @file TestSupport.h
+ * @brief Minimal checks for the ctest executables (no framework dependency)
+ *
+ * Each test executable calls CHECK()/CHECK_EQ() and returns testResult()
+ * from main(); a failed check prints its location and the test keeps going.
+ */
+
+#include <cstdio>
+
+namespace test {
+
+inline int& failures()
+{
+    static int count = 0;
+    return count;
+}
+
+inline void fail(const char* file, int line, const char* expression)
+{
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+    ++failures();
+}
+
+inline int testResult(const char* name)
+{
+    if (failures() > 0) {
+        std::fprintf(stderr, "%s: %d check(s) failed\n", name, failures());
+        return 1;
+    }
+    std::printf("%s: ok\n", name);
+    return 0;
+}
+
+} // namespace test
+
+#define CHECK(expression) \
+    do { \
+        if (!(expression)) { \
+            test::fail(__FILE__, __LINE__, #expression); \
+        } \
+    } while (0)
+
+#define CHECK_EQ(actual, expected) \
+    do { \
+        if (!((actual) == (expected))) { \
+            std::fprintf(stderr, "%s:%d: %s == %llu, expected %llu\n", __FILE__, __LINE__, #actual, \
+                         static_cast<unsigned long long>(actual), static_cast<unsigned long long>(expected)); \
+            ++test::failures(); \
+        } \
+    } while (0)
+
+#endif // WT13106_TEST_SUPPORT_H
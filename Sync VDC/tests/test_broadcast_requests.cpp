@@ -0,0 +1,111 @@
+/**
+ * @file test_broadcast_requests.cpp
+ * @brief submit() while the reader thread decodes into a BroadcastRing
+ *
+ * Replies must complete requests and timeouts must fire even when the
+ * board is idle (the reader wakes up for request deadlines by itself).
+ * The same goes for a TIME_WINDOW send queue nobody flushes.
+ */
+
+#include "../include/BroadcastRing.h"
+#include "../include/WT13106Connection.h"
+#include "../include/WT13106Simulator.h"
+#include "TestSupport.h"
+
+#include <chrono>
+#include <future>
+#include <thread>
+
+namespace {
+
+void testRequestsDuringBroadcast()
+{
+    WT13106Simulator simulator;
+    SimulatorOptions simOptions;
+    simOptions.sampleRateHz = 1.0;  // Nearly idle: no pen data to wake the reader
+    CHECK(simulator.start(simOptions));
+
+    WT13106Connection connection(simulator.connectionString());
+    CHECK(connection.connect());
+    BroadcastRing<StylusEvent> ring(1024);
+    int subscriber = ring.subscribe(SlowSubscriberPolicy::SKIP);
+    CHECK(subscriber >= 0);
+    CHECK(connection.startBroadcast(ring));
+
+    // Answered by the simulator (type | 0x80, same sequence and payload)
+    const uint8_t payload[3] = {1, 2, 3};
+    std::future<Response> answered = connection.submit(0x21, payload, 3);
+    CHECK(answered.wait_for(std::chrono::seconds(2)) == std::future_status::ready);
+    Response reply = answered.get();
+    CHECK(reply.ok());
+    CHECK_EQ(reply.type, 0x21 | FRAME_REPLY_FLAG);
+    CHECK_EQ(reply.payload.size(), 3u);
+
+    // Never answered: the simulator replies with 0xA2, not 0x7E
+    SubmitOptions options;
+    options.timeoutMs = 50;
+    options.replyType = 0x7E;
+    auto start = std::chrono::steady_clock::now();
+    std::future<Response> unanswered = connection.submit(0x22, payload, 3, options);
+    CHECK(unanswered.wait_for(std::chrono::seconds(2)) == std::future_status::ready);
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    CHECK(unanswered.get().status == ResponseStatus::TIMEOUT);
+    CHECK(elapsedMs < 500);
+    CHECK_EQ(connection.outstandingRequests(), 0u);
+
+    connection.stopStreaming();
+    ring.close();
+    connection.disconnect();
+    simulator.stop();
+}
+
+void testTimeWindowFlushedByReader()
+{
+    WT13106Simulator simulator;
+    SimulatorOptions simOptions;
+    simOptions.sampleRateHz = 1.0;
+    CHECK(simulator.start(simOptions));
+
+    WT13106Connection connection(simulator.connectionString());
+    connection.setMetricsEnabled(true);
+    CHECK(connection.connect());
+    SendOptions sendOptions;
+    sendOptions.policy = FlushPolicy::TIME_WINDOW;
+    sendOptions.windowUs = 20000;
+    connection.setSendOptions(sendOptions);
+    BroadcastRing<StylusEvent> ring(1024);
+    CHECK(connection.startBroadcast(ring));
+
+    // A lone command: queued, not yet counted as sent
+    const uint8_t payload[2] = {4, 5};
+    uint8_t frame[FRAME_MAX_SIZE];
+    size_t length = encodeFrame(0x23, 1, payload, 2, frame);
+    auto start = std::chrono::steady_clock::now();
+    CHECK(connection.sendCommand(frame, length));
+    CHECK_EQ(connection.getMetrics().framesOut, 0u);
+
+    // No further sends or receives: the reader writes it once the window passes
+    while (connection.getMetrics().framesOut == 0 &&
+           std::chrono::steady_clock::now() - start < std::chrono::seconds(2)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    CHECK_EQ(connection.getMetrics().framesOut, 1u);
+    CHECK(elapsedMs >= 19);
+    CHECK(elapsedMs < 500);
+    CHECK_EQ(connection.getMetrics().bytesOut, uint64_t(length));
+
+    connection.stopStreaming();
+    ring.close();
+    connection.disconnect();
+    simulator.stop();
+}
+
+} // namespace
+
+int main()
+{
+    testRequestsDuringBroadcast();
+    testTimeWindowFlushedByReader();
+    return test::testResult("test_broadcast_requests");
+}
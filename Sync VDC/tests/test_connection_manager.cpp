@@ -0,0 +1,146 @@
+/**
+ * @file test_connection_manager.cpp
+ * @brief ConnectionManager registration and send() from several threads at once
+ *
+ * Two loopback devices on different loops bounce pen frames between each
+ * other from their handlers (each handler send()s to the other loop) while
+ * two threads add and remove connections, and race to register the same
+ * connection. Nothing may deadlock, and a descriptor is registered once.
+ */
+
+#include "../include/ConnectionManager.h"
+#include "../include/WT13106Connection.h"
+#include "TestSupport.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int kBounces = 2000;
+const int kRounds = 200;
+const size_t kConnectionsPerThread = 4;
+
+std::unique_ptr<WT13106Connection> loopback()
+{
+    std::unique_ptr<WT13106Connection> connection(new WT13106Connection("LOOPBACK:"));
+    CHECK(connection->connect());
+    return connection;
+}
+
+void testConcurrentUse(IoEngine engine)
+{
+    ConnectionManagerOptions options;
+    options.loopCount = 2;
+    options.ioEngine = engine;
+    ConnectionManager manager(options);
+    CHECK(manager.start());
+
+    // Ping-pong: a's handler runs on one loop and sends to b on the other
+    std::unique_ptr<WT13106Connection> a = loopback();
+    std::unique_ptr<WT13106Connection> b = loopback();
+    std::atomic<int> idA(-1);
+    std::atomic<int> idB(-1);
+    std::atomic<int> bounces(0);
+    uint8_t frame[PEN_FRAME_SIZE];
+    StylusEvent event = {};
+    event.flags = STYLUS_IN_RANGE;
+    encodePenFrame(event, frame);
+
+    auto bounce = [&](std::atomic<int>& to) {
+        return [&](int, const StylusEvent*, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                if (bounces.fetch_add(1) + 1 < kBounces) {
+                    manager.send(to, frame, sizeof(frame));
+                }
+            }
+        };
+    };
+    DeviceHandlers handlersA;
+    handlersA.onEvents = bounce(idB);
+    DeviceHandlers handlersB;
+    handlersB.onEvents = bounce(idA);
+    idA = manager.addConnection(*a, handlersA);
+    idB = manager.addConnection(*b, handlersB);
+    CHECK(idA >= 0 && idB >= 0);
+
+    std::unique_ptr<WT13106Connection> shared = loopback();
+    std::atomic<int> sharedIds[2];
+    std::atomic<int> round(0);
+    std::atomic<int> arrived(0);
+    std::atomic<int> duplicates(0);
+
+    auto churn = [&](int self) {
+        std::vector<std::unique_ptr<WT13106Connection>> own;
+        for (size_t i = 0; i < kConnectionsPerThread; ++i) {
+            own.push_back(loopback());
+        }
+        for (int r = 0; r < kRounds; ++r) {
+            std::vector<int> ids;
+            for (auto& connection : own) {
+                ids.push_back(manager.addConnection(*connection, DeviceHandlers()));
+            }
+
+            // Both threads register the shared connection at the same moment
+            while (round.load() != r) {
+                std::this_thread::yield();
+            }
+            sharedIds[self] = manager.addConnection(*shared, DeviceHandlers());
+            if (arrived.fetch_add(1) % 2 == 1) {
+                int winners = (sharedIds[0] >= 0) + (sharedIds[1] >= 0);
+                duplicates += winners == 1 ? 0 : 1;
+                manager.removeConnection(sharedIds[0] >= 0 ? sharedIds[0] : sharedIds[1]);
+                round.fetch_add(1);
+            }
+
+            for (int id : ids) {
+                if (id < 0 || !manager.removeConnection(id)) {
+                    duplicates++;
+                }
+            }
+        }
+    };
+
+    std::promise<void> finished;
+    std::future<void> done = finished.get_future();
+    std::thread worker([&] {
+        std::thread first(churn, 0);
+        std::thread second(churn, 1);
+        // Two frames in flight, so both handlers send at the same time
+        CHECK(manager.send(idA, frame, sizeof(frame)));
+        CHECK(manager.send(idB, frame, sizeof(frame)));
+        first.join();
+        second.join();
+        while (bounces < kBounces) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        finished.set_value();
+    });
+    if (done.wait_for(std::chrono::seconds(20)) != std::future_status::ready) {
+        std::fprintf(stderr, "test_connection_manager: deadlock (%d bounces, round %d)\n",
+                     bounces.load(), round.load());
+        std::_Exit(1);
+    }
+    worker.join();
+
+    CHECK_EQ(duplicates.load(), 0);
+    CHECK(bounces >= kBounces);
+    CHECK_EQ(manager.connectionCount(), 2u);
+    CHECK(manager.addConnection(*a, DeviceHandlers()) < 0);
+    CHECK(manager.getLastError() == "Connection is already registered");
+    manager.stop();
+}
+
+} // namespace
+
+int main()
+{
+    testConcurrentUse(IoEngine::EPOLL);
+    testConcurrentUse(IoEngine::IO_URING);  // Falls back to epoll where unavailable
+    return test::testResult("test_connection_manager");
+}
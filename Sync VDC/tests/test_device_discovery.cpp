@@ -0,0 +1,176 @@
+/**
+ * @file test_device_discovery.cpp
+ * @brief DeviceDiscovery on a fake sysfs tree: matching, hot-add and removal
+ */
+
+#include "../include/DeviceDiscovery.h"
+#include "FakeSysfs.h"
+#include "TestSupport.h"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+const uint16_t kBoardVid = 0x2914;
+const uint16_t kBoardPid = 0x0100;
+const std::string kController = "/devices/pci0000:00/0000:00:14.0/usb1";
+
+struct Port {
+    std::string usbDevpath;
+    std::string ttyDevpath;
+};
+
+/**
+ * @brief A board with one CDC-ACM port on interface 0
+ */
+Port addAcmBoard(test::FakeSysfs& sysfs, const std::string& parent, const std::string& usbName,
+                 const std::string& serial, const std::string& ttyName)
+{
+    Port port;
+    port.usbDevpath = parent + "/" + usbName;
+    port.ttyDevpath = port.usbDevpath + "/" + usbName + ":1.0/tty/" + ttyName;
+    sysfs.addUsbDevice(port.usbDevpath, kBoardVid, kBoardPid, serial, "Boogie Board Sync");
+    sysfs.addTty(port.ttyDevpath);
+    return port;
+}
+
+bool findPort(DeviceDiscovery& discovery, const std::string& serial, int interfaceNumber, DiscoveredDevice& device)
+{
+    DeviceMatch match;
+    match.vid = kBoardVid;
+    match.pid = kBoardPid;
+    match.serial = serial;
+    match.interfaceNumber = interfaceNumber;
+    return discovery.findSerialPort(match, device);
+}
+
+bool deliver(DeviceDiscovery& discovery, const std::string& message)
+{
+    return discovery.applyUevent(message.data(), message.size());
+}
+
+void testDiscovery(const std::string& root)
+{
+    test::FakeSysfs sysfs(root);
+    sysfs.addUsbDevice(kController, 0x1d6b, 0x0002, "0000:00:14.0", "xHCI Host");
+    sysfs.addUsbDevice(kController + "/1-1", 0x05e3, 0x0610, "", "USB2.0 Hub");
+    Port acm = addAcmBoard(sysfs, kController, "1-2", "WT00001", "ttyACM0");
+
+    // usb-serial converter behind the hub: the tty sits one level deeper
+    Port converter;
+    converter.usbDevpath = kController + "/1-1/1-1.3";
+    converter.ttyDevpath = converter.usbDevpath + "/1-1.3:1.0/ttyUSB0/tty/ttyUSB0";
+    sysfs.addUsbDevice(converter.usbDevpath, kBoardVid, kBoardPid, "WT00002", "Boogie Board Sync");
+    sysfs.addTty(converter.ttyDevpath);
+
+    // Two serial interfaces on one device
+    addAcmBoard(sysfs, kController, "1-4", "WT00003", "ttyACM1");
+    sysfs.addTty(kController + "/1-4/1-4:1.2/tty/ttyACM2");
+
+    // No tty; a VID that is not 16-bit hex is ignored
+    sysfs.addUsbDevice(kController + "/1-5", 0x046d, 0xc52b, "", "Receiver");
+    sysfs.addUsbDevice(kController + "/1-6", 0x1234, 0x5678, "", "Odd");
+    test::writeFile(root + kController + "/1-6/idVendor", "12345");
+    sysfs.addTty("/devices/virtual/tty/tty0");
+    sysfs.addTty("/devices/platform/serial8250/tty/ttyS0");
+    CHECK(sysfs.ok());
+
+    DiscoveryOptions options;
+    options.sysfsRoot = root;
+    options.watchUevents = false;
+    DeviceDiscovery discovery(options);
+    CHECK_EQ(discovery.deviceCount(), 6u);
+    CHECK_EQ(discovery.serialPortCount(), 4u);
+
+    // Matching: lowest sysfs name without a serial number, then by serial and interface
+    DiscoveredDevice device;
+    CHECK(findPort(discovery, "", -1, device));
+    CHECK(device.usbName == "1-1.3");
+    CHECK(device.devicePath == "/dev/ttyUSB0");
+    CHECK(device.serial == "WT00002");
+    CHECK(device.product == "Boogie Board Sync");
+    CHECK_EQ(device.vid, kBoardVid);
+    CHECK_EQ(device.interfaceNumber, 0);
+
+    CHECK(findPort(discovery, "WT00001", -1, device));
+    CHECK(device.devicePath == "/dev/ttyACM0");
+    CHECK(findPort(discovery, "WT00003", -1, device));
+    CHECK(device.ttyName == "ttyACM1");
+    CHECK(findPort(discovery, "WT00003", 2, device));
+    CHECK(device.ttyName == "ttyACM2");
+    CHECK_EQ(device.interfaceNumber, 2);
+    CHECK(!findPort(discovery, "WT00003", 1, device));
+    CHECK(!findPort(discovery, "WT99999", -1, device));
+    CHECK(discovery.getLastError() == "No serial port found for USB device 2914:0100 with serial number WT99999");
+
+    DeviceMatch other;
+    other.vid = 0x046d;
+    other.pid = 0xc52b;
+    CHECK(!discovery.findSerialPort(other, device));
+
+    std::vector<DiscoveredDevice> list = discovery.devices();
+    CHECK_EQ(list.size(), 7u);
+    if (list.size() == 7) {
+        CHECK(list[0].ttyName == "ttyUSB0");
+        CHECK(list[1].ttyName == "ttyACM0");
+        CHECK(list[3].ttyName == "ttyACM2");
+        CHECK(list[4].usbName == "1-1");
+        CHECK(list[6].usbName == "usb1");
+        CHECK(list[6].devicePath.empty());
+    }
+
+    // Hot-add: device first, then its tty
+    Port added = addAcmBoard(sysfs, kController, "1-7", "WT00004", "ttyACM3");
+    CHECK(sysfs.ok());
+    CHECK(deliver(discovery, test::uevent("add", added.usbDevpath, "usb", "usb_device", "")));
+    CHECK_EQ(discovery.deviceCount(), 7u);
+    CHECK(deliver(discovery, test::uevent("add", added.ttyDevpath, "tty", "", "ttyACM3")));
+    CHECK_EQ(discovery.serialPortCount(), 5u);
+    CHECK(findPort(discovery, "WT00004", -1, device));
+    CHECK(device.devicePath == "/dev/ttyACM3");
+    CHECK(device.usbName == "1-7");
+
+    // Uevents for devices that are not USB devices or serial ports change nothing
+    CHECK(!deliver(discovery, test::uevent("add", "/devices/virtual/tty/tty1", "tty", "", "tty1")));
+    CHECK(!deliver(discovery, test::uevent("add", kController + "/1-7/1-7:1.0", "usb", "usb_interface", "")));
+    CHECK_EQ(discovery.serialPortCount(), 5u);
+
+    // Removal: tty then device, as the kernel sends them
+    sysfs.removeLink(converter.ttyDevpath, true);
+    sysfs.removeLink(converter.usbDevpath, false);
+    CHECK(sysfs.ok());
+    CHECK(deliver(discovery, test::uevent("remove", converter.ttyDevpath, "tty", "", "ttyUSB0")));
+    CHECK(deliver(discovery, test::uevent("remove", converter.usbDevpath, "usb", "usb_device", "")));
+    CHECK_EQ(discovery.deviceCount(), 6u);
+    CHECK_EQ(discovery.serialPortCount(), 4u);
+    CHECK(!findPort(discovery, "WT00002", -1, device));
+    CHECK(findPort(discovery, "", -1, device));
+    CHECK(device.devicePath == "/dev/ttyACM0");  // Next lowest sysfs name
+
+    // Removing a device alone also drops its ttys
+    sysfs.removeLink(acm.ttyDevpath, true);
+    sysfs.removeLink(acm.usbDevpath, false);
+    CHECK(deliver(discovery, test::uevent("remove", acm.usbDevpath, "usb", "usb_device", "")));
+    CHECK_EQ(discovery.serialPortCount(), 3u);
+    CHECK(!findPort(discovery, "WT00001", -1, device));
+    CHECK(!deliver(discovery, test::uevent("remove", acm.usbDevpath, "usb", "usb_device", "")));
+}
+
+} // namespace
+
+int main()
+{
+    char directory[] = "/tmp/test_discovery_XXXXXX";
+    if (!mkdtemp(directory)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    testDiscovery(directory);
+    std::string command = "rm -rf '" + std::string(directory) + "'";
+    if (std::system(command.c_str()) != 0) {
+        std::fprintf(stderr, "could not remove %s\n", directory);
+    }
+    return test::testResult("test_device_discovery");
+}
@@ -0,0 +1,174 @@
+/**
+ * @file test_frame_decoder.cpp
+ * @brief FrameDecoder: chunked decoding and recovery from corrupt frames
+ */
+
+#include "../include/FrameDecoder.h"
+#include "TestSupport.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+StylusEvent makeEvent(uint16_t i)
+{
+    // Coordinates stay below 0xA5 in both bytes so no payload byte looks like a sync byte
+    StylusEvent event = {};
+    event.x = static_cast<uint16_t>((i % 100) | ((i / 100 % 100) << 8));
+    event.y = static_cast<uint16_t>(i % 50);
+    event.pressure = 7;
+    event.flags = STYLUS_TIP_DOWN;
+    event.sequence = static_cast<uint8_t>(i % 100);
+    return event;
+}
+
+void appendPen(std::vector<uint8_t>& bytes, uint16_t i)
+{
+    uint8_t frame[PEN_FRAME_SIZE];
+    size_t n = encodePenFrame(makeEvent(i), frame);
+    bytes.insert(bytes.end(), frame, frame + n);
+}
+
+/**
+ * @brief Decode chunks in order and return every event
+ */
+std::vector<StylusEvent> decodeChunks(FrameDecoder& decoder, const std::vector<std::vector<uint8_t>>& chunks)
+{
+    std::vector<StylusEvent> out;
+    StylusEvent events[64];
+    for (const std::vector<uint8_t>& chunk : chunks) {
+        size_t offset = 0;
+        while (offset < chunk.size()) {
+            size_t produced = 0;
+            offset += decoder.decode(chunk.data() + offset, chunk.size() - offset, 0, events, 64, produced);
+            out.insert(out.end(), events, events + produced);
+        }
+    }
+    return out;
+}
+
+void checkEvents(const std::vector<StylusEvent>& events, uint16_t first, uint16_t count)
+{
+    CHECK_EQ(events.size(), count);
+    for (size_t i = 0; i < events.size() && i < count; ++i) {
+        StylusEvent expected = makeEvent(static_cast<uint16_t>(first + i));
+        CHECK_EQ(events[i].x, expected.x);
+        CHECK_EQ(events[i].sequence, expected.sequence);
+    }
+}
+
+void testSplitFrames()
+{
+    std::vector<uint8_t> stream;
+    for (uint16_t i = 0; i < 40; ++i) {
+        appendPen(stream, i);
+    }
+    // Every chunk boundary position, including one byte at a time
+    for (size_t chunkSize = 1; chunkSize <= PEN_FRAME_SIZE + 1; ++chunkSize) {
+        std::vector<std::vector<uint8_t>> chunks;
+        for (size_t offset = 0; offset < stream.size(); offset += chunkSize) {
+            size_t end = offset + chunkSize < stream.size() ? offset + chunkSize : stream.size();
+            chunks.emplace_back(stream.begin() + static_cast<std::ptrdiff_t>(offset),
+                                stream.begin() + static_cast<std::ptrdiff_t>(end));
+        }
+        FrameDecoder decoder;
+        checkEvents(decodeChunks(decoder, chunks), 0, 40);
+        CHECK_EQ(decoder.stats().checksumErrors, 0u);
+    }
+}
+
+/**
+ * @brief A corrupt long frame ends a chunk, so its length pulls valid pen
+ *        frames that follow into the partial buffer; all of them must come out
+ */
+void testCorruptLongFrameBeforePenFrames()
+{
+    std::vector<uint8_t> corrupt = {FRAME_SYNC, 0x10, 0x00, 200};
+    std::vector<uint8_t> valid;
+    for (uint16_t i = 0; i < 30; ++i) {
+        appendPen(valid, i);
+    }
+
+    FrameDecoder decoder;
+    std::vector<StylusEvent> events = decodeChunks(decoder, {corrupt, valid});
+    checkEvents(events, 0, 30);
+    CHECK_EQ(decoder.stats().checksumErrors, 1u);
+    CHECK_EQ(decoder.stats().skippedBytes, corrupt.size() - 1);
+    CHECK_EQ(decoder.pendingBytes(), 0u);
+
+    // The same stream one byte at a time
+    std::vector<uint8_t> stream = corrupt;
+    stream.insert(stream.end(), valid.begin(), valid.end());
+    std::vector<std::vector<uint8_t>> bytes;
+    for (uint8_t byte : stream) {
+        bytes.push_back({byte});
+    }
+    FrameDecoder byteDecoder;
+    checkEvents(decodeChunks(byteDecoder, bytes), 0, 30);
+    CHECK_EQ(byteDecoder.stats().checksumErrors, 1u);
+}
+
+/**
+ * @brief A corrupted non-pen frame in the middle of the stream, then more pen frames
+ */
+void testCorruptReplyBetweenPenFrames()
+{
+    std::vector<uint8_t> stream;
+    for (uint16_t i = 0; i < 5; ++i) {
+        appendPen(stream, i);
+    }
+    uint8_t payload[100] = {};
+    uint8_t reply[FRAME_OVERHEAD + 100];
+    size_t n = encodeFrame(0x22, 1, payload, 100, reply);
+    reply[n - 1] ^= 0xFF;  // Break the checksum
+    std::vector<uint8_t> head(stream);
+    head.insert(head.end(), reply, reply + 10);  // The reply's header ends the first chunk
+    std::vector<uint8_t> tail;
+    for (uint16_t i = 5; i < 40; ++i) {
+        appendPen(tail, i);
+    }
+
+    FrameDecoder decoder;
+    size_t replies = 0;
+    decoder.setFrameHandler([&replies](const FrameView&) { ++replies; });
+    std::vector<StylusEvent> events = decodeChunks(decoder, {head, tail});
+    checkEvents(events, 0, 40);
+    CHECK_EQ(replies, 0u);
+    CHECK(decoder.stats().checksumErrors >= 1);
+}
+
+/**
+ * @brief Events that do not fit stay queued in the partial buffer for the next call
+ */
+void testOutputCapacity()
+{
+    std::vector<uint8_t> corrupt = {FRAME_SYNC, 0x10, 0x00, 100};
+    std::vector<uint8_t> valid;
+    for (uint16_t i = 0; i < 12; ++i) {
+        appendPen(valid, i);
+    }
+
+    FrameDecoder decoder;
+    StylusEvent events[2];
+    std::vector<StylusEvent> out;
+    size_t produced = 0;
+    decoder.decode(corrupt.data(), corrupt.size(), 0, events, 2, produced);
+    size_t offset = 0;
+    for (int guard = 0; guard < 100 && (offset < valid.size() || produced > 0); ++guard) {
+        offset += decoder.decode(valid.data() + offset, valid.size() - offset, 0, events, 2, produced);
+        out.insert(out.end(), events, events + produced);
+    }
+    checkEvents(out, 0, 12);
+}
+
+} // namespace
+
+int main()
+{
+    testSplitFrames();
+    testCorruptLongFrameBeforePenFrames();
+    testCorruptReplyBetweenPenFrames();
+    testOutputCapacity();
+    return test::testResult("test_frame_decoder");
+}
@@ -0,0 +1,445 @@
+/**
+ * @file test_usb_bulk_engine.cpp
+ * @brief UsbBulkEngine against a fake UsbBackend: submit, complete, cancel
+ *
+ * The fake keeps submitted transfers in a queue. The test queues
+ * completions; the engine's event thread picks them up in handleEvents()
+ * the way libusb would run transfer callbacks.
+ */
+
+#include "../include/UsbBulkEngine.h"
+#include "TestSupport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const int kErrorNotFound = -5;
+const int kErrorIo = -1;
+
+struct FakeUsb {
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool devicePresent = true;
+    int failSubmitNumber = -1;          // Fail the Nth submit (counting from 0)
+    size_t maxWriteChunk = 3;           // bulkWrite transfers at most this many bytes per call
+    size_t writeFailAfter = SIZE_MAX;   // bulkWrite fails once this many bytes are written
+
+    int contexts = 0;
+    int devicesOpen = 0;
+    int interfacesClaimed = 0;
+    int transfersPrepared = 0;
+    int submits = 0;
+    int cancelled = 0;
+    bool interrupted = false;
+    std::deque<UsbTransfer*> pending;                   // Submitted, not yet completed
+    std::vector<UsbTransfer*> cancelRequests;
+    std::deque<std::pair<UsbTransferStatus, std::vector<uint8_t>>> completions;
+    std::vector<uint8_t> written;
+
+    void complete(UsbTransferStatus status, std::vector<uint8_t> data = {})
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        completions.emplace_back(status, std::move(data));
+        wake.notify_all();
+    }
+
+    size_t pendingCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pending.size();
+    }
+
+    bool completionsConsumed()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return completions.empty();
+    }
+};
+
+FakeUsb* g_fake = nullptr;
+int g_contextToken;
+int g_deviceToken;
+
+int fakeInit(void** context)
+{
+    std::lock_guard<std::mutex> lock(g_fake->mutex);
+    ++g_fake->contexts;
+    *context = &g_contextToken;
+    return 0;
+}
+
+void fakeExit(void*)
+{
+    std::lock_guard<std::mutex> lock(g_fake->mutex);
+    --g_fake->contexts;
+}
+
+void* fakeOpenDevice(void*, uint16_t vid, uint16_t pid)
+{
+    std::lock_guard<std::mutex> lock(g_fake->mutex);
+    if (!g_fake->devicePresent || vid != 0x1234 || pid != 0x5678) {
+        return nullptr;
+    }
+    ++g_fake->devicesOpen;
+    return &g_deviceToken;
+}
+
+void fakeCloseDevice(void*)
+{
+    std::lock_guard<std::mutex> lock(g_fake->mutex);
+    --g_fake->devicesOpen;
+}
+
+int fakeClaimInterface(void*, int)
+{
+    std::lock_guard<std::mutex> lock(g_fake->mutex);
+    ++g_fake->interfacesClaimed;
+    return 0;
+}
+
+void fakeReleaseInterface(void*, int)
+{
+    std::lock_guard<std::mutex> lock(g_fake->mutex);
+    --g_fake->interfacesClaimed;
+}
+
+int fakeFindBulkEndpoints(void*, int, uint8_t* inEndpoint, uint8_t* outEndpoint)
+{
+    *inEndpoint = 0x81;
+    *outEndpoint = 0x02;
+    return 0;
+}
+
+int fakePrepareTransfer(void*, UsbTransfer* transfer)
+{
+    std::lock_guard<std::mutex> lock(g_fake->mutex);
+    ++g_fake->transfersPrepared;
+    transfer->backendData = &g_deviceToken;
+    return 0;
+}
+
+void fakeReleaseTransfer(UsbTransfer* transfer)
+{
+    std::lock_guard<std::mutex> lock(g_fake->mutex);
+    --g_fake->transfersPrepared;
+    transfer->backendData = nullptr;
+}
+
+int fakeSubmitTransfer(UsbTransfer* transfer)
+{
+    std::lock_guard<std::mutex> lock(g_fake->mutex);
+    if (g_fake->submits++ == g_fake->failSubmitNumber) {
+        return kErrorIo;
+    }
+    g_fake->pending.push_back(transfer);
+    g_fake->wake.notify_all();
+    return 0;
+}
+
+int fakeCancelTransfer(UsbTransfer* transfer)
+{
+    std::lock_guard<std::mutex> lock(g_fake->mutex);
+    if (std::find(g_fake->pending.begin(), g_fake->pending.end(), transfer) == g_fake->pending.end() ||
+        std::find(g_fake->cancelRequests.begin(), g_fake->cancelRequests.end(), transfer) !=
+            g_fake->cancelRequests.end()) {
+        return kErrorNotFound;
+    }
+    g_fake->cancelRequests.push_back(transfer);
+    g_fake->wake.notify_all();
+    return 0;
+}
+
+/**
+ * @brief Deliver queued cancellations and completions, callbacks outside the lock
+ */
+int fakeHandleEvents(void*, int timeoutMs)
+{
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::unique_lock<std::mutex> lock(g_fake->mutex);
+        g_fake->wake.wait_for(lock, std::chrono::milliseconds(timeoutMs), [] {
+            return g_fake->interrupted || !g_fake->cancelRequests.empty() ||
+                   (!g_fake->completions.empty() && !g_fake->pending.empty());
+        });
+        g_fake->interrupted = false;
+
+        for (UsbTransfer* transfer : g_fake->cancelRequests) {
+            g_fake->pending.erase(std::find(g_fake->pending.begin(), g_fake->pending.end(), transfer));
+            ++g_fake->cancelled;
+            callbacks.push_back([transfer] {
+                transfer->callback(transfer, UsbTransferStatus::CANCELLED, 0);
+            });
+        }
+        g_fake->cancelRequests.clear();
+
+        while (!g_fake->completions.empty() && !g_fake->pending.empty()) {
+            UsbTransfer* transfer = g_fake->pending.front();
+            g_fake->pending.pop_front();
+            UsbTransferStatus status = g_fake->completions.front().first;
+            std::vector<uint8_t> data = std::move(g_fake->completions.front().second);
+            g_fake->completions.pop_front();
+            size_t length = std::min(data.size(), transfer->length);
+            std::memcpy(transfer->buffer, data.data(), length);
+            callbacks.push_back([transfer, status, length] {
+                transfer->callback(transfer, status, length);
+            });
+        }
+    }
+    for (std::function<void()>& callback : callbacks) {
+        callback();
+    }
+    return 0;
+}
+
+void fakeInterruptEvents(void*)
+{
+    std::lock_guard<std::mutex> lock(g_fake->mutex);
+    g_fake->interrupted = true;
+    g_fake->wake.notify_all();
+}
+
+int fakeBulkWrite(void*, uint8_t endpoint, const uint8_t* data, size_t length, size_t* transferred,
+                  unsigned int)
+{
+    std::lock_guard<std::mutex> lock(g_fake->mutex);
+    if (endpoint != 0x02) {
+        return kErrorIo;
+    }
+    if (g_fake->written.size() >= g_fake->writeFailAfter) {
+        return kErrorIo;
+    }
+    *transferred = std::min({length, g_fake->maxWriteChunk, g_fake->writeFailAfter - g_fake->written.size()});
+    g_fake->written.insert(g_fake->written.end(), data, data + *transferred);
+    return 0;
+}
+
+const char* fakeErrorName(int error)
+{
+    return error == kErrorNotFound ? "NOT_FOUND" : "IO";
+}
+
+const UsbBackend kFakeBackend = {
+    fakeInit, fakeExit, fakeOpenDevice, fakeCloseDevice, fakeClaimInterface, fakeReleaseInterface,
+    fakeFindBulkEndpoints, fakePrepareTransfer, fakeReleaseTransfer, fakeSubmitTransfer, fakeCancelTransfer,
+    fakeHandleEvents, fakeInterruptEvents, fakeBulkWrite, fakeErrorName
+};
+
+template <typename Predicate>
+bool waitUntil(Predicate predicate)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+std::chrono::steady_clock::time_point after(int ms)
+{
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+}
+
+void checkReleased(FakeUsb& fake)
+{
+    CHECK_EQ(fake.contexts, 0);
+    CHECK_EQ(fake.devicesOpen, 0);
+    CHECK_EQ(fake.interfacesClaimed, 0);
+    CHECK_EQ(fake.transfersPrepared, 0);
+    CHECK_EQ(fake.pending.size(), 0u);
+}
+
+/**
+ * @brief Transfers stay submitted, completed data reaches read() in order, close() cancels all
+ */
+void testStreamAndClose()
+{
+    FakeUsb fake;
+    g_fake = &fake;
+    UsbBulkEngine engine(kFakeBackend);
+    UsbBulkOptions options;
+    options.transferSize = 8;
+    options.transfersInFlight = 4;
+    CHECK(engine.open(0x1234, 0x5678, options));
+    CHECK(engine.isOpen());
+    CHECK_EQ(fake.pendingCount(), 4u);
+
+    fake.complete(UsbTransferStatus::COMPLETED, {1, 2, 3});
+    fake.complete(UsbTransferStatus::TIMED_OUT);
+    fake.complete(UsbTransferStatus::COMPLETED, {4, 5, 6, 7, 8, 9, 10, 11});
+    uint8_t buffer[32];
+    size_t n = engine.read(buffer, sizeof(buffer), 11, after(2000));
+    CHECK_EQ(n, 11u);
+    for (size_t i = 0; i < n; ++i) {
+        CHECK_EQ(buffer[i], i + 1);
+    }
+    // Completed and timed-out transfers were resubmitted
+    CHECK(waitUntil([&fake] { return fake.completionsConsumed() && fake.pendingCount() == 4; }));
+    CHECK_EQ(fake.submits, 7);
+
+    // Nothing arrives: read() returns at the deadline
+    auto start = std::chrono::steady_clock::now();
+    CHECK_EQ(engine.read(buffer, sizeof(buffer), 1, after(30)), 0u);
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(1000));
+
+    const uint8_t command[7] = {10, 11, 12, 13, 14, 15, 16};
+    CHECK(engine.write(command, sizeof(command), 100));
+    CHECK_EQ(fake.written.size(), sizeof(command));
+    CHECK(std::equal(command, command + sizeof(command), fake.written.begin()));
+
+    engine.close();
+    CHECK(!engine.isOpen());
+    CHECK(!engine.hasFailed());
+    CHECK_EQ(fake.cancelled, 4);
+    checkReleased(fake);
+    CHECK(!engine.write(command, 1, 100));
+}
+
+/**
+ * @brief A full ring drops bytes and counts them; transfers keep streaming
+ */
+void testRingOverflow()
+{
+    FakeUsb fake;
+    g_fake = &fake;
+    UsbBulkEngine engine(kFakeBackend);
+    UsbBulkOptions options;
+    options.transferSize = 8;
+    options.transfersInFlight = 2;
+    options.ringCapacity = 16;
+    CHECK(engine.open(0x1234, 0x5678, options));
+
+    for (int i = 0; i < 3; ++i) {
+        fake.complete(UsbTransferStatus::COMPLETED, std::vector<uint8_t>(8, static_cast<uint8_t>(i)));
+    }
+    CHECK(waitUntil([&fake] { return fake.completionsConsumed() && fake.pendingCount() == 2; }));
+    CHECK(engine.droppedBytes() >= 8);
+    uint8_t buffer[32];
+    size_t n = engine.read(buffer, sizeof(buffer), 1, after(100));
+    CHECK_EQ(n + engine.droppedBytes(), 24u);
+    CHECK(!engine.hasFailed());
+    engine.close();
+    checkReleased(fake);
+}
+
+/**
+ * @brief The device disappearing fails the engine and wakes a blocked reader
+ */
+void testDeviceGone()
+{
+    FakeUsb fake;
+    g_fake = &fake;
+    UsbBulkEngine engine(kFakeBackend);
+    UsbBulkOptions options;
+    options.transfersInFlight = 2;
+    CHECK(engine.open(0x1234, 0x5678, options));
+
+    std::thread unplug([&fake] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        fake.complete(UsbTransferStatus::NO_DEVICE);
+    });
+    uint8_t buffer[16];
+    auto start = std::chrono::steady_clock::now();
+    CHECK_EQ(engine.read(buffer, sizeof(buffer), 1, after(5000)), 0u);
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(2000));
+    unplug.join();
+    CHECK(engine.hasFailed());
+    CHECK(engine.getLastError() == "USB device disconnected");
+    CHECK_EQ(fake.pendingCount(), 1u);  // Not resubmitted
+
+    engine.close();
+    CHECK_EQ(fake.cancelled, 1);
+    checkReleased(fake);
+}
+
+/**
+ * @brief A write that stops moving bytes fails and reports how far it got
+ */
+void testWriteFailures()
+{
+    FakeUsb fake;
+    g_fake = &fake;
+    UsbBulkEngine engine(kFakeBackend);
+    CHECK(engine.open(0x1234, 0x5678));
+    const uint8_t command[7] = {10, 11, 12, 13, 14, 15, 16};
+
+    // Success without progress: fail at once instead of retrying forever
+    fake.maxWriteChunk = 0;
+    size_t written = 99;
+    auto start = std::chrono::steady_clock::now();
+    CHECK(!engine.write(command, sizeof(command), 1000, &written));
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500));
+    CHECK_EQ(written, 0u);
+    CHECK(engine.getLastError() == "USB bulk write made no progress");
+
+    // An error after a few short transfers still counts what went out
+    fake.maxWriteChunk = 3;
+    fake.writeFailAfter = 5;
+    CHECK(!engine.write(command, sizeof(command), 1000, &written));
+    CHECK_EQ(written, 5u);
+    CHECK_EQ(fake.written.size(), 5u);
+    CHECK(engine.getLastError() == "USB bulk write failed: IO");
+
+    engine.close();
+    checkReleased(fake);
+}
+
+/**
+ * @brief Failures while opening release everything acquired so far
+ */
+void testOpenFailures()
+{
+    FakeUsb fake;
+    g_fake = &fake;
+    {
+        UsbBulkEngine engine(kFakeBackend);
+        CHECK(!engine.open(0x1234, 0x9999));
+        CHECK(engine.getLastError().find("not found") != std::string::npos);
+        CHECK(!engine.isOpen());
+        checkReleased(fake);
+    }
+    {
+        // The third submit fails: the two already submitted are cancelled
+        // without an event thread
+        UsbBulkEngine engine(kFakeBackend);
+        UsbBulkOptions options;
+        options.transfersInFlight = 4;
+        fake.failSubmitNumber = 2;
+        CHECK(!engine.open(0x1234, 0x5678, options));
+        CHECK(engine.getLastError() == "Failed to submit USB transfer: IO");
+        CHECK_EQ(fake.cancelled, 2);
+        checkReleased(fake);
+    }
+    {
+        UsbBulkEngine engine(kFakeBackend);
+        UsbBulkOptions options;
+        options.transferSize = 0;
+        CHECK(!engine.open(0x1234, 0x5678, options));
+        CHECK_EQ(fake.contexts, 0);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    testStreamAndClose();
+    testRingOverflow();
+    testDeviceGone();
+    testWriteFailures();
+    testOpenFailures();
+    return test::testResult("test_usb_bulk_engine");
+}
@@ -0,0 +1,115 @@
+/**
+ * @file wt13106_devices.cpp
+ * @brief List USB devices and their serial ports (Linux)
+ *
+ * Usage: wt13106_devices [--vid VID] [--pid PID] [--all] [--watch] [--sysfs DIR]
+ *   --vid, --pid  only devices with this vendor/product ID (hexadecimal)
+ *   --all         include devices without a serial port
+ *   --watch       keep running and print the list again whenever it changes
+ *   --sysfs       read another sysfs tree (for testing)
+ *
+ * Each line shows the connection string that opens the port, e.g.
+ *   USB:1234:5678:A1B2C3  /dev/ttyACM0  if 0  1-1.4  Improv Electronics Boogie Board
+ * The Linux counterpart of find_usb_device.ps1.
+ */
+
+#include "../include/DeviceDiscovery.h"
+
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <poll.h>
+
+namespace {
+
+std::atomic<bool> g_interrupted(false);
+
+void onSignal(int)
+{
+    g_interrupted = true;
+}
+
+void printDevices(DeviceDiscovery& discovery, int vid, int pid, bool all)
+{
+    size_t shown = 0;
+    for (const DiscoveredDevice& device : discovery.devices()) {
+        if ((vid >= 0 && device.vid != vid) || (pid >= 0 && device.pid != pid) ||
+            (!all && device.devicePath.empty())) {
+            continue;
+        }
+        char id[16];
+        std::snprintf(id, sizeof(id), "%04x:%04x", device.vid, device.pid);
+        std::string connection = std::string("USB:") + id + (device.serial.empty() ? "" : ":" + device.serial);
+        std::string name = device.manufacturer + (device.manufacturer.empty() ? "" : " ") + device.product;
+        if (device.devicePath.empty()) {
+            std::printf("%-32s  %-14s  %-5s  %-10s  %s\n", connection.c_str(), "-", "", device.usbName.c_str(),
+                        name.c_str());
+        } else {
+            std::printf("%-32s  %-14s  if %-2d  %-10s  %s\n", connection.c_str(), device.devicePath.c_str(),
+                        device.interfaceNumber, device.usbName.c_str(), name.c_str());
+        }
+        ++shown;
+    }
+    if (shown == 0) {
+        std::printf("No %s found\n", all ? "USB devices" : "USB serial ports");
+    }
+    std::fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    int vid = -1;
+    int pid = -1;
+    bool all = false;
+    bool watch = false;
+    DiscoveryOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--vid" && i + 1 < argc) {
+            vid = static_cast<int>(std::strtol(argv[++i], nullptr, 16));
+        } else if (arg == "--pid" && i + 1 < argc) {
+            pid = static_cast<int>(std::strtol(argv[++i], nullptr, 16));
+        } else if (arg == "--all") {
+            all = true;
+        } else if (arg == "--watch") {
+            watch = true;
+        } else if (arg == "--sysfs" && i + 1 < argc) {
+            options.sysfsRoot = argv[++i];
+            options.watchUevents = false;
+        } else {
+            std::fprintf(stderr, "Usage: %s [--vid VID] [--pid PID] [--all] [--watch] [--sysfs DIR]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    DeviceDiscovery discovery(options);
+    std::string error = discovery.getLastError();
+    if (!error.empty()) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    printDevices(discovery, vid, pid, all);
+    if (!watch) {
+        return 0;
+    }
+    if (discovery.getNativeHandle() < 0) {
+        std::fprintf(stderr, "Cannot follow hotplug: the kernel uevent socket is unavailable\n");
+        return 1;
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    while (!g_interrupted) {
+        struct pollfd fd = {discovery.getNativeHandle(), POLLIN, 0};
+        if (::poll(&fd, 1, 500) > 0 && discovery.poll() > 0) {
+            std::printf("\n");
+            printDevices(discovery, vid, pid, all);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file wt13106_events.cpp
+ * @brief Export a connection's pen events to shared memory, and watch an export
+ *
+ * Usage:
+ *   wt13106_events export <connection string> <name> [--capacity N] [--seconds S]
+ *   wt13106_events watch <name> [--seconds S]
+ *
+ * "export" owns the port and publishes decoded events into /dev/shm/<name>
+ * until interrupted. "watch" maps that ring read-only, as a renderer or
+ * archiver process would, and prints the event rate once a second.
+ */
+
+#include "../include/SharedEventRing.h"
+#include "../include/WT13106Connection.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::atomic<bool> g_interrupted(false);
+
+void onSignal(int)
+{
+    g_interrupted = true;
+}
+
+void usage(const char* program)
+{
+    std::fprintf(stderr,
+                 "Usage: %s export <connection string> <name> [--capacity N] [--seconds S]\n"
+                 "       %s watch <name> [--seconds S]\n", program, program);
+}
+
+bool expired(std::chrono::steady_clock::time_point start, double seconds)
+{
+    return seconds > 0 && std::chrono::steady_clock::now() - start >= std::chrono::duration<double>(seconds);
+}
+
+int exportEvents(const std::string& connectionString, const std::string& name, size_t capacity, double seconds)
+{
+    SharedEventWriter writer;
+    if (!writer.create(name, capacity)) {
+        std::fprintf(stderr, "%s\n", writer.getLastError().c_str());
+        return 1;
+    }
+
+    WT13106Connection connection(connectionString);
+    if (!connection.connect() || !connection.startSharedExport(writer)) {
+        std::fprintf(stderr, "%s: %s\n", connectionString.c_str(), connection.getLastError().c_str());
+        return 1;
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    std::printf("Exporting %s to /dev/shm%s, Ctrl+C to stop\n", connectionString.c_str(), writer.name().c_str());
+    std::fflush(stdout);
+
+    auto start = std::chrono::steady_clock::now();
+    while (!g_interrupted && connection.isStreaming() && !expired(start, seconds)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    connection.stopStreaming();
+    connection.disconnect();
+    std::printf("%llu events published\n", static_cast<unsigned long long>(writer.published()));
+    writer.close();
+    return 0;
+}
+
+int watch(const std::string& name, double seconds)
+{
+    SharedEventReader reader;
+    if (!reader.open(name)) {
+        std::fprintf(stderr, "%s\n", reader.getLastError().c_str());
+        return 1;
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    StylusEvent events[1024];
+    StylusEvent last = {};
+    uint64_t received = 0;
+    uint64_t lost = 0;
+    uint64_t windowReceived = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto windowStart = start;
+    while (!g_interrupted && !expired(start, seconds)) {
+        size_t count = reader.readWait(events, 1024, lost, 100);
+        if (count > 0) {
+            last = events[count - 1];
+            received += count;
+            windowReceived += count;
+        } else if (reader.writerGone() && reader.lag() == 0) {
+            std::printf("writer closed\n");
+            break;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        double window = std::chrono::duration<double>(now - windowStart).count();
+        if (window >= 1.0) {
+            std::printf("%8.0f events/s  lost %llu  last x=%u y=%u p=%u%s\n", windowReceived / window,
+                        static_cast<unsigned long long>(lost), last.x, last.y, last.pressure,
+                        (last.flags & STYLUS_TIP_DOWN) ? " down" : "");
+            std::fflush(stdout);
+            windowStart = now;
+            windowReceived = 0;
+        }
+    }
+    std::printf("%llu events read, %llu lost\n", static_cast<unsigned long long>(received),
+                static_cast<unsigned long long>(lost));
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string command = argv[1];
+    size_t capacity = 65536;
+    double seconds = 0;
+    int first = command == "export" ? 4 : 3;
+    if (first > argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    for (int i = first; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--seconds" && i + 1 < argc) {
+            seconds = std::atof(argv[++i]);
+        } else if (arg == "--capacity" && i + 1 < argc && command == "export") {
+            capacity = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (command == "export") {
+        return exportEvents(argv[2], argv[3], capacity, seconds);
+    }
+    if (command == "watch") {
+        return watch(argv[2], seconds);
+    }
+    usage(argv[0]);
+    return 1;
+}
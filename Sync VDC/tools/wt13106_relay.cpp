@@ -0,0 +1,182 @@
+/**
+ * @file wt13106_relay.cpp
+ * @brief Serve a connection's pen events to local clients, and watch a relay
+ *
+ * Usage:
+ *   wt13106_relay serve <connection string> [--unix PATH] [--tcp PORT] [--queue BYTES] [--seconds S]
+ *   wt13106_relay watch <PATH | tcp:PORT> [--seconds S]
+ *
+ * "serve" owns the port and relays decoded events to every client of the
+ * Unix socket (default /tmp/wt13106.sock) and/or, with --tcp, of
+ * 127.0.0.1:PORT until interrupted, printing its counters once a second.
+ * --tcp without --unix serves TCP only.
+ * "watch" subscribes like a renderer or recorder would and prints the
+ * event rate once a second.
+ */
+
+#include "../include/StreamRelay.h"
+#include "../include/WT13106Connection.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::atomic<bool> g_interrupted(false);
+
+void onSignal(int)
+{
+    g_interrupted = true;
+}
+
+void usage(const char* program)
+{
+    std::fprintf(stderr,
+                 "Usage: %s serve <connection string> [--unix PATH] [--tcp PORT] [--queue BYTES] [--seconds S]\n"
+                 "       %s watch <PATH | tcp:PORT> [--seconds S]\n", program, program);
+}
+
+bool expired(std::chrono::steady_clock::time_point start, double seconds)
+{
+    return seconds > 0 && std::chrono::steady_clock::now() - start >= std::chrono::duration<double>(seconds);
+}
+
+int serve(const std::string& connectionString, const StreamRelayOptions& options, double seconds)
+{
+    WT13106Connection connection(connectionString);
+    if (!connection.connect()) {
+        std::fprintf(stderr, "%s: %s\n", connectionString.c_str(), connection.getLastError().c_str());
+        return 1;
+    }
+    StreamRelay relay(options);
+    if (!relay.start(connection)) {
+        std::fprintf(stderr, "%s\n", relay.getLastError().c_str());
+        return 1;
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    std::signal(SIGPIPE, SIG_IGN);
+    std::printf("Relaying %s on %s", connectionString.c_str(), options.unixPath.c_str());
+    if (relay.tcpPort() >= 0) {
+        std::printf("%stcp:%d", options.unixPath.empty() ? "" : " and ", relay.tcpPort());
+    }
+    std::printf(", Ctrl+C to stop\n");
+    std::fflush(stdout);
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t lastEvents = 0;
+    while (!g_interrupted && connection.isStreaming() && !expired(start, seconds)) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        StreamRelayStats stats = relay.getStats();
+        std::printf("%4llu clients  %8llu events/s  %llu writes  lost %llu (queues) %llu (relay)\n",
+                    static_cast<unsigned long long>(stats.clients),
+                    static_cast<unsigned long long>(stats.eventsIn - lastEvents),
+                    static_cast<unsigned long long>(stats.writeCalls),
+                    static_cast<unsigned long long>(stats.eventsLost),
+                    static_cast<unsigned long long>(stats.batchesDropped));
+        std::fflush(stdout);
+        lastEvents = stats.eventsIn;
+    }
+    relay.stop();
+    connection.disconnect();
+    std::printf("%llu events relayed to %llu clients\n",
+                static_cast<unsigned long long>(relay.getStats().eventsIn),
+                static_cast<unsigned long long>(relay.getStats().clientsServed));
+    return 0;
+}
+
+int watch(const std::string& address, double seconds)
+{
+    RelayClient client;
+    if (!client.connect(address)) {
+        std::fprintf(stderr, "%s\n", client.getLastError().c_str());
+        return 1;
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    StylusEvent events[1024];
+    StylusEvent last = {};
+    uint64_t received = 0;
+    uint64_t lost = 0;
+    uint64_t windowReceived = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto windowStart = start;
+    while (!g_interrupted && !expired(start, seconds)) {
+        size_t count = client.receive(events, 1024, lost, 100);
+        if (count > 0) {
+            last = events[count - 1];
+            received += count;
+            windowReceived += count;
+        } else if (!client.isConnected()) {
+            std::printf("%s\n", client.getLastError().c_str());
+            break;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        double window = std::chrono::duration<double>(now - windowStart).count();
+        if (window >= 1.0) {
+            std::printf("%8.0f events/s  lost %llu  last x=%u y=%u p=%u%s\n", windowReceived / window,
+                        static_cast<unsigned long long>(lost), last.x, last.y, last.pressure,
+                        (last.flags & STYLUS_TIP_DOWN) ? " down" : "");
+            std::fflush(stdout);
+            windowStart = now;
+            windowReceived = 0;
+        }
+    }
+    std::printf("%llu events received, %llu lost\n", static_cast<unsigned long long>(received),
+                static_cast<unsigned long long>(lost));
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string command = argv[1];
+    StreamRelayOptions options;
+    options.unixPath = "/tmp/wt13106.sock";
+    bool unixGiven = false;
+    double seconds = 0;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--seconds" && i + 1 < argc) {
+            seconds = std::atof(argv[++i]);
+        } else if (arg == "--unix" && i + 1 < argc && command == "serve") {
+            options.unixPath = argv[++i];
+            unixGiven = true;
+        } else if (arg == "--tcp" && i + 1 < argc && command == "serve") {
+            options.tcpPort = std::atoi(argv[++i]);
+        } else if (arg == "--queue" && i + 1 < argc && command == "serve") {
+            options.clientQueueBytes = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    // --tcp alone serves TCP only
+    if (options.tcpPort >= 0 && !unixGiven) {
+        options.unixPath.clear();
+    }
+
+    if (command == "serve") {
+        return serve(argv[2], options, seconds);
+    }
+    if (command == "watch") {
+        return watch(argv[2], seconds);
+    }
+    usage(argv[0]);
+    return 1;
+}
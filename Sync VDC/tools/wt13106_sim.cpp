@@ -0,0 +1,99 @@
+/**
+ * @file wt13106_sim.cpp
+ * @brief Stand-alone WT13106 board simulator on a pseudo-terminal
+ *
+ * Prints the pty path and streams synthetic pen frames until interrupted, so
+ * example_usage (or any client) can be pointed at it without a board.
+ *
+ * Usage: wt13106_sim [--rate HZ] [--frames-per-write N] [--pattern circle|scribble|counter] [--seconds S]
+ *   --rate 0 streams as fast as the client reads
+ */
+
+#include "../include/WT13106Simulator.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::atomic<bool> g_interrupted(false);
+
+void onSignal(int)
+{
+    g_interrupted = true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    SimulatorOptions options;
+    double seconds = 0;  // 0 = until interrupted
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--rate" && i + 1 < argc) {
+            options.sampleRateHz = std::atof(argv[++i]);
+        } else if (arg == "--frames-per-write" && i + 1 < argc) {
+            options.framesPerWrite = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--pattern" && i + 1 < argc) {
+            std::string pattern = argv[++i];
+            if (pattern == "circle") {
+                options.pattern = SimulatorPattern::CIRCLE;
+            } else if (pattern == "scribble") {
+                options.pattern = SimulatorPattern::SCRIBBLE;
+            } else if (pattern == "counter") {
+                options.pattern = SimulatorPattern::COUNTER;
+            } else {
+                std::fprintf(stderr, "Unknown pattern '%s'\n", pattern.c_str());
+                return 1;
+            }
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            seconds = std::atof(argv[++i]);
+        } else {
+            std::fprintf(stderr,
+                         "Usage: %s [--rate HZ] [--frames-per-write N] "
+                         "[--pattern circle|scribble|counter] [--seconds S]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    WT13106Simulator simulator;
+    if (!simulator.start(options)) {
+        std::fprintf(stderr, "Failed to start simulator: %s\n", simulator.getLastError().c_str());
+        return 1;
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    std::printf("Simulating WT13106 on %s\n", simulator.devicePath().c_str());
+    std::printf("Connect with: %s\n", simulator.connectionString().c_str());
+    std::fflush(stdout);
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t lastSent = 0;
+    while (!g_interrupted && simulator.isRunning()) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        uint64_t sent = simulator.framesSent();
+        std::printf("sent %llu frames/s, dropped %llu total, %llu commands answered\n",
+                    static_cast<unsigned long long>(sent - lastSent),
+                    static_cast<unsigned long long>(simulator.framesDropped()),
+                    static_cast<unsigned long long>(simulator.commandsAnswered()));
+        std::fflush(stdout);
+        lastSent = sent;
+
+        if (seconds > 0 &&
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= seconds) {
+            break;
+        }
+    }
+
+    simulator.stop();
+    return 0;
+}